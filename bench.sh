@@ -0,0 +1,102 @@
+#!/bin/bash
+
+# Run benchmark discs headless and tabulate the BENCH lines they print
+#
+# Each benchmark under tests/ builds one disc per variant into
+# build/<bench>/<variant>/test.ssd. Every variant is run under beebrun with
+# the clib ROM loaded, and the results are joined into one table with
+# cycles per call and cycles per byte for each variant, plus the ratio of
+# the last variant to the first. A benchmark whose Makefile sets RS423
+# gets that device plugged into beebrun's RS423 port.
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+cd "$SCRIPT_DIR"
+
+BENCH="bench-clib"
+ROM_IMAGE="roms/clib.rom"
+BUILD_FIRST=0
+
+usage() {
+  echo "Usage: $(basename $0) [-b] [-r rom] [bench]"
+  echo "    -b       build the benchmark before running it"
+  echo "    -r rom   sideways ROM image (default: roms/clib.rom)"
+  echo "    bench    benchmark under tests/ (default: bench-clib)"
+  exit 0
+}
+
+while getopts "br:h" opt; do
+  case $opt in
+    b) BUILD_FIRST=1 ;;
+    r) ROM_IMAGE="$OPTARG" ;;
+    h|*) usage ;;
+  esac
+done
+shift $((OPTIND-1))
+[ -n "$1" ] && BENCH="$1"
+
+if [ "$BUILD_FIRST" = 1 ]; then
+  make -C "tests/$BENCH" all || exit 1
+fi
+
+serial=()
+device=$(sed -n 's/^RS423[[:space:]]*=[[:space:]]*//p' "tests/$BENCH/Makefile" 2>/dev/null)
+[ -n "$device" ] && serial=(-S "$device")
+
+results=()
+for disc in build/$BENCH/*/test.ssd; do
+  [ -f "$disc" ] || continue
+  variant_dir=$(dirname "$disc")
+  variant=$(basename "$variant_dir")
+
+  echo "Running $BENCH/$variant" >&2
+  if ! ./run-headless.sh -d "$disc" -r "$ROM_IMAGE" \
+      -o "$variant_dir/output.txt" -R "$variant_dir/report.txt" "${serial[@]}"; then
+    echo "Error: $BENCH/$variant did not exit cleanly, see $variant_dir/report.txt" >&2
+    exit 1
+  fi
+  results+=("$variant" "$variant_dir/output.txt")
+done
+
+if [ ${#results[@]} -eq 0 ]; then
+  echo "Error: no discs in build/$BENCH, build with -b or make -C tests/$BENCH" >&2
+  exit 1
+fi
+
+# Arguments alternate label, output file. Rows keep the order in which
+# the first variant printed them.
+awk '
+  BEGIN {
+    for (i = 1; i < ARGC; i += 2) {
+      label[++nv] = ARGV[i]
+      file[ARGV[i + 1]] = nv
+      ARGV[i] = ""
+    }
+  }
+  $1 == "BENCH" {
+    v = file[FILENAME]
+    key = $2 " " $3
+    if (!(key in seen)) { seen[key] = 1; order[++nk] = key }
+    cycles[key, v] = $4
+  }
+  END {
+    printf "%-12s %5s", "FUNCTION", "BYTES"
+    for (v = 1; v <= nv; v++) printf " %14s %9s", label[v] "/call", "/byte"
+    if (nv > 1) printf " %7s", "RATIO"
+    printf "\n"
+    for (k = 1; k <= nk; k++) {
+      split(order[k], f, " ")
+      printf "%-12s %5s", f[1], (f[2] > 0 ? f[2] : "-")
+      for (v = 1; v <= nv; v++) {
+        c = cycles[order[k], v]
+        if (c == "") { printf " %14s %9s", "-", "-"; continue }
+        printf " %14d", c
+        if (f[2] > 0) printf " %9.1f", c / f[2]; else printf " %9s", "-"
+      }
+      if (nv > 1) {
+        a = cycles[order[k], 1]; b = cycles[order[k], nv]
+        if (a > 0 && b != "") printf " %7.2f", b / a; else printf " %7s", "-"
+      }
+      printf "\n"
+    }
+  }
+' "${results[@]}"
@@ -0,0 +1,56 @@
+; clib_header.s - sideways ROM header for the in-tree clib.rom build
+; Linked first, at &8000, by clib-rom.cfg.
+;
+; clib is a service ROM, so the language entry is free: it holds the jump
+; to the ordinal dispatcher (lib/rom/clib_dispatch.s) that every ordinal
+; stub enters through. The title is what lib/clib_tramp.s looks for at
+; startup, by way of the clib_title.s that tools/clibstubs.sh -T makes
+; from this ROM.
+;
+; The ROM's DATA and BSS run from RAM (see clib-rom.cfg). They are set up
+; on service call 2, which the MOS makes on every reset and BREAK, so
+; each program run from a freshly reset machine finds the descriptor and
+; stream tables as the C library starts them.
+
+        .export clib_service
+
+        .import clib_dispatch
+        .import copydata, zerobss
+
+ROM_TYPE        = $82           ; service entry, 6502 code
+ROM_VERSION     = 1
+
+        .segment "HEADER"
+
+header:
+        jmp     clib_dispatch   ; &8000: ordinal entry (not a language)
+        jmp     clib_service    ; &8003: service entry
+        .byte   ROM_TYPE
+        .byte   copyright - header
+        .byte   ROM_VERSION
+        .byte   "CLIB", 0
+        .byte   "1.00"
+copyright:
+        .byte   0, "(C)", 0
+
+        .code
+
+; Entry: A = service call, X = this ROM's slot, Y = call argument
+; Exit:  A, X and Y unchanged: no call is claimed
+clib_service:
+        cmp     #2              ; private workspace: the machine is resetting
+        bne     @done
+        pha
+        txa
+        pha
+        tya
+        pha
+        jsr     zerobss
+        jsr     copydata
+        pla
+        tay
+        pla
+        tax
+        pla
+@done:
+        rts
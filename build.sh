@@ -14,6 +14,7 @@ test_dirs=(
   "tests/test-break-handler"
   "tests/test-files"
   "tests/test-serial"
+  "tests/test-fujinet"
 )
 
 # Configuration
@@ -101,6 +102,68 @@ create_json() {
 EOF
 }
 
+# Bytes a library module adds to an executable, from the "Modules list"
+# of its map file: the Size= of each of its segments but BSS and the zero
+# page, added up. 0 if it was not linked, "-" if there is no map.
+module_bytes() {
+  local map=$1 module=$2
+
+  [ -f "$map" ] || { echo "-"; return; }
+  awk -v module="($module):" '
+    function hex(s,   i, n) {
+      n = 0
+      for (i = 1; i <= length(s); i++) n = n * 16 + index("0123456789ABCDEF", toupper(substr(s, i, 1))) - 1
+      return n
+    }
+    /^[^ \t]/ { in_module = substr($0, length($0) - length(module) + 1) == module; next }
+    in_module && $1 != "BSS" && $1 != "ZEROPAGE" && match($0, /Size=[0-9A-Fa-f]+/) { bytes += hex(substr($0, RSTART + 5, RLENGTH - 5)) }
+    /^Segment list:/ { exit }
+    END { print bytes + 0 }
+  ' "$map"
+}
+
+# Function to run all tests headless and summarise cycles/exit codes
+run_all_tests() {
+  local failed=0
+
+  make -C tools/beebrun all > /dev/null
+
+  printf "%-24s %-12s %-6s %7s %7s %14s %9s\n" "TEST" "STATUS" "EXIT" "BYTES" "PRINTF" "CYCLES" "SECONDS"
+  for test_dir in "${test_dirs[@]}"; do
+    local test_name=$(basename $test_dir)
+    local build_path=build/$test_name
+    local keys_args=()
+    local serial_args=()
+    local device
+
+    if [ ! -f "$build_path/test.ssd" ]; then
+      printf "%-24s %-12s\n" "$test_name" "not-built"
+      failed=1
+      continue
+    fi
+    if [ -f "$test_dir/test.keys" ]; then
+      keys_args=(-K "$test_dir/test.keys")
+    fi
+    device=$(sed -n 's/^RS423[[:space:]]*=[[:space:]]*//p' "$test_dir/Makefile" 2>/dev/null)
+    [ -n "$device" ] && serial_args=(-S "$device")
+
+    ./run-headless.sh -d "$build_path/test.ssd" "${keys_args[@]}" "${serial_args[@]}" \
+      -o "$build_path/output.txt" -R "$build_path/report.txt" || failed=1
+
+    printf "%-24s %-12s %-6s %7s %7s %14s %9s\n" "$test_name" \
+      "$(awk '$1 == "status" { print $2 }' $build_path/report.txt)" \
+      "$(awk '$1 == "exit_code" { print $2 }' $build_path/report.txt)" \
+      "$(wc -c < $build_path/test | tr -d ' ')" \
+      "$(module_bytes $build_path/test.map _printf.o)" \
+      "$(awk '$1 == "cycles" { print $2 }' $build_path/report.txt)" \
+      "$(awk '$1 == "seconds" { print $2 }' $build_path/report.txt)"
+  done
+
+  echo
+  echo "Output and reports: build/<test>/output.txt, build/<test>/report.txt"
+  return $failed
+}
+
 # Function to show results
 show_results() {
   echo "ROM files:"
@@ -116,16 +179,17 @@ show_results() {
 }
 
 usage() {
-  echo "Usage: $(basename $0) [-r|-t|-c|-a|-h]"
+  echo "Usage: $(basename $0) [-r|-t|-x|-b|-c|-a|-h]"
   echo "    -r     force clib ROM and cc65-clib re-build"
   echo "    -t     run all Tests"
+  echo "    -x     eXecute all built tests headless, report cycles"
   echo "    -c     Clean tests"
   echo "    -a     All: build tests, create disks"
   echo "    -h     Show Help"
   exit 0
 }
 
-while getopts "rtcah" opt; do
+while getopts "rtxbcah" opt; do
   case $opt in
     r)
       force_rom
@@ -135,8 +199,17 @@ while getopts "rtcah" opt; do
       build_all_tests
       exit 0
       ;;
+    x)
+      run_all_tests
+      exit $?
+      ;;
+    b)
+      ./bench.sh -b
+      exit $?
+      ;;
     c)
       echo "Cleaning all tests..."
+      make -C lib clean
       # make -C build-rom clean
       for test_dir in tests/*/; do
         if [ -f "$test_dir/Makefile" ]; then
@@ -0,0 +1,21 @@
+; clib_flush.s - flush the clib ROM's streams when the program ends
+;
+; The ROM's streams (lib/rom/filetab.s) keep written bytes in their
+; buffers until the buffer fills, a newline ends a line-buffered one, or
+; the stream is flushed or closed. This destructor runs fflush(NULL) on
+; the way out, so a program that returns with files still open loses
+; nothing. It is linked only by programs that can buffer a stream: the
+; ordinal stubs for fopen, freopen and setvbuf import it (lib/Makefile).
+
+        .export clib_flush_streams
+
+        .import _fflush
+
+        .destructor clib_flush_streams
+
+        .code
+
+clib_flush_streams:
+        lda     #0              ; fflush(NULL): every open stream
+        tax
+        jmp     _fflush
@@ -0,0 +1,172 @@
+; clib_tramp.s - fast-path ROM call trampoline and batched clib paging
+; Exported with leading underscores for C.
+;
+; The stubs generated by tools/clibstubs.sh compare the MOS ROMSEL copy
+; with _clib_slot themselves. When the clib ROM is already the paged bank
+; the stub jumps straight into the ROM, which returns to the caller with
+; no paging at all. Otherwise the stub calls clib_far_call, followed by
+; the ROM address, and the bank is switched around the call as the
+; clib.lib stubs do.
+;
+; The ordinal stubs from tools/clibords.sh enter clib_ord_call with the
+; function ordinal in Y instead, and the ROM dispatches it through its
+; single entry point at &8000 (lib/rom/clib_dispatch.s).
+;
+; clib_enter()/clib_leave() page the clib ROM in once around a block of
+; calls so that every fast stub inside the block takes the short path.
+
+        .export clib_far_call
+        .export clib_ord_call
+        .export _clib_enter
+        .export _clib_leave
+        .export _clib_slot
+
+        .import clib_rom_title
+        .importzp ptr1
+
+        .constructor clib_find_slot
+
+ROMSEL          := $FE30        ; sideways ROM select latch
+ROMSEL_COPY     := $F4          ; MOS RAM copy of ROMSEL
+ROM_TYPES       := $02A1        ; MOS ROM type table, 0 = empty slot
+ROM_TITLE       := $8009        ; title string in a sideways ROM header
+CLIB_ENTRY      := $8000        ; clib ordinal dispatch entry
+
+        .bss
+
+_clib_slot:     .res 1          ; clib ROM bank, $FF if not present
+clib_depth:     .res 1          ; clib_enter() nesting
+clib_saved:     .res 1          ; bank to restore at the outermost leave
+call_a:         .res 1          ; A on entry while the vector is set up
+call_vec:       .res 2          ; ROM routine being called
+
+        .code
+
+; Entry: JSR from a stub, followed by .addr of the ROM routine,
+;        A/X = last argument
+; Exit:  to the stub's caller, A/X/sreg as returned by the ROM routine,
+;        Y and ptr1 clobbered
+clib_far_call:
+        sta     call_a
+        pla                     ; our return address is the .addr - 1
+        sta     ptr1
+        pla
+        sta     ptr1+1
+        ldy     #1
+        lda     (ptr1),y
+        sta     call_vec
+        iny
+        lda     (ptr1),y
+        sta     call_vec+1
+        lda     _clib_slot
+        bmi     no_rom
+        ldy     ROMSEL_COPY     ; bank to restore
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+        tya
+        pha
+        lda     call_a
+        jsr     call_rom
+        tay
+        pla
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+        tya
+        rts
+
+call_rom:
+        jmp     (call_vec)
+
+; Entry: Y = function ordinal, A/X = last argument
+; Exit:  A/X/sreg as returned by the ROM routine, Y clobbered
+clib_ord_call:
+        sta     call_a
+        lda     ROMSEL_COPY
+        cmp     _clib_slot
+        bne     @page_in
+        lda     call_a
+        jmp     CLIB_ENTRY      ; already paged in: ROM returns to our caller
+
+@page_in:
+        pha                     ; bank to restore
+        lda     _clib_slot
+        bmi     no_rom
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+        lda     call_a
+        jsr     CLIB_ENTRY
+        sta     call_a
+        pla
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+        lda     call_a
+        rts
+
+no_rom:
+        brk
+        .byte   $FF
+        .byte   "clib ROM not found",0
+
+; void clib_enter(void);
+; Page the clib ROM in until the matching clib_leave(). Calls may nest.
+; Other sideways ROMs (including the language) are paged out meanwhile,
+; so do not return to BASIC from inside a clib_enter() block.
+_clib_enter:
+        lda     clib_depth
+        bne     @nested
+        lda     _clib_slot
+        bmi     no_rom
+        ldy     ROMSEL_COPY
+        sty     clib_saved
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+@nested:
+        inc     clib_depth
+        rts
+
+; void clib_leave(void);
+; Restore the bank that was paged in at the outermost clib_enter().
+; An unbalanced clib_leave() is ignored.
+_clib_leave:
+        lda     clib_depth
+        beq     @done
+        dec     clib_depth
+        bne     @done
+        lda     clib_saved
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+@done:
+        rts
+
+; Startup constructor: find the bank whose title matches the clib ROM the
+; stubs were generated from. Scans from the highest slot down, like the
+; MOS, and leaves the current bank paged in afterwards.
+clib_find_slot:
+        lda     ROMSEL_COPY
+        pha
+        ldx     #15
+@next:
+        lda     ROM_TYPES,x
+        beq     @skip
+        stx     ROMSEL_COPY
+        stx     ROMSEL
+        ldy     #0
+@compare:
+        lda     ROM_TITLE,y
+        cmp     clib_rom_title,y
+        bne     @skip
+        iny
+        cmp     #0              ; both titles ended together
+        bne     @compare
+        beq     @store
+@skip:
+        dex
+        bpl     @next
+@store:
+        stx     _clib_slot      ; $FF if no slot matched
+        lda     #0
+        sta     clib_depth
+        pla
+        sta     ROMSEL_COPY
+        sta     ROMSEL
+        rts
@@ -0,0 +1,80 @@
+/*
+ * clibctype.h - inline ctype for the bbc-clib target, from the tables in
+ * clib.rom (lib/rom/ctype.s)
+ */
+
+#ifndef CLIBCTYPE_H
+#define CLIBCTYPE_H
+
+#include <ctype.h>
+
+/* The ROM keeps its tables at a fixed address, in the top three pages:
+ * build-rom/clib-rom.cfg places them and lib/rom/ctype.s checks it */
+#define CLIB_CTYPE_ADDR   0xBD00
+#define CLIB_TOUPPER_ADDR 0xBE00
+#define CLIB_TOLOWER_ADDR 0xBF00
+
+#define CLIB_CTYPE   ((const unsigned char*)CLIB_CTYPE_ADDR)
+#define CLIB_TOUPPER ((const unsigned char*)CLIB_TOUPPER_ADDR)
+#define CLIB_TOLOWER ((const unsigned char*)CLIB_TOLOWER_ADDR)
+
+/* Class bits in CLIB_CTYPE */
+#define CLIB_CT_UPPER  0x01
+#define CLIB_CT_LOWER  0x02
+#define CLIB_CT_DIGIT  0x04
+#define CLIB_CT_XDIGIT 0x08
+#define CLIB_CT_SPACE  0x10
+#define CLIB_CT_PUNCT  0x20
+#define CLIB_CT_CNTRL  0x40
+#define CLIB_CT_SPC    0x80     /* ' ' only */
+
+#define CLIB_CT_ALPHA (CLIB_CT_UPPER | CLIB_CT_LOWER)
+#define CLIB_CT_ALNUM (CLIB_CT_ALPHA | CLIB_CT_DIGIT)
+#define CLIB_CT_GRAPH (CLIB_CT_ALNUM | CLIB_CT_PUNCT)
+#define CLIB_CT_PRINT (CLIB_CT_GRAPH | CLIB_CT_SPC)
+
+#define CLIB_IS(c, bits) (CLIB_CTYPE[(unsigned char)(c)] & (bits))
+
+/* The macros below replace <ctype.h>'s functions with one indexed load
+ * from the ROM each, so they are only valid while clib is paged in:
+ * include this header only in code that runs between clib_enter() and
+ * clib_leave() (see clibx.h). Each evaluates its argument once. EOF is
+ * taken as character 255, so it is in no class. toupper() and tolower()
+ * look up the low byte and keep the high byte, which leaves EOF as EOF
+ * since neither table changes 255. isblank() is left to the ROM
+ * function. */
+#undef isalnum
+#undef isalpha
+#undef iscntrl
+#undef isdigit
+#undef isgraph
+#undef islower
+#undef isprint
+#undef ispunct
+#undef isspace
+#undef isupper
+#undef isxdigit
+#undef toupper
+#undef tolower
+
+#define isalnum(c)  CLIB_IS(c, CLIB_CT_ALNUM)
+#define isalpha(c)  CLIB_IS(c, CLIB_CT_ALPHA)
+#define iscntrl(c)  CLIB_IS(c, CLIB_CT_CNTRL)
+#define isdigit(c)  CLIB_IS(c, CLIB_CT_DIGIT)
+#define isgraph(c)  CLIB_IS(c, CLIB_CT_GRAPH)
+#define islower(c)  CLIB_IS(c, CLIB_CT_LOWER)
+#define isprint(c)  CLIB_IS(c, CLIB_CT_PRINT)
+#define ispunct(c)  CLIB_IS(c, CLIB_CT_PUNCT)
+#define isspace(c)  CLIB_IS(c, CLIB_CT_SPACE)
+#define isupper(c)  CLIB_IS(c, CLIB_CT_UPPER)
+#define isxdigit(c) CLIB_IS(c, CLIB_CT_XDIGIT)
+#define toupper(c)  (__AX__ = (c),                            \
+                     __asm__ ("tay"),                         \
+                     __asm__ ("lda %w,y", CLIB_TOUPPER_ADDR), \
+                     __AX__)
+#define tolower(c)  (__AX__ = (c),                            \
+                     __asm__ ("tay"),                         \
+                     __asm__ ("lda %w,y", CLIB_TOLOWER_ADDR), \
+                     __AX__)
+
+#endif
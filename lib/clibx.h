@@ -0,0 +1,97 @@
+/*
+ * clibx.h - app-side helpers for the bbc-clib target (build/lib/clibx.lib)
+ */
+
+#ifndef CLIBX_H
+#define CLIBX_H
+
+#include <dirent.h>
+
+/* Bank the clib ROM was found in at startup, 0xFF if it is not present */
+extern unsigned char clib_slot;
+
+/* Page the clib ROM in around a block of ROM calls:
+ *
+ *     clib_enter();
+ *     for (...) n += strlen(lines[i]);
+ *     clib_leave();
+ *
+ * Inside the block every fast-path stub jumps straight into the ROM
+ * instead of switching banks on each call. Blocks may nest. Other
+ * sideways ROMs, including the language, are paged out until the
+ * outermost clib_leave(). */
+void clib_enter(void);
+void clib_leave(void);
+
+/* Copy src to dest like strcpy(), but return a pointer to the terminator
+ * written to dest. Appending with the result instead of strcat() copies
+ * each piece once without rescanning dest:
+ *
+ *     p = stpcpy(path, dir);
+ *     p = stpcpy(p, ".");
+ *     stpcpy(p, name);
+ */
+char* __fastcall__ stpcpy(char* dest, const char* src);
+
+/* A directory entry with the rest of its catalogue information: the
+ * fields after d_dir are in OSFILE's order, and d_dir is the DFS
+ * directory letter, or 0 where the filing system does not give one.
+ * readdir() returns the same entry, so d_name is also struct dirent's. */
+struct direntx {
+    char          d_name[11];
+    char          d_dir;
+    unsigned long d_load;
+    unsigned long d_exec;
+    unsigned long d_size;
+    unsigned char d_attr;       /* bit 3: locked */
+};
+
+/* readdir(), with the catalogue information filled in. On DFS opendir()
+ * reads the whole catalogue at once and neither call makes an OS call;
+ * other filing systems are listed a batch of names at a time, and
+ * readdirx() asks OSFILE 5 about each. opendir() takes "" or "." for the
+ * current directory and, on DFS, a letter for that directory or "*" for
+ * all of them. The entry is overwritten by the next call.
+ *
+ *     while ((e = readdirx(dir)) != NULL)
+ *         printf("%-7s %6lu\n", e->d_name, e->d_size);
+ */
+struct direntx* __fastcall__ readdirx(DIR* dir);
+
+/* A second descriptor for the file open on fd, sharing its position:
+ * dup() returns the lowest free one, and dup2() makes it fd2, closing
+ * what fd2 had open first. dup2(fd, 1) sends stdout to the file until
+ * close(1), after which 1 is the console again. */
+int __fastcall__ dup(int fd);
+int __fastcall__ dup2(int fd, int fd2);
+
+/* RS423 through the ACIA's interrupts, with no *FX3/*FX2 stream
+ * switching: serial_open() takes the port over at baud 1-8 as for *FX7
+ * (8 is 19200), with input going into a ring of the caller's. serial_read()
+ * copies out up to n bytes of what has arrived, waiting up to timeout
+ * centiseconds for more after the last one (0: not at all). RTS goes high
+ * while the ring is nearly full. serial_write() queues n bytes to send,
+ * waiting while the 64-byte queue is full and CTS holds it, and
+ * serial_close() waits for the queue to empty. If nothing leaves the
+ * queue for a second, serial_write() returns -1 with errno EIO, and
+ * serial_close() drops what is queued, closes the port and does the
+ * same. The ring must be at least 64 bytes and stay put until
+ * serial_close(). */
+int __fastcall__ serial_open(void* ring, unsigned int size, unsigned char baud);
+int __fastcall__ serial_read(void* buf, unsigned int n, unsigned int timeout);
+int __fastcall__ serial_write(const void* buf, unsigned int n);
+int serial_close(void);
+
+/* The FujiNet checksum of the bytes serial_read() has returned, or
+ * serial_write() has queued, since serial_open() or the last call; each
+ * call starts its sum again. The sums are kept as the bytes are copied,
+ * so a packet needs no second pass:
+ *
+ *     serial_write(cmd, 6);
+ *     cmd[6] = serial_tx_sum();
+ *     serial_write(cmd + 6, 1);
+ */
+unsigned char serial_rx_sum(void);
+unsigned char serial_tx_sum(void);
+
+#endif
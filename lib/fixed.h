@@ -0,0 +1,46 @@
+/*
+ * fixed.h - 8.8 and 16.16 fixed point in clib.rom (lib/rom/fix*.s)
+ */
+
+#ifndef FIXED_H
+#define FIXED_H
+
+/* 8.8 in an int and 16.16 in a long, two's complement */
+typedef int fix8_t;
+typedef long fix16_t;
+
+#define FIX8_ONE  0x0100
+#define FIX16_ONE 0x00010000L
+
+#define INT_TO_FIX8(i)   ((fix8_t)((i) << 8))
+#define FIX8_TO_INT(f)   ((int)((f) >> 8))
+#define INT_TO_FIX16(i)  ((fix16_t)(i) << 16)
+#define FIX16_TO_INT(f)  ((int)((f) >> 16))
+#define FIX8_TO_FIX16(f) ((fix16_t)(f) << 8)
+#define FIX16_TO_FIX8(f) ((fix8_t)((f) >> 8))
+
+/* Multiply and divide truncate towards zero. A result that does not fit
+ * wraps, and dividing by zero gives all ones (-1 in the last place),
+ * negated for a negative dividend, rather than an error. */
+fix8_t __fastcall__ fix8_mul(fix8_t a, fix8_t b);
+fix8_t __fastcall__ fix8_div(fix8_t a, fix8_t b);
+fix16_t __fastcall__ fix16_mul(fix16_t a, fix16_t b);
+fix16_t __fastcall__ fix16_div(fix16_t a, fix16_t b);
+
+/* Largest r with r * r <= n. For an 8.8 value f >= 0 the 8.8 root is
+ * isqrt((unsigned long)f << 8). */
+unsigned int __fastcall__ isqrt(unsigned long n);
+
+/* Angles run from 0 to FIX_ANGLE_FULL - 1 for a full turn, anticlockwise
+ * from the positive x axis. sin and cos take any angle and use only its
+ * low 10 bits; they are accurate to 1/256. */
+#define FIX_ANGLE_FULL    1024
+#define FIX_ANGLE_QUARTER 256
+
+fix8_t __fastcall__ fix_sin(unsigned int angle);
+fix8_t __fastcall__ fix_cos(unsigned int angle);
+
+/* Angle of the point (x, y), within about one unit; 0 for (0, 0) */
+unsigned int __fastcall__ fix_atan2(int y, int x);
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * fujinet.h - FujiNet client over RS423 in clib.rom (lib/rom/fujinet.s)
+ */
+
+#ifndef FUJINET_H
+#define FUJINET_H
+
+/* Open the port with serial_open() (clibx.h) first; the calls go through
+ * its receive ring and transmit queue.
+ *
+ * Each call is one exchange with the FujiNet: a command frame, any data
+ * it carries, and the reply. Replies go straight into the caller's
+ * structure or buffer, their checksum tested on the way. Calls return 0,
+ * or the byte count for fn_net_read() and fn_net_write(), or -1 with
+ * errno: ENODEV when nothing answered, EIO for a refusal, an error
+ * reply, a short reply or a bad checksum, and EINVAL when the port is not
+ * open, the URL is too long or a count is over 32767. */
+
+/* Device IDs on the bus; the network calls talk to N1: */
+#define FN_FUJI     0x70
+#define FN_NETWORK  0x71
+
+struct fn_ssid {
+    char ssid[33];
+    char password[64];
+};
+
+#define FN_HOST_SLOTS 8
+#define FN_HOST_SIZE  32
+
+#define FN_DEVICE_SLOTS 8
+
+struct fn_device_slot {
+    unsigned char host_slot;
+    unsigned char mode;
+    char          file[36];
+};
+
+struct fn_net_status {
+    unsigned int  waiting;      /* bytes ready for fn_net_read() */
+    unsigned char connected;
+    unsigned char error;        /* 1 when all is well */
+};
+
+/* fn_net_open() modes and translations */
+#define FN_READ        0x04
+#define FN_WRITE       0x08
+#define FN_READ_WRITE  0x0C
+#define FN_NO_TRANSLATION 0x00
+
+int fn_reset(void);
+int __fastcall__ fn_get_ssid(struct fn_ssid* ssid);
+int __fastcall__ fn_get_hosts(char (*hosts)[FN_HOST_SIZE]);
+int __fastcall__ fn_get_device_slots(struct fn_device_slot* slots);
+
+/* The URL is sent as a 256-byte block, so it may be up to 255 characters
+ * long, e.g. "N:HTTP://HOST/FILE" */
+int __fastcall__ fn_net_open(const char* url, unsigned char mode, unsigned char trans);
+int __fastcall__ fn_net_status(struct fn_net_status* status);
+
+/* n is at most 32767, so that the count returned is never negative */
+int __fastcall__ fn_net_read(void* buf, unsigned int n);
+int __fastcall__ fn_net_write(const void* buf, unsigned int n);
+int fn_net_close(void);
+
+/* Read the open N1: stream to its end through buf, n bytes at a time,
+ * handing each chunk to fn, or writing it to the open file fd. The next
+ * chunk is asked for before fn has this one, so the device is answering
+ * while fn works; fn must not make FujiNet calls itself. Return the
+ * bytes read, which may be more than fits in memory, or -1 with errno.
+ * A negative return from fn, or a failed write(), stops the stream with
+ * its errno; a write() that takes less than the chunk stops it with EIO,
+ * as does a connection left open with nothing waiting for 15 seconds. */
+long __fastcall__ fn_net_stream(void* buf, unsigned int n,
+                                int __fastcall__ (*fn)(const void* buf, unsigned int n));
+long __fastcall__ fn_net_copy(int fd, void* buf, unsigned int n);
+
+#endif
@@ -0,0 +1,34 @@
+; clib_dispatch.s - single ordinal entry point for the clib ROM
+; ROM side: assembled into clib.rom, by the cc65-clib build or by
+; build-rom's own (make -C build-rom rom), together with the clib_ordtab.s
+; that tools/clibords.sh -t generates from lib/clib.ord.
+;
+; clib is a service ROM, so the language entry at &8000 is free. The ROM
+; header (build-rom/clib_header.s) puts "jmp clib_dispatch" there, which
+; gives applications one entry point that does not move between ROM
+; builds.
+
+        .export clib_dispatch
+
+        .import clib_ord_lo, clib_ord_hi, clib_ord_count
+        .importzp tmp1
+
+        .code
+
+; Entry: Y = ordinal, A/X = last argument, clib paged in
+; Exit:  through the routine, which returns to the caller of the entry
+clib_dispatch:
+        cpy     #<clib_ord_count
+        bcs     bad_ordinal
+        sta     tmp1
+        lda     clib_ord_hi,y
+        pha
+        lda     clib_ord_lo,y
+        pha
+        lda     tmp1
+        rts                     ; to the routine: table holds address - 1
+
+bad_ordinal:
+        brk
+        .byte   $FF
+        .byte   "Bad clib ordinal",0
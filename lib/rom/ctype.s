@@ -0,0 +1,142 @@
+; ctype.s - character classification for clib.rom
+; Replaces cc65's ctype functions, and gives applications the tables
+; themselves: lib/clibctype.h turns isalpha() and the rest into one
+; indexed load and an AND, with no call into the ROM at all.
+;
+; The tables have to stay where applications expect them, so they are in
+; a segment of their own that the ROM's linker config places at &BD00,
+; the top three pages of the ROM (build-rom/clib-rom.cfg):
+;
+;       CTYPE: load = ROM, type = ro, start = $BD00;
+;
+; and the link fails if a config puts them anywhere else.
+;
+;       &BD00   clib_ctype      class bits below, one byte per character
+;       &BE00   clib_toupper    toupper() of each character
+;       &BF00   clib_tolower    tolower() of each character
+;
+; Characters 128-255 are in no class and have no case, as in the C locale.
+; The class bits must match CLIB_CT_* in lib/clibctype.h.
+
+        .export _isalnum, _isalpha, _isblank, _iscntrl, _isdigit, _isgraph
+        .export _islower, _isprint, _ispunct, _isspace, _isupper, _isxdigit
+        .export _toupper, _tolower
+        .export clib_ctype, clib_toupper, clib_tolower
+
+CT_UPPER        = $01
+CT_LOWER        = $02
+CT_DIGIT        = $04
+CT_XDIGIT       = $08           ; 0-9, A-F and a-f
+CT_SPACE        = $10           ; ' ', '\t', '\n', '\v', '\f' and '\r'
+CT_PUNCT        = $20
+CT_CNTRL        = $40
+CT_SPC          = $80           ; ' ' only: printable, but not graphic
+
+CT_ALPHA        = CT_UPPER | CT_LOWER
+CT_ALNUM        = CT_ALPHA | CT_DIGIT
+CT_GRAPH        = CT_ALNUM | CT_PUNCT
+CT_PRINT        = CT_GRAPH | CT_SPC
+
+        .code
+
+; int __fastcall__ isalpha(int c); and the rest: non-zero when c is in
+; the class. EOF and anything else outside 0-255 is in none.
+_isalnum:
+        ldy     #CT_ALNUM
+        bne     classify        ; always
+_isalpha:
+        ldy     #CT_ALPHA
+        bne     classify
+_iscntrl:
+        ldy     #CT_CNTRL
+        bne     classify
+_isdigit:
+        ldy     #CT_DIGIT
+        bne     classify
+_isgraph:
+        ldy     #CT_GRAPH
+        bne     classify
+_islower:
+        ldy     #CT_LOWER
+        bne     classify
+_isprint:
+        ldy     #CT_PRINT
+        bne     classify
+_ispunct:
+        ldy     #CT_PUNCT
+        bne     classify
+_isspace:
+        ldy     #CT_SPACE
+        bne     classify
+_isupper:
+        ldy     #CT_UPPER
+        bne     classify
+_isxdigit:
+        ldy     #CT_XDIGIT
+
+; Y = class bits to test
+classify:
+        cpx     #0
+        bne     none
+        tax
+        tya
+        and     clib_ctype,x
+        ldx     #0
+        rts
+
+; int __fastcall__ isblank(int c);
+_isblank:
+        cpx     #0
+        bne     none
+        cmp     #' '
+        beq     :+
+        cmp     #9              ; '\t'
+        bne     none
+:       rts                     ; A non-zero, X = 0
+
+none:   lda     #0
+        tax
+        rts
+
+; int __fastcall__ toupper(int c);
+_toupper:
+        cpx     #0              ; EOF is returned as it is
+        bne     :+
+        tay
+        lda     clib_toupper,y
+:       rts
+
+; int __fastcall__ tolower(int c);
+_tolower:
+        cpx     #0
+        bne     :+
+        tay
+        lda     clib_tolower,y
+:       rts
+
+        .segment "CTYPE"
+
+clib_ctype:
+        .byte   $40, $40, $40, $40, $40, $40, $40, $40, $40, $50, $50, $50, $50, $50, $40, $40  ; &00
+        .byte   $40, $40, $40, $40, $40, $40, $40, $40, $40, $40, $40, $40, $40, $40, $40, $40  ; &10
+        .byte   $90, $20, $20, $20, $20, $20, $20, $20, $20, $20, $20, $20, $20, $20, $20, $20  ; &20
+        .byte   $0C, $0C, $0C, $0C, $0C, $0C, $0C, $0C, $0C, $0C, $20, $20, $20, $20, $20, $20  ; &30
+        .byte   $20, $09, $09, $09, $09, $09, $09, $01, $01, $01, $01, $01, $01, $01, $01, $01  ; &40
+        .byte   $01, $01, $01, $01, $01, $01, $01, $01, $01, $01, $01, $20, $20, $20, $20, $20  ; &50
+        .byte   $20, $0A, $0A, $0A, $0A, $0A, $0A, $02, $02, $02, $02, $02, $02, $02, $02, $02  ; &60
+        .byte   $02, $02, $02, $02, $02, $02, $02, $02, $02, $02, $02, $20, $20, $20, $20, $40  ; &70
+        .res    128, 0
+
+clib_toupper:
+        .repeat 256, C
+        .byte   C - ((C >= 'a') && (C <= 'z')) * 32
+        .endrepeat
+
+clib_tolower:
+        .repeat 256, C
+        .byte   C + ((C >= 'A') && (C <= 'Z')) * 32
+        .endrepeat
+
+        .assert clib_ctype = $BD00, error, "CTYPE must be linked at $BD00 (lib/clibctype.h)"
+        .assert clib_toupper = $BE00, error, "CTYPE must be linked at $BD00 (lib/clibctype.h)"
+        .assert clib_tolower = $BF00, error, "CTYPE must be linked at $BD00 (lib/clibctype.h)"
@@ -0,0 +1,521 @@
+; dir.s - opendir/readdir/readdirx/closedir for clib.rom
+; ROM side; the DIR comes from page_alloc (pages.s) and holds a copy of
+; the catalogue.
+;
+; On DFS, opendir reads the whole catalogue, track 0 sectors 0 and 1,
+; with one OSWORD &7F, and readdir and readdirx then take every entry,
+; with its load and exec addresses, length and lock, from memory. Other
+; filing systems, and a DFS that refuses the disc command, are read with
+; OSGBPB 8 a batch of names at a time; readdirx asks OSFILE 5 for each
+; name's details there, as the caller would have had to.
+
+        .export _opendir, _readdir, _readdirx, _closedir
+
+        .import page_alloc, page_free
+        .importzp ptr1, ptr2, ptr4, tmp1, tmp2
+
+        .include "errno.inc"
+        .include "fd.inc"
+
+FS_DFS          = 4             ; filing system number from OSARGS 0
+
+; struct direntx, which starts with struct dirent's d_name. The fields
+; from d_load on are in OSFILE's order.
+DE_NAME         = 0             ; d_name[11]
+DE_NAME_MAX     = 10
+DE_DIR          = 11            ; DFS directory letter, 0 if not known
+DE_LOAD         = 12
+DE_EXEC         = 16
+DE_SIZE         = 20
+DE_ATTR         = 24            ; OSFILE attributes, bit 3 locked
+DIRENT_SIZE     = 25
+
+; DIR: the entry readdir returns, then the state to get the next
+D_MODE          = DIRENT_SIZE + 0
+D_WANT          = DIRENT_SIZE + 1   ; catalogue: directory letter, 0 any
+D_INDEX         = DIRENT_SIZE + 2   ; next entry, from the first
+D_END           = DIRENT_SIZE + 3   ; end of the entries, likewise
+D_NEXT          = DIRENT_SIZE + 4   ; names: OSGBPB 8's index, 4 bytes
+D_DATA          = DIRENT_SIZE + 8
+
+; D_MODE
+MODE_CAT        = 0             ; D_DATA holds the catalogue sectors
+MODE_NAMES      = 1             ; D_DATA holds a batch of counted names
+MODE_LAST       = $80           ; with MODE_NAMES: no batch after this
+
+CAT_SIZE        = 512
+NAMES_SIZE      = 128
+NAMES_COUNT     = NAMES_SIZE / (DE_NAME_MAX + 1)
+
+WANT_CURRENT    = 1             ; opendir: the current directory
+
+DISC_READ       = $53           ; OSWORD &7F: read data
+DISC_TWO_SECTORS = $22          ; 256 byte sectors, two of them
+
+        .bss
+
+want:   .res    1               ; opendir: the directory asked for
+mode:   .res    1               ; opendir: MODE_CAT or MODE_NAMES
+block:  .res    18              ; OSWORD, OSGBPB and OSFILE control block
+
+        .rodata
+
+; where readdir puts the low 16 bits of load, exec and length from the
+; catalogue's second sector
+low_to: .byte   DE_LOAD, DE_LOAD+1, DE_EXEC, DE_EXEC+1, DE_SIZE, DE_SIZE+1
+
+        .code
+
+; DIR* __fastcall__ opendir(const char* name);
+; "" and "." are the current directory, "*" every DFS directory and a
+; single letter that DFS directory. Other filing systems always list the
+; current directory.
+_opendir:
+        sta     ptr1
+        stx     ptr1+1
+        ldy     #0
+        lda     (ptr1),y
+        beq     @current
+        iny
+        lda     (ptr1),y
+        beq     :+
+        lda     #ENOENT
+        bne     @fail           ; always
+:       dey
+        lda     (ptr1),y
+        cmp     #'.'
+        beq     @current
+        cmp     #'*'
+        bne     :+
+        lda     #0
+        beq     @want           ; always
+:       cmp     #'a'            ; directory letters are upper case
+        bcc     @want
+        cmp     #'z' + 1
+        bcs     @want
+        and     #$DF
+        bne     @want           ; always
+@current:
+        lda     #WANT_CURRENT
+@want:  sta     want
+
+        lda     #0              ; filing system number
+        tay
+        jsr     OSARGS
+        ldx     #MODE_NAMES
+        cmp     #FS_DFS
+        bne     :+
+        ldx     #MODE_CAT
+:       stx     mode
+        lda     #<(D_DATA + NAMES_SIZE)
+        ldx     #>(D_DATA + NAMES_SIZE)
+        ldy     mode
+        bne     :+
+        lda     #<(D_DATA + CAT_SIZE)
+        ldx     #>(D_DATA + CAT_SIZE)
+:       jsr     page_alloc
+        cpx     #0
+        bne     @got
+        lda     #ENOMEM
+@fail:  jsr     fd_error
+        lda     #0
+        tax
+        rts
+
+@got:   sta     ptr4
+        stx     ptr4+1
+        lda     #0
+        ldy     #D_DATA - 1     ; nothing read yet
+:       sta     (ptr4),y
+        dey
+        cpy     #D_MODE
+        bcs     :-
+        ldy     #D_MODE
+        lda     mode
+        sta     (ptr4),y
+        bne     @done
+        jsr     catalogue
+        bcc     @done
+        lda     #MODE_NAMES     ; no disc command: ask for names instead
+        ldy     #D_MODE
+        sta     (ptr4),y
+@done:  lda     ptr4
+        ldx     ptr4+1
+        rts
+
+; Read the catalogue of the current drive into the DIR at ptr4; C set if
+; the filing system would not
+catalogue:
+        jsr     data
+        lda     #0              ; current drive and directory, as two
+        sta     block           ; counted strings
+        jsr     address
+        lda     #6
+        ldx     #<block
+        ldy     #>block
+        jsr     OSGBPB
+        ldy     #0              ; one character each, or this is not DFS
+        lda     (ptr1),y
+        cmp     #1
+        bne     @fail
+        ldy     #2
+        lda     (ptr1),y
+        cmp     #1
+        bne     @fail
+        lda     want
+        cmp     #WANT_CURRENT
+        bne     :+
+        iny
+        lda     (ptr1),y
+:       ldy     #D_WANT
+        sta     (ptr4),y
+
+        ldy     #1
+        lda     (ptr1),y        ; drive
+        sec
+        sbc     #'0'
+        sta     block
+        jsr     address
+        lda     #3
+        sta     block+5
+        lda     #DISC_READ
+        sta     block+6
+        lda     #0              ; track 0, from sector 0
+        sta     block+7
+        sta     block+8
+        lda     #DISC_TWO_SECTORS
+        sta     block+9
+        lda     #$FF            ; so that nobody answering is an error
+        sta     block+10
+        lda     #$7F
+        ldx     #<block
+        ldy     #>block
+        jsr     OSWORD
+        lda     block+10
+        bne     @fail
+
+        ldy     #5              ; entries * 8, in the second sector
+        inc     ptr1+1
+        lda     (ptr1),y
+        ldy     #D_END
+        sta     (ptr4),y
+        clc
+        rts
+@fail:  sec
+        rts
+
+; ptr1 = D_DATA of the DIR at ptr4
+data:   lda     ptr4
+        clc
+        adc     #D_DATA
+        sta     ptr1
+        lda     ptr4+1
+        adc     #0
+        sta     ptr1+1
+        rts
+
+; block+1..4 = ptr1, in the I/O processor
+address:
+        lda     ptr1
+        sta     block+1
+        lda     ptr1+1
+        sta     block+2
+        lda     #$FF
+        sta     block+3
+        sta     block+4
+        rts
+
+; struct dirent* __fastcall__ readdir(DIR* dir);
+_readdir:
+        sta     ptr4
+        stx     ptr4+1
+        ldy     #D_MODE
+        lda     (ptr4),y
+        beq     @cat
+        jmp     names
+
+@none:  lda     #0
+        tax
+        rts
+
+@cat:   ldy     #D_INDEX        ; the next entry in the directory wanted
+        lda     (ptr4),y
+        ldy     #D_END
+        cmp     (ptr4),y
+        bcs     @none
+        pha
+        clc
+        adc     #8
+        ldy     #D_INDEX
+        sta     (ptr4),y
+        jsr     data            ; ptr1 = the name, ptr2 = the rest,
+        pla                     ; after the title's 8 bytes
+        clc
+        adc     #8
+        adc     ptr1
+        sta     ptr1
+        sta     ptr2
+        lda     ptr1+1
+        adc     #0
+        sta     ptr1+1
+        adc     #1
+        sta     ptr2+1
+        ldy     #7
+        lda     (ptr1),y
+        sta     tmp1
+        and     #$7F
+        sta     tmp2
+        ldy     #D_WANT
+        lda     (ptr4),y
+        beq     :+
+        cmp     tmp2
+        bne     @cat
+
+:       ldx     #0              ; the name, without its padding
+        ldy     #0
+@name:  lda     (ptr1),y
+        and     #$7F
+        sta     (ptr4),y
+        iny
+        cmp     #' '
+        beq     :+
+        tya
+        tax
+:       cpy     #7
+        bne     @name
+        txa
+        tay
+        lda     #0
+        sta     (ptr4),y
+        ldy     #DE_DIR
+        lda     tmp2
+        sta     (ptr4),y
+        lda     tmp1            ; locked is the top bit of the letter
+        asl     a
+        lda     #0
+        bcc     :+
+        lda     #8
+:       ldy     #DE_ATTR
+        sta     (ptr4),y
+
+        ldx     #5              ; the low 16 bits of each
+@low:   txa
+        tay
+        lda     (ptr2),y
+        ldy     low_to,x
+        sta     (ptr4),y
+        dex
+        bpl     @low
+        ldy     #6              ; and the two above them
+        lda     (ptr2),y
+        sta     tmp1
+        lsr     a
+        lsr     a
+        and     #3
+        ldy     #DE_LOAD+2
+        jsr     high
+        lda     tmp1
+        asl     a
+        rol     a
+        rol     a
+        and     #3
+        ldy     #DE_EXEC+2
+        jsr     high
+        lda     tmp1
+        lsr     a
+        lsr     a
+        lsr     a
+        lsr     a
+        and     #3
+        ldy     #DE_SIZE+2
+        sta     (ptr4),y
+        iny
+        lda     #0
+        sta     (ptr4),y
+        lda     ptr4
+        ldx     ptr4+1
+        rts
+
+; Store bits 16 and 17 of an address, A, at Y in the entry at ptr4, and
+; bits 24-31. Both set means the I/O processor: &FFFFxxxx.
+high:   cmp     #3
+        bne     :+
+        lda     #$FF
+        sta     (ptr4),y
+        iny
+        sta     (ptr4),y
+        rts
+:       sta     (ptr4),y
+        iny
+        lda     #0
+        sta     (ptr4),y
+        rts
+
+; readdir for a DIR read by name
+names:  ldy     #D_INDEX
+        lda     (ptr4),y
+        ldy     #D_END
+        cmp     (ptr4),y
+        bcc     @take
+        ldy     #D_MODE
+        lda     (ptr4),y
+        bmi     @none
+        jsr     batch
+        ldy     #D_END
+        lda     (ptr4),y
+        bne     @take
+@none:  lda     #0
+        tax
+        rts
+
+@take:  jsr     data            ; ptr1 = the counted name
+        ldy     #D_INDEX
+        lda     (ptr4),y
+        clc
+        adc     ptr1
+        sta     ptr1
+        bcc     :+
+        inc     ptr1+1
+:       ldy     #0
+        lda     (ptr1),y
+        sta     tmp1
+        sec                     ; past it for next time
+        ldy     #D_INDEX
+        adc     (ptr4),y
+        sta     (ptr4),y
+        lda     tmp1
+        cmp     #DE_NAME_MAX + 1
+        bcc     :+
+        lda     #DE_NAME_MAX
+        sta     tmp1
+:       inc     ptr1
+        bne     :+
+        inc     ptr1+1
+:       ldx     #0              ; the name, without its padding
+        ldy     #0
+        beq     @end            ; always
+@name:  lda     (ptr1),y
+        and     #$7F
+        sta     (ptr4),y
+        iny
+        cmp     #' '
+        beq     @end
+        tya
+        tax
+@end:   cpy     tmp1
+        bne     @name
+        txa
+        tay
+        lda     #0
+        sta     (ptr4),y
+        ldy     #DE_DIR         ; and nothing else known
+:       sta     (ptr4),y
+        iny
+        cpy     #DIRENT_SIZE
+        bcc     :-
+        lda     ptr4
+        ldx     ptr4+1
+        rts
+
+; The next batch of names into the DIR at ptr4
+batch:  jsr     data
+        jsr     address
+        lda     #NAMES_COUNT
+        sta     block+5
+        ldx     #0
+        stx     block+6
+        stx     block+7
+        stx     block+8
+        ldy     #D_NEXT
+:       lda     (ptr4),y
+        sta     block+9,x
+        iny
+        inx
+        cpx     #4
+        bcc     :-
+        lda     #8
+        ldx     #<block
+        ldy     #>block
+        jsr     OSGBPB
+        lda     #0
+        ror     a               ; C: the directory ran out
+        ldy     #D_MODE
+        ora     (ptr4),y
+        sta     (ptr4),y
+        ldx     #0
+        ldy     #D_NEXT
+:       lda     block+9,x
+        sta     (ptr4),y
+        iny
+        inx
+        cpx     #4
+        bcc     :-
+        lda     #NAMES_COUNT    ; D_END is past the names that came
+        sec
+        sbc     block+5
+        tax
+        ldy     #0
+        txa
+        beq     @end
+@walk:  tya
+        sec
+        adc     (ptr1),y
+        tay
+        dex
+        bne     @walk
+@end:   tya
+        ldy     #D_END
+        sta     (ptr4),y
+        lda     #0
+        ldy     #D_INDEX
+        sta     (ptr4),y
+        rts
+
+; struct direntx* __fastcall__ readdirx(DIR* dir);
+_readdirx:
+        jsr     _readdir
+        cpx     #0
+        beq     @done
+        ldy     #D_MODE
+        lda     (ptr4),y
+        beq     @entry          ; the catalogue has it all
+        ldy     #DE_NAME        ; else OSFILE 5, with the name CR
+:       lda     (ptr4),y        ; terminated where it is
+        beq     :+
+        iny
+        bne     :-              ; always
+:       sty     tmp1
+        lda     #13
+        sta     (ptr4),y
+        lda     ptr4
+        sta     block
+        lda     ptr4+1
+        sta     block+1
+        lda     #5
+        ldx     #<block
+        ldy     #>block
+        jsr     OSFILE
+        tax
+        ldy     tmp1
+        lda     #0
+        sta     (ptr4),y
+        txa
+        beq     @entry          ; gone since: nothing known
+        ldx     #0
+        ldy     #DE_LOAD
+:       lda     block+2,x
+        sta     (ptr4),y
+        iny
+        inx
+        cpy     #DIRENT_SIZE
+        bcc     :-
+@entry: lda     ptr4
+        ldx     ptr4+1
+@done:  rts
+
+; int __fastcall__ closedir(DIR* dir);
+_closedir:
+        jsr     page_free
+        lda     #0
+        tax
+        rts
@@ -0,0 +1,82 @@
+; div.s - signed 16-bit division runtime for clib.rom
+; Replaces cc65's div/mod modules with wrappers around udiv16 in
+; lib/rom/udiv.s, so signed division gets its power of two and divide by
+; 10 fast paths too. The quotient truncates towards zero and the
+; remainder takes the sign of the dividend, as C requires.
+
+        .export tosdiva0, tosdivax, tosmoda0, tosmodax
+
+        .import popax, udiv16
+        .importzp ptr1, ptr4, sreg, tmp1, tmp2
+
+        .code
+
+; Entry: TOS = dividend, A/X = divisor (X = 0 for the a0 forms)
+; Exit:  A/X = quotient, TOS popped
+tosdiva0:
+        ldx     #0
+tosdivax:
+        jsr     sdiv_params
+        lda     tmp1            ; signs differ: negative quotient
+        eor     tmp2
+        bpl     :+
+        sec
+        lda     #0
+        sbc     ptr1
+        sta     ptr1
+        lda     #0
+        sbc     ptr1+1
+        sta     ptr1+1
+:       lda     ptr1
+        ldx     ptr1+1
+        rts
+
+; Entry: TOS = dividend, A/X = divisor (X = 0 for the a0 forms)
+; Exit:  A/X = remainder, TOS popped
+tosmoda0:
+        ldx     #0
+tosmodax:
+        jsr     sdiv_params
+        lda     tmp2            ; negative dividend: negative remainder
+        bpl     :+
+        sec
+        lda     #0
+        sbc     sreg
+        sta     sreg
+        lda     #0
+        sbc     sreg+1
+        sta     sreg+1
+:       lda     sreg
+        ldx     sreg+1
+        rts
+
+; Pop the operands, divide their magnitudes with udiv16 and leave the
+; divisor's sign in tmp1 and the dividend's in tmp2 (bit 7)
+sdiv_params:
+        stx     tmp1
+        cpx     #$80
+        bcc     :+
+        jsr     negate_ax
+:       sta     ptr4
+        stx     ptr4+1
+        jsr     popax
+        stx     tmp2
+        cpx     #$80
+        bcc     :+
+        jsr     negate_ax
+:       sta     ptr1
+        stx     ptr1+1
+        jmp     udiv16
+
+; A/X = -A/X
+negate_ax:
+        clc
+        eor     #$FF
+        adc     #1
+        pha
+        txa
+        eor     #$FF
+        adc     #0
+        tax
+        pla
+        rts
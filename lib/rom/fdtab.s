@@ -0,0 +1,347 @@
+; fdtab.s - file descriptor table and block transfers for clib.rom
+; Replaces cc65-clib's descriptor table along with open/close/read/write/
+; lseek, so that all of them agree on what a descriptor holds.
+;
+; Each descriptor is a MOS channel and a flags byte, in two tables indexed
+; by the descriptor. When a channel is opened the flags record whether its
+; filing system implements OSGBPB, so read() and write() can move a whole
+; request with one OSGBPB call instead of one OSBGET or OSBPUT per byte.
+; On DFS an OSGBPB call costs about as much as a few OSBGET calls, and the
+; sector copy inside it runs far faster than the MOS byte path, so any
+; request of GBPB_MIN bytes or more goes as a block. The cassette and ROM
+; filing systems, and short requests, use the byte calls.
+;
+; Each descriptor also caches the channel's PTR# and EXT#. read() and
+; write() move the cached pointer on by what they transfer, and write()
+; the extent with it, so lseek() works out the new pointer without asking
+; the filing system. It only records it, with FD_SEEK. The next transfer
+; hands the pointer over: in the same OSGBPB call (reason 1 or 3, which
+; take a pointer), or with OSARGS before the byte calls. A run of seeks
+; with no transfer between them costs no MOS calls at all, and a read at
+; the extent returns 0 straight away.
+;
+; All of that belongs to a slot, which is what open() fills in; a
+; descriptor is an index into fd_slot. dup() and dup2() point a second
+; descriptor at the same slot, so the two share a position as they
+; should. A file opened only for reading a second time under the same
+; name gets a slot of its own, with its own position, but the first
+; one's channel: that saves the catalogue search in OSFIND, and gets
+; round the filing system's limit on open channels. The slots on a
+; shared channel are marked FD_SHARED, and each transfer through one
+; sets FD_SEEK on the others, since it moves the channel's PTR# from
+; under them.
+
+        .include "errno.inc"
+        .include "fd.inc"
+
+        .importzp ptr1, ptr2, ptr3, ptr4, tmp1, tmp2, tmp3, tmp4
+
+        .data
+
+; Slot of each descriptor, $FF if it is closed. 0 is stdin, 1 stdout and
+; 2 stderr, on slots that are always the console.
+fd_slot:
+        .byte   0, 1, 2
+        .res    FD_COUNT - FD_FIRST_FILE, $FF
+
+; Flags of each slot
+fd_flags:
+        .byte   FD_OPEN | FD_CONSOLE | FD_READ
+        .byte   FD_OPEN | FD_CONSOLE | FD_WRITE
+        .byte   FD_OPEN | FD_CONSOLE | FD_WRITE
+        .res    FD_COUNT - FD_FIRST_FILE
+
+        .bss
+
+fd_handle:
+        .res    FD_COUNT
+
+; Name of each slot open only for reading, CR terminated, or 0 if it
+; would not fit, for open() to share the channel. Byte n of slot X is at
+; fd_name + n * FD_COUNT, X.
+fd_name:
+        .res    FD_NAME_MAX * FD_COUNT
+
+; Cached PTR# and EXT#, a table per byte: byte n of slot X is at
+; fd_ptr + n * FD_COUNT, X. fd_ext follows fd_ptr, so lseek can reach
+; either through fd_ptr with X moved on by 4 * FD_COUNT.
+fd_ptr: .res    4 * FD_COUNT
+fd_ext: .res    4 * FD_COUNT
+
+; OSGBPB control block, and the OSWORD 0 block for console reads
+fd_block:
+        .res    13
+
+fd_num: .res    1               ; slot of the transfer
+
+        .code
+
+; Entry: A/X = descriptor
+; Exit:  C clear, X = its slot and A = the slot's flags if it is open; C
+;        set otherwise
+fd_check:
+        cpx     #0
+        bne     @bad
+        cmp     #FD_COUNT
+        bcs     @bad
+        tax
+        lda     fd_slot,x
+        bmi     @bad
+        tax
+        lda     fd_flags,x
+        beq     @bad
+        clc
+        rts
+@bad:   sec
+        rts
+
+; Set errno and return -1
+fd_badf:
+        lda     #EBADF
+fd_error:
+        sta     ___errno
+        lda     #0
+        sta     ___errno+1
+        lda     #$FF
+        tax
+        rts
+
+; Move ptr2 bytes between the buffer at ptr1 and the channel of slot X at
+; its cached pointer. A = GBPB_READ or GBPB_WRITE, ptr2 not 0.
+; Exit: A/X = bytes moved, fewer than asked for on a read that meets the
+; end of the file
+fd_transfer:
+        sta     tmp1
+        stx     fd_num
+        cmp     #GBPB_READ
+        bne     :+
+        jsr     clamp
+        bne     :+
+        tax                     ; at the extent: nothing to read
+        rts
+:       lda     fd_flags,x
+        and     #FD_SHARED
+        beq     :+
+        jsr     stale
+:       ldy     fd_handle,x
+        lda     fd_flags,x
+        and     #FD_GBPB
+        beq     @bytes
+        lda     ptr2+1
+        bne     @block
+        lda     ptr2
+        cmp     #GBPB_MIN
+        bcc     @bytes
+
+@block: sty     fd_block        ; channel
+        lda     ptr1            ; address, in the I/O processor
+        sta     fd_block+1
+        lda     ptr1+1
+        sta     fd_block+2
+        lda     #$FF
+        sta     fd_block+3
+        sta     fd_block+4
+        lda     ptr2            ; count
+        sta     fd_block+5
+        lda     ptr2+1
+        sta     fd_block+6
+        lda     #0
+        sta     fd_block+7
+        sta     fd_block+8
+        lda     fd_flags,x      ; moved by lseek: the reason one below,
+        and     #FD_SEEK        ; which takes the pointer too
+        beq     @call
+        eor     fd_flags,x
+        sta     fd_flags,x
+        dec     tmp1
+        lda     fd_ptr,x
+        sta     fd_block+9
+        lda     fd_ptr+FD_COUNT,x
+        sta     fd_block+10
+        lda     fd_ptr+2*FD_COUNT,x
+        sta     fd_block+11
+        lda     fd_ptr+3*FD_COUNT,x
+        sta     fd_block+12
+@call:  lda     tmp1
+        ldx     #<fd_block
+        ldy     #>fd_block
+        jsr     OSGBPB
+        lda     ptr2            ; moved = asked for - left over
+        sec
+        sbc     fd_block+5
+        pha
+        lda     ptr2+1
+        sbc     fd_block+6
+        tax
+        pla
+        jmp     advance
+
+@bytes: sty     tmp2
+        lda     fd_flags,x      ; moved by lseek: set PTR# first
+        and     #FD_SEEK
+        beq     :+
+        eor     fd_flags,x
+        sta     fd_flags,x
+        lda     fd_ptr,x        ; through ptr3/ptr4, which are next to
+        sta     ptr3            ; each other in zero page
+        lda     fd_ptr+FD_COUNT,x
+        sta     ptr3+1
+        lda     fd_ptr+2*FD_COUNT,x
+        sta     ptr4
+        lda     fd_ptr+3*FD_COUNT,x
+        sta     ptr4+1
+        lda     #1
+        ldx     #ptr3
+        jsr     OSARGS
+:       lda     #0
+        sta     ptr3
+        sta     ptr3+1
+        lda     tmp1
+        cmp     #GBPB_READ
+        beq     @get
+
+@put:   ldy     #0
+        lda     (ptr1),y
+        ldy     tmp2
+        jsr     OSBPUT
+        jsr     @next
+        bne     @put
+        beq     @done           ; always
+
+@get:   ldy     tmp2
+        jsr     OSBGET
+        bcs     @done           ; end of file
+        ldy     #0
+        sta     (ptr1),y
+        jsr     @next
+        bne     @get
+
+@done:  lda     ptr3
+        ldx     ptr3+1
+        jmp     advance
+
+; Step the buffer and the count moved: Z set once all ptr2 bytes are
+@next:  inc     ptr1
+        bne     :+
+        inc     ptr1+1
+:       inc     ptr3
+        bne     :+
+        inc     ptr3+1
+:       lda     ptr3
+        cmp     ptr2
+        bne     :+
+        lda     ptr3+1
+        cmp     ptr2+1
+:       rts
+
+; Set FD_SEEK on the other slots on the channel of slot fd_num, whose
+; PTR# is about to move. X = fd_num on exit.
+stale:  lda     fd_handle,x
+        ldx     #FD_COUNT - 1
+@slot:  cpx     fd_num
+        beq     @next
+        ldy     fd_flags,x
+        beq     @next
+        cmp     fd_handle,x
+        bne     @next
+        tay
+        lda     fd_flags,x
+        ora     #FD_SEEK
+        sta     fd_flags,x
+        tya
+@next:  dex
+        cpx     #FD_FIRST_FILE
+        bcs     @slot
+        ldx     fd_num
+        rts
+
+; ptr2 = the smaller of ptr2 and EXT# - PTR# for slot X; Z set if
+; that is 0. Files under 64KB, which is all of them on DFS, take 16 bits.
+clamp:  lda     fd_ext+2*FD_COUNT,x
+        ora     fd_ext+3*FD_COUNT,x
+        ora     fd_ptr+2*FD_COUNT,x
+        ora     fd_ptr+3*FD_COUNT,x
+        bne     @long
+        sec
+        lda     fd_ext,x
+        sbc     fd_ptr,x
+        sta     tmp2
+        lda     fd_ext+FD_COUNT,x
+        sbc     fd_ptr+FD_COUNT,x
+        bcc     @none           ; past the extent
+        bcs     @less           ; always
+
+@long:  sec
+        lda     fd_ext,x
+        sbc     fd_ptr,x
+        sta     tmp2
+        lda     fd_ext+FD_COUNT,x
+        sbc     fd_ptr+FD_COUNT,x
+        sta     tmp3
+        lda     fd_ext+2*FD_COUNT,x
+        sbc     fd_ptr+2*FD_COUNT,x
+        sta     tmp4
+        lda     fd_ext+3*FD_COUNT,x
+        sbc     fd_ptr+3*FD_COUNT,x
+        bcc     @none
+        ora     tmp4
+        bne     @done           ; 64KB or more left
+        lda     tmp3
+
+@less:  sta     tmp3            ; tmp2/tmp3 left: fewer than ptr2?
+        lda     tmp2
+        cmp     ptr2
+        lda     tmp3
+        sbc     ptr2+1
+        bcs     @done
+        lda     tmp2
+        sta     ptr2
+        lda     tmp3
+        sta     ptr2+1
+@done:  lda     ptr2
+        ora     ptr2+1
+        rts
+@none:  lda     #0
+        sta     ptr2
+        sta     ptr2+1
+        rts
+
+; Move the cached pointer of slot fd_num on by A/X bytes, and the
+; extent with it if a write took it further. A/X are kept.
+advance:
+        pha
+        stx     tmp2
+        ldx     fd_num
+        clc
+        adc     fd_ptr,x
+        sta     fd_ptr,x
+        lda     tmp2
+        adc     fd_ptr+FD_COUNT,x
+        sta     fd_ptr+FD_COUNT,x
+        bcc     :+
+        inc     fd_ptr+2*FD_COUNT,x
+        bne     :+
+        inc     fd_ptr+3*FD_COUNT,x
+:       lda     tmp1            ; reads are reasons 3 and 4
+        cmp     #GBPB_READ_AT
+        bcs     @done
+        lda     fd_ext,x        ; EXT# < PTR#?
+        cmp     fd_ptr,x
+        lda     fd_ext+FD_COUNT,x
+        sbc     fd_ptr+FD_COUNT,x
+        lda     fd_ext+2*FD_COUNT,x
+        sbc     fd_ptr+2*FD_COUNT,x
+        lda     fd_ext+3*FD_COUNT,x
+        sbc     fd_ptr+3*FD_COUNT,x
+        bcs     @done
+        lda     fd_ptr,x
+        sta     fd_ext,x
+        lda     fd_ptr+FD_COUNT,x
+        sta     fd_ext+FD_COUNT,x
+        lda     fd_ptr+2*FD_COUNT,x
+        sta     fd_ext+2*FD_COUNT,x
+        lda     fd_ptr+3*FD_COUNT,x
+        sta     fd_ext+3*FD_COUNT,x
+@done:  ldx     tmp2
+        pla
+        rts
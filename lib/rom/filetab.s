@@ -0,0 +1,344 @@
+; filetab.s - stream table and buffer management for clib.rom stdio
+; Replaces cc65's _filetab/stdin/stdout/stderr and _fdesc. Each FILE has a
+; buffer that is full-buffered, line-buffered or unbuffered (setvbuf), so
+; fgetc, fputc, fgets and fputs make one read() or write() per buffer
+; rather than one per character. A buffer the application does not give
+; through setvbuf is taken from page_alloc (pages.s) the first time the
+; stream is used.
+; stdin, stdout and stderr start unbuffered, so console output is never
+; held back.
+;
+; The buffer holds either bytes read ahead (FILE_READING, F_POS to F_LEN)
+; or bytes waiting to be written (FILE_WRITING, 0 to F_LEN). Switching
+; direction, fflush, fseek and fclose empty it first. At exit the
+; application's lib/clib_flush.s calls fflush(NULL), which empties them
+; all.
+
+        .export _stdin, _stdout, _stderr, __fdesc
+
+        .import _lseek, page_alloc, pushax, pusheax
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg
+
+        .include "errno.inc"
+        .include "stdio.inc"
+        .include "fd.inc"
+        .include "file.inc"
+
+        .data
+
+__filetab:
+        .byte   0, FILE_OPEN, 0, IO_NONE, 0, 0, 0, 0, 0, 0, 0, 0
+        .byte   1, FILE_OPEN, 0, IO_NONE, 0, 0, 0, 0, 0, 0, 0, 0
+        .byte   2, FILE_OPEN, 0, IO_NONE, 0, 0, 0, 0, 0, 0, 0, 0
+        .res    (FILE_COUNT - 3) * FILE_SIZE
+
+_stdin: .addr   __filetab
+_stdout:
+        .addr   __filetab + FILE_SIZE
+_stderr:
+        .addr   __filetab + 2 * FILE_SIZE
+
+        .bss
+
+; The stream being worked on, which ptr4 points at between calls, and a
+; transfer between it and the caller's memory
+file_ptr:
+        .res    2
+file_src:
+        .res    2               ; caller's memory
+file_left:
+        .res    2               ; bytes still to move
+file_done:
+        .res    2               ; bytes moved
+
+        .code
+
+; FILE* _fdesc(void): a free FILE, or NULL
+__fdesc:
+        ldy     #0
+@next:  lda     __filetab+F_FLAGS,y
+        beq     @found
+        tya
+        clc
+        adc     #FILE_SIZE
+        tay
+        cpy     #FILE_COUNT * FILE_SIZE
+        bcc     @next
+        lda     #0
+        tax
+        rts
+@found: tya
+        clc
+        adc     #<__filetab
+        ldx     #>__filetab
+        bcc     :+
+        inx
+:       rts
+
+; Entry: A/X = FILE*
+; Exit:  ptr4 and file_ptr = it, C clear if it is open; C set, errno
+;        EINVAL and A/X = -1 otherwise
+file_check:
+        sta     ptr4
+        stx     ptr4+1
+        sta     file_ptr
+        stx     file_ptr+1
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_OPEN
+        beq     @bad
+        clc
+        rts
+@bad:   lda     #EINVAL
+        jsr     fd_error
+        sec
+        rts
+
+; ptr4 = file_ptr again after a call; A, X and C are kept
+file_load:
+        pha
+        lda     file_ptr
+        sta     ptr4
+        lda     file_ptr+1
+        sta     ptr4+1
+        pla
+        rts
+
+; C clear if the stream at ptr4 is buffered, with its buffer allocated
+; the first time; C set if it is unbuffered, or there was no memory for
+; the buffer, which leaves it unbuffered
+file_buffer:
+        ldy     #F_MODE
+        lda     (ptr4),y
+        cmp     #IO_NONE
+        beq     @none
+        ldy     #F_SIZE
+        lda     (ptr4),y
+        iny
+        ora     (ptr4),y
+        bne     :+
+        lda     #>FILE_BUFSIZ
+        sta     (ptr4),y
+        dey
+        lda     #<FILE_BUFSIZ
+        sta     (ptr4),y
+:       clc
+        ldy     #F_BUF+1        ; buffers are never in zero page
+        lda     (ptr4),y
+        bne     @done
+        ldy     #F_SIZE+1
+        lda     (ptr4),y
+        tax
+        dey
+        lda     (ptr4),y
+        jsr     page_alloc
+        jsr     file_load
+        cpx     #0
+        bne     @got
+        ldy     #F_MODE         ; no memory: unbuffered
+        lda     #IO_NONE
+        sta     (ptr4),y
+@none:  sec
+        rts
+@got:   ldy     #F_BUF
+        sta     (ptr4),y
+        iny
+        txa
+        sta     (ptr4),y
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        ora     #FILE_OWNBUF
+        sta     (ptr4),y
+        clc
+@done:  rts
+
+; Empty the buffer of the stream at ptr4: write out what is waiting, or
+; move the descriptor back over what was read ahead, so that it is where
+; the caller has got to. C set, with FILE_ERROR, if the write failed.
+file_flush:
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_WRITING | FILE_READING
+        bne     :+
+        clc                     ; nothing in it
+        rts
+:       and     #FILE_WRITING
+        beq     @reading
+
+        ldy     #F_LEN
+        lda     (ptr4),y
+        sta     ptr2
+        iny
+        lda     (ptr4),y
+        sta     ptr2+1
+        ora     ptr2
+        beq     @empty
+        ldy     #F_BUF
+        lda     (ptr4),y
+        sta     ptr1
+        iny
+        lda     (ptr4),y
+        sta     ptr1+1
+        ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     fd_write
+        jsr     file_load
+        ldy     #F_LEN          ; all of it?
+        cmp     (ptr4),y
+        bne     @error
+        txa
+        iny
+        cmp     (ptr4),y
+        beq     @empty
+@error: ldy     #F_FLAGS
+        lda     (ptr4),y
+        ora     #FILE_ERROR
+        sta     (ptr4),y
+        jsr     @empty
+        sec
+        rts
+
+@reading:
+        ldy     #F_POS          ; pos - len, what was read ahead, as a
+        lda     (ptr4),y        ; negative offset
+        ldy     #F_LEN
+        sec
+        sbc     (ptr4),y
+        sta     ptr1
+        ldy     #F_POS+1
+        lda     (ptr4),y
+        ldy     #F_LEN+1
+        sbc     (ptr4),y
+        sta     ptr1+1
+        ora     ptr1
+        beq     @empty
+        ldy     #F_FD           ; lseek(fd, pos - len, SEEK_CUR)
+        lda     (ptr4),y
+        ldx     #0
+        jsr     pushax
+        lda     #$FF
+        sta     sreg
+        sta     sreg+1
+        lda     ptr1
+        ldx     ptr1+1
+        jsr     pusheax
+        lda     #SEEK_CUR
+        ldx     #0
+        jsr     _lseek
+        jsr     file_load
+
+@empty: ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #<~(FILE_WRITING | FILE_READING)
+        sta     (ptr4),y
+        lda     #0
+        ldy     #F_POS
+        sta     (ptr4),y
+        iny
+        sta     (ptr4),y
+        iny                     ; F_LEN
+        sta     (ptr4),y
+        iny
+        sta     (ptr4),y
+        clc
+        rts
+
+; Read the next buffer of the stream at ptr4, whose buffer is allocated
+; and empty. C clear with F_LEN bytes from F_POS = 0; C set at the end of
+; the file, with FILE_EOF, or on an error, with FILE_ERROR.
+file_fill:
+        ldy     #F_BUF
+        lda     (ptr4),y
+        sta     ptr1
+        iny
+        lda     (ptr4),y
+        sta     ptr1+1
+        iny                     ; F_SIZE
+        lda     (ptr4),y
+        sta     ptr2
+        iny
+        lda     (ptr4),y
+        sta     ptr2+1
+        ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     fd_read
+        jsr     file_load
+        cpx     #0
+        bmi     @error
+        bne     @got
+        cmp     #0
+        beq     @eof
+@got:   ldy     #F_LEN
+        sta     (ptr4),y
+        iny
+        txa
+        sta     (ptr4),y
+        lda     #0
+        ldy     #F_POS
+        sta     (ptr4),y
+        iny
+        sta     (ptr4),y
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        ora     #FILE_READING
+        sta     (ptr4),y
+        clc
+        rts
+@eof:   lda     #FILE_EOF
+        bne     @set            ; always
+@error: lda     #FILE_ERROR
+@set:   ldy     #F_FLAGS
+        ora     (ptr4),y
+        sta     (ptr4),y
+        sec
+        rts
+
+; Copy ptr2 bytes, not 0, from (ptr1) to (ptr3). ptr1 and ptr3 move on
+; by the whole pages copied only.
+file_copy:
+        ldy     #0
+        ldx     ptr2+1
+        beq     @part
+@page:  lda     (ptr1),y
+        sta     (ptr3),y
+        iny
+        bne     @page
+        inc     ptr1+1
+        inc     ptr3+1
+        dex
+        bne     @page
+@part:  ldx     ptr2
+        beq     @done
+@byte:  lda     (ptr1),y
+        sta     (ptr3),y
+        iny
+        dex
+        bne     @byte
+@done:  rts
+
+; ptr2 more bytes moved: on in the caller's memory, fewer left, more done
+file_advance:
+        clc
+        lda     file_src
+        adc     ptr2
+        sta     file_src
+        lda     file_src+1
+        adc     ptr2+1
+        sta     file_src+1
+        sec
+        lda     file_left
+        sbc     ptr2
+        sta     file_left
+        lda     file_left+1
+        sbc     ptr2+1
+        sta     file_left+1
+        clc
+        lda     file_done
+        adc     ptr2
+        sta     file_done
+        lda     file_done+1
+        adc     ptr2+1
+        sta     file_done+1
+        rts
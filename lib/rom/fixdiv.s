@@ -0,0 +1,104 @@
+; fixdiv.s - 8.8 and 16.16 fixed point divide for clib.rom
+; Declared in lib/fixed.h.
+;
+; Both divide the magnitudes with udiv32 (through sdiv32 in lib/rom/ldiv.s)
+; and truncate towards zero. An 8.8 dividend shifted up by 8 still fits
+; in 32 bits, so fix8_div is one udiv32. A 16.16 dividend shifted up by 16
+; does not: udiv32 gives the integer part and its remainder, and the 16
+; fraction bits come from carrying on the same long division with zero
+; bits shifted in. A quotient that does not fit the type wraps, and
+; dividing by zero gives all ones before the sign is applied.
+
+        .export _fix8_div, _fix16_div
+
+        .import popax, negax, negeax, ludiv_params, sdiv32
+        .importzp ptr1, ptr2, ptr3, sreg, tmp1, tmp2, tmp3, tmp4
+
+        .code
+
+; fix8_t __fastcall__ fix8_div(fix8_t a, fix8_t b);
+_fix8_div:
+        sta     ptr3            ; b, sign extended -> ptr3:tmp3:tmp4
+        stx     ptr3+1
+        cpx     #$80
+        lda     #0
+        adc     #$FF            ; 0 if negative, else $FF
+        eor     #$FF
+        sta     tmp3
+        sta     tmp4
+        jsr     popax           ; a << 8, sign extended -> ptr1:sreg
+        sta     ptr1+1
+        stx     sreg
+        lda     #0
+        sta     ptr1
+        cpx     #$80
+        adc     #$FF
+        eor     #$FF
+        sta     sreg+1
+        eor     tmp4            ; signs differ: negative quotient
+        pha
+        jsr     sdiv32
+        pla
+        tay
+        lda     ptr1
+        ldx     ptr1+1
+        cpy     #$80
+        bcc     :+
+        jmp     negax
+:       rts
+
+; fix16_t __fastcall__ fix16_div(fix16_t a, fix16_t b);
+_fix16_div:
+        jsr     ludiv_params    ; b -> ptr3:tmp3:tmp4, a -> ptr1:sreg
+        lda     tmp4            ; signs differ: negative quotient
+        eor     sreg+1
+        pha
+        jsr     sdiv32
+        lda     ptr1            ; integer part -> sreg
+        sta     sreg
+        lda     ptr1+1
+        sta     sreg+1
+
+; Fraction bits into ptr1, remainder in ptr2:tmp1:tmp2
+        ldy     #16
+@frac:
+        asl     ptr2
+        rol     ptr2+1
+        rol     tmp1
+        rol     tmp2
+        bcs     @sub            ; past 32 bits: more than the divisor
+        lda     ptr2
+        cmp     ptr3
+        lda     ptr2+1
+        sbc     ptr3+1
+        lda     tmp1
+        sbc     tmp3
+        lda     tmp2
+        sbc     tmp4
+        bcc     @next
+@sub:   lda     ptr2            ; C set
+        sbc     ptr3
+        sta     ptr2
+        lda     ptr2+1
+        sbc     ptr3+1
+        sta     ptr2+1
+        lda     tmp1
+        sbc     tmp3
+        sta     tmp1
+        lda     tmp2
+        sbc     tmp4
+        sta     tmp2
+        sec
+@next:  rol     ptr1
+        rol     ptr1+1
+        dey
+        bne     @frac
+
+        pla
+        tay
+        lda     ptr1
+        ldx     ptr1+1
+        cpy     #$80
+        bcc     :+
+        jmp     negeax
+:       rts
@@ -0,0 +1,220 @@
+; fixmul.s - 8.8 and 16.16 fixed point multiply for clib.rom
+; Declared in lib/fixed.h.
+;
+; Both multiply the operands' magnitudes with quarter_mul8x8 from
+; lib/rom/mul.s and keep only the product bytes that survive the shift
+; back to the binary point, then restore the sign. The result truncates
+; towards zero; one that does not fit the type wraps.
+;
+; An 8.8 product is bytes 1-2 of the 32-bit product, so byte 0 is never
+; stored. A 16.16 product is bytes 2-5 of the 64-bit product. It is added
+; up a row at a time from the multiplicand's top byte down, and each row
+; reuses the zero page byte that held its multiplicand byte, so the five
+; result bytes needed fit alongside both operands.
+
+        .export _fix8_mul, _fix16_mul
+
+        .import popax, popeax, negax, negeax
+        .import quarter_mul8x8, quarter_mul8x8_lo
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg, tmp1, tmp4
+
+; 16.16 product bytes; r0 is only ever a carry into r1
+r1      = ptr1+1
+r2      = ptr2
+r3      = ptr2+1
+r4      = sreg
+r5      = sreg+1
+
+; rlo/rhi += multiplicand (tmp1) * yb, carrying into the bytes above
+.macro  product yb, rlo, rhi, carry
+        lda     yb
+        beq     :+
+        jsr     quarter_mul8x8
+        clc
+        adc     rlo
+        sta     rlo
+        txa
+        adc     rhi
+        sta     rhi
+        bcc     :+
+        jsr     carry
+:
+.endmacro
+
+; As product, for the topmost result byte: nothing to carry into
+.macro  product_top yb, rlo, rhi
+        lda     yb
+        beq     :+
+        jsr     quarter_mul8x8
+        clc
+        adc     rlo
+        sta     rlo
+        txa
+        adc     rhi
+        sta     rhi
+:
+.endmacro
+
+; r += the low byte of tmp1 * yb
+.macro  product_lo yb, r
+        lda     yb
+        beq     :+
+        jsr     quarter_mul8x8_lo
+        clc
+        adc     r
+        sta     r
+:
+.endmacro
+
+        .code
+
+; fix8_t __fastcall__ fix8_mul(fix8_t a, fix8_t b);
+_fix8_mul:
+        jsr     mul16_params
+        lda     ptr1            ; a0 * b0: the high byte only
+        sta     tmp1
+        lda     ptr3
+        jsr     quarter_mul8x8
+        stx     sreg
+        lda     #0
+        sta     sreg+1
+        lda     ptr3+1          ; a0 * b1
+        beq     :+
+        jsr     quarter_mul8x8
+        clc
+        adc     sreg
+        sta     sreg
+        txa
+        adc     sreg+1
+        sta     sreg+1
+:       lda     ptr1+1
+        beq     @sign
+        sta     tmp1
+        product_top ptr3, sreg, sreg+1  ; a1 * b0
+        product_lo ptr3+1, sreg+1       ; a1 * b1
+@sign:
+        lda     sreg
+        ldx     sreg+1
+        bit     tmp4
+        bpl     :+
+        jmp     negax
+:       rts
+
+; Magnitudes of b (in A/X) -> ptr3 and a (TOS) -> ptr1, with bit 7 of
+; tmp4 set when the signs differ
+mul16_params:
+        stx     tmp4
+        cpx     #$80
+        bcc     :+
+        jsr     negax
+:       sta     ptr3
+        stx     ptr3+1
+        jsr     popax
+        pha
+        txa
+        eor     tmp4
+        sta     tmp4
+        pla
+        cpx     #$80
+        bcc     :+
+        jsr     negax
+:       sta     ptr1
+        stx     ptr1+1
+        rts
+
+; fix16_t __fastcall__ fix16_mul(fix16_t a, fix16_t b);
+_fix16_mul:
+        ldy     sreg+1          ; b -> ptr3/ptr4
+        sty     tmp4
+        bpl     :+
+        jsr     negeax
+:       sta     ptr3
+        stx     ptr3+1
+        lda     sreg
+        sta     ptr4
+        lda     sreg+1
+        sta     ptr4+1
+        jsr     popeax          ; a -> ptr1/ptr2
+        pha
+        lda     sreg+1
+        eor     tmp4
+        sta     tmp4
+        pla
+        ldy     sreg+1
+        bpl     :+
+        jsr     negeax
+:       sta     ptr1
+        stx     ptr1+1
+        lda     sreg
+        sta     ptr2
+        lda     sreg+1
+        sta     ptr2+1
+
+        lda     ptr2+1          ; a3: product bytes 3-5
+        sta     tmp1
+        lda     #0
+        sta     r3
+        sta     r4
+        sta     r5
+        lda     tmp1
+        beq     @row2
+        product ptr3, r3, r4, carry5
+        product_top ptr3+1, r4, r5
+        product_lo ptr4, r5
+
+@row2:  lda     ptr2            ; a2: bytes 2-5
+        sta     tmp1
+        lda     #0
+        sta     r2
+        lda     tmp1
+        beq     @row1
+        product ptr3, r2, r3, carry4
+        product ptr3+1, r3, r4, carry5
+        product_top ptr4, r4, r5
+        product_lo ptr4+1, r5
+
+@row1:  lda     ptr1+1          ; a1: bytes 1-5
+        sta     tmp1
+        lda     #0
+        sta     r1
+        lda     tmp1
+        beq     @row0
+        product ptr3, r1, r2, carry3
+        product ptr3+1, r2, r3, carry4
+        product ptr4, r3, r4, carry5
+        product_top ptr4+1, r4, r5
+
+@row0:  lda     ptr1            ; a0: bytes 0-4, byte 0 dropped
+        beq     @sign
+        sta     tmp1
+        lda     ptr3
+        beq     :+
+        jsr     quarter_mul8x8
+        txa
+        clc
+        adc     r1
+        sta     r1
+        bcc     :+
+        jsr     carry2
+:
+        product ptr3+1, r1, r2, carry3
+        product ptr4, r2, r3, carry4
+        product ptr4+1, r3, r4, carry5
+
+@sign:  lda     r2
+        ldx     r3
+        bit     tmp4
+        bpl     :+
+        jmp     negeax
+:       rts
+
+; Carry into the result from byte n upwards
+carry2: inc     r2
+        bne     carry_done
+carry3: inc     r3
+        bne     carry_done
+carry4: inc     r4
+        bne     carry_done
+carry5: inc     r5
+carry_done:
+        rts
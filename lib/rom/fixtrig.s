@@ -0,0 +1,179 @@
+; fixtrig.s - sine, cosine and atan2 for clib.rom
+; Declared in lib/fixed.h.
+;
+; Angles run from 0 to 1023 for a full turn, so 256 is a right angle.
+; sin_tab holds sin() over the first quadrant at 256 steps, in 8.8, and
+; the other three quadrants read it backwards and/or negate it. Its last
+; entry is 255, just short of 1.0, which is returned at exactly 256.
+;
+; fix_atan2 reduces (x, y) to the first octant by taking magnitudes and
+; swapping them when |y| > |x|, divides the smaller by the larger with
+; udiv32 for an 8-bit fraction, and looks that up in atan_tab as an angle
+; of 0 to 128. The octant is then put back. The result is within about
+; one unit.
+;
+; Both tables were generated with
+;     sin_tab[i]  = min(255, round(sin(i * pi / 512) * 256))
+;     atan_tab[i] = round(atan(i / 256) * 512 / pi)
+
+        .export _fix_sin, _fix_cos, _fix_atan2
+
+        .import popax, negax, udiv32
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg, tmp1, tmp3, tmp4
+
+; ptr1 = k - ptr1
+.macro  angle_from k
+        sec
+        lda     #<k
+        sbc     ptr1
+        sta     ptr1
+        lda     #>k
+        sbc     ptr1+1
+        sta     ptr1+1
+.endmacro
+
+        .code
+
+; fix8_t __fastcall__ fix_cos(unsigned int angle);
+_fix_cos:
+        inx                     ; a quarter turn on
+
+; fix8_t __fastcall__ fix_sin(unsigned int angle);
+_fix_sin:
+        tay                     ; Y = angle within the quadrant
+        txa
+        and     #2              ; second half of the turn: negative
+        sta     tmp1
+        txa
+        lsr     a               ; odd quadrant: read the table backwards
+        bcc     @read
+        tya
+        beq     @one            ; a quarter or three quarters of a turn
+        eor     #$FF
+        tay
+        iny                     ; Y = 256 - Y
+@read:  lda     sin_tab,y
+        ldx     #0
+        beq     @sign           ; always
+@one:   ldx     #1              ; A = 0
+@sign:  ldy     tmp1
+        beq     :+
+        jmp     negax
+:       rts
+
+; unsigned int __fastcall__ fix_atan2(int y, int x);
+_fix_atan2:
+        stx     ptr4            ; |x| -> ptr2, sign -> ptr4
+        cpx     #$80
+        bcc     :+
+        jsr     negax
+:       sta     ptr2
+        stx     ptr2+1
+        jsr     popax
+        stx     ptr4+1          ; |y| -> ptr3, sign -> ptr4+1
+        cpx     #$80
+        bcc     :+
+        jsr     negax
+:       sta     ptr3
+        stx     ptr3+1
+
+        ldy     #0              ; steeper than 45 degrees: swap, Y = 1
+        lda     ptr2
+        cmp     ptr3
+        lda     ptr2+1
+        sbc     ptr3+1
+        bcs     @ordered
+        ldx     ptr2
+        lda     ptr3
+        sta     ptr2
+        stx     ptr3
+        ldx     ptr2+1
+        lda     ptr3+1
+        sta     ptr2+1
+        stx     ptr3+1
+        iny
+@ordered:
+        lda     ptr2
+        ora     ptr2+1
+        bne     @ratio
+        tax                     ; (0, 0): 0
+        rts
+
+@ratio: tya                     ; udiv32 takes every tmp
+        pha
+        lda     #0              ; smaller * 256 / larger, 0 to 256
+        sta     ptr1
+        sta     sreg+1
+        sta     tmp3
+        sta     tmp4
+        lda     ptr3
+        sta     ptr1+1
+        lda     ptr3+1
+        sta     sreg
+        lda     ptr2
+        sta     ptr3
+        lda     ptr2+1
+        sta     ptr3+1
+        jsr     udiv32
+        lda     #128            ; 256: exactly 45 degrees
+        ldx     ptr1+1
+        bne     :+
+        ldx     ptr1
+        lda     atan_tab,x
+:       sta     ptr1
+        lda     #0
+        sta     ptr1+1
+
+        pla
+        beq     :+
+        angle_from 256
+:       lda     ptr4
+        bpl     :+
+        angle_from 512
+:       lda     ptr4+1
+        bpl     :+
+        angle_from 1024
+:       lda     ptr1+1
+        and     #3              ; 1024 -> 0
+        tax
+        lda     ptr1
+        rts
+
+        .rodata
+
+; sin() for angles 0 to 255, in 8.8
+sin_tab:
+        .byte   $00, $02, $03, $05, $06, $08, $09, $0B, $0D, $0E, $10, $11, $13, $14, $16, $18
+        .byte   $19, $1B, $1C, $1E, $1F, $21, $22, $24, $26, $27, $29, $2A, $2C, $2D, $2F, $30
+        .byte   $32, $33, $35, $37, $38, $3A, $3B, $3D, $3E, $40, $41, $43, $44, $46, $47, $49
+        .byte   $4A, $4C, $4D, $4F, $50, $52, $53, $55, $56, $58, $59, $5B, $5C, $5E, $5F, $61
+        .byte   $62, $63, $65, $66, $68, $69, $6B, $6C, $6D, $6F, $70, $72, $73, $75, $76, $77
+        .byte   $79, $7A, $7B, $7D, $7E, $80, $81, $82, $84, $85, $86, $88, $89, $8A, $8C, $8D
+        .byte   $8E, $90, $91, $92, $93, $95, $96, $97, $98, $9A, $9B, $9C, $9D, $9F, $A0, $A1
+        .byte   $A2, $A4, $A5, $A6, $A7, $A8, $AA, $AB, $AC, $AD, $AE, $AF, $B1, $B2, $B3, $B4
+        .byte   $B5, $B6, $B7, $B8, $B9, $BA, $BC, $BD, $BE, $BF, $C0, $C1, $C2, $C3, $C4, $C5
+        .byte   $C6, $C7, $C8, $C9, $CA, $CB, $CC, $CD, $CE, $CF, $CF, $D0, $D1, $D2, $D3, $D4
+        .byte   $D5, $D6, $D7, $D7, $D8, $D9, $DA, $DB, $DC, $DC, $DD, $DE, $DF, $E0, $E0, $E1
+        .byte   $E2, $E3, $E3, $E4, $E5, $E5, $E6, $E7, $E7, $E8, $E9, $E9, $EA, $EB, $EB, $EC
+        .byte   $ED, $ED, $EE, $EE, $EF, $EF, $F0, $F1, $F1, $F2, $F2, $F3, $F3, $F4, $F4, $F5
+        .byte   $F5, $F5, $F6, $F6, $F7, $F7, $F8, $F8, $F8, $F9, $F9, $F9, $FA, $FA, $FA, $FB
+        .byte   $FB, $FB, $FC, $FC, $FC, $FC, $FD, $FD, $FD, $FD, $FE, $FE, $FE, $FE, $FE, $FF
+        .byte   $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF, $FF
+; atan() of 0 to 255 / 256, in angle units
+atan_tab:
+        .byte   $00, $01, $01, $02, $03, $03, $04, $04, $05, $06, $06, $07, $08, $08, $09, $0A
+        .byte   $0A, $0B, $0B, $0C, $0D, $0D, $0E, $0F, $0F, $10, $10, $11, $12, $12, $13, $14
+        .byte   $14, $15, $16, $16, $17, $17, $18, $19, $19, $1A, $1B, $1B, $1C, $1C, $1D, $1E
+        .byte   $1E, $1F, $1F, $20, $21, $21, $22, $22, $23, $24, $24, $25, $26, $26, $27, $27
+        .byte   $28, $29, $29, $2A, $2A, $2B, $2C, $2C, $2D, $2D, $2E, $2E, $2F, $30, $30, $31
+        .byte   $31, $32, $33, $33, $34, $34, $35, $35, $36, $37, $37, $38, $38, $39, $39, $3A
+        .byte   $3A, $3B, $3C, $3C, $3D, $3D, $3E, $3E, $3F, $3F, $40, $41, $41, $42, $42, $43
+        .byte   $43, $44, $44, $45, $45, $46, $46, $47, $47, $48, $48, $49, $4A, $4A, $4B, $4B
+        .byte   $4C, $4C, $4D, $4D, $4E, $4E, $4F, $4F, $50, $50, $51, $51, $52, $52, $53, $53
+        .byte   $54, $54, $54, $55, $55, $56, $56, $57, $57, $58, $58, $59, $59, $5A, $5A, $5B
+        .byte   $5B, $5B, $5C, $5C, $5D, $5D, $5E, $5E, $5F, $5F, $60, $60, $60, $61, $61, $62
+        .byte   $62, $63, $63, $63, $64, $64, $65, $65, $66, $66, $66, $67, $67, $68, $68, $68
+        .byte   $69, $69, $6A, $6A, $6A, $6B, $6B, $6C, $6C, $6C, $6D, $6D, $6E, $6E, $6E, $6F
+        .byte   $6F, $70, $70, $70, $71, $71, $71, $72, $72, $73, $73, $73, $74, $74, $74, $75
+        .byte   $75, $76, $76, $76, $77, $77, $77, $78, $78, $78, $79, $79, $79, $7A, $7A, $7A
+        .byte   $7B, $7B, $7B, $7C, $7C, $7C, $7D, $7D, $7D, $7E, $7E, $7E, $7F, $7F, $7F, $80
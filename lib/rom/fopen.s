@@ -0,0 +1,259 @@
+; fopen.s - fopen/freopen/fclose/fflush/setvbuf for clib.rom
+; ROM side, with the stream table in filetab.s.
+;
+; fopen takes the modes "r", "w" and "a", each with an optional "+", and
+; ignores "b". A new stream is full-buffered, with a FILE_BUFSIZ buffer
+; from page_alloc (pages.s) when it is first used. setvbuf may be called
+; at any time: it empties the buffer first, and a buffer it is given
+; stays the application's, so it can be anywhere in memory the program
+; chooses.
+; A buffer given with a size of 0 is refused with EINVAL.
+; freopen closes the stream as fclose does, writing out and giving back
+; its buffer, before opening the new file in the same FILE.
+
+        .export _fopen, __fopen, _freopen, _fclose, _fflush, _setvbuf
+
+        .import _open, _close, page_free, __fdesc
+        .import incsp2, incsp4, popax, pushax
+        .importzp ptr1, ptr4
+
+        .include "errno.inc"
+        .include "fcntl.inc"
+        .include "fd.inc"
+        .include "file.inc"
+
+        .bss
+
+index:  .res    1               ; fflush(NULL): the stream in __filetab
+failed: .res    1               ; fflush(NULL), fclose: not 0 on an error
+mode:   .res    1               ; setvbuf
+
+        .code
+
+; FILE* __fastcall__ fopen(const char* name, const char* mode);
+_fopen:
+        jsr     pushax          ; for _fopen
+        jsr     __fdesc
+        cpx     #0
+        bne     __fopen
+        jsr     incsp4
+        lda     #EMFILE
+        jsr     fd_error
+        jmp     null
+
+; FILE* __fastcall__ _fopen(const char* name, const char* mode, FILE* f);
+__fopen:
+        sta     file_ptr
+        stx     file_ptr+1
+        jsr     popax           ; mode
+        sta     ptr1
+        stx     ptr1+1
+        ldy     #0
+        lda     (ptr1),y
+        ldx     #O_RDONLY
+        cmp     #'r'
+        beq     @plus
+        ldx     #O_WRONLY | O_CREAT | O_TRUNC
+        cmp     #'w'
+        beq     @plus
+        ldx     #O_WRONLY | O_CREAT | O_APPEND
+        cmp     #'a'
+        beq     @plus
+        jsr     incsp2          ; name
+        lda     #EINVAL
+        jsr     fd_error
+        jmp     null
+
+@plus:  iny                     ; "+" anywhere after the letter
+        lda     (ptr1),y
+        beq     @open
+        cmp     #'+'
+        bne     @plus
+        txa
+        ora     #O_RDWR
+        tax
+
+@open:  txa                     ; open(name, flags)
+        ldx     #0
+        jsr     pushax
+        ldy     #4
+        jsr     _open
+        cpx     #$FF
+        beq     null
+        pha
+        jsr     file_load
+        lda     #0              ; a fresh FILE: full-buffered, no buffer
+        ldy     #FILE_SIZE - 1
+:       sta     (ptr4),y
+        dey
+        bne     :-
+        pla
+        sta     (ptr4),y        ; F_FD
+        ldy     #F_FLAGS
+        lda     #FILE_OPEN
+        sta     (ptr4),y
+        lda     file_ptr
+        ldx     file_ptr+1
+        rts
+
+null:   lda     #0
+        tax
+        rts
+
+; FILE* __fastcall__ freopen(const char* name, const char* mode, FILE* f);
+; f is closed even if the new file cannot be opened
+_freopen:
+        jsr     file_check
+        bcs     @fail
+        jsr     close_stream
+        lda     file_ptr
+        ldx     file_ptr+1
+        jmp     __fopen
+@fail:  jsr     incsp4
+        jmp     null
+
+; int __fastcall__ fclose(FILE* f);
+_fclose:
+        jsr     file_check
+        bcs     @done
+        jsr     close_stream
+        lda     failed
+        bne     eof
+        tax
+@done:  rts
+
+eof:    lda     #$FF            ; EOF
+        tax
+        rts
+
+; Close the stream at ptr4: write out its buffer, close the descriptor,
+; give back the buffer and free the FILE. failed is not 0 if the write or
+; the close failed.
+close_stream:
+        jsr     file_flush
+        lda     #0
+        rol     a
+        sta     failed
+        ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     _close
+        jsr     file_load
+        cpx     #0
+        beq     :+
+        inc     failed
+:       jsr     free_buffer
+        lda     #0              ; the FILE is free
+        ldy     #FILE_SIZE - 1
+:       sta     (ptr4),y
+        dey
+        bpl     :-
+        rts
+
+; int __fastcall__ fflush(FILE* f);
+; NULL flushes every open stream
+_fflush:
+        cpx     #0
+        bne     @one
+        cmp     #0
+        bne     @one
+        sta     index
+        sta     failed
+@next:  ldy     index
+        lda     __filetab+F_FLAGS,y
+        and     #FILE_OPEN
+        beq     @skip
+        tya
+        clc
+        adc     #<__filetab
+        ldx     #>__filetab
+        bcc     :+
+        inx
+:       jsr     file_check
+        jsr     file_flush
+        bcc     @skip
+        inc     failed
+@skip:  lda     index
+        clc
+        adc     #FILE_SIZE
+        sta     index
+        cmp     #FILE_COUNT * FILE_SIZE
+        bcc     @next
+        lda     failed
+        bne     eof
+        tax
+        rts
+
+@one:   jsr     file_check
+        bcs     @done
+        jsr     file_flush
+        bcs     eof
+        lda     #0
+        tax
+@done:  rts
+
+; int __fastcall__ setvbuf(FILE* f, char* buf, int mode, size_t size);
+_setvbuf:
+        sta     file_left       ; size, until the stream is checked
+        stx     file_left+1
+        jsr     popax
+        sta     mode
+        jsr     popax           ; buf
+        sta     file_src
+        stx     file_src+1
+        jsr     popax
+        jsr     file_check
+        bcs     @done
+        lda     mode
+        cmp     #IO_NONE + 1
+        bcs     @bad
+        lda     file_src+1      ; a buffer given needs its size; size 0
+        beq     :+              ; only means BUFSIZ for our own
+        lda     file_left
+        ora     file_left+1
+        beq     @bad
+:       jsr     file_flush
+        jsr     free_buffer
+        ldy     #F_MODE
+        lda     mode
+        sta     (ptr4),y
+        iny                     ; F_BUF
+        lda     file_src
+        sta     (ptr4),y
+        iny
+        lda     file_src+1
+        sta     (ptr4),y
+        iny                     ; F_SIZE
+        lda     file_left
+        sta     (ptr4),y
+        iny
+        lda     file_left+1
+        sta     (ptr4),y
+        lda     #0
+        tax
+@done:  rts
+@bad:   lda     #EINVAL
+        jmp     fd_error
+
+; Give back the buffer of the stream at ptr4 if it came from page_alloc
+free_buffer:
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_OWNBUF
+        beq     @done
+        lda     (ptr4),y
+        and     #<~FILE_OWNBUF
+        sta     (ptr4),y
+        ldy     #F_BUF+1
+        lda     (ptr4),y
+        tax
+        dey
+        lda     (ptr4),y
+        jsr     page_free
+        jsr     file_load
+        lda     #0
+        ldy     #F_BUF
+        sta     (ptr4),y
+        iny
+        sta     (ptr4),y
+@done:  rts
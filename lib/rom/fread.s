@@ -0,0 +1,450 @@
+; fread.s - fgetc/fread/fgets for clib.rom
+; ROM side, with the stream table in filetab.s.
+;
+; A buffered stream is read a buffer at a time. fgetc takes the next byte
+; from it, and fgets copies a line straight out of it, looking for the
+; '\n' as it goes. A request to fread that is at least a buffer long, once
+; the buffer is empty, is read straight into the caller's memory.
+
+        .export _fgetc, _fread, _fgets
+
+        .import popax, pushax, tosumulax, tosudivax
+        .importzp ptr1, ptr2, ptr3, ptr4, tmp1
+
+        .include "fd.inc"
+        .include "file.inc"
+
+        .bss
+
+byte:   .res    1               ; an unbuffered fgetc reads into this
+count:  .res    2               ; fread: items asked for
+size:   .res    2               ; fread: item size
+start:  .res    2               ; fgets: the caller's buffer
+
+        .code
+
+; int __fastcall__ fgetc(FILE* f);
+_fgetc:
+        jsr     file_check
+        bcc     getc
+        rts
+
+; The next character of the stream at ptr4 in A/X, or EOF
+getc:   ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_PUSHBACK | FILE_READING
+        cmp     #FILE_READING
+        bne     @other
+        ldy     #F_POS          ; the usual case: more in the buffer
+        lda     (ptr4),y
+        ldy     #F_LEN
+        cmp     (ptr4),y
+        bne     @take
+        ldy     #F_POS+1
+        lda     (ptr4),y
+        ldy     #F_LEN+1
+        cmp     (ptr4),y
+        bne     @take
+        beq     @buffer         ; always
+
+@other: and     #FILE_PUSHBACK
+        beq     @buffer
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #<~FILE_PUSHBACK
+        sta     (ptr4),y
+        ldy     #F_PUSHBACK
+        lda     (ptr4),y
+        ldx     #0
+        rts
+
+@buffer:
+        jsr     start_read
+        bcs     eof
+        jsr     file_buffer
+        bcs     @direct
+        jsr     available
+        bne     @take
+        jsr     file_fill
+        bcs     eof
+@take:  ldy     #F_BUF          ; buf[pos++]
+        lda     (ptr4),y
+        ldy     #F_POS
+        clc
+        adc     (ptr4),y
+        sta     ptr3
+        ldy     #F_BUF+1
+        lda     (ptr4),y
+        ldy     #F_POS+1
+        adc     (ptr4),y
+        sta     ptr3+1
+        ldy     #F_POS
+        lda     (ptr4),y
+        clc
+        adc     #1
+        sta     (ptr4),y
+        bcc     :+
+        iny
+        lda     (ptr4),y
+        adc     #0
+        sta     (ptr4),y
+:       ldy     #0
+        lda     (ptr3),y
+        ldx     #0
+        rts
+
+@direct:
+        lda     #<byte
+        sta     ptr1
+        lda     #>byte
+        sta     ptr1+1
+        lda     #1
+        sta     ptr2
+        lda     #0
+        sta     ptr2+1
+        ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     fd_read
+        jsr     file_load
+        cpx     #0
+        bmi     @error
+        cmp     #0
+        beq     @eof
+        lda     byte
+        rts                     ; X = 0
+@eof:   lda     #FILE_EOF
+        bne     @set            ; always
+@error: lda     #FILE_ERROR
+@set:   ldy     #F_FLAGS
+        ora     (ptr4),y
+        sta     (ptr4),y
+eof:    lda     #$FF
+        tax
+        rts
+
+; Write out anything waiting in the buffer of the stream at ptr4 before
+; reading from it; C set if that fails
+start_read:
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_WRITING
+        beq     :+
+        jmp     file_flush
+:       clc
+        rts
+
+; Bytes in the buffer of the stream at ptr4 not yet read, len - pos, in
+; ptr2; Z set if there are none
+available:
+        ldy     #F_LEN
+        lda     (ptr4),y
+        ldy     #F_POS
+        sec
+        sbc     (ptr4),y
+        sta     ptr2
+        ldy     #F_LEN+1
+        lda     (ptr4),y
+        ldy     #F_POS+1
+        sbc     (ptr4),y
+        sta     ptr2+1
+        ora     ptr2
+        rts
+
+; ptr1 = the buffer of the stream at ptr4 at its read position, and
+; pos += ptr2, the bytes about to be taken from there
+take:   ldy     #F_BUF
+        lda     (ptr4),y
+        ldy     #F_POS
+        clc
+        adc     (ptr4),y
+        sta     ptr1
+        ldy     #F_BUF+1
+        lda     (ptr4),y
+        ldy     #F_POS+1
+        adc     (ptr4),y
+        sta     ptr1+1
+        ldy     #F_POS
+        lda     (ptr4),y
+        clc
+        adc     ptr2
+        sta     (ptr4),y
+        iny
+        lda     (ptr4),y
+        adc     ptr2+1
+        sta     (ptr4),y
+        rts
+
+; size_t __fastcall__ fread(void* buf, size_t size, size_t count, FILE* f);
+_fread:
+        sta     ptr4            ; f, while the arguments come off
+        stx     ptr4+1
+        jsr     popax
+        sta     count
+        stx     count+1
+        jsr     popax
+        sta     size
+        stx     size+1
+        jsr     popax
+        sta     file_src
+        stx     file_src+1
+        lda     ptr4
+        ldx     ptr4+1
+        jsr     file_check
+        bcs     @none
+        lda     size            ; bytes = size * count
+        ldx     size+1
+        jsr     pushax
+        lda     count
+        ldx     count+1
+        jsr     tosumulax
+        jsr     file_load
+        sta     file_left
+        stx     file_left+1
+        stx     tmp1
+        ora     tmp1
+        beq     @none
+        lda     #0
+        sta     file_done
+        sta     file_done+1
+
+        ldy     #F_FLAGS        ; a pushed back character first
+        lda     (ptr4),y
+        and     #FILE_PUSHBACK
+        beq     @read
+        jsr     getc
+        jsr     getc_store
+@read:  jsr     get_bytes
+
+        lda     file_left       ; all of it: count
+        ora     file_left+1
+        bne     :+
+        lda     count
+        ldx     count+1
+        rts
+:       lda     file_done       ; else done / size
+        ldx     file_done+1
+        jsr     pushax
+        lda     size
+        ldx     size+1
+        jmp     tosudivax
+@none:  lda     #0
+        tax
+        rts
+
+; Store the character A at file_src and count it
+getc_store:
+        ldy     file_src
+        sty     ptr1
+        ldy     file_src+1
+        sty     ptr1+1
+        ldy     #0
+        sty     ptr2+1
+        sta     (ptr1),y
+        iny
+        sty     ptr2
+        jmp     file_advance
+
+; Move file_left bytes from the stream at ptr4 to file_src, stopping at
+; the end of the file or an error
+get_bytes:
+        lda     file_left
+        ora     file_left+1
+        beq     @end
+        jsr     start_read
+        bcc     :+
+@end:   rts
+:       jsr     file_buffer
+        bcs     @direct
+
+@next:  lda     file_left
+        ora     file_left+1
+        beq     @end
+        jsr     available
+        bne     @copy
+        lda     file_left+1     ; empty: a buffer or more goes straight
+        ldy     #F_SIZE+1       ; to the caller
+        cmp     (ptr4),y
+        bne     :+
+        lda     file_left
+        ldy     #F_SIZE
+        cmp     (ptr4),y
+:       bcs     @direct
+        jsr     file_fill
+        bcs     @done
+        bcc     @next           ; always
+
+@copy:  lda     ptr2+1          ; the smaller of what is there and left
+        cmp     file_left+1
+        bne     :+
+        lda     ptr2
+        cmp     file_left
+:       bcc     :+
+        lda     file_left
+        sta     ptr2
+        lda     file_left+1
+        sta     ptr2+1
+:       jsr     take
+        lda     file_src
+        sta     ptr3
+        lda     file_src+1
+        sta     ptr3+1
+        jsr     file_copy
+        jsr     file_advance
+        jmp     @next
+
+@direct:
+        lda     file_src
+        sta     ptr1
+        lda     file_src+1
+        sta     ptr1+1
+        lda     file_left
+        sta     ptr2
+        lda     file_left+1
+        sta     ptr2+1
+        ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     fd_read
+        jsr     file_load
+        cpx     #0
+        bmi     @error
+        sta     ptr2
+        stx     ptr2+1
+        ora     ptr2+1
+        beq     @eof            ; nothing: the end of the file
+        jsr     file_advance
+        jmp     get_bytes       ; short, as the console is: go on
+@eof:   lda     #FILE_EOF
+        bne     @set            ; always
+@error: lda     #FILE_ERROR
+@set:   ldy     #F_FLAGS
+        ora     (ptr4),y
+        sta     (ptr4),y
+@done:  rts
+
+; char* __fastcall__ fgets(char* s, int n, FILE* f);
+_fgets:
+        sta     ptr4
+        stx     ptr4+1
+        jsr     popax           ; n
+        sta     file_left
+        stx     file_left+1
+        jsr     popax
+        sta     file_src
+        stx     file_src+1
+        sta     start
+        stx     start+1
+        lda     ptr4
+        ldx     ptr4+1
+        jsr     file_check
+        bcs     @null
+        lda     file_left+1     ; n < 1: nothing can be stored
+        bmi     @null
+        ora     file_left
+        bne     @room
+@null:  lda     #0
+        tax
+        rts
+
+@room:  lda     file_left       ; room for n - 1 characters
+        bne     :+
+        dec     file_left+1
+:       dec     file_left
+        lda     #0
+        sta     file_done
+        sta     file_done+1
+        beq     @next           ; always
+
+; Pushed back, unbuffered or writing: a character at a time
+@slow:  jsr     getc
+        cpx     #0
+        bmi     @stop
+        pha
+        jsr     getc_store
+        pla
+        cmp     #10
+        bne     @next
+
+@end:   lda     file_src        ; the terminator
+        sta     ptr1
+        lda     file_src+1
+        sta     ptr1+1
+        lda     #0
+        tay
+        sta     (ptr1),y
+        lda     start
+        ldx     start+1
+        rts
+
+@stop:  lda     file_done       ; nothing before the end: NULL
+        ora     file_done+1
+        bne     @end
+        tax
+        rts
+
+@next:  lda     file_left
+        ora     file_left+1
+        beq     @end
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_PUSHBACK | FILE_WRITING
+        bne     @slow
+        jsr     file_buffer
+        bcs     @slow
+        jsr     available
+        bne     @scan
+        jsr     file_fill
+        bcs     @stop
+        jsr     available
+
+; Copy from the buffer until a '\n', the end of what is there, the end
+; of the room left, or 255 bytes, whichever comes first
+@scan:  lda     ptr2+1          ; tmp1 = the most to copy
+        beq     :+
+        lda     #$FF
+        sta     ptr2
+:       lda     file_left+1
+        bne     :+
+        lda     file_left
+        cmp     ptr2
+        bcs     :+
+        sta     ptr2
+:       lda     ptr2
+        sta     tmp1
+        lda     #0
+        sta     ptr2+1
+        jsr     take            ; pos moves on by ptr2 = tmp1
+        lda     file_src
+        sta     ptr3
+        lda     file_src+1
+        sta     ptr3+1
+        ldy     #0
+@char:  lda     (ptr1),y
+        sta     (ptr3),y
+        iny
+        cmp     #10
+        beq     @line
+        cpy     tmp1
+        bne     @char
+        sty     ptr2
+        jsr     file_advance
+        jmp     @next
+
+@line:  sty     ptr2            ; the '\n' came before tmp1: give back
+        lda     tmp1            ; the rest to the buffer
+        sec
+        sbc     ptr2
+        sta     tmp1
+        ldy     #F_POS
+        lda     (ptr4),y
+        sec
+        sbc     tmp1
+        sta     (ptr4),y
+        bcs     :+
+        iny
+        lda     (ptr4),y
+        sbc     #0
+        sta     (ptr4),y
+:       jsr     file_advance
+        jmp     @end
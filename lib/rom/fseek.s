@@ -0,0 +1,164 @@
+; fseek.s - fseek/ftell for clib.rom
+; ROM side, with the stream table in filetab.s.
+;
+; cc65's fseek and ftell go to lseek directly, which is wrong once a
+; stream has a buffer: fseek empties it first, and ftell corrects the
+; descriptor's position by what is in it.
+
+        .export _fseek, _ftell
+
+        .import _lseek, popax, popeax, pushax, pusheax
+        .importzp ptr1, ptr4, sreg
+
+        .include "stdio.inc"
+        .include "fd.inc"
+        .include "file.inc"
+
+        .bss
+
+whence: .res    1
+offset: .res    4
+
+        .code
+
+; int __fastcall__ fseek(FILE* f, long offset, int whence);
+_fseek:
+        sta     whence
+        jsr     popeax
+        sta     offset
+        stx     offset+1
+        lda     sreg
+        sta     offset+2
+        lda     sreg+1
+        sta     offset+3
+        jsr     popax
+        jsr     file_check
+        bcs     @done
+        jsr     file_flush
+        bcs     fail
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        tax
+        and     #<~(FILE_PUSHBACK | FILE_EOF)
+        sta     (ptr4),y
+        txa                     ; from here, a pushed back character
+        and     #FILE_PUSHBACK  ; counts as one back
+        beq     @seek
+        lda     whence
+        cmp     #SEEK_CUR
+        bne     @seek
+        lda     offset
+        bne     :+
+        dec     offset+1
+        lda     offset+1
+        cmp     #$FF
+        bne     :+
+        dec     offset+2
+        lda     offset+2
+        cmp     #$FF
+        bne     :+
+        dec     offset+3
+:       dec     offset
+
+@seek:  jsr     seek
+        lda     sreg+1
+        bmi     fail
+        lda     #0
+        tax
+@done:  rts
+
+fail:   lda     #$FF
+        tax
+        rts
+
+; long __fastcall__ ftell(FILE* f);
+_ftell:
+        jsr     file_check
+        bcs     @fail
+        lda     #0
+        sta     offset
+        sta     offset+1
+        sta     offset+2
+        sta     offset+3
+        lda     #SEEK_CUR
+        sta     whence
+        jsr     seek
+        ldy     sreg+1
+        bmi     @done
+
+        pha                     ; ptr1 = what the buffer moves it by
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_READING | FILE_WRITING
+        beq     @none
+        and     #FILE_WRITING
+        beq     @read
+        ldy     #F_LEN          ; waiting to go: + len
+        lda     (ptr4),y
+        sta     ptr1
+        iny
+        lda     (ptr4),y
+        sta     ptr1+1
+        jmp     @back
+@read:  ldy     #F_POS          ; read ahead: - (len - pos)
+        lda     (ptr4),y
+        ldy     #F_LEN
+        sec
+        sbc     (ptr4),y
+        sta     ptr1
+        ldy     #F_POS+1
+        lda     (ptr4),y
+        ldy     #F_LEN+1
+        sbc     (ptr4),y
+        sta     ptr1+1
+        jmp     @back
+@none:  sta     ptr1
+        sta     ptr1+1
+@back:  ldy     #F_FLAGS        ; and a pushed back character: - 1
+        lda     (ptr4),y
+        and     #FILE_PUSHBACK
+        beq     @add
+        lda     ptr1
+        bne     :+
+        dec     ptr1+1
+:       dec     ptr1
+@add:   pla                     ; position + ptr1, sign extended
+        clc
+        adc     ptr1
+        pha
+        txa
+        adc     ptr1+1
+        tax
+        ldy     #0
+        lda     ptr1+1
+        bpl     :+
+        dey
+:       tya
+        adc     sreg
+        sta     sreg
+        tya
+        adc     sreg+1
+        sta     sreg+1
+        pla
+@done:  rts
+
+@fail:  sta     sreg            ; -1 as a long
+        sta     sreg+1
+        rts
+
+; lseek(fd, offset, whence) for the stream at ptr4; ptr4 is kept
+seek:   ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     pushax
+        lda     offset+2
+        sta     sreg
+        lda     offset+3
+        sta     sreg+1
+        lda     offset
+        ldx     offset+1
+        jsr     pusheax
+        lda     whence
+        ldx     #0
+        jsr     _lseek
+        jmp     file_load
@@ -0,0 +1,703 @@
+; fujinet.s - FujiNet client over RS423 for clib.rom
+; ROM side, on serial.s: serial_open() the port first.
+;
+; Every exchange starts with a 7-byte command frame (device, command,
+; four aux bytes, checksum), which the device answers with 'A'. A command
+; that carries data then sends it with its checksum, for a second 'A'.
+; The device ends with 'C', or 'E' for an error; a command with a reply
+; then sends its payload and checksum. One routine, exchange, runs all of
+; them. It reads the status bytes one at a time as they arrive instead of
+; reading a fixed length and looking at it by index, and serial_read puts
+; the payload straight into the caller's memory with its checksum summed
+; on the way, so it is neither copied again nor walked a second time.
+; Bytes left over from an earlier exchange are thrown away before a
+; command goes out.
+;
+; fn_net_stream and fn_net_copy read N1: to its end through one buffer
+; of the caller's, a chunk at a time. STATUS says what is waiting, and
+; READs take it in chunks no bigger than the buffer, with no STATUS
+; between them while the last one's count lasts. The frame for the next
+; command goes out before a chunk is handed on, so the device answers,
+; and the serial ring fills with the next chunk, while the caller is
+; still busy with this one. A connection that STATUS says is open with
+; nothing waiting is asked again, for up to WAIT_MORE, then given up
+; with EIO.
+;
+; Errors return -1 with errno: ENODEV when nothing acknowledges the
+; command in time, EIO for a NAK, an 'E', a short reply or a bad
+; checksum, and EINVAL when the port is not open or a count is too big.
+; When serial_write fails, its errno is kept: EIO if its queue stalled.
+
+        .export _fn_reset, _fn_get_ssid, _fn_get_hosts, _fn_get_device_slots
+        .export _fn_net_open, _fn_net_status, _fn_net_read, _fn_net_write
+        .export _fn_net_close, _fn_net_stream, _fn_net_copy
+
+        .import _serial_read, _serial_write, _serial_rx_sum, _serial_tx_sum
+        .import serial_timer, serial_expired
+        .import _write
+        .import popa, popax, pushax
+        .importzp ptr1, sreg
+
+        .include "errno.inc"
+        .include "fd.inc"
+        .include "serial.inc"
+
+FN_FUJI         = $70           ; device IDs
+FN_NETWORK      = $71           ; N1:
+
+FUJI_RESET      = $FF           ; FN_FUJI commands
+FUJI_GET_SSID   = $FE
+FUJI_GET_HOSTS  = $F4
+FUJI_GET_SLOTS  = $F2
+NET_OPEN        = 'O'           ; FN_NETWORK commands
+NET_CLOSE       = 'C'
+NET_READ        = 'R'
+NET_STATUS      = 'S'
+NET_WRITE       = 'W'
+
+SSID_SIZE       = 33 + 64       ; reply payloads
+HOSTS_SIZE      = 8 * 32
+SLOTS_SIZE      = 8 * 38
+STATUS_SIZE     = 4
+NET_EOF         = 136           ; the status error byte at the end
+URL_SIZE        = 256           ; the devicespec block NET_OPEN sends
+
+ACK             = 'A'
+COMPLETE        = 'C'
+
+; serial_read timeouts, in centiseconds
+WAIT_ACK        = 50            ; for an 'A'
+WAIT_DONE       = 1500          ; for the 'C': opening a URL takes a while
+WAIT_DATA       = 50            ; between payload bytes
+WAIT_MORE       = 1500          ; for a stream with nothing waiting
+
+ZEROS_SIZE      = 32
+
+        .bss
+
+frame:          .res 2          ; device, command
+aux:            .res 4
+check:          .res 1          ; the frame's checksum
+out_len:        .res 2          ; bytes to send after the 'A'
+out_pad:        .res 2          ; and zeros after them
+in_len:         .res 2          ; payload bytes after the 'C'
+CLEAR           = in_len + 2 - aux  ; setup zeroes aux to here
+out_buf:        .res 2
+in_buf:         .res 2
+byte:           .res 1          ; a status byte, or a checksum
+wait:           .res 2          ; get_byte's timeout, write's count
+sum:            .res 1          ; the payload's sum as received
+
+; fn_net_stream and fn_net_copy
+chunk_buf:      .res 2
+chunk_max:      .res 2
+chunk:          .res 2          ; the chunk being handed on
+known:          .res 2          ; bytes STATUS said are waiting, less READs
+total:          .res 4
+sink:           .res 2          ; what chunks are handed to, less 1
+sink_fd:        .res 2          ; fn_net_copy's fd
+status:         .res STATUS_SIZE
+
+        .rodata
+
+zeros:          .res ZEROS_SIZE, 0
+
+        .code
+
+; int fn_reset(void);
+_fn_reset:
+        lda     #FN_FUJI
+        ldx     #FUJI_RESET
+        jsr     setup
+        jmp     run
+
+; int __fastcall__ fn_get_ssid(struct fn_ssid* ssid);
+_fn_get_ssid:
+        ldy     #FUJI_GET_SSID
+        jsr     fuji_in
+        lda     #SSID_SIZE
+        ldx     #0
+        jmp     run_in
+
+; int __fastcall__ fn_get_hosts(char (*hosts)[32]);
+_fn_get_hosts:
+        ldy     #FUJI_GET_HOSTS
+        jsr     fuji_in
+        lda     #<HOSTS_SIZE
+        ldx     #>HOSTS_SIZE
+        jmp     run_in
+
+; int __fastcall__ fn_get_device_slots(struct fn_device_slot* slots);
+_fn_get_device_slots:
+        ldy     #FUJI_GET_SLOTS
+        jsr     fuji_in
+        lda     #<SLOTS_SIZE
+        ldx     #>SLOTS_SIZE
+        jmp     run_in
+
+; int __fastcall__ fn_net_open(const char* url, unsigned char mode,
+;                              unsigned char trans);
+_fn_net_open:
+        pha                     ; trans, aux2
+        jsr     popa
+        pha                     ; mode, aux1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        lda     #FN_NETWORK
+        ldx     #NET_OPEN
+        jsr     setup
+        pla
+        sta     aux
+        pla
+        sta     aux+1
+        lda     ptr1            ; the URL, then zeros to URL_SIZE; it
+        sta     out_buf         ; needs at least one of them
+        lda     ptr1+1
+        sta     out_buf+1
+        ldy     #0
+:       lda     (ptr1),y
+        beq     :+
+        iny
+        bne     :-
+        lda     #EINVAL
+        jmp     fd_error
+:       sty     out_len
+        tya
+        eor     #$FF            ; 256 - len
+        clc
+        adc     #1
+        sta     out_pad
+        bne     :+
+        inc     out_pad+1       ; "": all 256
+:       jmp     run
+
+; int __fastcall__ fn_net_status(struct fn_net_status* status);
+_fn_net_status:
+        ldy     #NET_STATUS
+        jsr     net_in
+        lda     #STATUS_SIZE
+        ldx     #0
+        jmp     run_in
+
+; int __fastcall__ fn_net_read(void* buf, unsigned int n);
+_fn_net_read:
+        ldy     #NET_READ
+        jsr     net_len
+        bcs     net_error
+        sta     in_len
+        stx     in_len+1
+        jsr     exchange
+        bcs     net_error
+        lda     in_len
+        ldx     in_len+1
+        rts
+
+; int __fastcall__ fn_net_write(const void* buf, unsigned int n);
+_fn_net_write:
+        ldy     #NET_WRITE
+        jsr     net_len
+        bcs     net_error
+        sta     out_len
+        stx     out_len+1
+        lda     in_buf          ; net_len put buf there
+        sta     out_buf
+        lda     in_buf+1
+        sta     out_buf+1
+        jsr     exchange
+        bcc     :+
+net_error:
+        jmp     fd_error
+:       lda     out_len
+        ldx     out_len+1
+        rts
+
+; int fn_net_close(void);
+_fn_net_close:
+        lda     #FN_NETWORK
+        ldx     #NET_CLOSE
+        jsr     setup
+        jmp     run
+
+; NET_READ and NET_WRITE: pop buf into in_buf and return n in A/X, and
+; in aux1 and aux2, with C clear; or C set with EINVAL in A if n is over
+; 32767, which would come back looking like -1 and an errno
+net_len:
+        sta     ptr1
+        stx     ptr1+1
+        tya
+        tax
+        lda     #FN_NETWORK
+        jsr     setup
+        lda     ptr1
+        sta     aux
+        lda     ptr1+1
+        sta     aux+1
+        jsr     popax
+        sta     in_buf
+        stx     in_buf+1
+        lda     ptr1
+        ldx     ptr1+1
+        cpx     #$80
+        bcc     :+
+        lda     #EINVAL
+:       rts
+
+; Command Y to FN_FUJI, or to FN_NETWORK, with the pointer in A/X as
+; the payload's destination
+fuji_in:
+        sta     in_buf
+        stx     in_buf+1
+        lda     #FN_FUJI
+        bne     :+
+net_in:
+        sta     in_buf
+        stx     in_buf+1
+        lda     #FN_NETWORK
+:       pha
+        tya
+        tax
+        pla
+        jmp     setup
+
+; Run it with a payload of A/X bytes to come back
+run_in:
+        sta     in_len
+        stx     in_len+1
+run:
+        jsr     exchange
+        bcs     error
+        lda     #0
+        tax
+        rts
+error:
+        jmp     fd_error
+
+; Start a frame: device A, command X, and nothing else
+setup:
+        sta     frame
+        stx     frame+1
+        lda     #0
+        ldx     #CLEAR - 1
+:       sta     aux,x
+        dex
+        bpl     :-
+        rts
+
+; long __fastcall__ fn_net_stream(void* buf, unsigned int n,
+;                                 int __fastcall__ (*fn)(const void* buf,
+;                                                        unsigned int n));
+_fn_net_stream:
+        sec
+        sbc     #1
+        sta     sink
+        txa
+        sbc     #0
+        sta     sink+1
+        jsr     popax
+        jsr     stream_args
+        jmp     stream
+
+; long __fastcall__ fn_net_copy(int fd, void* buf, unsigned int n);
+_fn_net_copy:
+        jsr     stream_args
+        jsr     popax
+        sta     sink_fd
+        stx     sink_fd+1
+        lda     #<(to_fd - 1)
+        sta     sink
+        lda     #>(to_fd - 1)
+        sta     sink+1
+
+; Read to the end, handing each chunk on as the next is asked for
+stream:
+        lda     chunk_max
+        ora     chunk_max+1
+        bne     @go
+        lda     #EINVAL
+@fail:  jsr     fd_error
+@minus: lda     #$FF
+        tax
+        sta     sreg
+        sta     sreg+1
+        rts
+@go:    lda     #0
+        ldx     #3
+:       sta     total,x
+        dex
+        bpl     :-
+        sta     known
+        sta     known+1
+        jsr     wait_more
+        jsr     drain
+        bcs     @fail
+        jsr     ask
+        bcs     @fail
+@next:  jsr     get_ack
+        bcs     @fail
+        jsr     get_reply
+        bcs     @fail
+        lda     frame+1
+        cmp     #NET_STATUS
+        beq     @status
+        jsr     count           ; a chunk: ask for the next before
+        jsr     ask             ; handing it on
+        bcs     @fail
+        lda     chunk_buf
+        ldx     chunk_buf+1
+        jsr     pushax
+        jsr     call_sink
+        cpx     #$80            ; negative: stop, with the sink's errno,
+        bcc     @next           ; once the frame just sent is answered
+        jsr     get_ack
+        bcs     @minus
+        jsr     get_reply
+        jmp     @minus
+@status:
+        lda     status
+        sta     known
+        lda     status+1
+        sta     known+1
+        ora     known
+        bne     @data
+        lda     status+3        ; nothing waiting: the end, an error, or
+        cmp     #NET_EOF        ; not here yet
+        beq     @done
+        cmp     #1
+        bne     @eio
+        lda     status+2
+        beq     @done
+        ldx     #TIMER_STREAM   ; not for WAIT_MORE, though
+        jsr     serial_expired
+        bcs     @eio
+        bcc     @more
+@data:  jsr     wait_more
+@more:  jsr     ask
+        bcs     @error
+        jmp     @next
+@done:  lda     total+2
+        sta     sreg
+        lda     total+3
+        sta     sreg+1
+        lda     total
+        ldx     total+1
+        rts
+@eio:   lda     #EIO
+@error: jmp     @fail
+
+; Give a stream with nothing waiting WAIT_MORE from the next STATUS that
+; says so
+wait_more:
+        lda     #<WAIT_MORE
+        ldy     #>WAIT_MORE
+        ldx     #TIMER_STREAM
+        jmp     serial_timer
+
+; The chunk that has come in: counted into total and out of known
+count:
+        lda     in_len
+        sta     chunk
+        ldx     in_len+1
+        stx     chunk+1
+        clc
+        adc     total
+        sta     total
+        txa
+        adc     total+1
+        sta     total+1
+        bcc     :+
+        inc     total+2
+        bne     :+
+        inc     total+3
+:       sec
+        lda     known
+        sbc     chunk
+        sta     known
+        lda     known+1
+        sbc     chunk+1
+        sta     known+1
+        rts
+
+; buf from the C stack and the chunk size in A/X
+stream_args:
+        sta     chunk_max
+        stx     chunk_max+1
+        jsr     popax
+        sta     chunk_buf
+        stx     chunk_buf+1
+        rts
+
+; Send the next frame without waiting for its 'A': a READ of what is
+; known to be waiting, up to a buffer's worth, or a STATUS. C set, with
+; the errno in A, if it could not be sent.
+ask:
+        lda     #FN_NETWORK
+        ldx     #NET_STATUS
+        ldy     known
+        bne     @read
+        ldy     known+1
+        bne     @read
+        jsr     setup
+        lda     #<status
+        sta     in_buf
+        lda     #>status
+        sta     in_buf+1
+        lda     #STATUS_SIZE
+        sta     in_len
+        jmp     put_frame
+@read:  ldx     #NET_READ
+        jsr     setup
+        lda     chunk_buf
+        sta     in_buf
+        lda     chunk_buf+1
+        sta     in_buf+1
+        lda     known           ; in_len = min(known, chunk_max)
+        ldx     known+1
+        cmp     chunk_max
+        txa
+        sbc     chunk_max+1
+        lda     known
+        bcc     :+
+        lda     chunk_max
+        ldx     chunk_max+1
+:       sta     in_len
+        stx     in_len+1
+        sta     aux
+        stx     aux+1
+        jmp     put_frame
+
+; Hand the chunk to the sink by RTS to its address less 1, rather than
+; JMP (sink), which the NMOS 6502 reads wrongly if sink ends a page
+call_sink:
+        lda     sink+1
+        pha
+        lda     sink
+        pha
+        lda     chunk
+        ldx     chunk+1
+        rts
+
+; fn_net_copy's sink: write(fd, chunk_buf, chunk), which must take all
+; of it, or EIO
+to_fd:
+        jsr     popax
+        lda     sink_fd
+        ldx     sink_fd+1
+        jsr     pushax
+        lda     chunk_buf
+        ldx     chunk_buf+1
+        jsr     pushax
+        lda     chunk
+        ldx     chunk+1
+        jsr     _write
+        cpx     #$80
+        bcs     @out            ; -1 from write, errno set
+        cmp     chunk
+        bne     @short
+        cpx     chunk+1
+        bne     @short
+        lda     #0
+        tax
+@out:   rts
+@short: lda     #EIO
+        jmp     fd_error
+
+; Send the frame and see the exchange through. This and the stages
+; return C clear, or C set with the errno in A.
+exchange:
+        jsr     drain
+        bcs     :+
+        jsr     send_frame
+        bcs     :+
+        jsr     send_data
+        bcs     :+
+        jsr     get_reply
+:       rts
+
+; The frame, summed as it goes, and its 'A'
+send_frame:
+        jsr     put_frame
+        bcs     :+
+        jmp     get_ack
+:       rts
+
+put_frame:
+        jsr     _serial_tx_sum  ; the sum from the frame's first byte
+        lda     #<frame
+        ldx     #>frame
+        ldy     #6
+        jsr     write
+        bcs     :+
+        jsr     _serial_tx_sum
+        sta     check
+        lda     #<check
+        ldx     #>check
+        ldy     #1
+        jmp     write
+:       rts
+
+; out_len bytes from out_buf and out_pad zeros, their sum, and the 'A'
+send_data:
+        lda     out_len
+        ora     out_len+1
+        ora     out_pad
+        ora     out_pad+1
+        beq     @none
+        jsr     _serial_tx_sum
+        lda     out_buf
+        ldx     out_buf+1
+        jsr     pushax
+        lda     out_len
+        ldx     out_len+1
+        jsr     _serial_write
+        jsr     written
+        bcs     @fail
+@pad:   lda     out_pad         ; Y = the zeros to send this time
+        ldy     #ZEROS_SIZE
+        ldx     out_pad+1
+        bne     :+
+        cmp     #ZEROS_SIZE
+        bcs     :+
+        tay
+        beq     @sum
+:       sty     byte
+        sec
+        lda     out_pad
+        sbc     byte
+        sta     out_pad
+        bcs     :+
+        dec     out_pad+1
+:       lda     #<zeros
+        ldx     #>zeros
+        jsr     write
+        bcs     @fail
+        jmp     @pad
+@sum:   jsr     _serial_tx_sum
+        sta     byte
+        lda     #<byte
+        ldx     #>byte
+        ldy     #1
+        jsr     write
+        bcs     @fail
+        jsr     get_ack
+        bcc     @none
+        lda     #EIO
+@fail:  rts
+@none:  clc
+        rts
+
+; The 'C', then in_len bytes to in_buf and their sum
+get_reply:
+        lda     #<WAIT_DONE
+        ldx     #>WAIT_DONE
+        jsr     get_byte
+        bcs     @eio
+        cmp     #COMPLETE
+        bne     @eio
+        lda     in_len
+        ora     in_len+1
+        beq     @ok
+        jsr     _serial_rx_sum
+        lda     in_buf
+        ldx     in_buf+1
+        jsr     pushax
+        lda     in_len
+        ldx     in_len+1
+        jsr     pushax
+        lda     #<WAIT_DATA
+        ldx     #>WAIT_DATA
+        jsr     _serial_read
+        cmp     in_len
+        bne     @eio
+        cpx     in_len+1
+        bne     @eio
+        jsr     _serial_rx_sum
+        sta     sum
+        lda     #<WAIT_DATA
+        ldx     #>WAIT_DATA
+        jsr     get_byte
+        bcs     @eio
+        cmp     sum
+        bne     @eio
+@ok:    clc
+        rts
+@eio:   lda     #EIO
+        sec
+        rts
+
+; An 'A' within WAIT_ACK: C set if not, with ENODEV in A if nothing came
+; and EIO if something else did
+get_ack:
+        lda     #<WAIT_ACK
+        ldx     #>WAIT_ACK
+        jsr     get_byte
+        bcs     @none
+        cmp     #ACK
+        bne     @nak
+        clc
+        rts
+@none:  lda     #ENODEV
+        rts
+@nak:   lda     #EIO
+        sec
+        rts
+
+; serial_write Y bytes from A/X: C set, with its errno in A, if it
+; failed
+write:
+        sty     wait            ; pushax takes Y
+        jsr     pushax
+        lda     wait
+        ldx     #0
+        jsr     _serial_write
+
+; C set, with the errno serial_write set in A, if it returned -1
+written:
+        cpx     #$80
+        bcc     :+
+        lda     ___errno
+:       rts
+
+; One byte into byte and A, waiting up to A/X centiseconds: C set if
+; none came
+get_byte:
+        sta     wait
+        stx     wait+1
+        lda     #<byte
+        ldx     #>byte
+        jsr     pushax
+        lda     #1
+        ldx     #0
+        jsr     pushax
+        lda     wait
+        ldx     wait+1
+        jsr     _serial_read
+        cmp     #1
+        bne     :+
+        lda     byte
+        clc
+        rts
+:       sec
+        rts
+
+; Throw away whatever is already waiting: C set, with EINVAL in A, if
+; the port is not open
+drain:
+        lda     #<byte
+        ldx     #>byte
+        jsr     pushax
+        lda     #1
+        ldx     #0
+        jsr     pushax
+        lda     #0
+        tax
+        jsr     _serial_read
+        cpx     #0
+        bne     :+
+        cmp     #0
+        bne     drain
+        clc
+        rts
+:       lda     #EINVAL
+        sec
+        rts
@@ -0,0 +1,382 @@
+; fwrite.s - fputc/fwrite/fputs/puts for clib.rom
+; ROM side, with the stream table in filetab.s.
+;
+; Output to a buffered stream is copied into its buffer, which goes to
+; write() when it is full, or, line-buffered, when it holds a '\n'. A
+; request that is at least a buffer long, once the buffer is empty, is
+; written straight from the caller's memory.
+
+        .export _fputc, _fwrite, _fputs, _puts
+
+        .import _stdout, popax, pushax, tosumulax, tosudivax
+        .importzp ptr1, ptr2, ptr3, ptr4
+
+        .include "fd.inc"
+        .include "file.inc"
+
+        .bss
+
+byte:   .res    1               ; fputc's character
+count:  .res    2               ; fwrite: items asked for
+size:   .res    2               ; fwrite: item size
+line:   .res    1               ; put_bytes: not 0 once a '\n' is buffered
+
+        .code
+
+; int __fastcall__ fputc(int c, FILE* f);
+_fputc:
+        sta     ptr4
+        stx     ptr4+1
+        jsr     popax
+        sta     byte
+        lda     ptr4
+        ldx     ptr4+1
+        jsr     file_check
+        bcc     :+
+        rts
+:       lda     byte
+
+; Write the character A to the stream at ptr4; A/X = it, or EOF
+putc:   sta     byte
+        ldy     #F_MODE         ; the usual case: full-buffered, with room
+        lda     (ptr4),y        ; for more than this one
+        bne     @slow
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        and     #FILE_READING
+        bne     @slow
+        ldy     #F_BUF+1
+        lda     (ptr4),y
+        beq     @slow
+        ldy     #F_LEN          ; len + 1 < size
+        lda     (ptr4),y
+        clc
+        adc     #1
+        sta     ptr2
+        iny
+        lda     (ptr4),y
+        adc     #0
+        sta     ptr2+1
+        lda     ptr2
+        ldy     #F_SIZE
+        cmp     (ptr4),y
+        lda     ptr2+1
+        iny
+        sbc     (ptr4),y
+        bcs     @slow
+        ldy     #F_BUF          ; buf[len++] = c
+        lda     (ptr4),y
+        ldy     #F_LEN
+        clc
+        adc     (ptr4),y
+        sta     ptr3
+        ldy     #F_BUF+1
+        lda     (ptr4),y
+        ldy     #F_LEN+1
+        adc     (ptr4),y
+        sta     ptr3+1
+        lda     ptr2+1
+        sta     (ptr4),y
+        dey
+        lda     ptr2
+        sta     (ptr4),y
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        ora     #FILE_WRITING
+        sta     (ptr4),y
+        ldy     #0
+        lda     byte
+        sta     (ptr3),y
+        ldx     #0
+        rts
+
+@slow:  lda     #<byte
+        sta     file_src
+        lda     #>byte
+        sta     file_src+1
+        lda     #1
+        sta     file_left
+        lda     #0
+        sta     file_left+1
+        jsr     put_bytes
+        bcs     eof
+        lda     byte
+        ldx     #0
+done:   rts
+
+eof:    lda     #$FF
+        tax
+        rts
+
+; int __fastcall__ fputs(const char* s, FILE* f);
+_fputs:
+        sta     ptr4
+        stx     ptr4+1
+        jsr     popax
+        jsr     string
+        lda     ptr4
+        ldx     ptr4+1
+        jsr     file_check
+        bcs     done
+        jsr     put_bytes
+        bcs     eof
+        lda     #0
+        tax
+        rts
+
+; int __fastcall__ puts(const char* s);
+_puts:
+        jsr     string
+        lda     _stdout
+        ldx     _stdout+1
+        jsr     file_check
+        bcs     done
+        jsr     put_bytes
+        bcs     eof
+        lda     #10
+        jsr     putc
+        cpx     #0
+        bmi     done
+        lda     #0
+        tax
+        rts
+
+; size_t __fastcall__ fwrite(const void* buf, size_t size, size_t count,
+;                            FILE* f);
+_fwrite:
+        sta     ptr4            ; f, while the arguments come off
+        stx     ptr4+1
+        jsr     popax
+        sta     count
+        stx     count+1
+        jsr     popax
+        sta     size
+        stx     size+1
+        jsr     popax
+        sta     file_src
+        stx     file_src+1
+        lda     ptr4
+        ldx     ptr4+1
+        jsr     file_check
+        bcs     @none
+        lda     size            ; bytes = size * count
+        ldx     size+1
+        jsr     pushax
+        lda     count
+        ldx     count+1
+        jsr     tosumulax
+        jsr     file_load
+        sta     file_left
+        stx     file_left+1
+        jsr     put_bytes
+        lda     file_left       ; all of it: count
+        ora     file_left+1
+        bne     :+
+        lda     count
+        ldx     count+1
+        rts
+:       lda     file_done       ; else done / size
+        ldx     file_done+1
+        jsr     pushax
+        lda     size
+        ldx     size+1
+        jmp     tosudivax
+@none:  lda     #0
+        tax
+        rts
+
+; file_src = the string at A/X and file_left = its length
+string: sta     file_src
+        stx     file_src+1
+        sta     ptr1
+        stx     ptr1+1
+        ldy     #0
+        sty     file_left+1
+@next:  lda     (ptr1),y
+        beq     @end
+        iny
+        bne     @next
+        inc     ptr1+1
+        inc     file_left+1
+        bne     @next           ; always
+@end:   sty     file_left
+        rts
+
+; Move file_left bytes from file_src to the stream at ptr4. C set, with
+; FILE_ERROR, if they could not all be written.
+put_bytes:
+        lda     #0
+        sta     file_done
+        sta     file_done+1
+        sta     line
+        lda     file_left
+        ora     file_left+1
+        bne     :+
+        clc
+        rts
+:       ldy     #F_FLAGS        ; read ahead: put the descriptor back first
+        lda     (ptr4),y
+        and     #FILE_READING
+        beq     :+
+        jsr     file_flush
+:       jsr     file_buffer
+        bcc     @next
+
+@direct:
+        lda     file_src
+        sta     ptr1
+        lda     file_src+1
+        sta     ptr1+1
+        lda     file_left
+        sta     ptr2
+        lda     file_left+1
+        sta     ptr2+1
+        ldy     #F_FD
+        lda     (ptr4),y
+        ldx     #0
+        jsr     fd_write
+        jsr     file_load
+        cpx     #0
+        bmi     @error
+        sta     ptr2
+        stx     ptr2+1
+        jsr     file_advance
+        lda     file_left
+        ora     file_left+1
+        bne     @error
+        clc
+        rts
+@error: ldy     #F_FLAGS
+        lda     (ptr4),y
+        ora     #FILE_ERROR
+        sta     (ptr4),y
+        sec
+        rts
+
+@line:  lda     line            ; line-buffered: out if there is a '\n'
+        bne     @flush
+        clc
+        rts
+@flush: jmp     file_flush
+
+@next:  lda     file_left
+        ora     file_left+1
+        beq     @line
+        ldy     #F_LEN          ; empty, and a buffer or more to go:
+        lda     (ptr4),y        ; straight from the caller
+        iny
+        ora     (ptr4),y
+        bne     @copy
+        lda     file_left+1
+        ldy     #F_SIZE+1
+        cmp     (ptr4),y
+        bne     :+
+        lda     file_left
+        ldy     #F_SIZE
+        cmp     (ptr4),y
+:       bcs     @direct
+
+@copy:  ldy     #F_SIZE         ; ptr2 = the room left, size - len
+        lda     (ptr4),y
+        ldy     #F_LEN
+        sec
+        sbc     (ptr4),y
+        sta     ptr2
+        ldy     #F_SIZE+1
+        lda     (ptr4),y
+        ldy     #F_LEN+1
+        sbc     (ptr4),y
+        sta     ptr2+1
+        cmp     file_left+1     ; or less, if that is all there is
+        bne     :+
+        lda     ptr2
+        cmp     file_left
+:       bcc     :+
+        lda     file_left
+        sta     ptr2
+        lda     file_left+1
+        sta     ptr2+1
+:       jsr     newline
+        lda     file_src
+        sta     ptr1
+        lda     file_src+1
+        sta     ptr1+1
+        ldy     #F_BUF          ; ptr3 = buf + len
+        lda     (ptr4),y
+        ldy     #F_LEN
+        clc
+        adc     (ptr4),y
+        sta     ptr3
+        ldy     #F_BUF+1
+        lda     (ptr4),y
+        ldy     #F_LEN+1
+        adc     (ptr4),y
+        sta     ptr3+1
+        ldy     #F_LEN          ; len += ptr2
+        lda     (ptr4),y
+        clc
+        adc     ptr2
+        sta     (ptr4),y
+        iny
+        lda     (ptr4),y
+        adc     ptr2+1
+        sta     (ptr4),y
+        ldy     #F_FLAGS
+        lda     (ptr4),y
+        ora     #FILE_WRITING
+        sta     (ptr4),y
+        jsr     file_copy
+        jsr     file_advance
+        ldy     #F_LEN          ; full: out it goes
+        lda     (ptr4),y
+        ldy     #F_SIZE
+        cmp     (ptr4),y
+        bne     @more
+        ldy     #F_LEN+1
+        lda     (ptr4),y
+        ldy     #F_SIZE+1
+        cmp     (ptr4),y
+        bne     @more
+        lda     #0              ; any '\n' goes out with it
+        sta     line
+        jsr     file_flush
+        bcs     @fail
+@more:  jmp     @next
+@fail:  rts
+
+
+; Set line if the stream at ptr4 is line-buffered and the ptr2 bytes at
+; file_src, on their way into its buffer, hold a '\n'. Only what goes in
+; is looked at, never the whole buffer, so a line written a character at
+; a time costs one compare per character.
+newline:
+        ldy     #F_MODE
+        lda     (ptr4),y
+        cmp     #IO_LINE
+        bne     @done
+        lda     file_src
+        sta     ptr1
+        lda     file_src+1
+        sta     ptr1+1
+        ldy     #0
+        ldx     ptr2+1          ; whole pages
+        beq     @part
+@page:  lda     (ptr1),y
+        cmp     #10
+        beq     @found
+        iny
+        bne     @page
+        inc     ptr1+1
+        dex
+        bne     @page
+@part:  ldx     ptr2
+        beq     @done
+@byte:  lda     (ptr1),y
+        cmp     #10
+        beq     @found
+        iny
+        dex
+        bne     @byte
+@done:  rts
+@found: sta     line
+        rts
@@ -0,0 +1,103 @@
+; isqrt.s - integer square root for clib.rom
+; Declared in lib/fixed.h.
+;
+; The root is found a bit at a time from the top, two bits of the value
+; per root bit: the remainder takes the next two bits, and the root gets
+; a 1 wherever the remainder can lose root * 4 + 1. The remainder stays
+; under 2^19, so the 16 steps work on three bytes rather than 32 bits.
+; Leading zero bytes of the value are skipped four steps at a time.
+
+        .export _isqrt
+
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg, tmp1, tmp2, tmp3, tmp4
+
+; The value in ptr1/ptr2, the root in ptr3, the remainder in tmp1-tmp3
+; and root * 4 + 1 in ptr4/tmp4
+rem0    = tmp1
+rem1    = tmp2
+rem2    = tmp3
+test0   = ptr4
+test1   = ptr4+1
+test2   = tmp4
+
+        .code
+
+; unsigned int __fastcall__ isqrt(unsigned long n);
+_isqrt:
+        sta     ptr1
+        stx     ptr1+1
+        lda     sreg
+        sta     ptr2
+        lda     sreg+1
+        sta     ptr2+1
+        lda     #0
+        sta     ptr3
+        sta     ptr3+1
+        sta     rem0
+        sta     rem1
+        sta     rem2
+
+        ldy     #16
+@size:
+        ldx     ptr2+1
+        bne     @step
+        cpy     #4
+        beq     @step
+        ldx     ptr2
+        stx     ptr2+1
+        ldx     ptr1+1
+        stx     ptr2
+        ldx     ptr1
+        stx     ptr1+1
+        sta     ptr1            ; A = 0
+        dey
+        dey
+        dey
+        dey
+        bne     @size           ; always
+
+@step:
+        ldx     #2              ; next two bits into the remainder
+:       asl     ptr1
+        rol     ptr1+1
+        rol     ptr2
+        rol     ptr2+1
+        rol     rem0
+        rol     rem1
+        rol     rem2
+        dex
+        bne     :-
+        lda     ptr3            ; root * 4 + 1
+        asl     a
+        rol     ptr3+1          ; root * 2 from here on
+        sta     ptr3
+        asl     a
+        ora     #1
+        sta     test0
+        lda     ptr3+1
+        rol     a
+        sta     test1
+        lda     #0
+        rol     a
+        sta     test2
+        lda     rem0
+        cmp     test0
+        lda     rem1
+        sbc     test1
+        lda     rem2
+        sbc     test2
+        bcc     @next
+        sta     rem2
+        lda     rem0
+        sbc     test0           ; C set
+        sta     rem0
+        lda     rem1
+        sbc     test1
+        sta     rem1
+        inc     ptr3            ; bit 0 is clear after the doubling
+@next:  dey
+        bne     @step
+
+        lda     ptr3
+        ldx     ptr3+1
+        rts
@@ -0,0 +1,106 @@
+; ldiv.s - signed 32-bit division runtime for clib.rom
+; Replaces cc65's ldiv/lmod modules with wrappers around udiv32 in
+; lib/rom/ludiv.s. The quotient truncates towards zero and the remainder
+; takes the sign of the dividend. udiv32 uses every zero page temporary,
+; so the sign is kept on the CPU stack. sdiv32 is exported for the fixed
+; point divides in lib/rom/fixdiv.s.
+
+        .export tosdiv0ax, tosdiveax, tosmod0ax, tosmodeax
+        .export sdiv32
+
+        .import ludiv_params, udiv32
+        .importzp ptr1, ptr2, ptr3, sreg, tmp1, tmp2, tmp3, tmp4
+
+        .code
+
+; Entry: TOS = dividend, A/X/sreg = divisor (0ax: A/X only)
+; Exit:  A/X/sreg = quotient, TOS popped
+tosdiv0ax:
+        ldy     #0
+        sty     sreg
+        sty     sreg+1
+tosdiveax:
+        jsr     ludiv_params
+        lda     tmp4            ; signs differ: negative quotient
+        eor     sreg+1
+        pha
+        jsr     sdiv32
+        pla
+        bpl     :+
+        jsr     neg_ptr1_sreg
+:       lda     ptr1
+        ldx     ptr1+1
+        rts
+
+; Entry: TOS = dividend, A/X/sreg = divisor (0ax: A/X only)
+; Exit:  A/X/sreg = remainder, TOS popped
+tosmod0ax:
+        ldy     #0
+        sty     sreg
+        sty     sreg+1
+tosmodeax:
+        jsr     ludiv_params
+        lda     sreg+1          ; negative dividend: negative remainder
+        pha
+        jsr     sdiv32
+        pla
+        bpl     :+
+        sec
+        lda     #0
+        sbc     ptr2
+        sta     ptr2
+        lda     #0
+        sbc     ptr2+1
+        sta     ptr2+1
+        lda     #0
+        sbc     tmp1
+        sta     tmp1
+        lda     #0
+        sbc     tmp2
+        sta     tmp2
+:       lda     tmp1
+        sta     sreg
+        lda     tmp2
+        sta     sreg+1
+        lda     ptr2
+        ldx     ptr2+1
+        rts
+
+; Divide the magnitudes of ptr1:sreg and ptr3:tmp3:tmp4 with udiv32
+sdiv32:
+        lda     tmp4
+        bpl     :+
+        sec
+        lda     #0
+        sbc     ptr3
+        sta     ptr3
+        lda     #0
+        sbc     ptr3+1
+        sta     ptr3+1
+        lda     #0
+        sbc     tmp3
+        sta     tmp3
+        lda     #0
+        sbc     tmp4
+        sta     tmp4
+:       lda     sreg+1
+        bpl     :+
+        jsr     neg_ptr1_sreg
+:       jmp     udiv32
+
+; ptr1:sreg = -ptr1:sreg
+neg_ptr1_sreg:
+        sec
+        lda     #0
+        sbc     ptr1
+        sta     ptr1
+        lda     #0
+        sbc     ptr1+1
+        sta     ptr1+1
+        lda     #0
+        sbc     sreg
+        sta     sreg
+        lda     #0
+        sbc     sreg+1
+        sta     sreg+1
+        rts
@@ -0,0 +1,169 @@
+; lmul.s - 32-bit multiply runtime for clib.rom on the quarter-square tables
+; Replaces cc65's shift-and-add tosmuleax family.
+;
+; The low 32 bits of x * y are the sum of the byte products xi * yj with
+; i + j <= 3, each added in at byte i + j; those at byte 3 only need their
+; low byte. Products with a zero byte are skipped, so a long holding a
+; small value costs little more than an int multiply.
+;
+; There is no zero page left for a separate result, so the rows run from
+; x3 down to x0 and each row's result byte reuses the slot of the x byte
+; it has just finished with.
+
+        .export tosmuleax, tosumuleax, tosmul0ax, tosumul0ax
+
+        .import popax, quarter_mul8x8, quarter_mul8x8_lo
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg, tmp1, tmp4
+
+; x = ptr1:ptr2, y = ptr3:ptr4, least significant byte first
+r0      = ptr1+1                ; once x1 is done with
+r1      = ptr2                  ; once x2 is done with
+r2      = ptr2+1                ; once x3 is done with
+r3      = tmp4
+
+        .code
+
+; Entry: TOS = left operand, A/X/sreg = right operand (0ax: A/X only)
+; Exit:  A/X/sreg = low 32 bits of the product, TOS popped
+tosmul0ax:
+tosumul0ax:
+        ldy     #0
+        sty     sreg
+        sty     sreg+1
+tosmuleax:
+tosumuleax:
+        sta     ptr3
+        stx     ptr3+1
+        lda     sreg
+        sta     ptr4
+        lda     sreg+1
+        sta     ptr4+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popax
+        sta     ptr2
+        stx     ptr2+1
+        lda     #0
+        sta     r3
+
+; Row 3: x3 * y0 into r3
+        lda     ptr2+1
+        sta     tmp1
+        lda     #0
+        sta     r2
+        lda     tmp1
+        beq     @row2
+        lda     ptr3
+        jsr     quarter_mul8x8_lo
+        sta     r3
+
+; Row 2: x2 * y0 into r2, x2 * y1 into r3
+@row2:
+        lda     ptr2
+        sta     tmp1
+        lda     #0
+        sta     r1
+        lda     tmp1
+        beq     @row1
+        lda     ptr3
+        beq     :+
+        jsr     quarter_mul8x8
+        sta     r2
+        txa
+        clc
+        adc     r3
+        sta     r3
+:       lda     ptr3+1
+        beq     @row1
+        jsr     quarter_mul8x8_lo
+        clc
+        adc     r3
+        sta     r3
+
+; Row 1: x1 * y0 into r1, x1 * y1 into r2, x1 * y2 into r3
+@row1:
+        lda     ptr1+1
+        sta     tmp1
+        lda     #0
+        sta     r0
+        lda     tmp1
+        beq     @row0
+        lda     ptr3
+        beq     :+
+        jsr     quarter_mul8x8
+        sta     r1
+        txa
+        clc
+        adc     r2
+        sta     r2
+        bcc     :+
+        inc     r3
+:       lda     ptr3+1
+        beq     :+
+        jsr     quarter_mul8x8
+        clc
+        adc     r2
+        sta     r2
+        txa
+        adc     r3
+        sta     r3
+:       lda     ptr4
+        beq     @row0
+        jsr     quarter_mul8x8_lo
+        clc
+        adc     r3
+        sta     r3
+
+; Row 0: x0 * y0 into r0, x0 * y1 into r1, x0 * y2 into r2, x0 * y3 into r3
+@row0:
+        lda     ptr1
+        beq     @done
+        sta     tmp1
+        lda     ptr3
+        beq     :+
+        jsr     quarter_mul8x8
+        sta     r0
+        txa
+        clc
+        adc     r1
+        sta     r1
+        bcc     :+
+        inc     r2
+        bne     :+
+        inc     r3
+:       lda     ptr3+1
+        beq     :+
+        jsr     quarter_mul8x8
+        clc
+        adc     r1
+        sta     r1
+        txa
+        adc     r2
+        sta     r2
+        bcc     :+
+        inc     r3
+:       lda     ptr4
+        beq     :+
+        jsr     quarter_mul8x8
+        clc
+        adc     r2
+        sta     r2
+        txa
+        adc     r3
+        sta     r3
+:       lda     ptr4+1
+        beq     @done
+        jsr     quarter_mul8x8_lo
+        clc
+        adc     r3
+        sta     r3
+
+@done:
+        lda     r3
+        sta     sreg+1
+        lda     r2
+        sta     sreg
+        lda     r0
+        ldx     r1
+        rts
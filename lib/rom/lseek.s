@@ -0,0 +1,125 @@
+; lseek.s - lseek for clib.rom
+; ROM side, with the descriptor table in fdtab.s.
+;
+; The new pointer is worked out from 0 or the PTR# and EXT# that fdtab.s
+; caches, and only recorded: the next read() or write() hands it to the
+; filing system, so lseek itself makes no MOS calls. A file opened only
+; for reading cannot be moved past its end, since the filing system would
+; have to extend it, so that is EINVAL here rather than a MOS error.
+
+        .export _lseek
+
+        .import popax, popeax
+        .importzp ptr1, ptr2, sreg, tmp1, tmp3
+
+        .include "errno.inc"
+        .include "stdio.inc"
+        .include "fd.inc"
+
+whence  = tmp1
+fd      = tmp3
+
+        .code
+
+; off_t __fastcall__ lseek(int fd, off_t offset, int whence);
+_lseek:
+        sta     whence
+        jsr     popeax          ; offset
+        sta     ptr1
+        stx     ptr1+1
+        lda     sreg
+        sta     ptr2
+        lda     sreg+1
+        sta     ptr2+1
+        jsr     popax
+        jsr     fd_check
+        bcs     @badf
+        stx     fd
+        and     #FD_CONSOLE
+        bne     @pipe
+
+        lda     whence          ; where from
+        cmp     #SEEK_SET
+        beq     @check
+        cmp     #SEEK_CUR
+        beq     @add
+        cmp     #SEEK_END
+        beq     @ext
+
+; Errors return -1 as a long
+@invalid:
+        lda     #EINVAL
+        bne     @fail           ; always
+@badf:  lda     #EBADF
+        bne     @fail           ; always
+@pipe:  lda     #ESPIPE
+@fail:  jsr     fd_error
+        sta     sreg
+        sta     sreg+1
+        rts
+
+@ext:   txa                     ; fd_ext through fd_ptr
+        clc
+        adc     #4 * FD_COUNT
+        tax
+@add:   clc
+        lda     ptr1
+        adc     fd_ptr,x
+        sta     ptr1
+        lda     ptr1+1
+        adc     fd_ptr+FD_COUNT,x
+        sta     ptr1+1
+        lda     ptr2
+        adc     fd_ptr+2*FD_COUNT,x
+        sta     ptr2
+        lda     ptr2+1
+        adc     fd_ptr+3*FD_COUNT,x
+        sta     ptr2+1
+
+@check: lda     ptr2+1
+        bmi     @invalid        ; before the start
+        ldx     fd
+        lda     fd_flags,x
+        and     #FD_WRITE
+        bne     @set
+        lda     fd_ext,x        ; read only: not past EXT#
+        cmp     ptr1
+        lda     fd_ext+FD_COUNT,x
+        sbc     ptr1+1
+        lda     fd_ext+2*FD_COUNT,x
+        sbc     ptr2
+        lda     fd_ext+3*FD_COUNT,x
+        sbc     ptr2+1
+        bcc     @invalid
+
+@set:   lda     ptr1            ; somewhere new?
+        cmp     fd_ptr,x
+        bne     @move
+        lda     ptr1+1
+        cmp     fd_ptr+FD_COUNT,x
+        bne     @move
+        lda     ptr2
+        cmp     fd_ptr+2*FD_COUNT,x
+        bne     @move
+        lda     ptr2+1
+        cmp     fd_ptr+3*FD_COUNT,x
+        beq     @done
+@move:  lda     ptr1
+        sta     fd_ptr,x
+        lda     ptr1+1
+        sta     fd_ptr+FD_COUNT,x
+        lda     ptr2
+        sta     fd_ptr+2*FD_COUNT,x
+        lda     ptr2+1
+        sta     fd_ptr+3*FD_COUNT,x
+        lda     fd_flags,x
+        ora     #FD_SEEK
+        sta     fd_flags,x
+
+@done:  lda     ptr2
+        sta     sreg
+        lda     ptr2+1
+        sta     sreg+1
+        lda     ptr1
+        ldx     ptr1+1
+        rts
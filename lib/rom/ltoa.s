@@ -0,0 +1,290 @@
+; ltoa.s - itoa/utoa/ltoa/ultoa for clib.rom with a decimal mode BCD engine
+; ROM side: no self-modifying code, workspace in the cc65 zero page temps.
+;
+; Radix 10 never divides. The binary value is shifted out a bit at a time
+; and doubled into a BCD accumulator with ADC in decimal mode, then the
+; BCD digits are written out. Whole leading zero bytes are skipped first,
+; and values that fit in 16 bits only double three BCD bytes. cc65's
+; printf formats %d/%u/%ld/%lu through ltoa/ultoa, so it takes the same
+; path once these replace cc65's versions in the ROM.
+;
+; An NMOS 6502 does not clear D on an interrupt, so each doubling step
+; runs with IRQs disabled. That holds them off for about 40 cycles at a
+; time rather than for the whole conversion.
+;
+; Any other radix divides by it once per digit, as cc65 does.
+
+        .export _itoa, _utoa, _ltoa, _ultoa
+
+        .import popax, popeax, __hextab
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg, tmp1, tmp2, tmp3, tmp4
+
+; The value being converted, least significant byte first, in ptr3/ptr4,
+; and the BCD accumulator, least significant digits first
+bcd0    = tmp1
+bcd1    = tmp2
+bcd2    = tmp3
+bcd3    = tmp4
+bcd4    = sreg
+
+radix   = tmp1                  ; until the decimal path takes it over
+
+        .code
+
+; char* __fastcall__ itoa(int val, char* buf, int radix);
+_itoa:
+        jsr     int_params
+        lda     radix           ; signed in decimal only
+        cmp     #10
+        bne     convert
+        lda     ptr3+1
+        bpl     convert
+        lda     #$FF            ; sign extend
+        sta     ptr4
+        sta     ptr4+1
+        bne     convert_signed  ; always
+
+; char* __fastcall__ utoa(unsigned val, char* buf, int radix);
+_utoa:
+        jsr     int_params
+        jmp     convert
+
+; char* __fastcall__ ltoa(long val, char* buf, int radix);
+_ltoa:
+        jsr     long_params
+        jmp     convert_signed
+
+; char* __fastcall__ ultoa(unsigned long val, char* buf, int radix);
+_ultoa:
+        jsr     long_params
+        jmp     convert
+
+; Pop radix (in A/X) -> radix, buf -> ptr1 and ptr2
+buf_params:
+        sta     radix
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        sta     ptr2
+        stx     ptr2+1
+        rts
+
+; buf_params, then the 16-bit value -> ptr3, zero extended into ptr4
+int_params:
+        jsr     buf_params
+        jsr     popax
+        sta     ptr3
+        stx     ptr3+1
+        lda     #0
+        sta     ptr4
+        sta     ptr4+1
+        rts
+
+; buf_params, then the 32-bit value -> ptr3/ptr4
+long_params:
+        jsr     buf_params
+        jsr     popeax
+        sta     ptr3
+        stx     ptr3+1
+        lda     sreg
+        sta     ptr4
+        lda     sreg+1
+        sta     ptr4+1
+        rts
+
+; A negative value in radix 10 gets a '-' and is converted negated
+convert_signed:
+        lda     radix
+        cmp     #10
+        bne     convert
+        lda     ptr4+1
+        bpl     convert
+        lda     #'-'
+        ldy     #0
+        sta     (ptr1),y
+        inc     ptr1
+        bne     :+
+        inc     ptr1+1
+:       sec
+        tya                     ; A = 0
+        sbc     ptr3
+        sta     ptr3
+        tya
+        sbc     ptr3+1
+        sta     ptr3+1
+        tya
+        sbc     ptr4
+        sta     ptr4
+        tya
+        sbc     ptr4+1
+        sta     ptr4+1
+
+convert:
+        lda     radix
+        cmp     #10
+        beq     decimal
+
+; Any other radix: divide by it for each digit, least significant first,
+; and stack the digits above a zero so they pop off in order
+        lda     #0
+        pha
+@digit:
+        lda     #0              ; remainder
+        ldx     #32
+@div:
+        asl     ptr3
+        rol     ptr3+1
+        rol     ptr4
+        rol     ptr4+1
+        rol     a
+        cmp     radix
+        bcc     :+
+        sbc     radix
+        inc     ptr3
+:       dex
+        bne     @div
+        tay
+        lda     __hextab,y
+        pha
+        lda     ptr3
+        ora     ptr3+1
+        ora     ptr4
+        ora     ptr4+1
+        bne     @digit
+
+        ldy     #0
+@unstack:
+        pla
+        sta     (ptr1),y
+        beq     done
+        iny
+        bne     @unstack        ; always
+
+done:
+        lda     ptr2
+        ldx     ptr2+1
+        rts
+
+; Radix 10
+decimal:
+        lda     #0
+        sta     bcd0
+        sta     bcd1
+        sta     bcd2
+        sta     bcd3
+        sta     bcd4
+
+; Move the value up a byte at a time until its top byte is non-zero,
+; leaving X = the number of bits still to convert
+        ldx     #32
+@size:
+        lda     ptr4+1
+        bne     @sized
+        cpx     #8
+        beq     @sized          ; zero: convert one byte anyway
+        lda     ptr4
+        sta     ptr4+1
+        lda     ptr3+1
+        sta     ptr4
+        lda     ptr3
+        sta     ptr3+1
+        lda     #0
+        sta     ptr3
+        txa                     ; C set by the CPX
+        sbc     #8
+        tax
+        bne     @size           ; always
+
+@sized:
+        cpx     #17
+        bcs     @wide
+
+; Up to 16 bits, held in ptr4: at most five digits, in three BCD bytes
+@narrow:
+        asl     ptr4
+        rol     ptr4+1
+        php
+        sei
+        sed
+        lda     bcd0
+        adc     bcd0
+        sta     bcd0
+        lda     bcd1
+        adc     bcd1
+        sta     bcd1
+        lda     bcd2
+        adc     bcd2
+        sta     bcd2
+        plp
+        dex
+        bne     @narrow
+        beq     digits          ; always
+
+; Up to 32 bits: at most ten digits, in five BCD bytes
+@wide:
+        asl     ptr3
+        rol     ptr3+1
+        rol     ptr4
+        rol     ptr4+1
+        php
+        sei
+        sed
+        lda     bcd0
+        adc     bcd0
+        sta     bcd0
+        lda     bcd1
+        adc     bcd1
+        sta     bcd1
+        lda     bcd2
+        adc     bcd2
+        sta     bcd2
+        lda     bcd3
+        adc     bcd3
+        sta     bcd3
+        lda     bcd4
+        adc     bcd4
+        sta     bcd4
+        plp
+        dex
+        bne     @wide
+
+; Write the BCD digits from the most significant, Y = characters written
+digits:
+        ldy     #0
+        lda     bcd4
+        jsr     put_pair
+        lda     bcd3
+        jsr     put_pair
+        lda     bcd2
+        jsr     put_pair
+        lda     bcd1
+        jsr     put_pair
+        lda     bcd0
+        jsr     put_pair
+        tya
+        bne     :+
+        lda     #'0'            ; the value was zero
+        sta     (ptr1),y
+        iny
+:       lda     #0
+        sta     (ptr1),y
+        jmp     done
+
+; Write the two digits in A, suppressing leading zeros
+put_pair:
+        pha
+        lsr     a
+        lsr     a
+        lsr     a
+        lsr     a
+        jsr     put_digit
+        pla
+        and     #$0F
+put_digit:
+        bne     :+
+        cpy     #0              ; still a leading zero?
+        beq     :++
+:       ora     #'0'
+        sta     (ptr1),y
+        iny
+:       rts
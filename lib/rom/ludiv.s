@@ -0,0 +1,205 @@
+; ludiv.s - unsigned 32-bit division runtime for clib.rom
+; Replaces cc65's ludiv/lumod modules, keeping udiv32's interface for the
+; library code that calls it directly; lib/rom/ldiv.s builds the signed
+; forms on it.
+;
+; udiv32 skips the dividend's leading zero bytes, then runs a loop sized
+; to the divisor: a divisor under 256 keeps the remainder in A, one under
+; 65536 a 16-bit remainder, and only a full 32-bit divisor compares and
+; subtracts four bytes a bit. File offsets and byte counts divided by a
+; sector or record size take the short loops.
+
+        .export tosudiv0ax, tosudiveax, tosumod0ax, tosumodeax
+        .export udiv32, ludiv_params
+
+        .import popax
+        .importzp ptr1, ptr2, ptr3, sreg, tmp1, tmp2, tmp3, tmp4
+
+        .code
+
+; Entry: TOS = dividend, A/X/sreg = divisor (0ax: A/X only)
+; Exit:  A/X/sreg = quotient, TOS popped
+tosudiv0ax:
+        ldy     #0
+        sty     sreg
+        sty     sreg+1
+tosudiveax:
+        jsr     ludiv_params
+        jsr     udiv32
+        lda     ptr1
+        ldx     ptr1+1
+        rts
+
+; Entry: TOS = dividend, A/X/sreg = divisor (0ax: A/X only)
+; Exit:  A/X/sreg = remainder, TOS popped
+tosumod0ax:
+        ldy     #0
+        sty     sreg
+        sty     sreg+1
+tosumodeax:
+        jsr     ludiv_params
+        jsr     udiv32
+        lda     tmp1
+        sta     sreg
+        lda     tmp2
+        sta     sreg+1
+        lda     ptr2
+        ldx     ptr2+1
+        rts
+
+; Divisor (in A/X/sreg) -> ptr3:tmp3:tmp4, dividend -> ptr1:sreg
+ludiv_params:
+        sta     ptr3
+        stx     ptr3+1
+        lda     sreg
+        sta     tmp3
+        lda     sreg+1
+        sta     tmp4
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popax
+        sta     sreg
+        stx     sreg+1
+        rts
+
+; ptr1:sreg / ptr3:tmp3:tmp4 -> quotient in ptr1:sreg, remainder in
+; ptr2:tmp1:tmp2. Division by zero gives a quotient of $FFFFFFFF and
+; the dividend as the remainder.
+udiv32:
+        lda     ptr3
+        ora     ptr3+1
+        ora     tmp3
+        ora     tmp4
+        beq     @by_zero
+        lda     #0
+        sta     ptr2
+        sta     ptr2+1
+        sta     tmp1
+        sta     tmp2
+
+; Move the dividend up a byte at a time until its top byte is non-zero,
+; leaving Y = the number of quotient bits to produce
+        ldy     #32
+@size:
+        ldx     sreg+1
+        bne     @sized
+        cpy     #8
+        beq     @sized
+        ldx     sreg
+        stx     sreg+1
+        ldx     ptr1+1
+        stx     sreg
+        ldx     ptr1
+        stx     ptr1+1
+        sta     ptr1            ; A = 0
+        tya                     ; C set by the CPY
+        sbc     #8
+        tay
+        lda     #0
+        beq     @size           ; always
+
+; Division by zero: what the full 32 steps would leave, every quotient
+; bit set and the dividend as the remainder. Skipping the dividend's
+; leading zero bytes would otherwise cut the quotient short.
+@by_zero:
+        lda     ptr1
+        sta     ptr2
+        lda     ptr1+1
+        sta     ptr2+1
+        lda     sreg
+        sta     tmp1
+        lda     sreg+1
+        sta     tmp2
+        lda     #$FF
+        sta     ptr1
+        sta     ptr1+1
+        sta     sreg
+        sta     sreg+1
+        rts
+
+@sized:
+        lda     tmp3
+        ora     tmp4
+        bne     @by32
+        lda     ptr3+1
+        bne     @by16
+
+; Divisor under 256: remainder in A, with the bit shifted out in C
+@by8:
+        asl     ptr1
+        rol     ptr1+1
+        rol     sreg
+        rol     sreg+1
+        rol     a
+        bcs     :+
+        cmp     ptr3
+        bcc     :++
+:       sbc     ptr3
+        inc     ptr1
+:       dey
+        bne     @by8
+        sta     ptr2
+        rts
+
+; Divisor under 65536: 16-bit remainder in ptr2
+@by16:
+        asl     ptr1
+        rol     ptr1+1
+        rol     sreg
+        rol     sreg+1
+        rol     ptr2
+        rol     ptr2+1
+        bcs     :+
+        lda     ptr2
+        cmp     ptr3
+        lda     ptr2+1
+        sbc     ptr3+1
+        bcc     :++
+:       lda     ptr2            ; C set
+        sbc     ptr3
+        sta     ptr2
+        lda     ptr2+1
+        sbc     ptr3+1
+        sta     ptr2+1
+        inc     ptr1
+:       dey
+        bne     @by16
+        rts
+
+; Full 32-bit divisor and remainder
+@by32:
+        asl     ptr1
+        rol     ptr1+1
+        rol     sreg
+        rol     sreg+1
+        rol     ptr2
+        rol     ptr2+1
+        rol     tmp1
+        rol     tmp2
+        bcs     :+
+        lda     ptr2
+        cmp     ptr3
+        lda     ptr2+1
+        sbc     ptr3+1
+        lda     tmp1
+        sbc     tmp3
+        lda     tmp2
+        sbc     tmp4
+        bcc     :++
+:       lda     ptr2            ; C set
+        sbc     ptr3
+        sta     ptr2
+        lda     ptr2+1
+        sbc     ptr3+1
+        sta     ptr2+1
+        lda     tmp1
+        sbc     tmp3
+        sta     tmp1
+        lda     tmp2
+        sbc     tmp4
+        sta     tmp2
+        inc     ptr1
+:       dey
+        bne     @by32
+        rts
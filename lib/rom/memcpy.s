@@ -0,0 +1,79 @@
+; memcpy.s - page-unrolled memcpy for clib.rom
+; ROM side: no self-modifying code, workspace in the cc65 zero page temps.
+;
+; Whole 256-byte pages are copied with an 8x unrolled Y-indexed loop. The
+; remaining n & 255 bytes are copied with Y counting up to zero from -n,
+; the pointers moved back to match, so the tail needs no separate counter.
+; Both loops copy upwards, which memmove relies on when dest < src.
+
+        .export _memcpy
+        .export memcpy_params, memcpy_up
+
+        .import popax
+        .importzp ptr1, ptr2, ptr3, sreg
+
+        .code
+
+; void* __fastcall__ memcpy(void* dest, const void* src, size_t n);
+_memcpy:
+        jsr     memcpy_params
+
+; Copy ptr3 bytes from ptr1 to ptr2, upwards; returns sreg (dest) in A/X
+memcpy_up:
+        ldy     #0
+        ldx     ptr3+1
+        beq     @tail
+@page:
+        .repeat 8
+        lda     (ptr1),y
+        sta     (ptr2),y
+        iny
+        .endrepeat
+        bne     @page
+        inc     ptr1+1
+        inc     ptr2+1
+        dex
+        bne     @page
+
+@tail:
+        lda     ptr3
+        beq     @done
+        clc                     ; ptr += n.lo - 256
+        adc     ptr1
+        sta     ptr1
+        bcs     :+
+        dec     ptr1+1
+:       lda     ptr3
+        clc
+        adc     ptr2
+        sta     ptr2
+        bcs     :+
+        dec     ptr2+1
+:       lda     #0              ; Y = -n.lo, up to zero
+        sec
+        sbc     ptr3
+        tay
+@byte:
+        lda     (ptr1),y
+        sta     (ptr2),y
+        iny
+        bne     @byte
+
+@done:
+        lda     sreg
+        ldx     sreg+1
+        rts
+
+; Pop the arguments: n (in A/X) -> ptr3, src -> ptr1, dest -> ptr2 and sreg
+memcpy_params:
+        sta     ptr3
+        stx     ptr3+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popax
+        sta     ptr2
+        stx     ptr2+1
+        sta     sreg
+        stx     sreg+1
+        rts
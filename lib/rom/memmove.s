@@ -0,0 +1,73 @@
+; memmove.s - overlap-safe memmove for clib.rom, page-unrolled both ways
+; ROM side: no self-modifying code, workspace in the cc65 zero page temps.
+;
+; dest <= src copies upwards with memcpy's kernel. dest > src copies
+; downwards: the n & 255 bytes at the top first, then whole pages from the
+; top with an 8x unrolled Y-indexed loop.
+
+        .export _memmove
+
+        .import memcpy_params, memcpy_up
+        .importzp ptr1, ptr2, ptr3, sreg
+
+        .code
+
+; void* __fastcall__ memmove(void* dest, const void* src, size_t n);
+_memmove:
+        jsr     memcpy_params
+        lda     ptr2+1          ; dest <= src: upwards is safe
+        cmp     ptr1+1
+        bcc     @up
+        bne     @down
+        lda     ptr2
+        cmp     ptr1
+        bcc     @up
+        bne     @down
+@up:
+        jmp     memcpy_up
+
+@down:
+        lda     ptr1+1          ; point at the last partial page
+        clc
+        adc     ptr3+1
+        sta     ptr1+1
+        lda     ptr2+1
+        clc
+        adc     ptr3+1
+        sta     ptr2+1
+
+        ldy     ptr3            ; top n.lo bytes, Y = n.lo-1 down to 0
+        beq     @pages
+        dey
+        beq     @last
+@byte:
+        lda     (ptr1),y
+        sta     (ptr2),y
+        dey
+        bne     @byte
+@last:
+        lda     (ptr1),y
+        sta     (ptr2),y
+
+@pages:
+        ldx     ptr3+1
+        beq     @done
+@page:
+        dec     ptr1+1
+        dec     ptr2+1
+        ldy     #0
+@block:
+        .repeat 8
+        dey
+        lda     (ptr1),y
+        sta     (ptr2),y
+        .endrepeat
+        cpy     #0
+        bne     @block
+        dex
+        bne     @page
+
+@done:
+        lda     sreg
+        ldx     sreg+1
+        rts
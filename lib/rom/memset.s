@@ -0,0 +1,73 @@
+; memset.s - page-unrolled memset and bzero for clib.rom
+; ROM side: no self-modifying code, workspace in the cc65 zero page temps.
+;
+; Whole pages are filled with an 8x unrolled Y-indexed loop, the remaining
+; n & 255 bytes with Y counting up to zero from -n.
+
+        .export _memset, _bzero, ___bzero
+
+        .import popax
+        .importzp ptr1, ptr3, sreg, tmp1
+
+        .code
+
+; void __fastcall__ bzero(void* ptr, size_t n);
+_bzero:
+___bzero:
+        sta     ptr3
+        stx     ptr3+1
+        lda     #0
+        sta     tmp1
+        beq     fill            ; always
+
+; void* __fastcall__ memset(void* ptr, int c, size_t n);
+_memset:
+        sta     ptr3
+        stx     ptr3+1
+        jsr     popax
+        sta     tmp1
+
+fill:
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        sta     sreg
+        stx     sreg+1
+
+        lda     tmp1
+        ldy     #0
+        ldx     ptr3+1
+        beq     @tail
+@page:
+        .repeat 8
+        sta     (ptr1),y
+        iny
+        .endrepeat
+        bne     @page
+        inc     ptr1+1
+        dex
+        bne     @page
+
+@tail:
+        ldx     ptr3
+        beq     @done
+        txa                     ; ptr1 += n.lo - 256
+        clc
+        adc     ptr1
+        sta     ptr1
+        bcs     :+
+        dec     ptr1+1
+:       txa                     ; Y = -n.lo, up to zero
+        eor     #$FF
+        tay
+        iny
+        lda     tmp1
+@byte:
+        sta     (ptr1),y
+        iny
+        bne     @byte
+
+@done:
+        lda     sreg
+        ldx     sreg+1
+        rts
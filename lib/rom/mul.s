@@ -0,0 +1,122 @@
+; mul.s - quarter-square multiply runtime for clib.rom
+; Replaces cc65's shift-and-add tosmulax family.
+;
+; x * y = f(x + y) - f(x - y) with f(n) = n * n / 4, rounded down, which
+; is exact because x + y and x - y are both odd or both even. f is kept
+; for n = 0..510 in two 512-byte tables, so an 8x8 multiply is a few
+; lookups and one 16-bit subtract.
+;
+; The low 16 bits of a 16x16 product are the same signed or unsigned:
+; xL * yL, plus the low bytes of xL * yH and xH * yL added to the high
+; byte. A cross product is skipped when its high byte is zero, so char
+; and small int operands cost a single 8x8 multiply.
+
+        .export tosmulax, tosumulax, tosmula0, tosumula0
+        .export quarter_mul8x8, quarter_mul8x8_lo
+
+        .import popax
+        .importzp ptr1, ptr3, ptr4, tmp1, tmp2, tmp3
+
+        .code
+
+; Entry: TOS = left operand, A/X = right operand (X = 0 for the a0 forms)
+; Exit:  A/X = low 16 bits of the product, TOS popped
+tosmula0:
+tosumula0:
+        ldx     #0
+tosmulax:
+tosumulax:
+        sta     ptr4
+        stx     ptr4+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+
+        sta     tmp1            ; xL * yL
+        lda     ptr4
+        jsr     quarter_mul8x8
+        sta     ptr3
+        stx     ptr3+1
+
+        lda     ptr4+1          ; + xL * yH << 8
+        beq     :+
+        jsr     quarter_mul8x8_lo
+        clc
+        adc     ptr3+1
+        sta     ptr3+1
+
+:       lda     ptr1+1          ; + xH * yL << 8
+        beq     :+
+        sta     tmp1
+        lda     ptr4
+        jsr     quarter_mul8x8_lo
+        clc
+        adc     ptr3+1
+        sta     ptr3+1
+
+:       lda     ptr3
+        ldx     ptr3+1
+        rts
+
+; A and tmp1 -> X = |A - tmp1|, Y = (A + tmp1) & 255, C = A + tmp1 > 255
+.macro  quarter_index
+        sta     tmp2
+        sec
+        sbc     tmp1
+        bcs     :+
+        eor     #$FF            ; negate, C clear
+        adc     #1
+:       tax
+        lda     tmp2
+        clc
+        adc     tmp1
+        tay
+.endmacro
+
+; A * tmp1 -> A (low), X (high); tmp1 is preserved, Y/tmp2/tmp3 clobbered
+quarter_mul8x8:
+        quarter_index
+        bcs     @big
+        sec
+        lda     sqr_lo,y
+        sbc     sqr_lo,x
+        sta     tmp3
+        lda     sqr_hi,y
+        sbc     sqr_hi,x
+        tax
+        lda     tmp3
+        rts
+@big:
+        lda     sqr_lo+256,y    ; C set
+        sbc     sqr_lo,x
+        sta     tmp3
+        lda     sqr_hi+256,y
+        sbc     sqr_hi,x
+        tax
+        lda     tmp3
+        rts
+
+; A * tmp1 -> A, the low byte only; tmp1 is preserved
+quarter_mul8x8_lo:
+        quarter_index
+        bcs     @big
+        sec
+        lda     sqr_lo,y
+        sbc     sqr_lo,x
+        rts
+@big:
+        lda     sqr_lo+256,y    ; C set
+        sbc     sqr_lo,x
+        rts
+
+        .rodata
+
+; f(n) = n * n / 4 for n = 0..511
+sqr_lo:
+        .repeat 512, N
+        .byte   <((N * N) / 4)
+        .endrepeat
+sqr_hi:
+        .repeat 512, N
+        .byte   >((N * N) / 4)
+        .endrepeat
@@ -0,0 +1,375 @@
+; open.s - open/close/dup/dup2 for clib.rom over OSFIND
+; ROM side, with the descriptor table in fdtab.s.
+;
+; O_RDONLY opens with OPENIN. Anything that writes opens with OPENUP, so
+; the file keeps its contents, unless O_TRUNC asks for OPENOUT or O_CREAT
+; finds no file to update. O_APPEND moves the cached pointer to the
+; extent once, at open, and the first write hands it to the filing
+; system. OPENIN and OPENUP return 0 for a file that is not there, which
+; is ENOENT; filing system errors such as a locked file are raised by the
+; MOS as usual.
+;
+; O_RDONLY of a name that another slot already has open only for reading
+; does not call OSFIND: the new slot shares that slot's channel. The name
+; is compared as given, so a *DIR between the two opens would fool it,
+; and "A" and "$.A" get channels of their own. A channel is closed with
+; the last slot on it, and a slot is freed with the last descriptor.
+
+        .export _open, _close, _dup, _dup2
+
+        .import addysp, popax
+        .importzp ptr1, tmp1, tmp2, tmp3, tmp4
+
+        .include "errno.inc"
+        .include "fcntl.inc"
+        .include "fd.inc"
+
+NAME_MAX = 63                   ; longest name, without the CR
+
+OPENIN  = $40
+OPENOUT = $80
+OPENUP  = $C0
+
+slot    = tmp2
+mode    = tmp3
+from    = tmp3                  ; dup2: slot of the descriptor copied
+fd      = tmp4
+
+        .bss
+
+name:   .res    NAME_MAX + 1    ; the name, CR terminated for OSFIND
+
+        .code
+
+; int open(const char* name, int flags, ...);
+_open:
+        dey                     ; the mode argument is not used
+        dey
+        dey
+        dey
+        beq     :+
+        jsr     addysp
+:       jsr     popax           ; flags
+        sta     mode
+        jsr     popax           ; name
+        sta     ptr1
+        stx     ptr1+1
+
+        ldy     #0              ; copy it with a CR on the end
+@copy:  lda     (ptr1),y
+        beq     @named
+        sta     name,y
+        iny
+        cpy     #NAME_MAX + 1
+        bcc     @copy
+        lda     #EINVAL
+        jmp     fd_error
+@named: lda     #13
+        sta     name,y
+
+        ldx     #FD_FIRST_FILE  ; a free descriptor
+@free:  lda     fd_slot,x
+        bmi     @found
+        inx
+        cpx     #FD_COUNT
+        bcc     @free
+@full:  lda     #EMFILE
+        jmp     fd_error
+@found: stx     fd
+        ldx     #FD_FIRST_FILE  ; and a free slot
+@empty: lda     fd_flags,x
+        beq     :+
+        inx
+        cpx     #FD_COUNT
+        bcc     @empty
+        bcs     @full           ; always
+:       stx     slot
+
+        lda     mode
+        and     #O_RDWR
+        cmp     #O_RDONLY
+        bne     @write
+        jsr     shared
+        bcc     @share
+        lda     #OPENIN
+        jsr     find
+        bne     @opened
+@none:  lda     #ENOENT
+        jmp     fd_error
+
+; The channel of slot X, already open for reading under this name
+@share: lda     fd_flags,x
+        ora     #FD_SHARED
+        sta     fd_flags,x
+        and     #FD_OPEN | FD_READ | FD_GBPB | FD_SHARED
+        ora     #FD_SEEK        ; PTR# is wherever slot X left it
+        ldy     slot
+        sta     fd_flags,y
+        lda     fd_handle,x
+        sta     fd_handle,y
+        lda     fd_ext,x
+        sta     fd_ext,y
+        lda     fd_ext+FD_COUNT,x
+        sta     fd_ext+FD_COUNT,y
+        lda     fd_ext+2*FD_COUNT,x
+        sta     fd_ext+2*FD_COUNT,y
+        lda     fd_ext+3*FD_COUNT,x
+        sta     fd_ext+3*FD_COUNT,y
+        ldx     slot
+        jmp     @ptr
+
+@write: lda     mode
+        and     #O_CREAT | O_EXCL
+        cmp     #O_CREAT | O_EXCL
+        bne     :+
+        lda     #OPENIN         ; must not exist yet
+        jsr     find
+        beq     :+
+        jsr     close_channel
+        lda     #EEXIST
+        jmp     fd_error
+:       lda     mode
+        and     #O_TRUNC
+        bne     @out
+        lda     #OPENUP
+        jsr     find
+        bne     @opened
+        lda     mode
+        and     #O_CREAT
+        beq     @none
+@out:   lda     #OPENOUT
+        jsr     find
+        beq     @none
+
+@opened:
+        ldx     slot
+        sta     fd_handle,x
+        lda     mode
+        and     #O_RDWR         ; FD_READ and FD_WRITE are the same bits
+        ora     #FD_OPEN
+        sta     tmp1
+        lda     #0              ; filing system number
+        tay
+        jsr     OSARGS
+        cmp     #FS_FIRST_GBPB
+        lda     tmp1
+        bcc     :+
+        ora     #FD_GBPB
+:       ldx     slot
+        sta     fd_flags,x
+
+        and     #FD_GBPB        ; EXT#, through ptr1/ptr2, which are next
+        beq     @tape           ; to each other in zero page
+        ldy     fd_handle,x
+        lda     #2
+        ldx     #ptr1
+        jsr     OSARGS
+        ldx     slot
+        lda     ptr1
+        sta     fd_ext,x
+        lda     ptr1+1
+        sta     fd_ext+FD_COUNT,x
+        lda     ptr2
+        sta     fd_ext+2*FD_COUNT,x
+        lda     ptr2+1
+        sta     fd_ext+3*FD_COUNT,x
+        jmp     @ptr
+
+; The cassette and ROM filing systems do not give EXT#. As far as reads
+; are concerned the file never ends there, and OSBGET finds where it does.
+@tape:  lda     #$FF
+        sta     fd_ext,x
+        sta     fd_ext+FD_COUNT,x
+        sta     fd_ext+2*FD_COUNT,x
+        lda     #$7F
+        sta     fd_ext+3*FD_COUNT,x
+
+@ptr:   jsr     keep_name
+        lda     #0              ; PTR# = 0
+        sta     fd_ptr,x
+        sta     fd_ptr+FD_COUNT,x
+        sta     fd_ptr+2*FD_COUNT,x
+        sta     fd_ptr+3*FD_COUNT,x
+        lda     mode
+        and     #O_APPEND
+        beq     @done
+        lda     fd_ext,x        ; or EXT#, set with the first write
+        sta     fd_ptr,x
+        lda     fd_ext+FD_COUNT,x
+        sta     fd_ptr+FD_COUNT,x
+        lda     fd_ext+2*FD_COUNT,x
+        sta     fd_ptr+2*FD_COUNT,x
+        lda     fd_ext+3*FD_COUNT,x
+        sta     fd_ptr+3*FD_COUNT,x
+        lda     fd_flags,x
+        ora     #FD_SEEK
+        sta     fd_flags,x
+
+@done:  lda     slot
+        ldx     fd
+        sta     fd_slot,x
+        txa
+        ldx     #0
+        rts
+
+; X = a slot open only for reading under the name in name, with C clear;
+; C set if there is none
+shared: ldx     #FD_FIRST_FILE
+@slot:  lda     fd_flags,x
+        and     #FD_OPEN | FD_WRITE
+        cmp     #FD_OPEN
+        bne     @next
+        stx     tmp1
+        ldy     #0
+@char:  lda     fd_name,x
+        cmp     name,y
+        bne     @differ
+        cmp     #13
+        beq     @found
+        txa
+        clc
+        adc     #FD_COUNT
+        tax
+        iny
+        cpy     #FD_NAME_MAX
+        bcc     @char
+@differ:
+        ldx     tmp1
+@next:  inx
+        cpx     #FD_COUNT
+        bcc     @slot
+        rts                     ; C set
+@found: ldx     tmp1
+        clc
+        rts
+
+; Keep the name in fd_name for slot X if it is open only for reading and
+; the name fits. X is kept.
+keep_name:
+        lda     mode
+        and     #O_RDWR
+        cmp     #O_RDONLY
+        bne     @none
+        ldy     #0
+@copy:  lda     name,y
+        sta     fd_name,x
+        cmp     #13
+        beq     @done
+        txa
+        clc
+        adc     #FD_COUNT
+        tax
+        iny
+        cpy     #FD_NAME_MAX
+        bcc     @copy
+@none:  ldx     slot
+        lda     #0
+        sta     fd_name,x
+@done:  ldx     slot
+        rts
+
+; A = OSFIND reason -> A = channel, Z set if there is none
+find:   ldx     #<name
+        ldy     #>name
+        jsr     OSFIND
+        tay
+        rts
+
+; Close channel A
+close_channel:
+        tay
+        lda     #0
+        jmp     OSFIND
+
+; int __fastcall__ close(int fd);
+_close:
+        sta     fd
+        jsr     fd_check
+        bcs     @bad
+        stx     slot
+        jsr     release
+        lda     #0
+        tax
+        rts
+@bad:   jmp     fd_badf
+
+; Take descriptor fd off its slot, slot. Descriptors 0-2 go back to the
+; console, which stays open. The slot is freed with the last descriptor
+; on it, and its channel closed with the last slot.
+release:
+        ldx     fd
+        txa
+        cpx     #FD_FIRST_FILE
+        bcc     :+
+        lda     #$FF
+:       sta     fd_slot,x
+        ldx     slot
+        lda     fd_flags,x
+        and     #FD_CONSOLE
+        bne     @done
+        txa
+        ldy     #FD_COUNT - 1
+@fd:    cmp     fd_slot,y
+        beq     @done
+        dey
+        bpl     @fd
+        lda     #0
+        sta     fd_flags,x
+        lda     fd_handle,x
+        ldy     #FD_COUNT - 1
+@slot:  ldx     fd_flags,y
+        beq     :+
+        cmp     fd_handle,y
+        beq     @done
+:       dey
+        cpy     #FD_FIRST_FILE
+        bcs     @slot
+        jmp     close_channel
+@done:  rts
+
+; int __fastcall__ dup(int fd);
+_dup:
+        jsr     fd_check
+        bcs     @bad
+        stx     slot
+        ldx     #0              ; the lowest free descriptor
+@free:  lda     fd_slot,x
+        bmi     @found
+        inx
+        cpx     #FD_COUNT
+        bcc     @free
+        lda     #EMFILE
+        jmp     fd_error
+@found: lda     slot
+        sta     fd_slot,x
+        txa
+        ldx     #0
+        rts
+@bad:   jmp     fd_badf
+
+; int __fastcall__ dup2(int fd, int fd2);
+_dup2:
+        sta     fd
+        stx     tmp1
+        jsr     popax
+        jsr     fd_check
+        bcs     @bad
+        stx     from
+        lda     tmp1            ; fd2 must be a descriptor
+        bne     @bad
+        ldx     fd
+        cpx     #FD_COUNT
+        bcs     @bad
+        lda     fd_slot,x       ; open: closed first, unless it is on
+        bmi     @set            ; the same slot already
+        cmp     from
+        beq     @done
+        sta     slot
+        jsr     release
+@set:   ldx     fd
+        lda     from
+        sta     fd_slot,x
+@done:  lda     fd
+        ldx     #0
+        rts
+@bad:   jmp     fd_badf
@@ -0,0 +1,94 @@
+; pages.s - page_alloc/page_free, the memory clib.rom allocates from
+; ROM side: a fixed pool of 256-byte pages in the ROM's RAM workspace.
+;
+; cc65's malloc needs its heap set up by a constructor, which nothing in a
+; ROM runs, and there is no room for a heap between the workspace and the
+; screen anyway (see build-rom/clib-rom.cfg). So the stream buffers
+; (filetab.s) and the DIRs (dir.s) come from here, in whole pages: a
+; stream's FILE_BUFSIZ buffer is one, and a DIR one, or three on DFS,
+; where it holds the catalogue. The pool is cleared with the rest of the
+; BSS on reset. When it is full, a stream falls back to unbuffered and
+; opendir fails with ENOMEM, as they did when malloc returned NULL.
+;
+; page_runs has a byte per page: 0 if it is free, the length in pages at
+; the start of a run that is in use, and $FF on the rest of the run.
+
+        .export page_alloc, page_free
+
+POOL_PAGES      = 6
+
+        .bss
+
+page_pool:
+        .res    POOL_PAGES * 256
+page_runs:
+        .res    POOL_PAGES
+page_want:
+        .res    1               ; page_alloc: pages asked for
+page_first:
+        .res    1               ; page_alloc: start of the run being tried
+
+        .code
+
+; Take memory from the pool, the first run of free pages that is long
+; enough. Entry: A/X = bytes. Exit: A/X = the memory, or 0 if there is
+; no such run, or no bytes were asked for. Y is lost.
+page_alloc:
+        cmp     #1              ; pages = X, plus 1 if A is not 0
+        txa
+        adc     #0
+        beq     @none
+        cmp     #POOL_PAGES + 1
+        bcs     @none
+        sta     page_want
+        ldy     #0
+@start: sty     page_first
+        ldx     #0              ; free pages found from page_first
+@scan:  cpy     #POOL_PAGES
+        bcs     @none
+        lda     page_runs,y
+        bne     @used
+        iny
+        inx
+        cpx     page_want
+        bne     @scan
+        ldy     page_first      ; mark the run
+        lda     page_want
+        sta     page_runs,y
+        lda     #$FF
+@mark:  dex
+        beq     @found
+        iny
+        sta     page_runs,y
+        bne     @mark           ; always, Y is not 0
+@found: lda     page_first
+        clc
+        adc     #>page_pool
+        tax
+        lda     #<page_pool
+        rts
+@used:  iny                     ; try again after this page
+        bne     @start          ; always
+@none:  lda     #0
+        tax
+        rts
+
+; Give back a run from page_alloc. Entry: A/X = its start; anything not
+; in the pool, 0 among them, is ignored. Y is lost.
+page_free:
+        txa
+        sec
+        sbc     #>page_pool
+        cmp     #POOL_PAGES
+        bcs     @done
+        tay
+        ldx     page_runs,y
+        beq     @done
+        cpx     #$FF            ; not the start of a run
+        beq     @done
+        lda     #0
+:       sta     page_runs,y
+        iny
+        dex
+        bne     :-
+@done:  rts
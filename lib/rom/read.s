@@ -0,0 +1,113 @@
+; read.s - read for clib.rom
+; Files go through fd_transfer (fdtab.s): one OSGBPB call for any request
+; of GBPB_MIN bytes or more on a filing system that has it, OSBGET
+; otherwise. The console reads a line with OSWORD 0, so the user can edit
+; it before it is returned, and its CR comes back as '\n'. The line is
+; kept until it has all been read, so a caller that reads a character at
+; a time (fgetc on an unbuffered stdin) still gets the edited line.
+
+        .export _read
+
+        .import popax
+        .importzp ptr1, ptr2, ptr3
+
+        .include "errno.inc"
+        .include "fd.inc"
+
+LINE_MAX = 126                  ; longest console line, without the '\n'
+
+        .bss
+
+line:   .res    LINE_MAX + 2    ; the line and its '\n'
+line_pos:
+        .res    1               ; next character to return
+line_len:
+        .res    1               ; 0 when there is no line
+
+        .code
+
+; int __fastcall__ read(int fd, void* buf, unsigned count);
+_read:
+        sta     ptr2            ; count
+        stx     ptr2+1
+        jsr     popax           ; buf
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popax
+
+; The same from the stdio layer
+fd_read:
+        jsr     fd_check
+        bcs     @bad
+        lsr     a               ; C = FD_READ
+        bcc     @bad
+        lda     ptr2
+        ora     ptr2+1
+        beq     @none
+        lda     fd_flags,x
+        and     #FD_CONSOLE
+        bne     console
+        lda     #GBPB_READ
+        jmp     fd_transfer
+@none:  tax
+        rts
+@bad:   jmp     fd_badf
+
+; Up to count characters of the current line, reading a new one when it
+; has all gone
+console:
+        lda     line_pos
+        cmp     line_len
+        bcc     @copy
+        lda     #<line          ; OSWORD 0 block: buffer, longest line,
+        sta     fd_block        ; and the range of characters it accepts
+        lda     #>line
+        sta     fd_block+1
+        lda     #LINE_MAX
+        sta     fd_block+2
+        lda     #' '
+        sta     fd_block+3
+        lda     #$FF
+        sta     fd_block+4
+        lda     #0
+        ldx     #<fd_block
+        ldy     #>fd_block
+        jsr     OSWORD
+        bcs     @escape
+        lda     #10             ; Y = length, at the CR
+        sta     line,y
+        iny
+        sty     line_len
+        lda     #0
+        sta     line_pos
+
+@copy:  lda     line_len        ; the smaller of what is left and count
+        sec
+        sbc     line_pos
+        ldx     ptr2+1
+        bne     :+
+        cmp     ptr2
+        bcc     :+
+        lda     ptr2
+:       sta     ptr3
+        ldx     line_pos
+        ldy     #0
+@char:  lda     line,x
+        sta     (ptr1),y
+        inx
+        iny
+        cpy     ptr3
+        bne     @char
+        stx     line_pos
+        tya
+        ldx     #0
+        rts
+
+@escape:
+        lda     #$7E            ; acknowledge it
+        jsr     OSBYTE
+        lda     #0              ; and drop the line
+        sta     line_len
+        sta     line_pos
+        lda     #EINTR
+        jmp     fd_error
@@ -0,0 +1,694 @@
+; serial.s - serial_open/serial_read/serial_write/serial_close for clib.rom
+; ROM side; the interrupt handler is copied into RAM.
+;
+; serial_open() takes the ACIA's interrupt ahead of the MOS on IRQ1V, and
+; the handler moves each byte that arrives into a ring buffer that the
+; application gives it, as large as it likes, in place of the MOS's
+; 255-byte RS423 input buffer and its OSBYTE call a byte. serial_read()
+; then takes everything that has arrived in one pass, a reply in one
+; call. RTS goes high while the ring has less than SERIAL_SLACK bytes
+; free, so the other end holds off instead of the bytes being lost.
+;
+; serial_write() queues bytes in a SERIAL_TX_SIZE ring of its own, and
+; the handler sends them from the transmit interrupt. Nothing goes through
+; OSWRCH, so there are no *FX3 output streams to switch and the screen
+; stays the screen. The ACIA holds a byte back while CTS is high. The
+; 6850 cannot have RTS high and the transmit interrupt on at once, so
+; while the receive side holds RTS high serial_write() sends from the
+; foreground instead. Other interrupts, and transmit from the MOS's own
+; buffer, go on to the MOS. If nothing leaves the queue for SERIAL_STALL
+; centiseconds, because CTS stays high or nothing is there, serial_write()
+; gives up with EIO, and serial_close() drops what is queued, closes the
+; port and does the same.
+;
+; Both calls add the bytes they move into a FujiNet checksum as they copy
+; them, an 8-bit sum with the carry added back in, so a packet is not
+; walked a second time to check or sign it. serial_rx_sum() and
+; serial_tx_sum() hand the sums over and start them again.
+;
+; The handler runs with whatever sideways ROM is paged in, so it cannot
+; run from this one: serial_open copies it into RAM and patches the ring
+; and the old IRQ1V into its operands. The operand of its STA is the
+; ring's write pointer, so it needs no zero page.
+
+        .export _serial_open, _serial_read, _serial_write, _serial_close
+        .export _serial_rx_sum, _serial_tx_sum
+        .export serial_timer, serial_expired
+
+        .import popax
+        .importzp ptr1, ptr2, ptr3, tmp1
+
+        .include "errno.inc"
+        .include "fd.inc"
+        .include "serial.inc"
+
+; The address in irq_code of a label in irq_template
+.define RAM(label) (irq_code + ((label) - irq_template))
+
+        .code
+
+; The IRQ1V handler, as copied into irq_code. Operands marked "patched"
+; are set by serial_open; branches are relative and everything else it
+; writes is in RAM(), so the copy runs where it is.
+irq_template:
+        lda     ACIA_STATUS
+        lsr     a               ; RDRF into C
+        bcs     t_rx
+        and     #ACIA_TDRE >> 1 ; room to send, and something to send?
+        beq     t_chain
+        lda     tx_used
+        bne     t_tx
+t_chain:
+        jmp     $FFFF           ; patched: the old IRQ1V
+t_tx:   stx     irq_x
+        ldx     tx_out
+        lda     tx_ring,x
+        sta     ACIA_DATA
+        inx
+        txa
+        and     #SERIAL_TX_SIZE - 1
+        sta     tx_out
+        dec     tx_used         ; the last one: transmit interrupt off,
+        bne     t_sent          ; unless RTS high has it off already
+        lda     rx_held
+        bne     t_sent
+        lda     ctrl_idle
+        sta     ACIA_CONTROL
+t_sent: ldx     irq_x
+        lda     IRQ_A
+        rti
+t_rx:   lda     rx_used         ; full: nowhere to put it
+t_size_lo = * + 1
+        cmp     #0              ; patched: ring size
+        lda     rx_used+1
+t_size_hi = * + 1
+        sbc     #0
+        bcs     t_full
+        lda     ACIA_DATA
+t_store:
+        sta     $FFFF           ; patched: write pointer
+        inc     RAM(t_store)+1
+        bne     :+
+        inc     RAM(t_store)+2
+:       lda     RAM(t_store)+1  ; at the end: back to the start
+t_end_lo = * + 1
+        cmp     #0              ; patched: ring end
+        bne     t_count
+        lda     RAM(t_store)+2
+t_end_hi = * + 1
+        cmp     #0
+        bne     t_count
+t_start_lo = * + 1
+        lda     #0              ; patched: ring start
+        sta     RAM(t_store)+1
+t_start_hi = * + 1
+        lda     #0
+        sta     RAM(t_store)+2
+t_count:
+        inc     rx_used
+        bne     :+
+        inc     rx_used+1
+:       lda     rx_used         ; nearly full: RTS high
+t_hold_lo = * + 1
+        cmp     #0              ; patched: size - SERIAL_SLACK
+        lda     rx_used+1
+t_hold_hi = * + 1
+        sbc     #0
+        bcc     t_done
+t_hold = * + 1
+        lda     #0              ; patched: RTS high, transmit interrupt off
+        sta     ACIA_CONTROL
+        sta     rx_held
+t_done: lda     IRQ_A
+        rti
+t_full: lda     ACIA_DATA       ; dropped, but RDRF has to be cleared
+        lda     IRQ_A
+        rti
+irq_end:
+
+IRQ_SIZE        = irq_end - irq_template
+
+        .bss
+
+irq_code:       .res IRQ_SIZE   ; the handler
+rx_used:        .res 2          ; bytes in the ring, counted up by the handler
+rx_held:        .res 1          ; not 0 while the handler holds RTS high
+rx_open:        .res 1          ; not 0 between serial_open and serial_close
+rx_out:         .res 2          ; next byte for serial_read
+rx_start:       .res 2          ; the ring
+rx_end:         .res 2
+rx_release:     .res 2          ; RTS goes low again below this many
+tx_ring:        .res SERIAL_TX_SIZE
+tx_in:          .res 1          ; where serial_write puts the next byte
+tx_out:         .res 1          ; and where the handler takes it
+tx_used:        .res 1          ; bytes queued, counted down by the handler
+irq_x:          .res 1          ; the handler's X
+rx_sum:         .res 1          ; FujiNet checksums of what serial_read
+tx_sum:         .res 1          ; has returned and serial_write queued
+ctrl_idle:      .res 1          ; ACIA control: receive interrupt, RTS low
+ctrl_send:      .res 1          ; and the transmit interrupt on too
+ctrl_old:       .res 1          ; and as it was before serial_open
+dest:           .res 2          ; serial_read: where the next byte goes
+left:           .res 2          ; bytes still wanted
+done:           .res 2          ; and copied
+timers:         .res TIMER_COUNT * TIMER_SIZE
+timer:          .res 1          ; serial_expired's
+clock:          .res 5          ; OSWORD 1 block
+
+; serial.s's own timer
+timeout         = timers + TIMER_SERIAL + T_TIMEOUT
+waiting         = timers + TIMER_SERIAL + T_WAITING
+
+        .code
+
+; int __fastcall__ serial_open(void* ring, unsigned int size,
+;                              unsigned char baud);
+_serial_open:
+        sta     tmp1            ; baud, 1-8 as for *FX7
+        jsr     popax
+        sta     ptr2            ; size
+        stx     ptr2+1
+        jsr     popax
+        sta     ptr1            ; ring
+        stx     ptr1+1
+        lda     rx_open
+        beq     :+
+        lda     #EBUSY
+        jmp     fd_error
+:       lda     ptr2+1
+        bne     @copy
+        lda     ptr2
+        cmp     #2 * SERIAL_SLACK
+        bcs     @copy
+        lda     #EINVAL
+        jmp     fd_error
+
+@copy:  ldy     #0
+:       lda     irq_template,y
+        sta     irq_code,y
+        iny
+        cpy     #IRQ_SIZE
+        bne     :-
+
+        lda     ptr1            ; the ring's bounds, and the write and read
+        sta     rx_start        ; pointers at its start
+        sta     rx_out
+        sta     RAM(t_store)+1
+        sta     RAM(t_start_lo)
+        clc
+        adc     ptr2
+        sta     rx_end
+        sta     RAM(t_end_lo)
+        lda     ptr1+1
+        sta     rx_start+1
+        sta     rx_out+1
+        sta     RAM(t_store)+2
+        sta     RAM(t_start_hi)
+        adc     ptr2+1
+        sta     rx_end+1
+        sta     RAM(t_end_hi)
+        lda     ptr2            ; full, hold and release levels
+        sta     RAM(t_size_lo)
+        sec
+        sbc     #SERIAL_SLACK
+        sta     RAM(t_hold_lo)
+        tax
+        lda     ptr2+1
+        sta     RAM(t_size_hi)
+        sbc     #0
+        sta     RAM(t_hold_hi)
+        tay
+        txa
+        sec
+        sbc     #SERIAL_SLACK
+        sta     rx_release
+        tya
+        sbc     #0
+        sta     rx_release+1
+        lda     #0
+        sta     rx_used
+        sta     rx_used+1
+        sta     rx_held
+        sta     tx_in
+        sta     tx_out
+        sta     tx_used
+        sta     rx_sum
+        sta     tx_sum
+
+        lda     #OSBYTE_RX_RATE
+        ldx     tmp1
+        jsr     OSBYTE
+        lda     #OSBYTE_TX_RATE
+        ldx     tmp1
+        jsr     OSBYTE
+
+        sei                     ; the handler onto IRQ1V, then the receive
+        lda     IRQ1V           ; interrupt on and RTS low; the transmit
+        sta     RAM(t_chain)+1  ; interrupt waits for serial_write
+        lda     IRQ1V+1
+        sta     RAM(t_chain)+2
+        lda     #<irq_code
+        sta     IRQ1V
+        lda     #>irq_code
+        sta     IRQ1V+1
+        lda     #OSBYTE_ACIA
+        ldx     #ACIA_RX_IRQ
+        ldy     #ACIA_FORMAT
+        jsr     OSBYTE
+        stx     ctrl_old
+        txa
+        and     #ACIA_FORMAT
+        ora     #ACIA_RX_IRQ
+        sta     ctrl_idle
+        sta     rx_open
+        ora     #ACIA_TX_IRQ
+        sta     ctrl_send
+        eor     #ACIA_TX_IRQ | ACIA_RTS_HIGH
+        sta     RAM(t_hold)
+        cli
+        lda     #0
+        tax
+        rts
+
+; int serial_close(void);
+; Waits for serial_write's bytes to go first
+_serial_close:
+        lda     rx_open
+        beq     @ok
+        jsr     stall_start
+        lda     tx_used
+        sta     left            ; queued at the last look
+@drain: lda     tx_used
+        beq     @close
+        cmp     left            ; some went: the wait starts again
+        beq     :+
+        sta     left
+        lda     #0
+        sta     waiting
+:       jsr     expired
+        bcs     @close
+        jsr     tx_wait
+        jmp     @drain
+@close: sei
+        lda     RAM(t_chain)+1
+        sta     IRQ1V
+        lda     RAM(t_chain)+2
+        sta     IRQ1V+1
+        lda     #OSBYTE_ACIA
+        ldx     ctrl_old
+        ldy     #0
+        jsr     OSBYTE
+        lda     #0
+        sta     rx_open
+        cli
+        lda     tx_used         ; any still queued are dropped
+        beq     @ok
+        lda     #0
+        sta     tx_used
+        lda     #EIO
+        jmp     fd_error
+@ok:    lda     #0
+        tax
+        rts
+
+; int __fastcall__ serial_read(void* buf, unsigned int n,
+;                              unsigned int timeout);
+_serial_read:
+        sta     timeout
+        stx     timeout+1
+        jsr     popax
+        sta     left
+        stx     left+1
+        jsr     popax
+        sta     dest
+        stx     dest+1
+        lda     #0
+        sta     done
+        sta     done+1
+        sta     waiting
+        lda     rx_open
+        bne     @next
+        lda     #EINVAL
+        jmp     fd_error
+
+@next:  lda     left
+        ora     left+1
+        bne     :+
+        jmp     @end
+:       sei                     ; ptr3 = what is there
+        lda     rx_used
+        ldx     rx_used+1
+        cli
+        sta     ptr3
+        stx     ptr3+1
+        ora     ptr3+1
+        bne     :+
+        jmp     @wait
+:       lda     left            ; at most what is left
+        cmp     ptr3
+        lda     left+1
+        sbc     ptr3+1
+        bcs     :+
+        lda     left
+        sta     ptr3
+        lda     left+1
+        sta     ptr3+1
+:       lda     rx_end          ; and at most up to the end of the ring
+        sec
+        sbc     rx_out
+        sta     ptr1
+        lda     rx_end+1
+        sbc     rx_out+1
+        sta     ptr1+1
+        lda     ptr1
+        cmp     ptr3
+        lda     ptr1+1
+        sbc     ptr3+1
+        bcs     :+
+        lda     ptr1
+        sta     ptr3
+        lda     ptr1+1
+        sta     ptr3+1
+
+:       lda     rx_out
+        sta     ptr1
+        lda     rx_out+1
+        sta     ptr1+1
+        lda     dest
+        sta     ptr2
+        lda     dest+1
+        sta     ptr2+1
+        lda     rx_sum
+        sta     tmp1
+        jsr     copy_sum
+        lda     tmp1
+        sta     rx_sum
+
+        clc                     ; rx_out moves on, round to the start at
+        lda     rx_out          ; the end
+        adc     ptr3
+        sta     rx_out
+        lda     rx_out+1
+        adc     ptr3+1
+        sta     rx_out+1
+        cmp     rx_end+1
+        bne     :+
+        lda     rx_out
+        cmp     rx_end
+        bne     :+
+        lda     rx_start
+        sta     rx_out
+        lda     rx_start+1
+        sta     rx_out+1
+:       clc
+        lda     dest
+        adc     ptr3
+        sta     dest
+        lda     dest+1
+        adc     ptr3+1
+        sta     dest+1
+        clc
+        lda     done
+        adc     ptr3
+        sta     done
+        lda     done+1
+        adc     ptr3+1
+        sta     done+1
+        sec
+        lda     left
+        sbc     ptr3
+        sta     left
+        lda     left+1
+        sbc     ptr3+1
+        sta     left+1
+
+        sei                     ; give the room back to the handler, and
+        sec                     ; RTS low again if it held it high and
+        lda     rx_used         ; there is now plenty
+        sbc     ptr3
+        sta     rx_used
+        lda     rx_used+1
+        sbc     ptr3+1
+        sta     rx_used+1
+        lda     rx_held
+        beq     :+
+        lda     rx_used
+        cmp     rx_release
+        lda     rx_used+1
+        sbc     rx_release+1
+        bcs     :+
+        lda     #0
+        sta     rx_held
+        lda     ctrl_idle       ; and the transmit interrupt back on if
+        ldx     tx_used         ; serial_write has bytes waiting
+        beq     @ctrl
+        lda     ctrl_send
+@ctrl:  sta     ACIA_CONTROL
+:       cli
+        lda     #0
+        sta     waiting
+        jmp     @next
+
+; Nothing there: wait for more, for up to timeout centiseconds since the
+; last byte came
+@wait:  lda     timeout
+        ora     timeout+1
+        beq     @end
+        jsr     expired
+        bcs     @end
+        jmp     @next
+@end:   lda     done
+        ldx     done+1
+        rts
+
+; int __fastcall__ serial_write(const void* buf, unsigned int n);
+; Returns once the last byte is queued, waiting while the queue is full
+_serial_write:
+        sta     left
+        stx     left+1
+        sta     done            ; all of it, once it returns
+        stx     done+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        lda     rx_open
+        bne     :+
+        lda     #EINVAL
+        jmp     fd_error
+:       jsr     stall_start
+
+@next:  lda     left
+        ora     left+1
+        beq     @end
+        lda     tx_used         ; tmp1 = the room in the queue
+        eor     #$FF
+        sec
+        adc     #SERIAL_TX_SIZE
+        bne     @room
+        jsr     tx_wait
+        jsr     expired
+        bcc     @next
+        lda     #EIO            ; nothing has gone for SERIAL_STALL
+        jmp     fd_error
+@room:  ldx     #0              ; the queue moved: the wait starts again
+        stx     waiting
+        ldx     left+1          ; and at most what is left
+        bne     :+
+        cmp     left
+        bcc     :+
+        lda     left
+:       sta     tmp1
+        ldy     #0
+        ldx     tx_in
+@copy:  lda     (ptr1),y
+        sta     tx_ring,x
+        clc
+        adc     tx_sum
+        adc     #0
+        sta     tx_sum
+        inx
+        txa
+        and     #SERIAL_TX_SIZE - 1
+        tax
+        iny
+        cpy     tmp1
+        bne     @copy
+        stx     tx_in
+
+        clc                     ; past them in buf
+        lda     ptr1
+        adc     tmp1
+        sta     ptr1
+        bcc     :+
+        inc     ptr1+1
+:       sec
+        lda     left
+        sbc     tmp1
+        sta     left
+        bcs     :+
+        dec     left+1
+
+:       sei                     ; over to the handler, and the transmit
+        clc                     ; interrupt on unless RTS is held high
+        lda     tx_used
+        adc     tmp1
+        sta     tx_used
+        lda     rx_held
+        bne     :+
+        lda     ctrl_send
+        sta     ACIA_CONTROL
+:       cli
+        jmp     @next
+
+@end:   lda     done
+        ldx     done+1
+        rts
+
+; Wait a little for the queue to empty. While RTS is held high there are
+; no transmit interrupts, so send a byte from here if the ACIA has room.
+tx_wait:
+        lda     rx_held
+        beq     @done
+        sei
+        lda     ACIA_STATUS
+        and     #ACIA_TDRE
+        beq     :+
+        lda     tx_used
+        beq     :+
+        ldx     tx_out
+        lda     tx_ring,x
+        sta     ACIA_DATA
+        inx
+        txa
+        and     #SERIAL_TX_SIZE - 1
+        sta     tx_out
+        dec     tx_used
+:       cli
+@done:  rts
+
+; serial_write and serial_close: wait up to SERIAL_STALL centiseconds
+; from the next call to expired
+stall_start:
+        lda     #<SERIAL_STALL
+        ldy     #>SERIAL_STALL
+        ldx     #TIMER_SERIAL
+
+; Set timer X (TIMER_SERIAL or TIMER_STREAM) to A/Y centiseconds, counted
+; from its next serial_expired. X is kept.
+serial_timer:
+        sta     timers+T_TIMEOUT,x
+        tya
+        sta     timers+T_TIMEOUT+1,x
+        lda     #0
+        sta     timers+T_WAITING,x
+        rts
+
+; serial.s's own timer
+expired:
+        ldx     #TIMER_SERIAL
+
+; C set once timer X's timeout has passed since the first call after it
+; was set, or its T_WAITING was cleared, which starts the clock. X is kept.
+serial_expired:
+        stx     timer
+        lda     #1              ; read the clock
+        ldx     #<clock
+        ldy     #>clock
+        jsr     OSWORD
+        ldx     timer
+        lda     timers+T_WAITING,x
+        bne     @check
+        inc     timers+T_WAITING,x ; deadline = clock + timeout
+        clc
+        lda     clock
+        adc     timers+T_TIMEOUT,x
+        sta     timers+T_DEADLINE,x
+        lda     clock+1
+        adc     timers+T_TIMEOUT+1,x
+        sta     timers+T_DEADLINE+1,x
+        lda     clock+2
+        adc     #0
+        sta     timers+T_DEADLINE+2,x
+        lda     clock+3
+        adc     #0
+        sta     timers+T_DEADLINE+3,x
+        clc
+        rts
+@check: lda     clock           ; clock >= deadline
+        cmp     timers+T_DEADLINE,x
+        lda     clock+1
+        sbc     timers+T_DEADLINE+1,x
+        lda     clock+2
+        sbc     timers+T_DEADLINE+2,x
+        lda     clock+3
+        sbc     timers+T_DEADLINE+3,x
+        rts
+
+; unsigned char serial_rx_sum(void);
+; The checksum of the bytes serial_read() has returned since serial_open()
+; or the last call, which starts it again
+_serial_rx_sum:
+        lda     rx_sum
+        ldx     #0
+        stx     rx_sum
+        rts
+
+; unsigned char serial_tx_sum(void);
+; And of the bytes serial_write() has queued
+_serial_tx_sum:
+        lda     tx_sum
+        ldx     #0
+        stx     tx_sum
+        rts
+
+; Copy ptr3 bytes from ptr1 to ptr2 as memcpy_up does, adding each into
+; tmp1 with the carry added back in. C stays clear from byte to byte: a
+; sum that carries leaves at most $FE, so the ADC #0 never carries again.
+copy_sum:
+        ldy     #0
+        ldx     ptr3+1
+        beq     @tail
+        clc
+@page:
+        .repeat 4
+        lda     (ptr1),y
+        sta     (ptr2),y
+        adc     tmp1
+        adc     #0
+        sta     tmp1
+        iny
+        .endrepeat
+        bne     @page
+        inc     ptr1+1
+        inc     ptr2+1
+        dex
+        bne     @page
+
+@tail:
+        lda     ptr3
+        beq     @done
+        clc                     ; ptr += n.lo - 256
+        adc     ptr1
+        sta     ptr1
+        bcs     :+
+        dec     ptr1+1
+:       lda     ptr3
+        clc
+        adc     ptr2
+        sta     ptr2
+        bcs     :+
+        dec     ptr2+1
+:       lda     #0              ; Y = -n.lo, up to zero
+        sec
+        sbc     ptr3
+        tay
+        clc
+@byte:
+        lda     (ptr1),y
+        sta     (ptr2),y
+        adc     tmp1
+        adc     #0
+        sta     tmp1
+        iny
+        bne     @byte
+@done:  rts
@@ -0,0 +1,37 @@
+; strcat.s - page-scanning strcat for clib.rom
+;
+; Finds the end of dest with the same four-times unrolled page scan as
+; strlen, then appends src with strcpy's copy loop.
+
+        .export _strcat
+
+        .import strcpy_params, strcpy_copy
+        .importzp ptr2, sreg
+
+        .code
+
+; char* __fastcall__ strcat(char* dest, const char* src);
+_strcat:
+        jsr     strcpy_params   ; src -> ptr1, dest -> ptr2 and sreg
+        ldy     #0
+@find:
+        .repeat 4
+        lda     (ptr2),y
+        beq     @found
+        iny
+        .endrepeat
+        bne     @find
+        inc     ptr2+1
+        bne     @find           ; always
+
+@found:
+        tya                     ; ptr2 = terminator of dest
+        clc
+        adc     ptr2
+        sta     ptr2
+        bcc     :+
+        inc     ptr2+1
+:       jsr     strcpy_copy
+        lda     sreg
+        ldx     sreg+1
+        rts
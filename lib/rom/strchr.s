@@ -0,0 +1,48 @@
+; strchr.s - page-scanning strchr for clib.rom
+;
+; Y indexes the current 256-byte page and only the pointer's high byte
+; moves between pages. The scan is unrolled four times; Y starts at zero,
+; so it can only wrap on the last INY of each pass.
+
+        .export _strchr
+
+        .import popax
+        .importzp ptr1, tmp1
+
+        .code
+
+; char* __fastcall__ strchr(const char* s, int c);
+_strchr:
+        sta     tmp1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        ldy     #0
+@loop:
+        .repeat 4
+        lda     (ptr1),y
+        beq     @end
+        cmp     tmp1
+        beq     @found
+        iny
+        .endrepeat
+        bne     @loop
+        inc     ptr1+1
+        bne     @loop           ; always
+
+@end:
+        lda     tmp1            ; strchr(s, 0) finds the terminator
+        bne     @none
+@found:
+        tya                     ; ptr1 + Y
+        clc
+        adc     ptr1
+        ldx     ptr1+1
+        bcc     :+
+        inx
+:       rts
+
+@none:
+        lda     #0
+        tax
+        rts
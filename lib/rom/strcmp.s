@@ -0,0 +1,45 @@
+; strcmp.s - page-scanning strcmp for clib.rom
+;
+; Y indexes the current 256-byte page and only the pointers' high bytes
+; move between pages. The compare is unrolled four times; Y starts at
+; zero, so it can only wrap on the last INY of each pass.
+
+        .export _strcmp
+
+        .import popax
+        .importzp ptr1, ptr2
+
+        .code
+
+; int __fastcall__ strcmp(const char* s1, const char* s2);
+_strcmp:
+        sta     ptr2
+        stx     ptr2+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        ldy     #0
+@loop:
+        .repeat 4
+        lda     (ptr1),y
+        cmp     (ptr2),y
+        bne     @differ
+        tax                     ; both strings ended?
+        beq     @equal
+        iny
+        .endrepeat
+        bne     @loop
+        inc     ptr1+1
+        inc     ptr2+1
+        bne     @loop           ; always
+
+@equal:
+        rts                     ; A = X = 0
+
+@differ:
+        bcs     @greater
+        ldx     #$FF            ; s1 < s2
+        rts
+@greater:
+        ldx     #$01            ; s1 > s2
+        rts
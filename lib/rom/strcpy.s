@@ -0,0 +1,68 @@
+; strcpy.s - page-scanning strcpy and stpcpy for clib.rom
+;
+; Y indexes the current 256-byte page and only the pointers' high bytes
+; move between pages. The copy is unrolled four times; Y starts at zero,
+; so it can only wrap on the last INY of each pass.
+;
+; stpcpy returns the end of the copy instead of its start, so a string
+; built from several pieces is copied once rather than rescanned by
+; every strcat.
+
+        .export _strcpy, _stpcpy
+        .export strcpy_params, strcpy_copy
+
+        .import popax
+        .importzp ptr1, ptr2, sreg
+
+        .code
+
+; char* __fastcall__ strcpy(char* dest, const char* src);
+_strcpy:
+        jsr     strcpy_params
+        jsr     strcpy_copy
+        lda     sreg
+        ldx     sreg+1
+        rts
+
+; char* __fastcall__ stpcpy(char* dest, const char* src);
+; Returns a pointer to the terminator written to dest.
+_stpcpy:
+        jsr     strcpy_params
+        jsr     strcpy_copy
+        tya                     ; ptr2 + Y
+        clc
+        adc     ptr2
+        ldx     ptr2+1
+        bcc     :+
+        inx
+:       rts
+
+; Pop the arguments: src (in A/X) -> ptr1, dest -> ptr2 and sreg
+strcpy_params:
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popax
+        sta     ptr2
+        stx     ptr2+1
+        sta     sreg
+        stx     sreg+1
+        rts
+
+; Copy the string at ptr1 to ptr2, terminator included. Returns with
+; ptr2 + Y pointing at the terminator in the copy.
+strcpy_copy:
+        ldy     #0
+@loop:
+        .repeat 4
+        lda     (ptr1),y
+        sta     (ptr2),y
+        beq     @done
+        iny
+        .endrepeat
+        bne     @loop
+        inc     ptr1+1
+        inc     ptr2+1
+        bne     @loop           ; always
+
+@done:
+        rts
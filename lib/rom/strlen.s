@@ -0,0 +1,32 @@
+; strlen.s - page-scanning strlen for clib.rom
+;
+; Y indexes the current 256-byte page and only the pointer's high byte
+; moves between pages. The scan is unrolled four times; Y starts at zero,
+; so it can only wrap on the last INY of each pass.
+
+        .export _strlen
+
+        .importzp ptr1
+
+        .code
+
+; size_t __fastcall__ strlen(const char* s);
+_strlen:
+        sta     ptr1
+        stx     ptr1+1
+        ldx     #0              ; whole pages scanned
+        ldy     #0
+@loop:
+        .repeat 4
+        lda     (ptr1),y
+        beq     @done
+        iny
+        .endrepeat
+        bne     @loop
+        inc     ptr1+1
+        inx
+        bne     @loop           ; always, short of a 64KB string
+
+@done:
+        tya
+        rts
@@ -0,0 +1,444 @@
+; strtol.s - strtol/strtoul/atoi/atol for clib.rom
+; Replaces cc65's C strtol and strtoul and its atoi/atol module with one
+; parser.
+;
+; Decimal digits are multiplied in with mul10, which shifts and adds:
+; v * 10 = (v * 4 + v) * 2. While the value is under 6400 this is done on
+; 16 bits with the copy held in A/X, so the first four digits of any
+; number cost a few shifts each. Bases that are powers of two shift, and
+; any other base from 2 to 36 shifts and adds a bit of the base at a time.
+;
+; Base 0 picks 16 for a "0x" prefix, 2 for "0b", 8 for a leading "0" and
+; 10 otherwise; base 16 and base 2 accept their prefix too. A prefix only
+; counts when a digit follows it, so "0x" alone parses as 0 and ends at
+; the "x". The end pointer lets a caller walk a line of numbers without
+; scanning it again.
+;
+; Out of range values give LONG_MIN/LONG_MAX (strtol) or ULONG_MAX
+; (strtoul) and set errno to ERANGE. atoi and atol are strtol in base 10
+; without an end pointer.
+
+        .export _strtol, _strtoul, _atoi, _atol
+
+        .import popax
+        .importzp ptr1, ptr2, ptr3, ptr4, sreg, tmp1, tmp2, tmp3, tmp4
+
+        .include "errno.inc"
+
+; The value is kept in ptr3/ptr4, least significant byte first, and
+; copied to ptr2/sreg while it is multiplied
+base    = tmp1
+negative = tmp2                 ; $FF after a '-'
+flags   = tmp3                  ; bits below
+digit   = tmp4
+
+OVERFLOW = $80
+DIGITS  = $40
+SIGNED  = $01
+
+; Move to the next character: Y counts within the page of ptr1
+.macro  next_char
+        iny
+        bne     :+
+        inc     ptr1+1
+:
+.endmacro
+
+        .code
+
+; long __fastcall__ strtol(const char* nptr, char** endptr, int base);
+_strtol:
+        ldy     #SIGNED
+        bne     strto           ; always
+
+; unsigned long __fastcall__ strtoul(const char* nptr, char** endptr,
+;                                    int base);
+_strtoul:
+        ldy     #0
+strto:
+        sty     flags
+        sta     base
+        txa                     ; base over 255: no digits
+        beq     :+
+        lda     #1
+        sta     base
+:       jsr     popax           ; endptr
+        sta     ptr2
+        stx     ptr2+1
+        jsr     popax           ; nptr
+        jmp     parse
+
+; int __fastcall__ atoi(const char* s);
+; long __fastcall__ atol(const char* s);
+_atoi:
+_atol:
+        ldy     #SIGNED
+        sty     flags
+        ldy     #10
+        sty     base
+        ldy     #0
+        sty     ptr2
+        sty     ptr2+1
+
+; nptr in A/X, endptr in ptr2, base and flags set
+parse:
+        sta     ptr1
+        stx     ptr1+1
+        lda     ptr2            ; endptr and nptr wait on the CPU stack
+        pha
+        lda     ptr2+1
+        pha
+        lda     ptr1
+        pha
+        txa
+        pha
+        lda     #0
+        sta     negative
+        sta     ptr3
+        sta     ptr3+1
+        sta     ptr4
+        sta     ptr4+1
+
+        ldy     #0              ; white space
+@space: lda     (ptr1),y
+        cmp     #' '
+        beq     @skip
+        cmp     #9              ; '\t' to '\r'
+        bcc     @sign
+        cmp     #13 + 1
+        bcs     @sign
+@skip:
+        next_char
+        jmp     @space
+
+@sign:  cmp     #'-'
+        bne     :+
+        dec     negative
+        bne     @signed         ; always
+:       cmp     #'+'
+        bne     @prefix
+@signed:
+        next_char
+
+@prefix:
+        tya                     ; ptr1 += Y, so the prefix can be looked
+        clc                     ; ahead at with Y = 1 and 2
+        adc     ptr1
+        sta     ptr1
+        bcc     :+
+        inc     ptr1+1
+:       ldy     #0
+        lda     base
+        cmp     #37             ; 1 and over 36: no digits
+        bcs     :+
+        cmp     #1
+        bne     :++
+:       jmp     @none
+:       lda     (ptr1),y
+        cmp     #'0'
+        bne     @nozero
+        iny
+        lda     (ptr1),y
+        ora     #$20            ; lower case
+        ldx     #16
+        cmp     #'x'
+        beq     :+
+        ldx     #2
+        cmp     #'b'
+        bne     @octal
+:       lda     base            ; "0x" in base 0 or 16, "0b" in 0 or 2
+        beq     :+
+        cpx     base
+        bne     @octal
+:       iny                     ; and a digit after it
+        lda     (ptr1),y
+        jsr     digit_value
+        stx     digit
+        cmp     digit
+        bcs     @octal
+        stx     base
+        bcc     @digits         ; always, Y at the digit
+
+@octal: ldy     #0              ; the '0' is a digit in any base
+        lda     base
+        bne     @digits
+        lda     #8
+        sta     base
+        bne     @digits         ; always
+@nozero:
+        lda     base
+        bne     @digits
+        lda     #10
+        sta     base
+
+@digits:
+        lda     base
+        cmp     #10
+        bne     @other
+
+; Base 10
+@dec:   lda     (ptr1),y
+        sec
+        sbc     #'0'
+        cmp     #10
+        bcs     @end
+        sta     digit
+        bit     flags           ; past the range: just find the end
+        bmi     :+
+        jsr     mul10
+        jsr     add_digit
+:       lda     flags
+        ora     #DIGITS
+        sta     flags
+        next_char
+        jmp     @dec
+
+; Any other base
+@other: lda     (ptr1),y
+        jsr     digit_value
+        cmp     base
+        bcs     @end
+        sta     digit
+        bit     flags
+        bmi     :+
+        jsr     mul_base
+        jsr     add_digit
+:       lda     flags
+        ora     #DIGITS
+        sta     flags
+        next_char
+        jmp     @other
+
+@none:  lda     #0              ; no digits: value 0, end at nptr
+        sta     flags
+@end:   pla                     ; nptr
+        tax
+        pla
+        bit     flags
+        bvc     :+
+        tya                     ; the end of the digits
+        clc
+        adc     ptr1
+        ldx     ptr1+1
+        bcc     :+
+        inx
+:       sta     ptr2            ; end -> *endptr
+        stx     ptr2+1
+        pla
+        sta     ptr1+1
+        pla
+        sta     ptr1
+        ora     ptr1+1
+        beq     @range
+        ldy     #0
+        lda     ptr2
+        sta     (ptr1),y
+        iny
+        lda     ptr2+1
+        sta     (ptr1),y
+
+@range: lda     flags
+        bmi     @overflow
+        lsr     a               ; C = signed
+        bcc     @apply
+        lda     ptr4+1          ; at most $7FFFFFFF, or $80000000 when
+        bpl     @apply          ; negative
+        bit     negative
+        bpl     @overflow
+        and     #$7F
+        ora     ptr4
+        ora     ptr3+1
+        ora     ptr3
+        bne     @overflow
+
+@apply: bit     negative
+        bpl     @return
+        sec
+        lda     #0
+        sbc     ptr3
+        sta     ptr3
+        lda     #0
+        sbc     ptr3+1
+        sta     ptr3+1
+        lda     #0
+        sbc     ptr4
+        sta     ptr4
+        lda     #0
+        sbc     ptr4+1
+        sta     ptr4+1
+
+@return:
+        lda     ptr4
+        sta     sreg
+        lda     ptr4+1
+        sta     sreg+1
+        lda     ptr3
+        ldx     ptr3+1
+        rts
+
+; ERANGE, and the nearest value that can be returned
+@overflow:
+        lda     #<ERANGE
+        sta     ___errno
+        lda     #>ERANGE
+        sta     ___errno+1
+        lda     #$FF            ; ULONG_MAX
+        ldx     #$7F            ; LONG_MAX
+        lsr     flags           ; C = signed
+        bcc     :+
+        bit     negative
+        bpl     :++
+        lda     #0              ; LONG_MIN
+        ldx     #$80
+        bne     :++             ; always
+:       tax
+:       stx     sreg+1
+        sta     sreg
+        tax
+        rts
+
+; A = character -> A = its value as a digit, 36 or more if it is not one;
+; X is preserved
+digit_value:
+        sec
+        sbc     #'0'
+        cmp     #10
+        bcc     @done
+        sbc     #'A' - '0'      ; C set
+        and     #$DF            ; 'a'-'z' are 32 on from 'A'-'Z'
+        cmp     #26
+        bcs     @none
+        adc     #10             ; C clear
+@done:  rts
+@none:  lda     #$FF
+        rts
+
+; value = value * 10
+mul10:
+        lda     ptr4
+        ora     ptr4+1
+        bne     @wide
+        ldx     ptr3+1          ; under 6400: the result fits 16 bits
+        cpx     #>6400
+        bcs     @wide
+        lda     ptr3
+        asl     ptr3
+        rol     ptr3+1
+        asl     ptr3
+        rol     ptr3+1
+        clc
+        adc     ptr3
+        sta     ptr3
+        txa
+        adc     ptr3+1
+        sta     ptr3+1
+        asl     ptr3
+        rol     ptr3+1
+        rts
+
+@wide:  jsr     copy_value
+        jsr     double_value
+        jsr     double_value
+        jsr     add_copy
+        jmp     double_value
+
+; value = value * base, for any base from 2 to 36
+mul_base:
+        lda     base
+        tax                     ; a power of two has no bits in common
+        dex                     ; with itself less one
+        txa
+        and     base
+        bne     @general
+        lda     base
+@shift: lsr     a
+        bcs     @done
+        pha
+        jsr     double_value
+        pla
+        jmp     @shift
+@done:  rts
+
+; A bit of the base at a time from the top, doubling in between
+@general:
+        jsr     copy_value
+        lda     #0
+        sta     ptr3
+        sta     ptr3+1
+        sta     ptr4
+        sta     ptr4+1
+        lda     base
+        asl     a               ; bit 5, the top one under 37, to bit 7
+        asl     a
+        ldx     #6
+@bit:   pha
+        jsr     double_value
+        pla
+        asl     a
+        bcc     :+
+        pha
+        jsr     add_copy
+        pla
+:       dex
+        bne     @bit
+        rts
+
+; value -> ptr2/sreg
+copy_value:
+        lda     ptr3
+        sta     ptr2
+        lda     ptr3+1
+        sta     ptr2+1
+        lda     ptr4
+        sta     sreg
+        lda     ptr4+1
+        sta     sreg+1
+        rts
+
+; value = value * 2
+double_value:
+        asl     ptr3
+        rol     ptr3+1
+        rol     ptr4
+        rol     ptr4+1
+        bcs     overflow
+        rts
+
+; value = value + ptr2/sreg
+add_copy:
+        clc
+        lda     ptr3
+        adc     ptr2
+        sta     ptr3
+        lda     ptr3+1
+        adc     ptr2+1
+        sta     ptr3+1
+        lda     ptr4
+        adc     sreg
+        sta     ptr4
+        lda     ptr4+1
+        adc     sreg+1
+        sta     ptr4+1
+        bcs     overflow
+        rts
+
+; value = value + digit
+add_digit:
+        lda     digit
+        clc
+        adc     ptr3
+        sta     ptr3
+        bcc     @done
+        inc     ptr3+1
+        bne     @done
+        inc     ptr4
+        bne     @done
+        inc     ptr4+1
+        beq     overflow
+@done:  rts
+
+overflow:
+        lda     flags
+        ora     #OVERFLOW
+        sta     flags
+        rts
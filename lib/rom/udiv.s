@@ -0,0 +1,214 @@
+; udiv.s - unsigned 16-bit division runtime for clib.rom
+; Replaces cc65's udiv/umod modules; lib/rom/div.s builds the signed
+; forms on the same udiv16.
+;
+; udiv16 looks at the divisor before falling back to shift-and-subtract:
+; a power of two is a shift and a mask, and 10 takes the dividend a byte
+; at a time through 256-entry quotient and remainder tables. Dividing the
+; high byte h leaves a remainder r < 10, and
+;
+;     (r * 256 + lo) / 10 = r * 25 + (r * 6 + lo) / 10
+;
+; where r * 6 + lo < 310 is brought under 256 by taking out 25 * 10.
+
+        .export tosudiva0, tosudivax, tosumoda0, tosumodax
+        .export udiv16
+
+        .import popax
+        .importzp ptr1, ptr4, sreg
+
+        .code
+
+; Entry: TOS = dividend, A/X = divisor (X = 0 for the a0 forms)
+; Exit:  A/X = quotient, TOS popped
+tosudiva0:
+        ldx     #0
+tosudivax:
+        jsr     udiv_params
+        jsr     udiv16
+        lda     ptr1
+        ldx     ptr1+1
+        rts
+
+; Entry: TOS = dividend, A/X = divisor (X = 0 for the a0 forms)
+; Exit:  A/X = remainder, TOS popped
+tosumoda0:
+        ldx     #0
+tosumodax:
+        jsr     udiv_params
+        jsr     udiv16
+        lda     sreg
+        ldx     sreg+1
+        rts
+
+; Divisor (in A/X) -> ptr4, dividend -> ptr1
+udiv_params:
+        sta     ptr4
+        stx     ptr4+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        rts
+
+; Divisor 10, see above
+div10:
+        ldx     ptr1+1
+        lda     div10_quot,x
+        sta     ptr1+1
+        ldy     div10_rem,x     ; r = high byte % 10
+        lda     times6,y
+        clc
+        adc     ptr1            ; r * 6 + lo
+        bcc     @small
+        adc     #256 - 250 - 1  ; over 255: take out 250, C set
+        tax
+        lda     times25,y
+        adc     #25             ; C clear
+        bne     @sum            ; always
+@small:
+        tax
+        lda     times25,y
+@sum:
+        clc
+        adc     div10_quot,x
+        sta     ptr1
+        lda     #0
+        sta     sreg+1
+        lda     div10_rem,x
+        sta     sreg
+        rts
+
+; ptr1 / ptr4 -> quotient in ptr1, remainder in sreg and A
+; ptr4 is preserved. Division by zero gives a quotient of $FFFF.
+udiv16:
+        ldx     ptr4+1
+        bne     @wide
+        ldx     ptr4
+        cpx     #10
+        beq     div10
+        dex                     ; a power of two has no bits in common
+        txa                     ; with itself less one
+        and     ptr4
+        bne     @general
+        lda     ptr4
+        bne     pow2_lo         ; not zero, which is left to the loop
+        beq     @general        ; always
+
+@wide:
+        dex
+        txa
+        and     ptr4+1
+        bne     @general
+        lda     ptr4
+        beq     pow2_hi
+
+@general:
+        lda     #0
+        sta     sreg+1
+        ldy     #16
+        ldx     ptr4+1
+        beq     @byte
+
+@loop16:
+        asl     ptr1
+        rol     ptr1+1
+        rol     a
+        rol     sreg+1
+        tax
+        cmp     ptr4
+        lda     sreg+1
+        sbc     ptr4+1
+        bcc     :+
+        sta     sreg+1
+        txa
+        sbc     ptr4
+        tax
+        inc     ptr1
+:       txa
+        dey
+        bne     @loop16
+        sta     sreg
+        rts
+
+; An 8-bit divisor keeps the remainder in A alone. A divisor of 0 would
+; lose its high bits there, so it takes the 16-bit loop, which leaves
+; the whole dividend as the remainder.
+@byte:
+        ldx     ptr4
+        beq     @loop16
+@by8:
+        asl     ptr1
+        rol     ptr1+1
+        rol     a
+        bcs     :+
+        cmp     ptr4
+        bcc     :++
+:       sbc     ptr4
+        inc     ptr1
+:       dey
+        bne     @by8
+        sta     sreg
+        rts
+
+; Divisor 2^n, n < 8: remainder = low bits, quotient = dividend >> n
+pow2_lo:
+        tax                     ; X = divisor
+        dex
+        txa
+        and     ptr1
+        sta     sreg
+        lda     #0
+        sta     sreg+1
+        lda     ptr4
+@shift:
+        lsr     a
+        bcs     @done
+        lsr     ptr1+1
+        ror     ptr1
+        jmp     @shift
+@done:
+        lda     sreg
+        rts
+
+; Divisor 2^n, n >= 8: as pow2_lo on the high byte, the low byte is all
+; remainder
+pow2_hi:
+        lda     ptr1
+        sta     sreg
+        ldx     ptr4+1
+        dex
+        txa
+        and     ptr1+1
+        sta     sreg+1
+        lda     ptr1+1
+        sta     ptr1
+        lda     #0
+        sta     ptr1+1
+        lda     ptr4+1
+@shift:
+        lsr     a
+        bcs     @done
+        lsr     ptr1
+        jmp     @shift
+@done:
+        lda     sreg
+        rts
+
+        .rodata
+
+div10_quot:
+        .repeat 256, N
+        .byte   N / 10
+        .endrepeat
+div10_rem:
+        .repeat 256, N
+        .byte   N .mod 10
+        .endrepeat
+times6:
+        .repeat 10, N
+        .byte   N * 6
+        .endrepeat
+times25:
+        .repeat 10, N
+        .byte   N * 25
+        .endrepeat
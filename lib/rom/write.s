@@ -0,0 +1,73 @@
+; write.s - write for clib.rom
+; Files go through fd_transfer (fdtab.s): one OSGBPB call for any request
+; of GBPB_MIN bytes or more on a filing system that has it, OSBPUT
+; otherwise. The console writes with OSWRCH, and '\n' with OSNEWL so it
+; starts a new line.
+
+        .export _write
+
+        .import popax
+        .importzp ptr1, ptr2, ptr3
+
+        .include "fd.inc"
+
+        .code
+
+; int __fastcall__ write(int fd, const void* buf, unsigned count);
+_write:
+        sta     ptr2            ; count
+        stx     ptr2+1
+        jsr     popax           ; buf
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popax
+
+; The same from the stdio layer
+fd_write:
+        jsr     fd_check
+        bcs     @bad
+        and     #FD_WRITE
+        beq     @bad
+        lda     ptr2
+        ora     ptr2+1
+        beq     @none
+        lda     fd_flags,x
+        and     #FD_CONSOLE
+        bne     console
+        lda     #GBPB_WRITE
+        jmp     fd_transfer
+@none:  tax
+        rts
+@bad:   jmp     fd_badf
+
+; All of it goes, a page at a time: ptr3 counts the pages down and Y
+; indexes within one
+console:
+        lda     ptr2+1
+        sta     ptr3
+        ldy     #0
+        ldx     ptr2            ; bytes in the last, partial page
+@page:  lda     ptr3
+        beq     @last
+@char:  lda     (ptr1),y
+        jsr     put
+        iny
+        bne     @char
+        inc     ptr1+1
+        dec     ptr3
+        jmp     @page
+@last:  txa
+        beq     @done
+@tail:  lda     (ptr1),y
+        jsr     put
+        iny
+        dex
+        bne     @tail
+@done:  lda     ptr2
+        ldx     ptr2+1
+        rts
+
+put:    cmp     #10
+        beq     :+
+        jmp     OSWRCH
+:       jmp     OSNEWL
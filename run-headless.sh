@@ -0,0 +1,110 @@
+#!/bin/bash
+
+# Run a test disc headless under beebrun: clib ROM in a sideways slot,
+# scripted keypresses, OSWRCH output captured, cycles and exit code reported
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+BEEBRUN="${SCRIPT_DIR}/build/tools/beebrun"
+
+# Default values
+DISK_IMAGE="build/test-c-comprehensive/test.ssd"
+ROM_IMAGE="roms/clib.rom"
+ROM_SLOT=1
+KEYS=""
+KEYS_FILE=""
+OUTPUT=""
+REPORT=""
+MAX_CYCLES=""
+PROFILE=""
+SERIAL=""
+COSTS=()
+
+# Parse command line arguments
+while getopts "d:r:s:k:K:o:R:c:P:S:C:h" opt; do
+  case $opt in
+    d)
+      DISK_IMAGE="$OPTARG"
+      ;;
+    r)
+      ROM_IMAGE="$OPTARG"
+      ;;
+    s)
+      ROM_SLOT="$OPTARG"
+      ;;
+    k)
+      KEYS="$OPTARG"
+      ;;
+    K)
+      KEYS_FILE="$OPTARG"
+      ;;
+    o)
+      OUTPUT="$OPTARG"
+      ;;
+    R)
+      REPORT="$OPTARG"
+      ;;
+    c)
+      MAX_CYCLES="$OPTARG"
+      ;;
+    P)
+      PROFILE="$OPTARG"
+      ;;
+    S)
+      SERIAL="$OPTARG"
+      ;;
+    C)
+      COSTS+=(-C "$OPTARG")
+      ;;
+    h)
+      echo "Usage: $0 [OPTIONS]"
+      echo ""
+      echo "Options:"
+      echo "  -d <disk_image>    Disk image file (default: build/test-c-comprehensive/test.ssd)"
+      echo "  -r <rom_image>     Sideways ROM image (default: roms/clib.rom)"
+      echo "  -s <slot>          Sideways ROM slot (default: 1)"
+      echo "  -k <keys>          Scripted keypresses, e.g. 'q' or '\\r\\r\\r\\r'"
+      echo "  -K <keys_file>     Read scripted keypresses from a file (e.g. a test.keys)"
+      echo "  -o <output_file>   Write screen output to file (default: stdout)"
+      echo "  -R <report_file>   Write cycles/exit code report to file (default: stderr)"
+      echo "  -c <cycles>        Stop after this many 2MHz cycles"
+      echo "  -P <profile_file>  Write a JSR call-count profile (for tools/pgosplit.sh)"
+      echo "  -S <device>        Device on the RS423 port: loop (TX wired to RX),"
+      echo "                     or fujinet[:<file>] (a FujiNet serving the file)"
+      echo "  -C <name>=<cycles> Set a figure of beebrun's cost model (repeatable)"
+      echo "  -h                 Show this help message"
+      exit 0
+      ;;
+    \?)
+      echo "Invalid option: -$OPTARG" >&2
+      echo "Use -h for usage information"
+      exit 1
+      ;;
+    :)
+      echo "Option -$OPTARG requires an argument" >&2
+      exit 1
+      ;;
+  esac
+done
+
+shift $((OPTIND-1))
+
+if [ ! -x "$BEEBRUN" ]; then
+  make -C "${SCRIPT_DIR}/tools/beebrun" all > /dev/null || exit 1
+fi
+
+args=(-t)
+if [ -f "$ROM_IMAGE" ]; then
+  args+=(-r "${ROM_SLOT}:${ROM_IMAGE}")
+else
+  echo "Warning: $ROM_IMAGE not found, running without the clib ROM" >&2
+fi
+[ -n "$KEYS" ] && args+=(-k "$KEYS")
+[ -n "$KEYS_FILE" ] && args+=(-K "$KEYS_FILE")
+[ -n "$OUTPUT" ] && args+=(-o "$OUTPUT")
+[ -n "$REPORT" ] && args+=(-R "$REPORT")
+[ -n "$MAX_CYCLES" ] && args+=(-c "$MAX_CYCLES")
+[ -n "$PROFILE" ] && args+=(-p "$PROFILE")
+[ -n "$SERIAL" ] && args+=(-S "$SERIAL")
+args+=("${COSTS[@]}")
+
+"$BEEBRUN" "${args[@]}" "$DISK_IMAGE"
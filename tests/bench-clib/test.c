@@ -0,0 +1,144 @@
+/*
+ * ROM call cost benchmark
+ * Times each clib function over a range of input sizes. The same source
+ * is built for the static bbc target and the bbc-clib ROM target, and
+ * bench.sh joins the result sets into one table. The CLIB_FAST build
+ * links the clibx fast-path stubs and keeps clib paged in throughout.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#ifdef CLIB_FAST
+#include "clibx.h"
+#else
+#define clib_enter()
+#define clib_leave()
+#endif
+
+#define MAX_SIZE 250
+
+static const unsigned int sizes[] = { 1, 8, 64, MAX_SIZE };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static char src[MAX_SIZE + 1];
+static char src2[MAX_SIZE + 1];
+static char dst[MAX_SIZE + 1];
+static char numbuf[12];
+
+// Results are stored here so the calls cannot be optimised away
+static volatile long sink;
+
+// Fill a buffer with n non-zero characters and terminate it
+static void fill(char *buf, unsigned int n) {
+    unsigned int i;
+    for (i = 0; i < n; i++) {
+        buf[i] = 'a' + (i % 26);
+    }
+    buf[n] = '\0';
+}
+
+static void bench_strings(void) {
+    unsigned char i;
+    unsigned int n;
+
+    for (i = 0; i < NUM_SIZES; i++) {
+        n = sizes[i];
+        fill(src, n);
+        fill(src2, n);
+
+        bench_start();
+        sink = strlen(src);
+        bench_report("strlen", n, bench_stop());
+
+        bench_start();
+        strcpy(dst, src);
+        bench_report("strcpy", n, bench_stop());
+
+        dst[0] = '\0';
+        bench_start();
+        strcat(dst, src);
+        bench_report("strcat", n, bench_stop());
+
+        // Equal strings: the worst case, every byte is compared
+        bench_start();
+        sink = strcmp(src, src2);
+        bench_report("strcmp", n, bench_stop());
+
+        bench_start();
+        strncpy(dst, src, n);
+        bench_report("strncpy", n, bench_stop());
+
+        // Character not present: the whole string is scanned
+        bench_start();
+        sink = (long)strchr(src, '#');
+        bench_report("strchr", n, bench_stop());
+
+        bench_start();
+        memcpy(dst, src, n);
+        bench_report("memcpy", n, bench_stop());
+
+        bench_start();
+        memset(dst, 0x55, n);
+        bench_report("memset", n, bench_stop());
+
+        bench_start();
+        sink = memcmp(src, src2, n);
+        bench_report("memcmp", n, bench_stop());
+    }
+}
+
+static void bench_scalars(void) {
+    bench_start();
+    sink = abs(-12345);
+    bench_report("abs", 0, bench_stop());
+
+    bench_start();
+    sink = labs(-1234567L);
+    bench_report("labs", 0, bench_stop());
+
+    bench_start();
+    sink = atoi("-12345");
+    bench_report("atoi", 0, bench_stop());
+
+    bench_start();
+    sink = atol("-1234567");
+    bench_report("atol", 0, bench_stop());
+
+    bench_start();
+    itoa(-12345, numbuf, 10);
+    bench_report("itoa", 0, bench_stop());
+
+    bench_start();
+    ltoa(-1234567L, numbuf, 10);
+    bench_report("ltoa", 0, bench_stop());
+
+    bench_start();
+    sink = isalpha('q');
+    bench_report("isalpha", 0, bench_stop());
+
+    bench_start();
+    sink = isdigit('7');
+    bench_report("isdigit", 0, bench_stop());
+
+    bench_start();
+    sink = toupper('q');
+    bench_report("toupper", 0, bench_stop());
+
+    bench_start();
+    sink = tolower('Q');
+    bench_report("tolower", 0, bench_stop());
+}
+
+int main(void) {
+    clib_enter();
+    bench_calibrate();
+    bench_strings();
+    bench_scalars();
+    clib_leave();
+    return 0;
+}
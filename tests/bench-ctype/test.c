@@ -0,0 +1,127 @@
+/*
+ * Character classification benchmark
+ * Runs the ctype calls a tokenizer makes over a 4KB buffer of program
+ * text: counting each class, upper-casing the buffer in place, and
+ * splitting it into words and numbers. With CLIB_INLINE the calls are
+ * clibctype.h's table lookups in the ROM, so the whole run is inside
+ * clib_enter()/clib_leave().
+ */
+
+#include <ctype.h>
+
+#include "bench.h"
+
+#ifdef CLIB_FAST
+#include "clibx.h"
+#else
+#define clib_enter()
+#define clib_leave()
+#endif
+
+#ifdef CLIB_INLINE
+#include "clibctype.h"
+#endif
+
+#define SIZE 4096
+
+static const char text[] =
+    "10 FOR I% = 1 TO 255: PRINT TAB(3), x$; \"Count\", A(I%) * 2\r"
+    "\tif (n >= 0x7F) { total += n; } else return -1;\n";
+
+static char buf[SIZE];
+
+// Results are stored here so the loops cannot be optimised away
+static volatile unsigned int sink;
+
+static void fill(void) {
+    unsigned int i;
+    unsigned char j = 0;
+
+    for (i = 0; i < SIZE; i++) {
+        buf[i] = text[j++];
+        if (j == sizeof(text) - 1) {
+            j = 0;
+        }
+    }
+}
+
+static void bench_classes(void) {
+    unsigned int i, n;
+
+    bench_start();
+    for (i = n = 0; i < SIZE; i++) {
+        if (isalpha(buf[i])) n++;
+    }
+    sink = n;
+    bench_report("isalpha", SIZE, bench_stop());
+
+    bench_start();
+    for (i = n = 0; i < SIZE; i++) {
+        if (isdigit(buf[i])) n++;
+    }
+    sink = n;
+    bench_report("isdigit", SIZE, bench_stop());
+
+    bench_start();
+    for (i = n = 0; i < SIZE; i++) {
+        if (isspace(buf[i])) n++;
+    }
+    sink = n;
+    bench_report("isspace", SIZE, bench_stop());
+
+    bench_start();
+    for (i = n = 0; i < SIZE; i++) {
+        if (ispunct(buf[i])) n++;
+    }
+    sink = n;
+    bench_report("ispunct", SIZE, bench_stop());
+}
+
+static void bench_case(void) {
+    unsigned int i;
+
+    bench_start();
+    for (i = 0; i < SIZE; i++) {
+        buf[i] = toupper(buf[i]);
+    }
+    bench_report("toupper", SIZE, bench_stop());
+
+    bench_start();
+    for (i = 0; i < SIZE; i++) {
+        buf[i] = tolower(buf[i]);
+    }
+    bench_report("tolower", SIZE, bench_stop());
+}
+
+// Count identifiers and numbers, skipping everything else
+static void bench_tokens(void) {
+    unsigned int i = 0, words = 0, numbers = 0;
+
+    bench_start();
+    while (i < SIZE) {
+        if (isalpha(buf[i])) {
+            words++;
+            while (++i < SIZE && isalnum(buf[i])) {
+            }
+        } else if (isdigit(buf[i])) {
+            numbers++;
+            while (++i < SIZE && isxdigit(buf[i])) {
+            }
+        } else {
+            i++;
+        }
+    }
+    sink = words + numbers;
+    bench_report("tokenize", SIZE, bench_stop());
+}
+
+int main(void) {
+    bench_calibrate();
+    fill();
+    clib_enter();
+    bench_classes();
+    bench_case();
+    bench_tokens();
+    clib_leave();
+    return 0;
+}
@@ -0,0 +1,21 @@
+; osfile.s - OSFILE for the bench-dir program
+
+        .export _osfile
+
+        .import popa
+        .importzp ptr1
+
+OSFILE  := $FFDD
+
+        .code
+
+; unsigned char __fastcall__ osfile(unsigned char reason, void* block);
+_osfile:
+        sta     ptr1
+        stx     ptr1+1
+        jsr     popa
+        ldx     ptr1
+        ldy     ptr1+1
+        jsr     OSFILE
+        ldx     #0
+        rts
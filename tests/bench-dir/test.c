@@ -0,0 +1,138 @@
+/*
+ * Directory listing benchmark
+ * A file picker over a full DFS disc: the program and 30 files of
+ * different lengths, the 31 the catalogue holds. Two cases, each listing
+ * the directory PASSES times:
+ *
+ *   names    opendir(".") and readdir() to the end
+ *   details  the same with each file's length and load and exec
+ *            addresses: OSFILE 5 per name after cc65's readdir(), or
+ *            readdirx() from lib/rom/dir.s
+ *
+ * Each listing must find all ENTRIES files, and the details the lengths
+ * make_files() wrote, or the run fails.
+ *
+ * beebrun charges the calls for which DFS loads its catalogue from the
+ * disc, so the per-name OSFILE costs what it would on a real drive.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#ifdef HAVE_READDIRX
+#include "clibx.h"
+#else
+unsigned char __fastcall__ osfile(unsigned char reason, void* block);
+#endif
+
+#define FILES 30
+#define ENTRIES (FILES + 1)     /* and the program */
+#define PASSES 4
+
+static char data[FILES * 37];
+static unsigned int count;
+static unsigned long total;
+static unsigned long written;
+static unsigned int failures;
+
+static void make_files(void) {
+    unsigned int i;
+    char name[4];
+    int fd;
+
+    for (i = 0; i < FILES; i++) {
+        sprintf(name, "F%02u", i);
+        fd = open(name, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd < 0) {
+            printf("open %s failed\n", name);
+            return;
+        }
+        write(fd, data, i * 37);
+        close(fd);
+        written += i * 37;
+    }
+}
+
+static void bench_names(void) {
+    unsigned int i;
+    DIR *dir;
+    unsigned long cycles;
+
+    count = 0;
+    bench_start();
+    for (i = 0; i < PASSES; i++) {
+        dir = opendir(".");
+        while (readdir(dir) != NULL) {
+            count++;
+        }
+        closedir(dir);
+    }
+    cycles = bench_stop();
+    bench_report("names", 0, cycles);
+    printf("names: %u entries, %lu cycles/listing\n", count / PASSES, cycles / PASSES);
+    if (count != ENTRIES * PASSES) {
+        printf("names: %u entries, not %u\n", count / PASSES, ENTRIES);
+        failures++;
+    }
+}
+
+static void bench_details(void) {
+    unsigned int i;
+    DIR *dir;
+    unsigned long cycles;
+#ifdef HAVE_READDIRX
+    struct direntx *e;
+#else
+    struct dirent *e;
+    static unsigned char block[18];
+    static char name[12];
+#endif
+
+    count = 0;
+    total = 0;
+    bench_start();
+    for (i = 0; i < PASSES; i++) {
+        dir = opendir(".");
+#ifdef HAVE_READDIRX
+        while ((e = readdirx(dir)) != NULL) {
+            if (e->d_name[0] == 'F') {
+                total += e->d_size;
+            }
+            count++;
+        }
+#else
+        while ((e = readdir(dir)) != NULL) {
+            strcpy(name, e->d_name);
+            strcat(name, "\r");
+            *(char**)block = name;
+            if (osfile(5, block) && name[0] == 'F') {
+                total += *(unsigned long*)(block + 10);
+            }
+            count++;
+        }
+#endif
+        closedir(dir);
+    }
+    cycles = bench_stop();
+    bench_report("details", 0, cycles);
+    printf("details: %u entries, %lu bytes, %lu cycles/listing\n",
+           count / PASSES, total / PASSES, cycles / PASSES);
+    if (count != ENTRIES * PASSES || total != written * PASSES) {
+        printf("details: %lu bytes in %u entries, not %lu in %u\n",
+               total / PASSES, count / PASSES, written, ENTRIES);
+        failures++;
+    }
+}
+
+int main(void) {
+    bench_calibrate();
+    make_files();
+    bench_names();
+    bench_details();
+    return failures;
+}
@@ -0,0 +1,119 @@
+/*
+ * File throughput benchmark
+ * Writes an 8KB file and reads it back with read() and write() requests
+ * of 1, 64, 1024 and 8192 bytes, the sizes of a character at a time, a
+ * record, a buffer and a whole file load. Only the transfers are timed,
+ * not the open and close. The BYTES column holds the bytes moved, so
+ * bench.sh's per-byte column reads as cycles per byte, and each case also
+ * prints its rate in bytes per second at 2MHz.
+ *
+ * Each read is checked against what was written, so a size whose path
+ * is broken (the 1-byte reads go through OSBGET, the rest OSGBPB) fails
+ * the run rather than timing the wrong thing.
+ *
+ * beebrun keeps the disc in memory and charges each filing system call
+ * from its cost model, but not the time the drive takes to find a sector.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define TOTAL 8192
+#define CPU_HZ 2000000UL
+
+static const char name[] = "DATA";
+static unsigned char buffer[TOTAL];
+static unsigned int failures;
+
+static void report(const char *label, unsigned int size, unsigned long cycles) {
+    char text[16];
+
+    sprintf(text, "%s-%u", label, size);
+    bench_report(text, TOTAL, cycles);
+    printf("%s: %lu bytes/s\n", text, CPU_HZ * (TOTAL / 64) / (cycles / 64));
+}
+
+static void bench_write(unsigned int size) {
+    int fd;
+    unsigned int done;
+    unsigned long cycles;
+
+    fd = open(name, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        printf("open %s failed\n", name);
+        failures++;
+        return;
+    }
+    bench_start();
+    for (done = 0; done < TOTAL; done += size) {
+        write(fd, buffer + done, size);
+    }
+    cycles = bench_stop();
+    close(fd);
+    report("write", size, cycles);
+}
+
+// Check a read got the file back
+static void verify(unsigned int size, unsigned int got) {
+    unsigned int i;
+
+    if (got != TOTAL) {
+        printf("read-%u: %u of %u bytes\n", size, got, TOTAL);
+        failures++;
+        return;
+    }
+    for (i = 0; i < TOTAL; i++) {
+        if (buffer[i] != (unsigned char)(i * 7)) {
+            printf("read-%u: wrong at %u\n", size, i);
+            failures++;
+            return;
+        }
+    }
+}
+
+static void bench_read(unsigned int size) {
+    int fd;
+    unsigned int done;
+    unsigned int got = 0;
+    unsigned long cycles;
+
+    memset(buffer, 0, TOTAL);
+    fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        printf("open %s failed\n", name);
+        failures++;
+        return;
+    }
+    bench_start();
+    for (done = 0; done < TOTAL; done += size) {
+        if (read(fd, buffer + done, size) == (int)size) {
+            got += size;
+        }
+    }
+    cycles = bench_stop();
+    close(fd);
+    report("read", size, cycles);
+    verify(size, got);
+}
+
+int main(void) {
+    static const unsigned int sizes[] = { 1, 64, 1024, TOTAL };
+    unsigned char i;
+    unsigned int j;
+
+    bench_calibrate();
+    for (j = 0; j < TOTAL; j++) {
+        buffer[j] = j * 7;
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_write(sizes[i]);
+    }
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_read(sizes[i]);
+    }
+    return failures;
+}
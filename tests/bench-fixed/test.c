@@ -0,0 +1,160 @@
+/*
+ * Fixed point benchmark
+ * Times each fixed.h function against the plain C way of getting the same
+ * result with long arithmetic, where there is one. Each case runs CALLS
+ * times on operands read from volatile variables, and the BYTES column
+ * holds the number of calls, so bench.sh's per-byte column reads as
+ * cycles per operation.
+ */
+
+#include "bench.h"
+#include "fixed.h"
+
+#define CALLS 100
+
+static volatile fix8_t a8 = 0x0380, b8 = -0x0140;      // 3.5, -1.25
+static volatile fix16_t a16 = 0x00038000L;             // 3.5
+static volatile fix16_t b16 = -0x00014000L;            // -1.25
+static volatile unsigned long n = 1234567UL;
+static volatile int px = 300, py = -120;
+
+// Results are stored here so the calls cannot be optimised away
+static volatile long sink;
+
+// 16.16 multiply in C: no 64-bit type, so from 16-bit halves
+static fix16_t c_fix16_mul(fix16_t x, fix16_t y) {
+    unsigned char neg = 0;
+    unsigned long ux, uy, lo;
+    unsigned int xh, xl, yh, yl;
+
+    if (x < 0) {
+        x = -x;
+        neg = 1;
+    }
+    if (y < 0) {
+        y = -y;
+        neg ^= 1;
+    }
+    ux = x;
+    uy = y;
+    xh = ux >> 16;
+    xl = ux;
+    yh = uy >> 16;
+    yl = uy;
+    lo = ((unsigned long)xl * yl) >> 16;
+    ux = ((unsigned long)xh * yh << 16) + (unsigned long)xh * yl +
+         (unsigned long)xl * yh + lo;
+    return neg ? -(fix16_t)ux : (fix16_t)ux;
+}
+
+// Bit at a time square root in C
+static unsigned int c_isqrt(unsigned long v) {
+    unsigned long root = 0, bit = 1UL << 30;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static void bench_8_8(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix8_mul(a8, b8);
+    }
+    bench_report("fix8_mul", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = (fix8_t)(((long)a8 * b8) >> 8);
+    }
+    bench_report("c-mul8", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix8_div(a8, b8);
+    }
+    bench_report("fix8_div", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = (fix8_t)(((long)a8 << 8) / b8);
+    }
+    bench_report("c-div8", CALLS, bench_stop());
+}
+
+static void bench_16_16(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix16_mul(a16, b16);
+    }
+    bench_report("fix16_mul", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = c_fix16_mul(a16, b16);
+    }
+    bench_report("c-mul16", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix16_div(a16, b16);
+    }
+    bench_report("fix16_div", CALLS, bench_stop());
+}
+
+static void bench_functions(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = isqrt(n);
+    }
+    bench_report("isqrt", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = c_isqrt(n);
+    }
+    bench_report("c-isqrt", CALLS, bench_stop());
+
+    // One sweep round the circle
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix_sin(i * 10);
+    }
+    bench_report("fix_sin", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix_cos(i * 10);
+    }
+    bench_report("fix_cos", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = fix_atan2(py, px);
+    }
+    bench_report("fix_atan2", CALLS, bench_stop());
+}
+
+int main(void) {
+    bench_calibrate();
+    bench_8_8();
+    bench_16_16();
+    bench_functions();
+    return 0;
+}
@@ -0,0 +1,453 @@
+/*
+ * FujiNet protocol benchmark
+ * beebrun's FujiNet stand-in is on the RS423 port (beebrun -S fujinet).
+ * It answers each command as soon as the last byte is in, and serves
+ * 16KB of text for any URL, so the times are the Beeb's side of the
+ * protocol and the line and nothing else. The bbc variant implements
+ * lib/fujinet.h here through the MOS, as tests/test-serial does: the
+ * frame and any data sent with OSWRCH and *FX3, every byte of the reply
+ * taken with OSBYTE 128 and OSBYTE 145, and each checksum a second pass
+ * with rs232_checksum(). The kernel variant is clib.rom's client, on
+ * serial_read() and serial_write().
+ *
+ *   reset, ssid, hosts, slots, open, status, close
+ *            one command at 19200 baud, from the frame going out to the
+ *            last byte of the reply checked, the average of eight
+ *   read24, read48, read96, read192
+ *            4KB through status and 512-byte reads at 2400, 4800, 9600
+ *            and 19200 baud, with the bytes/s printed
+ *   stream   the whole 16KB at 19200 through fn_net_stream(), 512 bytes
+ *            at a time, to a function that sums each chunk
+ *   copy     the same through fn_net_copy() into a file on the disc
+ *
+ * The bbc variant's fn_net_stream() and fn_net_copy() ask for each
+ * chunk once the last has been dealt with; clib.rom's ask for the next
+ * before handing this one on.
+ *
+ * Every result is checked against what the stand-in serves: the SSID,
+ * host and slot, the status, the bytes of each read, a running sum of
+ * the stream against the body's, and the copied file read back. Reads
+ * are checked with the clock stopped. Failures are counted in each
+ * line, and the exit code is the total.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "fujinet.h"
+
+#ifdef HAVE_FUJINET
+#include "clibx.h"
+#else
+#include "rs423.h"
+#endif
+
+#define REPS 8
+#define CHUNK 512
+#define READ_TOTAL 4096
+#define BODY 16384              /* what the stand-in serves */
+#define LINE 52                 /* each of its lines */
+#define RING 1024
+#define STALL 2000000UL         /* a second without a byte: give up */
+
+#define BAUD_2400 5
+#define BAUD_4800 6
+#define BAUD_9600 7
+#define BAUD_19200 8
+
+static const char url[] = "N:HTTP://BEEBNET/BODY.TXT";
+
+static unsigned char buf[CHUNK];
+static struct fn_ssid ssid;
+static char hosts[FN_HOST_SLOTS][FN_HOST_SIZE];
+static struct fn_device_slot slots[FN_DEVICE_SLOTS];
+static struct fn_net_status status;
+static unsigned int failed, failures;
+static unsigned char sum1, sum2;
+
+static char line[LINE + 1];
+static unsigned int line_no, line_pos;
+
+#ifdef HAVE_FUJINET
+static unsigned char ring[RING];
+#endif
+
+static void start(unsigned char baud) {
+#ifdef HAVE_FUJINET
+    if (serial_open(ring, RING, baud) < 0) {
+        printf("serial_open failed\n");
+    }
+#else
+    rs423_setup(baud);
+#endif
+}
+
+static void stop(void) {
+#ifdef HAVE_FUJINET
+    serial_close();
+#endif
+}
+
+#ifndef HAVE_FUJINET
+static unsigned char frame[7];
+static unsigned char url_block[256];
+
+/* FujiNet checksum, as in tests/test-serial */
+static unsigned char rs232_checksum(const unsigned char* p, unsigned int len) {
+    unsigned int chk = 0;
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        chk = ((chk + p[i]) >> 8) + ((chk + p[i]) & 0xff);
+    }
+    return (unsigned char)chk;
+}
+
+/* The next byte from the device, or -1 if none comes */
+static int get_byte(void) {
+    unsigned long t = bench_cycles();
+
+    while (!rs423_waiting()) {
+        if (bench_cycles() - t > STALL) {
+            return -1;
+        }
+    }
+    return rs423_get();
+}
+
+/* Frame, then any data and its checksum, then 'C' and in_len bytes of
+ * reply with theirs: 0, or -1 if anything is missing or wrong */
+static int exchange(unsigned char device, unsigned char command, unsigned int aux,
+                    const unsigned char* out, unsigned int out_len,
+                    unsigned char* in, unsigned int in_len) {
+    unsigned char sum;
+    unsigned int i;
+    int c;
+
+    frame[0] = device;
+    frame[1] = command;
+    frame[2] = (unsigned char)aux;
+    frame[3] = (unsigned char)(aux >> 8);
+    frame[4] = 0;
+    frame[5] = 0;
+    frame[6] = rs232_checksum(frame, 6);
+    rs423_oswrch(frame, 7);
+    if (get_byte() != 'A') {
+        return -1;
+    }
+    if (out_len) {
+        sum = rs232_checksum(out, out_len);
+        rs423_oswrch(out, out_len);
+        rs423_oswrch(&sum, 1);
+        if (get_byte() != 'A') {
+            return -1;
+        }
+    }
+    if (get_byte() != 'C') {
+        return -1;
+    }
+    if (in_len) {
+        for (i = 0; i < in_len; i++) {
+            if ((c = get_byte()) < 0) {
+                return -1;
+            }
+            in[i] = (unsigned char)c;
+        }
+        if (get_byte() != rs232_checksum(in, in_len)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int fn_reset(void) {
+    return exchange(FN_FUJI, 0xFF, 0, NULL, 0, NULL, 0);
+}
+
+int __fastcall__ fn_get_ssid(struct fn_ssid* p) {
+    return exchange(FN_FUJI, 0xFE, 0, NULL, 0, (unsigned char*)p, sizeof(*p));
+}
+
+int __fastcall__ fn_get_hosts(char (*p)[FN_HOST_SIZE]) {
+    return exchange(FN_FUJI, 0xF4, 0, NULL, 0, (unsigned char*)p,
+                    FN_HOST_SLOTS * FN_HOST_SIZE);
+}
+
+int __fastcall__ fn_get_device_slots(struct fn_device_slot* p) {
+    return exchange(FN_FUJI, 0xF2, 0, NULL, 0, (unsigned char*)p, FN_DEVICE_SLOTS * sizeof(*p));
+}
+
+int __fastcall__ fn_net_open(const char* p, unsigned char mode, unsigned char trans) {
+    memset(url_block, 0, sizeof(url_block));
+    strcpy((char*)url_block, p);
+    return exchange(FN_NETWORK, 'O', mode | trans << 8, url_block, sizeof(url_block), NULL, 0);
+}
+
+int __fastcall__ fn_net_status(struct fn_net_status* p) {
+    return exchange(FN_NETWORK, 'S', 0, NULL, 0, (unsigned char*)p, sizeof(*p));
+}
+
+int __fastcall__ fn_net_read(void* p, unsigned int n) {
+    if (n > 32767) {
+        errno = EINVAL;
+        return -1;
+    }
+    return exchange(FN_NETWORK, 'R', n, NULL, 0, p, n) < 0 ? -1 : (int)n;
+}
+
+int fn_net_close(void) {
+    return exchange(FN_NETWORK, 'C', 0, NULL, 0, NULL, 0);
+}
+
+/* Status, then reads of what it says is waiting, each chunk handed on
+ * before the next is asked for */
+long __fastcall__ fn_net_stream(void* p, unsigned int n,
+                                int __fastcall__ (*fn)(const void* buf, unsigned int n)) {
+    struct fn_net_status st;
+    unsigned int k;
+    long got = 0;
+
+    for (;;) {
+        if (fn_net_status(&st) < 0) {
+            return -1;
+        }
+        if (st.waiting == 0) {
+            if (st.error == 136 || !st.connected) {
+                return got;
+            }
+            continue;
+        }
+        while (st.waiting) {
+            k = st.waiting < n ? st.waiting : n;
+            if (fn_net_read(p, k) < 0 || fn(p, k) < 0) {
+                return -1;
+            }
+            st.waiting -= k;
+            got += k;
+        }
+    }
+}
+
+static int copy_fd;
+static void* copy_buf;
+
+static int __fastcall__ copy_chunk(const void* p, unsigned int n) {
+    (void)p;
+    return write(copy_fd, copy_buf, n) == (int)n ? 0 : -1;
+}
+
+long __fastcall__ fn_net_copy(int fd, void* p, unsigned int n) {
+    copy_fd = fd;
+    copy_buf = p;
+    return fn_net_stream(p, n, copy_chunk);
+}
+#endif
+
+static void check(int result) {
+    if (result < 0) {
+        failed++;
+    }
+}
+
+/* The stand-in's body a byte at a time, from body_start() */
+static void body_start(void) {
+    line_no = 0;
+    line_pos = 0;
+}
+
+static unsigned char body_next(void) {
+    unsigned char c;
+
+    if (line_pos == 0) {
+        sprintf(line, "%05u The quick brown fox jumps over the lazy dog.\r\n", line_no++);
+    }
+    c = line[line_pos];
+    if (++line_pos == LINE) {
+        line_pos = 0;
+    }
+    return c;
+}
+
+/* Whether p holds the body's next n bytes */
+static int body_matches(const unsigned char* p, unsigned int n) {
+    while (n--) {
+        if (*p++ != body_next()) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void bench_commands(void) {
+    unsigned int i;
+
+    start(BAUD_19200);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_reset());
+    bench_report("reset", 0, bench_stop() / REPS);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_get_ssid(&ssid));
+    bench_report("ssid", sizeof(ssid), bench_stop() / REPS);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_get_hosts(hosts));
+    bench_report("hosts", sizeof(hosts), bench_stop() / REPS);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_get_device_slots(slots));
+    bench_report("slots", sizeof(slots), bench_stop() / REPS);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_net_open(url, FN_READ, FN_NO_TRANSLATION));
+    bench_report("open", 256, bench_stop() / REPS);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_net_status(&status));
+    bench_report("status", sizeof(status), bench_stop() / REPS);
+    bench_start();
+    for (i = 0; i < REPS; i++) check(fn_net_close());
+    bench_report("close", 0, bench_stop() / REPS);
+    stop();
+
+    if (strcmp(ssid.ssid, "BEEBNET") || strcmp(hosts[1], "fujinet.online") ||
+        strcmp(slots[0].file, "/BBC/GAMES/ELITE.SSD") || slots[0].host_slot != 1) {
+        failed++;
+    }
+    if (status.waiting != BODY || !status.connected || status.error != 1) {
+        failed++;
+    }
+    failures += failed;
+    printf("commands: %u failed, ssid %s, host 1 %s, slot 0 %s\n", failed, ssid.ssid, hosts[1],
+           slots[0].file);
+}
+
+static void bench_read(unsigned char baud, const char* name) {
+    unsigned int got = 0, n;
+    unsigned long cycles, paused = 0, t;
+
+    start(baud);
+    failed = 0;
+    check(fn_net_open(url, FN_READ, FN_NO_TRANSLATION));
+    body_start();
+    bench_start();
+    while (got < READ_TOTAL) {
+        if (fn_net_status(&status) < 0 || status.waiting == 0) {
+            failed++;
+            break;
+        }
+        n = status.waiting < CHUNK ? status.waiting : CHUNK;
+        if (n > READ_TOTAL - got) {
+            n = READ_TOTAL - got;
+        }
+        if (fn_net_read(buf, n) != (int)n) {
+            failed++;
+            break;
+        }
+        t = bench_cycles();
+        if (!body_matches(buf, n)) {
+            failed++;
+        }
+        paused += bench_cycles() - t;
+        got += n;
+    }
+    cycles = bench_stop() - paused;
+    check(fn_net_close());
+    stop();
+    failures += failed;
+
+    bench_report(name, READ_TOTAL, cycles);
+    printf("%s: %u of %u bytes, %u failed, %lu bytes/s\n", name, got, READ_TOTAL, failed,
+           bench_rate(got, cycles));
+}
+
+/* Something to do with each chunk: a running sum of it, and of the
+ * sums, so a byte out of place shows as well as a wrong one */
+static int __fastcall__ consume(const void* p, unsigned int n) {
+    const unsigned char* c = p;
+
+    while (n--) {
+        sum1 += *c++;
+        sum2 += sum1;
+    }
+    return 0;
+}
+
+/* The stream's sums, or the copied file, against the body */
+static void verify_stream(int to_file) {
+    unsigned char got1 = sum1, got2 = sum2;
+    unsigned int i;
+    int fd, n;
+
+    body_start();
+    if (to_file) {
+        fd = open("BODY", O_RDONLY);
+        check(fd);
+        for (i = 0; i < BODY; i += n) {
+            n = read(fd, buf, CHUNK);
+            if (n <= 0 || !body_matches(buf, n)) {
+                failed++;
+                break;
+            }
+        }
+        close(fd);
+        return;
+    }
+    sum1 = sum2 = 0;
+    for (i = 0; i < BODY; i++) {
+        sum1 += body_next();
+        sum2 += sum1;
+    }
+    if (got1 != sum1 || got2 != sum2) {
+        failed++;
+    }
+}
+
+static void bench_stream(int to_file) {
+    const char* name = to_file ? "copy" : "stream";
+    unsigned long cycles;
+    long got;
+    int fd = -1;
+
+    start(BAUD_19200);
+    failed = 0;
+    sum1 = sum2 = 0;
+    if (to_file) {
+        fd = open("BODY", O_WRONLY | O_CREAT | O_TRUNC);
+        check(fd);
+    }
+    check(fn_net_open(url, FN_READ, FN_NO_TRANSLATION));
+    bench_start();
+    if (to_file) {
+        got = fn_net_copy(fd, buf, CHUNK);
+    } else {
+        got = fn_net_stream(buf, CHUNK, consume);
+    }
+    cycles = bench_stop();
+    check(fn_net_close());
+    if (to_file) {
+        close(fd);
+    }
+    stop();
+    if (got != BODY) {
+        failed++;
+    } else {
+        verify_stream(to_file);
+    }
+    failures += failed;
+
+    bench_report(name, BODY, cycles);
+    printf("%s: %ld of %u bytes, %u failed, %lu bytes/s\n", name, got, BODY, failed,
+           bench_rate(got, cycles));
+}
+
+int main(void) {
+    bench_calibrate();
+    bench_commands();
+    bench_read(BAUD_2400, "read24");
+    bench_read(BAUD_4800, "read48");
+    bench_read(BAUD_9600, "read96");
+    bench_read(BAUD_19200, "read192");
+    bench_stream(0);
+    bench_stream(1);
+    return failures;
+}
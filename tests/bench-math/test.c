@@ -0,0 +1,207 @@
+/*
+ * Integer multiply and divide benchmark
+ * Covers int and long arithmetic, and the calls test-maths makes. Each
+ * case runs CALLS times on operands read from volatile variables, so
+ * the compiler has to call the runtime helpers. The BYTES column holds
+ * the number of calls, so bench.sh's per-byte column reads as cycles per
+ * operation, loop overhead included.
+ */
+
+#include <stdlib.h>
+
+#include "bench.h"
+
+#ifdef CLIB_FAST
+#include "clibx.h"
+#else
+#define clib_enter()
+#define clib_leave()
+#endif
+
+#define CALLS 100
+
+struct point {
+    int x, y, z;
+};
+
+static struct point points[CALLS];
+
+static volatile int a = 1234, b = 56, c = 15, d = 3, e = -4321;
+static volatile unsigned int u = 54321U;
+static volatile unsigned char p = 200, q = 100;
+static volatile long la = 123456L, lb = 789L, lneg = -98765L;
+static volatile unsigned long offset = 1234567UL, record = 100000UL;
+static volatile unsigned int sector = 512;
+static char buf[12];
+
+// Results are stored here so the calls cannot be optimised away
+static volatile long sink;
+
+static void bench_multiply(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = p * q;
+    }
+    bench_report("mul-8x8", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = c * d;
+    }
+    bench_report("mul-15x3", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = a * b;
+    }
+    bench_report("mul-16x16", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = e * a;
+    }
+    bench_report("mul-signed", CALLS, bench_stop());
+
+    // Array of 6-byte structs: the index is scaled by a multiply
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        points[i * q / 100].x = i;
+    }
+    bench_report("index", CALLS, bench_stop());
+}
+
+static void bench_divide(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = c / d;
+    }
+    bench_report("div-15/3", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = c % d;
+    }
+    bench_report("mod-15%3", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = u / 10;
+    }
+    bench_report("udiv-10", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = u % 10;
+    }
+    bench_report("umod-10", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = e / 10;
+    }
+    bench_report("div-10", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = e / 16;
+    }
+    bench_report("div-16", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = u / b;
+    }
+    bench_report("udiv-8bit", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = u / a;
+    }
+    bench_report("udiv-16bit", CALLS, bench_stop());
+}
+
+static void bench_long(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = la * lb;
+    }
+    bench_report("lmul", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = la * b;
+    }
+    bench_report("lmul-int", CALLS, bench_stop());
+
+    // A file offset split into 512-byte sectors. The size is a variable,
+    // as a constant power of two would be compiled to a shift.
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = offset / sector;
+    }
+    bench_report("ludiv-512", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = lneg / 10;
+    }
+    bench_report("ldiv-10", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = offset % 1000;
+    }
+    bench_report("lumod-1000", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = offset / record;
+    }
+    bench_report("ludiv-32bit", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = lneg % la;
+    }
+    bench_report("lmod-32bit", CALLS, bench_stop());
+}
+
+// The calls test-maths makes
+static void bench_maths(void) {
+    unsigned char i;
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = labs(lneg);
+    }
+    bench_report("labs", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        sink = atol("123456");
+    }
+    bench_report("atol", CALLS, bench_stop());
+
+    bench_start();
+    for (i = 0; i < CALLS; i++) {
+        ltoa(-54321L, buf, 10);
+    }
+    bench_report("ltoa", CALLS, bench_stop());
+}
+
+int main(void) {
+    clib_enter();
+    bench_calibrate();
+    bench_multiply();
+    bench_divide();
+    bench_long();
+    bench_maths();
+    clib_leave();
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Block memory benchmark
+ * Times memcpy, memset and memmove on blocks from 16 bytes up to a whole
+ * 20KB MODE 0 screen. The program is linked below &3000 and the screen
+ * area &3000-&7FFF is used as the destination; copies read from the paged
+ * ROM at &8000 upwards. The unaligned cases offset both pointers within
+ * their pages, which costs the (zp),y loads an extra cycle per page cross.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+
+#define SCREEN     ((unsigned char *)0x3000)
+#define SCREEN_END 0x8000
+#define ROM        ((const unsigned char *)0x8000)
+
+/* One MODE 0 character row: the distance a text scroll moves the screen */
+#define ROW 640
+
+/* Largest size for the unaligned cases, which leave room for the offset */
+#define MAX_UNALIGNED 4096
+
+static const unsigned int sizes[] = { 16, 256, 4096, SCREEN_END - 0x3000 };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static void bench_copy(unsigned int n) {
+    bench_start();
+    memcpy(SCREEN, ROM, n);
+    bench_report("memcpy", n, bench_stop());
+
+    if (n <= MAX_UNALIGNED) {
+        bench_start();
+        memcpy(SCREEN + 3, ROM + 1, n);
+        bench_report("memcpy+3", n, bench_stop());
+    }
+}
+
+static void bench_fill(unsigned int n) {
+    bench_start();
+    memset(SCREEN, 0, n);
+    bench_report("memset", n, bench_stop());
+
+    if (n <= MAX_UNALIGNED) {
+        bench_start();
+        memset(SCREEN + 3, 0x55, n);
+        bench_report("memset+3", n, bench_stop());
+    }
+}
+
+static void bench_move(unsigned int n) {
+    /* The full-screen case scrolls everything but one row */
+    if (n > SCREEN_END - 0x3000 - ROW) {
+        n -= ROW;
+    }
+
+    // Scroll up a row: dest below src, copied upwards
+    bench_start();
+    memmove(SCREEN, SCREEN + ROW, n);
+    bench_report("memmove-up", n, bench_stop());
+
+    // Scroll down a row: dest above src, copied downwards
+    bench_start();
+    memmove(SCREEN + ROW, SCREEN, n);
+    bench_report("memmove-down", n, bench_stop());
+}
+
+int main(void) {
+    unsigned char i;
+
+    bench_calibrate();
+    for (i = 0; i < NUM_SIZES; i++) {
+        bench_copy(sizes[i]);
+        bench_fill(sizes[i]);
+        bench_move(sizes[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Number formatting benchmark
+ * Times decimal conversion of single values with one to ten digits, and
+ * sweeps of 256 values spread over the whole 16-bit and 32-bit ranges.
+ * For the sweeps the BYTES column holds the number of calls, so bench.sh's
+ * per-byte column reads as cycles per call.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define SWEEP 256
+
+static const unsigned int words[] = { 9, 99, 999, 9999, 65535U };
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+static const unsigned long longs[] = {
+    9UL, 9999UL, 999999UL, 99999999UL, 4294967295UL
+};
+#define NUM_LONGS (sizeof(longs) / sizeof(longs[0]))
+
+static char buf[16];
+
+// Digit count of a value, used as the BYTES column
+static unsigned char digits(unsigned long v) {
+    unsigned char n = 1;
+    while (v >= 10) {
+        v /= 10;
+        n++;
+    }
+    return n;
+}
+
+static void bench_values(void) {
+    unsigned char i;
+
+    for (i = 0; i < NUM_WORDS; i++) {
+        bench_start();
+        utoa(words[i], buf, 10);
+        bench_report("utoa", digits(words[i]), bench_stop());
+
+        bench_start();
+        itoa(-(int)(words[i] >> 1), buf, 10);
+        bench_report("itoa-neg", digits(words[i] >> 1), bench_stop());
+    }
+
+    for (i = 0; i < NUM_LONGS; i++) {
+        bench_start();
+        ultoa(longs[i], buf, 10);
+        bench_report("ultoa", digits(longs[i]), bench_stop());
+
+        bench_start();
+        ltoa(-(long)(longs[i] >> 1), buf, 10);
+        bench_report("ltoa-neg", digits(longs[i] >> 1), bench_stop());
+
+        bench_start();
+        sprintf(buf, "%lu", longs[i]);
+        bench_report("sprintf-lu", digits(longs[i]), bench_stop());
+    }
+
+    bench_start();
+    utoa(0xBEEF, buf, 16);
+    bench_report("utoa-hex", 4, bench_stop());
+}
+
+static void bench_sweeps(void) {
+    unsigned int i;
+    unsigned long v;
+
+    bench_start();
+    for (i = 0; i < SWEEP; i++) {
+        utoa(i * 257, buf, 10);
+    }
+    bench_report("utoa-sweep", SWEEP, bench_stop());
+
+    bench_start();
+    for (i = 0; i < SWEEP; i++) {
+        sprintf(buf, "%u", i * 257);
+    }
+    bench_report("sprintf-u-sw", SWEEP, bench_stop());
+
+    bench_start();
+    for (i = 0, v = 0; i < SWEEP; i++, v += 16777259UL) {
+        ultoa(v, buf, 10);
+    }
+    bench_report("ultoa-sweep", SWEEP, bench_stop());
+}
+
+int main(void) {
+    bench_calibrate();
+    bench_values();
+    bench_sweeps();
+    return 0;
+}
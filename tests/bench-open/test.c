@@ -0,0 +1,115 @@
+/*
+ * Shared-channel benchmark
+ * A 4KB data file of 128 records of 32 bytes, read through several
+ * descriptors at once the way a program reading an index and its records
+ * from one file does. Three cases:
+ *
+ *   reopen  open and close the file 64 times while one descriptor holds
+ *           it open
+ *   parts   READERS descriptors on the file, each reading its own run of
+ *           records, a record from each in turn
+ *   limit   how many descriptors the file can be opened on at once
+ *
+ * beebrun charges an OSFIND open for the catalogue search DFS makes, so
+ * the opens that need no OS call show as cycles saved.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define RECORDS 128
+#define RECORD 32
+#define REOPENS 64
+#define READERS 4
+#define RUN (RECORDS / READERS)
+#define MAX_FDS 16
+
+static const char name[] = "DATA";
+static unsigned char record[RECORD];
+
+static void bench_reopen(void) {
+    unsigned int i;
+    int keep, fd;
+    unsigned long cycles;
+
+    keep = open(name, O_RDONLY);
+    bench_start();
+    for (i = 0; i < REOPENS; i++) {
+        fd = open(name, O_RDONLY);
+        close(fd);
+    }
+    cycles = bench_stop();
+    close(keep);
+    bench_report("reopen", 0, cycles);
+    printf("reopen: %lu cycles/open\n", cycles / REOPENS);
+}
+
+static void bench_parts(void) {
+    unsigned int i;
+    int fd[READERS];
+    unsigned char bad = 0;
+    unsigned long cycles;
+
+    for (i = 0; i < READERS; i++) {
+        fd[i] = open(name, O_RDONLY);
+        lseek(fd[i], (long)i * RUN * RECORD, SEEK_SET);
+    }
+    bench_start();
+    for (i = 0; i < RECORDS; i++) {
+        read(fd[i % READERS], record, RECORD);
+        if (record[0] != (i % READERS) * RUN + i / READERS) {
+            bad = 1;
+        }
+    }
+    cycles = bench_stop();
+    for (i = 0; i < READERS; i++) {
+        close(fd[i]);
+    }
+    bench_report("parts", RECORDS * RECORD, cycles);
+    if (bad) {
+        printf("parts: wrong record\n");
+    }
+}
+
+static void limit(void) {
+    int fd[MAX_FDS];
+    int n;
+
+    for (n = 0; n < MAX_FDS; n++) {
+        fd[n] = open(name, O_RDONLY);
+        if (fd[n] < 0) {
+            break;
+        }
+    }
+    printf("limit: %d descriptors on one file\n", n);
+    while (n > 0) {
+        close(fd[--n]);
+    }
+}
+
+int main(void) {
+    unsigned int i;
+    unsigned char j;
+    int fd;
+
+    bench_calibrate();
+    fd = open(name, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        printf("open %s failed\n", name);
+        return 1;
+    }
+    for (i = 0; i < RECORDS; i++) {
+        for (j = 0; j < RECORD; j++) {
+            record[j] = i;
+        }
+        write(fd, record, RECORD);
+    }
+    close(fd);
+    bench_reopen();
+    bench_parts();
+    limit();
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Number parsing benchmark
+ * Parses whole lines of numbers the way a config file or a FujiNet reply
+ * is read: strtol/strtoul walk the line with their end pointer, and atoi
+ * takes one field at a time. The BYTES column holds the number of values
+ * parsed, so bench.sh's per-byte column reads as cycles per number, and
+ * each case also prints its rate in numbers per second at 2MHz.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#define COUNT 64
+#define CPU_HZ 2000000UL
+
+static char decimal[COUNT * 7 + 1];     // "12 -345 6789 ..."
+static char wide[COUNT * 12 + 1];       // up to ten digits each
+static char hex[COUNT * 7 + 1];         // "0x1f 0xbeef ..."
+static char csv[COUNT * 6 + 1];         // "200,1024,65535,..."
+
+// Results are stored here so the calls cannot be optimised away
+static volatile long sink;
+
+static void report(const char *name, unsigned long cycles) {
+    bench_report(name, COUNT, cycles);
+    printf("%s: %lu numbers/s\n", name, CPU_HZ * COUNT / cycles);
+}
+
+// Fill the lines with a spread of values; sprintf is not timed
+static void fill(void) {
+    unsigned char i;
+    char *d = decimal, *w = wide, *h = hex, *c = csv;
+    unsigned long v = 7;
+
+    for (i = 0; i < COUNT; i++) {
+        v = v * 75 + 74;
+        d += sprintf(d, (i & 1) ? "-%u " : "%u ", (unsigned int)(v % 10000));
+        w += sprintf(w, "%lu ", v);
+        h += sprintf(h, "0x%x ", (unsigned int)v);
+        c += sprintf(c, "%u,", (unsigned int)(v % 65536));
+    }
+}
+
+static void bench_lines(void) {
+    unsigned char i;
+    char *p, *end;
+
+    bench_start();
+    p = decimal;
+    for (i = 0; i < COUNT; i++) {
+        sink = strtol(p, &end, 10);
+        p = end;
+    }
+    report("strtol-dec", bench_stop());
+
+    bench_start();
+    p = wide;
+    for (i = 0; i < COUNT; i++) {
+        sink = strtoul(p, &end, 10);
+        p = end;
+    }
+    report("strtoul-10d", bench_stop());
+
+    // Base 0: the "0x" prefix picks base 16
+    bench_start();
+    p = hex;
+    for (i = 0; i < COUNT; i++) {
+        sink = strtoul(p, &end, 0);
+        p = end;
+    }
+    report("strtoul-hex", bench_stop());
+
+    // Comma separated fields: step over each ',' after the number
+    bench_start();
+    p = csv;
+    for (i = 0; i < COUNT; i++) {
+        sink = strtol(p, &end, 10);
+        p = end + 1;
+    }
+    report("strtol-csv", bench_stop());
+}
+
+static void bench_atoi(void) {
+    unsigned char i;
+    char *p;
+
+    // atoi gives no end pointer, so the caller finds each separator
+    bench_start();
+    p = csv;
+    for (i = 0; i < COUNT; i++) {
+        sink = atoi(p);
+        while (*p++ != ',') {
+        }
+    }
+    report("atoi-csv", bench_stop());
+
+    bench_start();
+    p = decimal;
+    for (i = 0; i < COUNT; i++) {
+        sink = atol(p);
+        while (*p++ != ' ') {
+        }
+    }
+    report("atol-dec", bench_stop());
+}
+
+int main(void) {
+    bench_calibrate();
+    fill();
+    bench_lines();
+    bench_atoi();
+    return 0;
+}
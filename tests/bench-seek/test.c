@@ -0,0 +1,147 @@
+/*
+ * Random-access record file benchmark
+ * A 4KB file of 128 records of 32 bytes, worked on the way a database or
+ * an adventure game's save file is: every access seeks to its record
+ * first. Four cases of 256 operations each:
+ *
+ *   fetch   lseek(SEEK_SET) to a random record and read it
+ *   update  the same, then lseek(SEEK_CUR) back over it and rewrite it
+ *   scan    the records in order, each still sought with SEEK_SET
+ *   tell    the position and the size with lseek(SEEK_CUR) and
+ *           lseek(SEEK_END), and back with SEEK_SET
+ *
+ * The BYTES column holds the record bytes moved (0 for tell), and each
+ * case also prints its cost per operation. beebrun charges each filing
+ * system call a DFS-like cost, so the saving in calls shows as cycles.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define RECORDS 128
+#define RECORD 32
+#define OPS 256
+
+static const char name[] = "RECORDS";
+static unsigned char record[RECORD];
+static unsigned char order[OPS];
+
+static void report(const char *label, unsigned int bytes, unsigned long cycles) {
+    bench_report(label, bytes, cycles);
+    printf("%s: %lu cycles/op\n", label, cycles / OPS);
+}
+
+static void bench_fetch(int fd) {
+    unsigned int i;
+    unsigned long cycles;
+
+    bench_start();
+    for (i = 0; i < OPS; i++) {
+        lseek(fd, (long)order[i] * RECORD, SEEK_SET);
+        read(fd, record, RECORD);
+    }
+    cycles = bench_stop();
+    report("fetch", OPS * RECORD, cycles);
+}
+
+static void bench_update(int fd) {
+    unsigned int i;
+    unsigned long cycles;
+
+    bench_start();
+    for (i = 0; i < OPS; i++) {
+        lseek(fd, (long)order[i] * RECORD, SEEK_SET);
+        read(fd, record, RECORD);
+        record[0]++;
+        lseek(fd, -RECORD, SEEK_CUR);
+        write(fd, record, RECORD);
+    }
+    cycles = bench_stop();
+    report("update", 2 * OPS * RECORD, cycles);
+}
+
+static void bench_scan(int fd) {
+    unsigned int i;
+    unsigned long cycles;
+
+    bench_start();
+    for (i = 0; i < OPS; i++) {
+        lseek(fd, (long)(i % RECORDS) * RECORD, SEEK_SET);
+        read(fd, record, RECORD);
+    }
+    cycles = bench_stop();
+    report("scan", OPS * RECORD, cycles);
+}
+
+static void bench_tell(int fd) {
+    unsigned int i;
+    long here;
+    long size = 0;
+    unsigned long cycles;
+
+    lseek(fd, 5 * RECORD, SEEK_SET);
+    bench_start();
+    for (i = 0; i < OPS; i++) {
+        here = lseek(fd, 0, SEEK_CUR);
+        size = lseek(fd, 0, SEEK_END);
+        lseek(fd, here, SEEK_SET);
+    }
+    cycles = bench_stop();
+    report("tell", 0, cycles);
+    if (size != (long)RECORDS * RECORD) {
+        printf("size %ld\n", size);
+    }
+}
+
+// Every record starts with its own number, plus one per update
+static void verify(int fd) {
+    unsigned int i;
+    static unsigned char updates[RECORDS];
+
+    for (i = 0; i < OPS; i++) {
+        updates[order[i]]++;
+    }
+    lseek(fd, 0, SEEK_SET);
+    for (i = 0; i < RECORDS; i++) {
+        if (read(fd, record, RECORD) != RECORD ||
+            record[0] != (unsigned char)(i + updates[i]) ||
+            record[RECORD - 1] != (unsigned char)i) {
+            printf("record %u wrong\n", i);
+            return;
+        }
+    }
+}
+
+int main(void) {
+    unsigned int i;
+    unsigned char j;
+    int fd;
+
+    bench_calibrate();
+    srand(1);
+    for (i = 0; i < OPS; i++) {
+        order[i] = rand() % RECORDS;
+    }
+    fd = open(name, O_RDWR | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        printf("open %s failed\n", name);
+        return 1;
+    }
+    for (i = 0; i < RECORDS; i++) {
+        for (j = 0; j < RECORD; j++) {
+            record[j] = i;
+        }
+        write(fd, record, RECORD);
+    }
+    bench_fetch(fd);
+    bench_update(fd);
+    bench_scan(fd);
+    bench_tell(fd);
+    verify(fd);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ * RS423 benchmark
+ * The RS423 port is looped back on itself (beebrun -S loop), so each byte
+ * sent comes back a byte time later. The bbc variant goes through the
+ * MOS: OSBYTE 138 or OSWRCH with *FX3 to send, and OSBYTE 128 and
+ * OSBYTE 145 for every byte received, as tests/test-serial does. The
+ * kernel variant has serial_open() take the ACIA, serial_write() queue
+ * what is sent and serial_read() copy out of a 1KB receive ring.
+ *
+ *   stream   4KB sent and received at 19200 baud, which the line bounds
+ *   recv     the time spent in the calls that took those bytes
+ *   stream96 and recv96, the same at 9600 baud
+ *   block    16 FujiNet-sized exchanges at 19200: a 7-byte command and a
+ *            256-byte block sent with its checksum, and the 263 bytes
+ *            read back and checked
+ *   send     the time spent summing and sending them
+ *
+ * The bbc variant sums each packet with rs232_checksum() from
+ * tests/test-serial, a second pass over it; serial_read() and
+ * serial_write() sum the bytes as they copy them.
+ *
+ * beebrun charges the MOS's interrupt and buffer calls for RS423, so
+ * both paths pay for what the MOS does for them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "rs423.h"
+
+#ifdef HAVE_SERIAL
+#include "clibx.h"
+#endif
+
+#define TOTAL 4096
+#define RING 1024
+#define CHUNK 32                /* serial_write()s a pass in stream */
+#define BLOCK (7 + 256)
+#define BLOCKS 16
+#define STALL 2000000UL         /* a second without a byte: give up */
+
+#define BAUD_9600 7
+#define BAUD_19200 8
+
+static unsigned char out[TOTAL];
+static unsigned char in[TOTAL];
+#ifdef HAVE_SERIAL
+static unsigned char ring[RING];
+#endif
+
+static void start(unsigned char baud) {
+#ifdef HAVE_SERIAL
+    if (serial_open(ring, RING, baud) < 0) {
+        printf("serial_open failed\n");
+    }
+#else
+    rs423_setup(baud);
+#endif
+}
+
+static void stop(void) {
+#ifdef HAVE_SERIAL
+    serial_close();
+#endif
+}
+
+/* Send what there is room for, without waiting long */
+static unsigned int send_some(const unsigned char* p, unsigned int n) {
+#ifdef HAVE_SERIAL
+    return serial_write(p, n < CHUNK ? n : CHUNK);
+#else
+    unsigned int sent = 0;
+    while (sent < n && rs423_put(p[sent]) == 0) {
+        sent++;
+    }
+    return sent;
+#endif
+}
+
+/* Send all n bytes, the way each side would send a command */
+static void send_all(const unsigned char* p, unsigned int n) {
+#ifdef HAVE_SERIAL
+    serial_write(p, n);
+#else
+    rs423_oswrch(p, n);
+#endif
+}
+
+/* Take up to max bytes that have arrived */
+static unsigned int receive(unsigned char* p, unsigned int max) {
+#ifdef HAVE_SERIAL
+    return serial_read(p, max, 0);
+#else
+    unsigned int n = 0;
+    while (n < max && rs423_waiting()) {
+        p[n++] = rs423_get();
+    }
+    return n;
+#endif
+}
+
+/* Receive n bytes into p: how many came before the line went quiet.
+ * *spent gains the cycles in the calls that took them. */
+static unsigned int receive_all(unsigned char* p, unsigned int n, unsigned long* spent) {
+    unsigned int got = 0, k;
+    unsigned long t, last = bench_cycles();
+
+    while (got < n) {
+        t = bench_cycles();
+        k = receive(p + got, n - got);
+        if (k) {
+            last = bench_cycles();
+            *spent += last - t;
+            got += k;
+        } else if (t - last > STALL) {
+            break;
+        }
+    }
+    return got;
+}
+
+#ifndef HAVE_SERIAL
+/* FujiNet checksum, as in tests/test-serial */
+static unsigned char rs232_checksum(const unsigned char* buf, unsigned int len) {
+    unsigned int chk = 0;
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        chk = ((chk + buf[i]) >> 8) + ((chk + buf[i]) & 0xff);
+    }
+    return (unsigned char)chk;
+}
+#endif
+
+static unsigned int wrong(unsigned int n) {
+    unsigned int i, bad = 0;
+    for (i = 0; i < n; i++) {
+        if (in[i] != out[i]) {
+            bad++;
+        }
+    }
+    return bad;
+}
+
+static void bench_stream(unsigned char baud, const char* stream, const char* recv) {
+    unsigned int sent = 0, got = 0, n;
+    unsigned long cycles, rx = 0, t, last;
+
+    start(baud);
+    memset(in, 0, TOTAL);
+    bench_start();
+    last = bench_cycles();
+    while (got < TOTAL) {
+        if (sent < TOTAL) {
+            sent += send_some(out + sent, TOTAL - sent);
+        }
+        t = bench_cycles();
+        n = receive(in + got, TOTAL - got);
+        if (n) {
+            last = bench_cycles();
+            rx += last - t;
+            got += n;
+        } else if (t - last > STALL) {
+            break;
+        }
+    }
+    cycles = bench_stop();
+    stop();
+
+    bench_report(stream, TOTAL, cycles);
+    bench_report(recv, TOTAL, rx);
+    printf("%s: %u of %u bytes, %u wrong, %lu bytes/s\n", stream, got, TOTAL, wrong(TOTAL),
+           bench_rate(got, cycles));
+}
+
+static void bench_block(void) {
+    unsigned int i, got = 0, bad = 0, sums = 0;
+    unsigned char sent, back;
+    unsigned long cycles, tx = 0, rx = 0, t;
+
+    start(BAUD_19200);
+    bench_start();
+    for (i = 0; i < BLOCKS; i++) {
+        memset(in, 0, BLOCK);
+        t = bench_cycles();
+#ifdef HAVE_SERIAL
+        send_all(out, BLOCK);
+        sent = serial_tx_sum();
+#else
+        sent = rs232_checksum(out, BLOCK);
+        send_all(out, BLOCK);
+#endif
+        tx += bench_cycles() - t;
+        got += receive_all(in, BLOCK, &rx);
+#ifdef HAVE_SERIAL
+        back = serial_rx_sum();
+#else
+        back = rs232_checksum(in, BLOCK);
+#endif
+        if (back != sent) {
+            sums++;
+        }
+        bad += wrong(BLOCK);
+    }
+    cycles = bench_stop();
+    stop();
+
+    bench_report("block", BLOCK * BLOCKS, cycles);
+    bench_report("send", BLOCK * BLOCKS, tx);
+    printf("block: %u of %u bytes, %u wrong, %u bad checksums\n", got, BLOCK * BLOCKS, bad, sums);
+}
+
+int main(void) {
+    unsigned int i;
+
+    for (i = 0; i < TOTAL; i++) {
+        out[i] = (unsigned char)(i * 7 + (i >> 8));
+    }
+    bench_calibrate();
+    bench_stream(BAUD_19200, "stream", "recv");
+    bench_stream(BAUD_9600, "stream96", "recv96");
+    bench_block();
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Buffered stdio benchmark
+ * Writes a 4KB file with fputc and with fputs, and reads it back with
+ * fgetc, fgets and fread in 16-byte records. Lines are 32 characters
+ * with the '\n'. Only the transfers are timed, not fopen and fclose,
+ * except that fclose's final flush is counted for the writes. The BYTES
+ * column holds the bytes moved, and each case also prints its rate in
+ * bytes per second at 2MHz.
+ *
+ * With CLIB_STDIO (the clib.rom stream layer) fputs is also timed on a
+ * line-buffered stream, and fread on a stream given a static buffer with
+ * setvbuf.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define TOTAL 4096
+#define LINE 32
+#define RECORD 16
+#define CPU_HZ 2000000UL
+
+#ifndef _IOFBF
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+#endif
+
+#ifdef CLIB_STDIO
+int __fastcall__ setvbuf(FILE *f, char *buf, int mode, size_t size);
+
+static char iobuf[512];
+#endif
+
+static const char name[] = "DATA";
+static char line[LINE + 1];
+static unsigned char record[RECORD];
+
+static void report(const char *label, unsigned long cycles) {
+    bench_report(label, TOTAL, cycles);
+    printf("%s: %lu bytes/s\n", label, CPU_HZ * (TOTAL / 64) / (cycles / 64));
+}
+
+static FILE *start(const char *mode) {
+    FILE *f;
+
+    f = fopen(name, mode);
+    if (f == NULL) {
+        printf("fopen %s failed\n", name);
+    }
+    return f;
+}
+
+static void bench_fputc(void) {
+    FILE *f;
+    unsigned int i;
+    unsigned long cycles;
+
+    if ((f = start("w")) == NULL) {
+        return;
+    }
+    bench_start();
+    for (i = 0; i < TOTAL; i++) {
+        fputc(line[i % LINE], f);
+    }
+    fclose(f);
+    cycles = bench_stop();
+    report("fputc", cycles);
+}
+
+static void bench_fputs(const char *label, int mode) {
+    FILE *f;
+    unsigned int i;
+    unsigned long cycles;
+
+    if ((f = start("w")) == NULL) {
+        return;
+    }
+#ifdef CLIB_STDIO
+    setvbuf(f, NULL, mode, 0);
+#else
+    (void)mode;
+#endif
+    bench_start();
+    for (i = 0; i < TOTAL / LINE; i++) {
+        fputs(line, f);
+    }
+    fclose(f);
+    cycles = bench_stop();
+    report(label, cycles);
+}
+
+static void bench_fgetc(void) {
+    FILE *f;
+    unsigned int i;
+    unsigned long cycles;
+    unsigned int wrong = 0;
+
+    if ((f = start("r")) == NULL) {
+        return;
+    }
+    bench_start();
+    for (i = 0; i < TOTAL; i++) {
+        if (fgetc(f) != line[i % LINE]) {
+            wrong++;
+        }
+    }
+    cycles = bench_stop();
+    fclose(f);
+    report("fgetc", cycles);
+    if (wrong) {
+        printf("fgetc: %u wrong\n", wrong);
+    }
+}
+
+static void bench_fgets(void) {
+    FILE *f;
+    char got[LINE + 1];
+    unsigned int n = 0;
+    unsigned long cycles;
+
+    if ((f = start("r")) == NULL) {
+        return;
+    }
+    bench_start();
+    while (fgets(got, sizeof(got), f) != NULL) {
+        n++;
+    }
+    cycles = bench_stop();
+    fclose(f);
+    report("fgets", cycles);
+    if (n != TOTAL / LINE || strcmp(got, line) != 0) {
+        printf("fgets: %u lines\n", n);
+    }
+}
+
+static void bench_fread(const char *label, char *buf) {
+    FILE *f;
+    unsigned int n = 0;
+    unsigned long cycles;
+
+    if ((f = start("r")) == NULL) {
+        return;
+    }
+#ifdef CLIB_STDIO
+    if (buf != NULL) {
+        setvbuf(f, buf, _IOFBF, sizeof(iobuf));
+    }
+#else
+    (void)buf;
+#endif
+    bench_start();
+    while (fread(record, RECORD, 1, f) == 1) {
+        n++;
+    }
+    cycles = bench_stop();
+    fclose(f);
+    report(label, cycles);
+    if (n != TOTAL / RECORD) {
+        printf("%s: %u records\n", label, n);
+    }
+}
+
+int main(void) {
+    unsigned char i;
+
+    bench_calibrate();
+    for (i = 0; i < LINE - 1; i++) {
+        line[i] = 'A' + i % 26;
+    }
+    line[LINE - 1] = '\n';
+
+    bench_fputc();
+    bench_fputs("fputs", _IOFBF);
+#ifdef CLIB_STDIO
+    bench_fputs("fputs-line", _IOLBF);
+#endif
+    bench_fgetc();
+    bench_fgets();
+    bench_fread("fread", NULL);
+#ifdef CLIB_STDIO
+    bench_fread("fread-static", iobuf);
+#endif
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * String benchmark
+ * Times the string functions on 8, 64 and 250 character strings, and
+ * builds a path from short pieces the way a filename is put together:
+ * with a chain of strcat calls, and in the kernel build also with stpcpy,
+ * which carries on from the end of the previous piece.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+
+#ifdef HAVE_STPCPY
+#include "clibx.h"
+#endif
+
+#define MAX_SIZE 250
+
+static const unsigned int sizes[] = { 8, 64, MAX_SIZE };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+/* Path pieces: 16 pieces of 8 characters, 128 bytes in all */
+#define NUM_PIECES 16
+static const char piece[] = "dir.file";
+
+static char src[MAX_SIZE + 1];
+static char src2[MAX_SIZE + 1];
+static char dst[2 * MAX_SIZE + 1];
+
+// Results are stored here so the calls cannot be optimised away
+static volatile long sink;
+
+// Fill a buffer with n non-zero characters and terminate it
+static void fill(char *buf, unsigned int n) {
+    unsigned int i;
+    for (i = 0; i < n; i++) {
+        buf[i] = 'a' + (i % 26);
+    }
+    buf[n] = '\0';
+}
+
+static void bench_strings(void) {
+    unsigned char i;
+    unsigned int n;
+
+    for (i = 0; i < NUM_SIZES; i++) {
+        n = sizes[i];
+        fill(src, n);
+        fill(src2, n);
+
+        bench_start();
+        sink = strlen(src);
+        bench_report("strlen", n, bench_stop());
+
+        bench_start();
+        strcpy(dst, src);
+        bench_report("strcpy", n, bench_stop());
+
+        // Appending to a string of the same length: n bytes scanned, n copied
+        bench_start();
+        strcat(dst, src);
+        bench_report("strcat", n, bench_stop());
+
+        // Equal strings: the worst case, every byte is compared
+        bench_start();
+        sink = strcmp(src, src2);
+        bench_report("strcmp", n, bench_stop());
+
+        // Character not present: the whole string is scanned
+        bench_start();
+        sink = (long)strchr(src, '#');
+        bench_report("strchr", n, bench_stop());
+    }
+}
+
+static void bench_path(void) {
+    unsigned char i;
+
+    bench_start();
+    dst[0] = '\0';
+    for (i = 0; i < NUM_PIECES; i++) {
+        strcat(dst, piece);
+    }
+    bench_report("strcat-path", NUM_PIECES * (sizeof(piece) - 1), bench_stop());
+
+#ifdef HAVE_STPCPY
+    {
+        char *p;
+
+        bench_start();
+        p = dst;
+        for (i = 0; i < NUM_PIECES; i++) {
+            p = stpcpy(p, piece);
+        }
+        bench_report("stpcpy-path", NUM_PIECES * (sizeof(piece) - 1), bench_stop());
+    }
+#endif
+}
+
+int main(void) {
+    bench_calibrate();
+    bench_strings();
+    bench_path();
+    return 0;
+}
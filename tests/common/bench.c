@@ -0,0 +1,34 @@
+/*
+ * Cycle timing helpers for benchmark programs
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+
+static unsigned long bench_t0;
+static unsigned long bench_overhead;
+
+void bench_start(void) {
+    bench_t0 = bench_cycles();
+}
+
+unsigned long bench_stop(void) {
+    return bench_cycles() - bench_t0 - bench_overhead;
+}
+
+void bench_calibrate(void) {
+    bench_overhead = 0;
+    bench_start();
+    bench_overhead = bench_stop();
+}
+
+void bench_report(const char *name, unsigned int bytes, unsigned long cycles) {
+    printf("BENCH %s %u %lu\n", name, bytes, cycles);
+}
+
+unsigned long bench_rate(unsigned long bytes, unsigned long cycles) {
+    // bytes * 2000000 / cycles would overflow 32 bits above 2147 bytes
+    cycles /= 100;
+    return cycles ? bytes * 20000UL / cycles : 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * Cycle timing helpers for benchmark programs
+ * Timings come from the beebrun bench port and are only meaningful when
+ * the program is run headless under tools/beebrun
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/* 2MHz cycles since reset */
+unsigned long __fastcall__ bench_cycles(void);
+
+/* Measure the cost of an empty start/stop pair so it can be subtracted */
+void bench_calibrate(void);
+
+/* Time a region: bench_start(); ...; cycles = bench_stop(); */
+void bench_start(void);
+unsigned long bench_stop(void);
+
+/* Print one result line for bench.sh: BENCH <name> <bytes> <cycles>
+ * bytes is 0 for functions that do not work on a buffer */
+void bench_report(const char *name, unsigned int bytes, unsigned long cycles);
+
+/* Bytes per second at 2MHz for bytes moved in cycles, up to 214KB, or 0
+ * if cycles is below 100. Within 1% once cycles is 10000 or more. */
+unsigned long bench_rate(unsigned long bytes, unsigned long cycles);
+
+#endif
@@ -0,0 +1,68 @@
+#
+# Shared rules for benchmark programs: one build, and one disc, per variant
+#
+# The including Makefile sets:
+#   BENCH_NAME        output goes to build/$(BENCH_NAME)/<variant>/
+#   VARIANTS          variant names, e.g. "bbc bbc-clib"
+#   SRCS              C and assembly sources common to every variant
+#   <variant>_TARGET  cc65 target for the variant (default: bbc-clib)
+#   <variant>_CFLAGS  extra cl65 flags for the variant
+#   <variant>_SRCS    extra sources for the variant
+#   <variant>_LIBS    libraries linked ahead of the target library
+#   <variant>_LDFLAGS extra cl65 flags for the link only
+#
+# Sources are looked up in the benchmark's directory, tests/common and
+# lib/rom, so a variant can link the ROM kernels directly into the program.
+#
+# Each variant is compiled into its own object directory so the same
+# source can be built for several targets side by side.
+#
+
+BUILD_DIR = ../../build
+TEST_BUILD_DIR = $(BUILD_DIR)/$(BENCH_NAME)
+COMMON_DIR = ../common
+LIB_DIR = ../../lib
+CLIBX = $(BUILD_DIR)/lib/clibx.lib
+CC_ARGS = -Osir
+START_ADDR = 0x1900
+
+BENCH_SRCS = $(COMMON_DIR)/bench.c $(COMMON_DIR)/bench_cycles.s
+
+vpath %.c . $(COMMON_DIR)
+vpath %.s . $(COMMON_DIR) $(LIB_DIR)/rom
+
+all: $(foreach v,$(VARIANTS),$(TEST_BUILD_DIR)/$(v)/test.ssd)
+
+define variant_rules
+$(1)_DIR = $(TEST_BUILD_DIR)/$(1)
+$(1)_CC = cl65 $(CC_ARGS) -t $(or $($(1)_TARGET),bbc-clib) $($(1)_CFLAGS) -I $(COMMON_DIR)
+$(1)_OBJS = $$(foreach s,$(SRCS) $(BENCH_SRCS) $($(1)_SRCS),$$($(1)_DIR)/obj/$$(basename $$(notdir $$(s))).o)
+
+$$($(1)_DIR)/obj/%.o: %.c $(COMMON_DIR)/bench.h
+	mkdir -p $$(@D)
+	$$($(1)_CC) -c -o $$@ $$<
+
+$$($(1)_DIR)/obj/%.o: %.s
+	mkdir -p $$(@D)
+	$$($(1)_CC) -c -o $$@ $$<
+
+$$($(1)_DIR)/test: $$($(1)_OBJS) $($(1)_LIBS)
+	$$($(1)_CC) $($(1)_LDFLAGS) -Ln $$($(1)_DIR)/test.lbl --mapfile $$($(1)_DIR)/test.map --start-addr $(START_ADDR) -o $$@ $$^
+
+$$($(1)_DIR)/test.json: $$($(1)_DIR)/test
+	printf '{\n  "version": 1,\n  "discTitle": "bench",\n  "discSize": 800,\n  "bootOption": "none",\n  "cycleNumber": 0,\n  "files": [\n    {\n      "fileName": "TEST",\n      "directory": "$$$$",\n      "locked": false,\n      "loadAddress": "&001900",\n      "executionAddress": "&001900",\n      "contentPath": "%s",\n      "type": "other"\n    }\n  ]\n}\n' "$$(abspath $$<)" > $$@
+
+$$($(1)_DIR)/test.ssd: $$($(1)_DIR)/test.json $$($(1)_DIR)/test
+	dfstool make --output $$@ --overwrite $$<
+	@echo "  Disk: $$$$(realpath $$@)"
+endef
+
+$(foreach v,$(VARIANTS),$(eval $(call variant_rules,$(v))))
+
+$(CLIBX):
+	$(MAKE) -C $(LIB_DIR) all
+
+clean:
+	rm -rf $(TEST_BUILD_DIR)
+
+.PHONY: all clean
@@ -0,0 +1,24 @@
+; bench_cycles.s - read the beebrun cycle counter
+; Exported with leading underscores for C.
+
+        .export _bench_cycles
+
+        .importzp sreg
+
+; beebrun bench port in FRED: a write latches the 2MHz cycle counter,
+; which then reads back as four bytes, least significant first.
+; Not present on real hardware.
+BENCH_PORT := $FCD0
+
+        .code
+
+; unsigned long __fastcall__ bench_cycles(void);
+_bench_cycles:
+        sta     BENCH_PORT      ; latch
+        lda     BENCH_PORT+3
+        sta     sreg+1
+        lda     BENCH_PORT+2
+        sta     sreg
+        ldx     BENCH_PORT+1
+        lda     BENCH_PORT
+        rts
@@ -0,0 +1,24 @@
+/*
+ * MOS RS423 buffer calls for the serial benchmarks (rs423.s)
+ * These go through the MOS's buffers as tests/test-serial does, for
+ * the bbc variants to compare clib.rom's serial calls against
+ */
+
+#ifndef RS423_H
+#define RS423_H
+
+/* *FX7 and *FX8 to an OSBYTE rate (5 2400 baud .. 8 19200), RS423 input
+ * on with the keyboard still the input stream, and the buffer emptied */
+void __fastcall__ rs423_setup(unsigned char baud);
+
+/* Bytes in the input buffer, and the next of them */
+unsigned char rs423_waiting(void);
+unsigned char rs423_get(void);
+
+/* Add c to the output buffer: 0, or 1 if it is full */
+unsigned char __fastcall__ rs423_put(unsigned char c);
+
+/* Send n bytes with OSWRCH under *FX3,3 */
+void __fastcall__ rs423_oswrch(const void* buf, unsigned int n);
+
+#endif
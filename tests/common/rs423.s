@@ -0,0 +1,93 @@
+; rs423.s - MOS RS423 buffer calls for the serial benchmarks (rs423.h)
+
+        .export _rs423_setup, _rs423_waiting, _rs423_get, _rs423_put
+        .export _rs423_oswrch
+
+        .import popax
+        .importzp ptr1, ptr2
+
+OSWRCH  := $FFEE
+OSBYTE  := $FFF4
+
+        .code
+
+; void __fastcall__ rs423_setup(unsigned char baud);
+; *FX7 and *FX8 to baud, *FX2,2 to receive with the keyboard still the
+; input, and *FX21,1 to empty the input buffer
+_rs423_setup:
+        pha
+        tax
+        lda     #7
+        jsr     OSBYTE
+        pla
+        tax
+        lda     #8
+        jsr     OSBYTE
+        lda     #2
+        ldx     #2
+        jsr     OSBYTE
+        lda     #21
+        ldx     #1
+        jmp     OSBYTE
+
+; unsigned char rs423_waiting(void);
+; Bytes in the input buffer, ADVAL(-2)
+_rs423_waiting:
+        lda     #128
+        ldx     #$FE
+        jsr     OSBYTE
+        txa
+        ldx     #0
+        rts
+
+; unsigned char rs423_get(void);
+; The next byte from the input buffer, which must have one
+_rs423_get:
+        lda     #145
+        ldx     #1
+        jsr     OSBYTE
+        tya
+        ldx     #0
+        rts
+
+; unsigned char __fastcall__ rs423_put(unsigned char c);
+; Add c to the output buffer: 0, or 1 if it is full
+_rs423_put:
+        tay
+        lda     #138
+        ldx     #2
+        jsr     OSBYTE
+        lda     #0
+        tax
+        rol     a
+        rts
+
+; void __fastcall__ rs423_oswrch(const void* buf, unsigned int n);
+; Send n bytes with OSWRCH and *FX3,3, then *FX3,0 for the screen again,
+; as send_data_to_device() in tests/test-serial does
+_rs423_oswrch:
+        sta     ptr2
+        stx     ptr2+1
+        jsr     popax
+        sta     ptr1
+        stx     ptr1+1
+        lda     #3
+        ldx     #3
+        jsr     OSBYTE
+        ldy     #0
+@next:  lda     ptr2
+        ora     ptr2+1
+        beq     @done
+        lda     (ptr1),y
+        jsr     OSWRCH
+        inc     ptr1
+        bne     :+
+        inc     ptr1+1
+:       lda     ptr2
+        bne     :+
+        dec     ptr2+1
+:       dec     ptr2
+        jmp     @next
+@done:  lda     #3
+        ldx     #0
+        jmp     OSBYTE
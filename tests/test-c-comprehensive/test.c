@@ -7,6 +7,8 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "clibx.h"
+
 /* BBC OS functions for simple output */
 void __fastcall__ OSWRCH(unsigned char c);
 
@@ -162,6 +164,9 @@ int main(void) {
     /* === STRING FUNCTIONS === */
     print_string(STRING_FUNCS_HEADER);
     print_newline();
+
+    /* Keep clib paged in across the block so each call skips the bank switch */
+    clib_enter();
     
     /* Test strlen */
     print_string(STRLEN_TEST_PREFIX);
@@ -225,12 +230,16 @@ int main(void) {
         print_string(R_NOT_FOUND_MSG);
     }
     print_newline();
+
+    clib_leave();
     
     wait_for_key();
     
     /* === MEMORY FUNCTIONS === */
     print_string(MEMORY_FUNCS_HEADER);
     print_newline();
+
+    clib_enter();
     
     /* Test memcpy */
     print_string(MEMCPY_TEST_PREFIX);
@@ -271,6 +280,8 @@ int main(void) {
     print_decimal(result);
     print_string(GREATER_ZERO_SUFFIX);
     print_newline();
+
+    clib_leave();
     
     wait_for_key();
     
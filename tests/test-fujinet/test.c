@@ -0,0 +1,186 @@
+/*
+ * FujiNet client test for bbc-clib ROM target
+ * Runs clib.rom's FujiNet calls (lib/fujinet.h) against beebrun's
+ * FujiNet stand-in on the RS423 port (beebrun -S fujinet), which
+ * build.sh -x plugs in from this directory's Makefile.
+ *
+ * Checks the replies against what the stand-in serves: its SSID, host
+ * and device slots, the status of the open body, and every byte of the
+ * body's numbered lines through fn_net_read() and fn_net_stream(). Then
+ * each error path: opening one of the stand-in's N:TEST:// URLs makes
+ * the next command fail, as a NAK, a bad checksum, an 'E' or no answer
+ * at all, and the client must return -1 with EIO, or ENODEV for the
+ * silence, and carry on afterwards. A stream whose connection stalls,
+ * open with nothing waiting, must give up with EIO. A 255-character URL
+ * must be sent and a 256-character one refused with EINVAL, as must a
+ * read or write of more than 32767 bytes. Only failures are printed,
+ * then the totals; the exit code is the number of failures.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "clibx.h"
+#include "fujinet.h"
+
+#define BAUD_19200 8
+#define RING 1024
+#define CHUNK 512
+#define BODY 16384              /* what the stand-in serves */
+#define LINE 52                 /* each of its lines */
+
+static const char url[] = "N:HTTP://BEEBNET/BODY.TXT";
+
+static unsigned char ring[RING];
+static unsigned char buf[CHUNK];
+static char long_url[257];
+static struct fn_ssid ssid;
+static char hosts[FN_HOST_SLOTS][FN_HOST_SIZE];
+static struct fn_device_slot slots[FN_DEVICE_SLOTS];
+static struct fn_net_status status;
+
+static unsigned int checks, failures;
+
+static char line[LINE + 1];
+static unsigned int line_no, line_pos;
+static unsigned long body_pos;
+
+// Count a check, and print it if the result is not the one expected
+static void check(const char* what, long got, long expected) {
+    checks++;
+    if (got != expected) {
+        failures++;
+        printf("FAIL %s = %ld, not %ld\n", what, got, expected);
+    }
+}
+
+// As check(), for strings
+static void check_str(const char* what, const char* got, const char* expected) {
+    checks++;
+    if (strcmp(got, expected)) {
+        failures++;
+        printf("FAIL %s = \"%s\", not \"%s\"\n", what, got, expected);
+    }
+}
+
+// A call that should fail: -1, with errno set to expected
+static void check_error(const char* what, long got, int expected) {
+    check(what, got, -1);
+    check(what, errno, expected);
+}
+
+// Compare bytes with the body from where the last call left off
+static int body_matches(const unsigned char* p, unsigned int n) {
+    while (n--) {
+        if (line_pos == 0) {
+            sprintf(line, "%05u The quick brown fox jumps over the lazy dog.\r\n", line_no++);
+        }
+        if (*p++ != (unsigned char)line[line_pos]) {
+            return 0;
+        }
+        body_pos++;
+        if (++line_pos == LINE) {
+            line_pos = 0;
+        }
+    }
+    return 1;
+}
+
+// fn_net_stream()'s function: stop at the first chunk that is wrong
+static int __fastcall__ check_chunk(const void* p, unsigned int n) {
+    int ok = body_matches(p, n);
+
+    check("stream chunk matches", ok, 1);
+    return ok ? 0 : -1;
+}
+
+static void check_fuji(void) {
+    check("fn_reset()", fn_reset(), 0);
+    check("fn_get_ssid()", fn_get_ssid(&ssid), 0);
+    check_str("ssid", ssid.ssid, "BEEBNET");
+    check_str("password", ssid.password, "");
+    check("fn_get_hosts()", fn_get_hosts(hosts), 0);
+    check_str("host 0", hosts[0], "SD");
+    check_str("host 1", hosts[1], "fujinet.online");
+    check_str("host 2", hosts[2], "tnfs.fujinet.online");
+    check_str("host 3", hosts[3], "");
+    check("fn_get_device_slots()", fn_get_device_slots(slots), 0);
+    check("slot 0 host", slots[0].host_slot, 1);
+    check("slot 0 mode", slots[0].mode, 1);
+    check_str("slot 0 file", slots[0].file, "/BBC/GAMES/ELITE.SSD");
+    check_str("slot 1 file", slots[1].file, "/BBC/UTILS/DISCDOCTOR.SSD");
+    check("slot 2 host", slots[2].host_slot, 0);
+    check("slot 2 mode", slots[2].mode, 2);
+    check_str("slot 2 file", slots[2].file, "/WORK.SSD");
+    check("slot 3 host", slots[3].host_slot, 0xFF);
+}
+
+static void check_network(void) {
+    check("fn_net_open()", fn_net_open(url, FN_READ, FN_NO_TRANSLATION), 0);
+    check("fn_net_status()", fn_net_status(&status), 0);
+    check("waiting", status.waiting, BODY);
+    check("connected", status.connected, 1);
+    check("error", status.error, 1);
+
+    check("fn_net_read(100)", fn_net_read(buf, 100), 100);
+    check("read matches", body_matches(buf, 100), 1);
+    check("fn_net_status()", fn_net_status(&status), 0);
+    check("waiting after read", status.waiting, BODY - 100);
+    check("fn_net_write(10)", fn_net_write("0123456789", 10), 10);
+
+    check("fn_net_stream()", fn_net_stream(buf, CHUNK, check_chunk), BODY - 100);
+    check("body read", body_pos, BODY);
+    check("fn_net_status()", fn_net_status(&status), 0);
+    check("waiting at end", status.waiting, 0);
+    check("error at end", status.error, 136);
+    check("fn_net_close()", fn_net_close(), 0);
+}
+
+static void check_errors(void) {
+    check("open NAK", fn_net_open("N:TEST://NAK", FN_READ, FN_NO_TRANSLATION), 0);
+    check_error("status after NAK", fn_net_status(&status), EIO);
+    check("status again", fn_net_status(&status), 0);
+
+    check("open CHECKSUM", fn_net_open("N:TEST://CHECKSUM", FN_READ, FN_NO_TRANSLATION), 0);
+    check_error("hosts with bad checksum", fn_get_hosts(hosts), EIO);
+    check("hosts again", fn_get_hosts(hosts), 0);
+    check_str("host 1 again", hosts[1], "fujinet.online");
+
+    check("open ERROR", fn_net_open("N:TEST://ERROR", FN_READ, FN_NO_TRANSLATION), 0);
+    check_error("read after E", fn_net_read(buf, 10), EIO);
+    check("read again", fn_net_read(buf, 10), 10);
+
+    check("open SILENT", fn_net_open("N:TEST://SILENT", FN_READ, FN_NO_TRANSLATION), 0);
+    check_error("reset with no answer", fn_reset(), ENODEV);
+    check("reset again", fn_reset(), 0);
+
+    check("open STALL", fn_net_open("N:TEST://STALL", FN_READ, FN_NO_TRANSLATION), 0);
+    check_error("stream that stalls", fn_net_stream(buf, CHUNK, check_chunk), EIO);
+    check("close after stall", fn_net_close(), 0);
+
+    memcpy(long_url, "N:HTTP://", 9);
+    memset(long_url + 9, 'X', 255 - 9);
+    check("open 255 characters", fn_net_open(long_url, FN_READ, FN_NO_TRANSLATION), 0);
+    long_url[255] = 'X';
+    check_error("open 256 characters", fn_net_open(long_url, FN_READ, FN_NO_TRANSLATION), EINVAL);
+    check_error("read 32768", fn_net_read(buf, 32768U), EINVAL);
+    check_error("write 40000", fn_net_write(buf, 40000U), EINVAL);
+    check("fn_net_close()", fn_net_close(), 0);
+
+    check("serial_close()", serial_close(), 0);
+    check_error("reset with the port closed", fn_reset(), EINVAL);
+}
+
+int main(void) {
+    printf("FujiNet client test\n");
+    if (serial_open(ring, RING, BAUD_19200) < 0) {
+        printf("serial_open failed\n");
+        return 1;
+    }
+    check_fuji();
+    check_network();
+    check_errors();
+    printf("%u checks, %u failed\n", checks, failures);
+    return failures;
+}
@@ -1,13 +1,236 @@
 /*
  * Math functions test for bbc-clib ROM target
  * Tests mathematical functions available in ROM
+ *
+ * After the printed examples, checks the ROM kernels against known
+ * answers, edge cases included: the multiply and divide runtime, long
+ * arithmetic, fixed point, isqrt, sin/cos/atan2, strtol/strtoul, the
+ * ctype functions and clibctype.h's macros. Only failures are printed,
+ * then the totals; the exit code is the number of failures. Operands are
+ * read from volatile variables so that the compiler has to call the
+ * runtime helpers.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <conio.h>
 
+#include "fixed.h"
+#include "clibx.h"
+#include "clibctype.h"
+
+static volatile int i_a, i_b;
+static volatile unsigned int u_a, u_b;
+static volatile long l_a, l_b;
+static volatile unsigned long ul_a, ul_b;
+
+static unsigned int checks, failures;
+
+// Count a check, and print it if the result is not the one expected
+static void check(const char* what, long got, long expected) {
+    checks++;
+    if (got != expected) {
+        failures++;
+        printf("FAIL %s = %ld, not %ld\n", what, got, expected);
+    }
+}
+
+// As check(), for results that may be off by up to tolerance
+static void check_near(const char* what, long got, long expected, long tolerance) {
+    check(what, labs(got - expected) <= tolerance ? expected : got, expected);
+}
+
+static int mul_i(int a, int b) { i_a = a; i_b = b; return i_a * i_b; }
+static int div_i(int a, int b) { i_a = a; i_b = b; return i_a / i_b; }
+static int mod_i(int a, int b) { i_a = a; i_b = b; return i_a % i_b; }
+static unsigned int mul_u(unsigned int a, unsigned int b) { u_a = a; u_b = b; return u_a * u_b; }
+static unsigned int div_u(unsigned int a, unsigned int b) { u_a = a; u_b = b; return u_a / u_b; }
+static unsigned int mod_u(unsigned int a, unsigned int b) { u_a = a; u_b = b; return u_a % u_b; }
+static long mul_l(long a, long b) { l_a = a; l_b = b; return l_a * l_b; }
+static long div_l(long a, long b) { l_a = a; l_b = b; return l_a / l_b; }
+static long mod_l(long a, long b) { l_a = a; l_b = b; return l_a % l_b; }
+static unsigned long div_ul(unsigned long a, unsigned long b) { ul_a = a; ul_b = b; return ul_a / ul_b; }
+static unsigned long mod_ul(unsigned long a, unsigned long b) { ul_a = a; ul_b = b; return ul_a % ul_b; }
+
+static void check_runtime(void) {
+    check("123 * 45", mul_i(123, 45), 5535);
+    check("-300 * 7", mul_i(-300, 7), -2100);
+    check("-181 * -181", mul_i(-181, -181), 32761);
+    check("255u * 255u", mul_u(255, 255), 65025U);
+    check("0 * 999", mul_i(0, 999), 0);
+    check("54321u / 10", div_u(54321U, 10), 5432);
+    check("54321u % 10", mod_u(54321U, 10), 1);
+    check("54321u / 512", div_u(54321U, 512), 106);
+    check("54321u % 512", mod_u(54321U, 512), 49);
+    check("65535u / 1", div_u(65535U, 1), 65535U);
+    check("1000 / 7", div_i(1000, 7), 142);
+    check("-1000 / 7", div_i(-1000, 7), -142);
+    check("-1000 % 7", mod_i(-1000, 7), -6);
+    check("1000 % -7", mod_i(1000, -7), 6);
+
+    check("123456 * 789", mul_l(123456L, 789L), 97406784L);
+    check("100000 * 100000", mul_l(100000L, 100000L), 1410065408L);
+    check("-98765 * 3", mul_l(-98765L, 3L), -296295L);
+    check("1234567 / 512", div_ul(1234567UL, 512UL), 2411);
+    check("1234567 % 512", mod_ul(1234567UL, 512UL), 135);
+    check("1234567 / 10", div_ul(1234567UL, 10UL), 123456L);
+    check("4000000000 / 3000000000", div_ul(4000000000UL, 3000000000UL), 1);
+    check("4000000000 % 3000000000", mod_ul(4000000000UL, 3000000000UL), 1000000000L);
+    check("-1234567 / 10", div_l(-1234567L, 10L), -123456L);
+    check("-1234567 % 10", mod_l(-1234567L, 10L), -7);
+
+    // Division by zero: every quotient bit set, the dividend left over
+    check("5u / 0", div_u(5, 0), 65535U);
+    check("5ul / 0", div_ul(5, 0), (long)ULONG_MAX);
+    check("5ul % 0", mod_ul(5, 0), 5);
+    check("65536ul / 0", div_ul(65536UL, 0), (long)ULONG_MAX);
+    check("65536ul % 0", mod_ul(65536UL, 0), 65536L);
+}
+
+static void check_fixed(void) {
+    static const unsigned long roots[][2] = {
+        { 0, 0 }, { 1, 1 }, { 2, 1 }, { 3, 1 }, { 4, 2 }, { 99, 9 }, { 100, 10 },
+        { 65535UL, 255 }, { 65536UL, 256 }, { 999999UL, 999 }, { 1000000UL, 1000 },
+        { 4294967295UL, 65535U }
+    };
+    static const int angles[][3] = {        // y, x, angle
+        { 0, 1, 0 }, { 1, 0, 256 }, { 0, -1, 512 }, { -1, 0, 768 },
+        { 1, 1, 128 }, { -1, 1, 896 }, { 100, -100, 384 }, { 0, 0, 0 }
+    };
+    char what[24];
+    unsigned int i;
+    int wrong;
+
+    check("fix8_mul(3, 4)", fix8_mul(INT_TO_FIX8(3), INT_TO_FIX8(4)), INT_TO_FIX8(12));
+    check("fix8_mul(1.5, 1.5)", fix8_mul(0x0180, 0x0180), 0x0240);
+    check("fix8_mul(-1.5, 1.5)", fix8_mul(-0x0180, 0x0180), -0x0240);
+    check("fix8_mul(1/256, 0.5)", fix8_mul(1, 0x0080), 0);
+    check("fix8_mul(-1/256, 0.5)", fix8_mul(-1, 0x0080), 0);
+    check("fix8_div(1, 3)", fix8_div(FIX8_ONE, INT_TO_FIX8(3)), 0x0055);
+    check("fix8_div(-1, 3)", fix8_div(-FIX8_ONE, INT_TO_FIX8(3)), -0x0055);
+    check("fix8_div(7, -2)", fix8_div(INT_TO_FIX8(7), INT_TO_FIX8(-2)), -0x0380);
+    check("fix16_mul(3, 4)", fix16_mul(INT_TO_FIX16(3), INT_TO_FIX16(4)), INT_TO_FIX16(12));
+    check("fix16_mul(1.5, 1.5)", fix16_mul(0x18000L, 0x18000L), 0x24000L);
+    check("fix16_mul(-1.5, 1.5)", fix16_mul(-0x18000L, 0x18000L), -0x24000L);
+    check("fix16_div(1, 3)", fix16_div(FIX16_ONE, INT_TO_FIX16(3)), 0x5555L);
+    check("fix16_div(-1, 3)", fix16_div(-FIX16_ONE, INT_TO_FIX16(3)), -0x5555L);
+    check("fix16_div(100, 0.5)", fix16_div(INT_TO_FIX16(100), 0x8000L), INT_TO_FIX16(200));
+    check("fix8_div(5, 0)", fix8_div(INT_TO_FIX8(5), 0), -1);
+    check("fix8_div(-5, 0)", fix8_div(INT_TO_FIX8(-5), 0), 1);
+    check("fix16_div(5, 0)", fix16_div(INT_TO_FIX16(5), 0), -1L);
+
+    for (i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+        sprintf(what, "isqrt(%lu)", roots[i][0]);
+        check(what, isqrt(roots[i][0]), roots[i][1]);
+    }
+
+    check("fix_sin(0)", fix_sin(0), 0);
+    check_near("fix_sin(64)", fix_sin(64), 98, 1);
+    check_near("fix_sin(128)", fix_sin(128), 181, 1);
+    check_near("fix_sin(192)", fix_sin(192), 237, 1);
+    check("fix_sin(256)", fix_sin(256), FIX8_ONE);
+    check("fix_sin(512)", fix_sin(512), 0);
+    check("fix_sin(768)", fix_sin(768), -FIX8_ONE);
+    check("fix_sin(1280)", fix_sin(1280), FIX8_ONE);
+    check("fix_cos(0)", fix_cos(0), FIX8_ONE);
+    check("fix_cos(512)", fix_cos(512), -FIX8_ONE);
+
+    // Every angle: a half turn negates sin, and cos is sin a quarter on
+    wrong = 0;
+    for (i = 0; i < FIX_ANGLE_FULL; i++) {
+        if (fix_sin(i + 512) != -fix_sin(i) || fix_cos(i) != fix_sin(i + 256)) {
+            wrong++;
+        }
+    }
+    check("sin/cos symmetry", wrong, 0);
+
+    for (i = 0; i < sizeof(angles) / sizeof(angles[0]); i++) {
+        sprintf(what, "fix_atan2(%d, %d)", angles[i][0], angles[i][1]);
+        // Compare the difference, within a turn, so 1023 is near 0
+        check_near(what, (int)((fix_atan2(angles[i][0], angles[i][1]) - angles[i][2] + 512) & 1023) - 512,
+                   0, 1);
+    }
+}
+
+static void check_strtol(void) {
+    static const char minus[] = "  -123abc";
+    static const char hex[] = "0x1F";
+    static const char prefix[] = "0x";
+    static const char junk[] = "xyz";
+    static const char over[] = "2147483648";
+    char* end;
+
+    check("strtol(\"  -123abc\")", strtol(minus, &end, 10), -123);
+    check("  end", end - minus, 6);
+    check("strtol(\"0x1F\", 0)", strtol(hex, &end, 0), 31);
+    check("  end", end - hex, 4);
+    check("strtol(\"0755\", 0)", strtol("0755", NULL, 0), 493);
+    check("strtol(\"0x\", 16)", strtol(prefix, &end, 16), 0);
+    check("  end", end - prefix, 1);
+    check("strtol(\"101\", 2)", strtol("101", NULL, 2), 5);
+    check("strtol(\"zz\", 36)", strtol("zz", NULL, 36), 1295);
+    check("strtol(\"xyz\")", strtol(junk, &end, 10), 0);
+    check("  end", end - junk, 0);
+    check("strtoul(\"4294967295\")", strtoul("4294967295", NULL, 10), (long)ULONG_MAX);
+    check("strtol(\"-2147483648\")", strtol("-2147483648", NULL, 10), LONG_MIN);
+    errno = 0;
+    check("strtol(\"2147483648\")", strtol(over, &end, 10), LONG_MAX);
+    check("  errno", errno, ERANGE);
+    check("  end", end - over, 10);
+}
+
+static void check_ctype(void) {
+    // The functions themselves, not any macro from ctype.h
+    check("isalpha('A')", (isalpha)('A') != 0, 1);
+    check("isalpha('@')", (isalpha)('@') != 0, 0);
+    check("isdigit('9')", (isdigit)('9') != 0, 1);
+    check("isdigit('/')", (isdigit)('/') != 0, 0);
+    check("isxdigit('f')", (isxdigit)('f') != 0, 1);
+    check("isxdigit('g')", (isxdigit)('g') != 0, 0);
+    check("isspace('\\t')", (isspace)('\t') != 0, 1);
+    check("isspace(0)", (isspace)(0) != 0, 0);
+    check("ispunct('!')", (ispunct)('!') != 0, 1);
+    check("iscntrl(127)", (iscntrl)(127) != 0, 1);
+    check("isprint(' ')", (isprint)(' ') != 0, 1);
+    check("isgraph(' ')", (isgraph)(' ') != 0, 0);
+    check("isblank('\\t')", (isblank)('\t') != 0, 1);
+    check("isalpha(EOF)", (isalpha)(EOF) != 0, 0);
+    check("isalpha(200)", (isalpha)(200) != 0, 0);
+    check("toupper('a')", (toupper)('a'), 'A');
+    check("toupper('{')", (toupper)('{'), '{');
+    check("tolower('Z')", (tolower)('Z'), 'z');
+    check("tolower('@')", (tolower)('@'), '@');
+    check("toupper(200)", (toupper)(200), 200);
+    check("toupper(EOF)", (toupper)(EOF), EOF);
+    check("tolower(EOF)", (tolower)(EOF), EOF);
+}
+
+// clibctype.h's macros, which read the ROM's tables while it is paged in
+static void check_ctype_macros(void) {
+    static volatile int eof = EOF, c255 = 255, lower_a = 'a', upper_z = 'Z';
+    int upper_eof, lower_eof, upper_255, upper_a, lower_z, alpha_eof;
+
+    clib_enter();
+    upper_eof = toupper(eof);
+    lower_eof = tolower(eof);
+    upper_255 = toupper(c255);
+    upper_a = toupper(lower_a);
+    lower_z = tolower(upper_z);
+    alpha_eof = isalpha(eof) != 0;
+    clib_leave();
+
+    check("toupper(EOF) macro", upper_eof, EOF);
+    check("tolower(EOF) macro", lower_eof, EOF);
+    check("toupper(255) macro", upper_255, 255);
+    check("toupper('a') macro", upper_a, 'A');
+    check("tolower('Z') macro", lower_z, 'z');
+    check("isalpha(EOF) macro", alpha_eof, 0);
+}
+
 int main(void) {
     long big_negative = -98765L;
     char buffer[20];
@@ -40,6 +263,14 @@ int main(void) {
     itoa(value * 2, buffer, 10);
     printf("atoi(\"999\") * 2 = %s\n", buffer);
     
+    printf("\nChecking the ROM kernels...\n");
+    check_runtime();
+    check_fixed();
+    check_strtol();
+    check_ctype();
+    check_ctype_macros();
+    printf("%u checks, %u failed\n", checks, failures);
+
     printf("\nMath test completed\n");
     printf("Press q to exit\n");
     c = 0;
@@ -47,5 +278,5 @@ int main(void) {
         printf("You pressed: %c\n", c);
     };
     
-    return 0;
+    return failures;
 }
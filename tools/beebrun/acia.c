@@ -0,0 +1,177 @@
+/*
+ * acia.c - 6850 ACIA and serial ULA: the RS423 port, and the device
+ * plugged into the other end of it
+ *
+ * Bytes go out and come in at the rate the serial ULA is set to, ten
+ * bits (start, eight data, stop) per byte. The device gets each byte the
+ * ACIA sends as the stop bit ends, and what it sends back queues on the
+ * line until the ACIA has taken it, one byte time apart. While RTS is
+ * high the device sends nothing, and while the device holds CTS high the
+ * ACIA starts nothing new and reads back TDRE clear, as the 6850 does.
+ * A byte that arrives with the last one still unread is lost (OVRN).
+ */
+
+#include <string.h>
+
+#include "beeb.h"
+#include "fujinet.h"
+
+#define NO_EVENT    UINT64_MAX
+
+/* Serial ULA rate bits to baud */
+static const unsigned ula_baud[8] = { 19200, 1200, 4800, 150, 9600, 300, 2400, 75 };
+
+/* OSBYTE 7/8 rates 1-8 (75 to 19200 baud) to serial ULA rate bits */
+static const uint8_t osbyte_rate[9] = { 4, 7, 3, 5, 1, 6, 2, 4, 0 };
+
+static uint64_t byte_cycles(uint8_t rate) {
+    return (uint64_t)CPU_HZ * 10 / ula_baud[rate & 7];
+}
+
+static int rts_high(const acia *a) {
+    return (a->control & ACIA_TX_MASK) == ACIA_RTS_HIGH;
+}
+
+static int cts_high(const acia *a) {
+    return a->device_busy || (a->loopback && rts_high(a));
+}
+
+static void update_status(acia *a) {
+    a->status &= ACIA_RDRF | ACIA_OVRN;
+    if (!a->tx_full && !cts_high(a)) a->status |= ACIA_TDRE;
+    if (cts_high(a)) a->status |= ACIA_CTS;
+    a->irq = ((a->control & ACIA_RX_IRQ) && (a->status & (ACIA_RDRF | ACIA_OVRN))) ||
+             ((a->control & ACIA_TX_MASK) == ACIA_TX_IRQ && (a->status & ACIA_TDRE));
+    if (a->irq) a->status |= ACIA_IRQ;
+
+    a->next_event = NO_EVENT;
+    if (a->tx_busy) a->next_event = a->tx_done;
+    if (a->line_len && !rts_high(a) && a->rx_next < a->next_event) a->next_event = a->rx_next;
+}
+
+/* Move tx_data into the shift register if it is free and CTS allows */
+static void start_tx(acia *a, uint64_t now) {
+    if (a->tx_busy || !a->tx_full || cts_high(a)) return;
+    a->tx_shift = a->tx_data;
+    a->tx_full = 0;
+    a->tx_busy = 1;
+    a->tx_done = now + byte_cycles(a->ula);
+}
+
+void acia_init(acia *a) {
+    memset(a, 0, sizeof(*a));
+    a->ula = 0x24;                  /* 9600 baud both ways */
+    update_status(a);
+}
+
+static void loop_device(acia *a, void *ctx, uint8_t c, uint64_t now) {
+    (void)ctx;
+    acia_send(a, &c, 1, now);
+}
+
+int acia_attach(acia *a, const char *spec) {
+    if (strcmp(spec, "loop") == 0) {
+        a->device = loop_device;
+        a->loopback = 1;
+        return 0;
+    }
+    if (strcmp(spec, "fujinet") == 0) return fujinet_attach(a, NULL);
+    if (strncmp(spec, "fujinet:", 8) == 0) return fujinet_attach(a, spec + 8);
+    return -1;
+}
+
+void acia_set_baud(acia *a, int rx, uint8_t rate) {
+    uint8_t bits = osbyte_rate[rate <= 8 ? rate : 0];
+    if (rx) {
+        a->ula = (uint8_t)((a->ula & ~0x38) | bits << 3);
+    } else {
+        a->ula = (uint8_t)((a->ula & ~0x07) | bits);
+    }
+}
+
+uint8_t acia_read(acia *a, uint16_t addr, uint64_t now) {
+    if (!(addr & 1)) return a->status;
+    acia_update(a, now);
+    a->status &= ~(ACIA_RDRF | ACIA_OVRN);
+    update_status(a);
+    return a->rx_data;
+}
+
+void acia_write(acia *a, uint16_t addr, uint8_t value, uint64_t now) {
+    int held;
+
+    acia_update(a, now);
+    if (addr >= SERIAL_ULA) {
+        a->ula = value;
+        return;
+    }
+    if (addr & 1) {
+        a->tx_data = value;
+        a->tx_full = 1;
+        start_tx(a, now);
+        update_status(a);
+        return;
+    }
+
+    held = rts_high(a);
+    if ((value & 0x03) == ACIA_RESET) {
+        a->status = 0;
+        a->tx_full = 0;
+    }
+    a->control = value;
+    /* The device starts its next byte a byte time after RTS falls */
+    if (held && !rts_high(a) && a->rx_next < now + byte_cycles(a->ula >> 3)) {
+        a->rx_next = now + byte_cycles(a->ula >> 3);
+    }
+    start_tx(a, now);
+    update_status(a);
+}
+
+void acia_update(acia *a, uint64_t now) {
+    while (a->next_event <= now) {
+        if (a->tx_busy && a->tx_done == a->next_event) {
+            uint64_t done = a->tx_done;
+            a->tx_busy = 0;
+            a->tx_bytes++;
+            if (a->device) a->device(a, a->device_ctx, a->tx_shift, done);
+            start_tx(a, done);
+        } else {
+            uint64_t next = a->rx_next + byte_cycles(a->ula >> 3);
+            uint8_t c = a->line[a->line_head];
+            a->line_head = (a->line_head + 1) % SERIAL_LINE_SIZE;
+            a->line_len--;
+            a->rx_bytes++;
+            if (a->status & ACIA_RDRF) {
+                a->status |= ACIA_OVRN;
+                a->overruns++;
+            } else {
+                a->rx_data = c;
+                a->status |= ACIA_RDRF;
+            }
+            /* A clock run on past a whole byte (INKEY's wait) leaves
+             * the rest of the line where it was rather than overrunning */
+            a->rx_next = next > now ? next : now + byte_cycles(a->ula >> 3);
+        }
+        update_status(a);
+    }
+}
+
+void acia_send(acia *a, const uint8_t *data, size_t len, uint64_t now) {
+    size_t i;
+
+    /* An idle line starts the first byte now */
+    if (a->line_len == 0 && a->rx_next < now + byte_cycles(a->ula >> 3)) {
+        a->rx_next = now + byte_cycles(a->ula >> 3);
+    }
+    for (i = 0; i < len && a->line_len < SERIAL_LINE_SIZE; i++) {
+        a->line[(a->line_head + a->line_len) % SERIAL_LINE_SIZE] = data[i];
+        a->line_len++;
+    }
+    update_status(a);
+}
+
+void acia_set_busy(acia *a, int busy, uint64_t now) {
+    a->device_busy = busy;
+    start_tx(a, now);
+    update_status(a);
+}
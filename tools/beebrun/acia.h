@@ -0,0 +1,85 @@
+/*
+ * acia.h - 6850 ACIA and serial ULA: the RS423 port, and the device
+ * plugged into the other end of it
+ */
+
+#ifndef BEEBRUN_ACIA_H
+#define BEEBRUN_ACIA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ACIA_BASE       0xFE08      /* status/control, data at +1, mirrored to &FE0F */
+#define SERIAL_ULA      0xFE10      /* baud rates, write only, mirrored to &FE17 */
+
+/* ACIA status register */
+#define ACIA_RDRF       0x01        /* receive data register full */
+#define ACIA_TDRE       0x02        /* transmit data register empty */
+#define ACIA_DCD        0x04
+#define ACIA_CTS        0x08        /* set: the device is not ready */
+#define ACIA_FE         0x10
+#define ACIA_OVRN       0x20        /* a byte arrived with RDRF still set */
+#define ACIA_PE         0x40
+#define ACIA_IRQ        0x80
+
+/* ACIA control register */
+#define ACIA_RESET      0x03        /* counter divide bits both set */
+#define ACIA_TX_MASK    0x60
+#define ACIA_TX_IRQ     0x20        /* RTS low, transmit interrupt enabled */
+#define ACIA_RTS_HIGH   0x40        /* RTS high, transmit interrupt disabled */
+#define ACIA_RX_IRQ     0x80
+
+/* Bytes the device has put on the line that the ACIA has not yet had */
+#define SERIAL_LINE_SIZE    65536
+
+typedef struct acia acia;
+
+/* The far end of the line: gets each byte as the ACIA finishes sending it */
+typedef void (*acia_device_fn)(acia *a, void *ctx, uint8_t c, uint64_t now);
+
+struct acia {
+    uint8_t  control, status;
+    uint8_t  rx_data, tx_data, tx_shift;
+    uint8_t  ula;
+    int      tx_full;               /* tx_data waiting for the shift register */
+    int      tx_busy;               /* tx_shift going out, done at tx_done */
+    uint64_t tx_done;
+    uint64_t rx_next;               /* next byte from the line complete at */
+    int      device_busy;           /* device holding CTS high */
+    int      irq;                   /* IRQ line, as the status bit */
+
+    uint8_t  line[SERIAL_LINE_SIZE];
+    size_t   line_head, line_len;
+
+    acia_device_fn device;
+    void    *device_ctx;
+    int      loopback;              /* RTS wired back to CTS */
+
+    /* Earliest cycle at which anything changes */
+    uint64_t next_event;
+
+    unsigned long rx_bytes, tx_bytes, overruns;
+};
+
+void    acia_init(acia *a);
+
+/* Plug in a device by name: "loop" wires TX to RX and RTS to CTS, and
+ * "fujinet" or "fujinet:<file>" is the FujiNet stand-in (fujinet.h).
+ * Returns 0, or -1 for a device that is not known or will not start. */
+int     acia_attach(acia *a, const char *spec);
+
+uint8_t acia_read(acia *a, uint16_t addr, uint64_t now);
+void    acia_write(acia *a, uint16_t addr, uint8_t value, uint64_t now);
+
+/* Bring the ACIA up to date; call when now reaches next_event */
+void    acia_update(acia *a, uint64_t now);
+
+/* Set the serial ULA rate bits from an OSBYTE 7/8 rate (1-8) */
+void    acia_set_baud(acia *a, int rx, uint8_t rate);
+
+/* The device side: put bytes on the line to the ACIA, and hold off the
+ * transmitter (CTS high) while busy */
+void    acia_send(acia *a, const uint8_t *data, size_t len, uint64_t now);
+void    acia_set_busy(acia *a, int busy, uint64_t now);
+
+#endif
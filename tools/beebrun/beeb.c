@@ -0,0 +1,281 @@
+/*
+ * beeb.c - memory map, sideways ROM paging and the run loop
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "beeb.h"
+
+#define ROMSEL          0xFE30
+#define ROM_TYPE_TABLE  0x02A1
+#define ROM_WORKSPACE   0x0DF0
+#define CUR_ROM         0xF4
+
+/* The cost model. None of these is a measurement: they are estimates of
+ * what MOS 1.20 and Acorn DFS spend, and every cycle figure beebrun
+ * reports for filing system or RS423 work rests on them. A figure timed
+ * on a real machine replaces one with -C name=cycles.
+ *
+ *   fs_call     getting from a filing system vector to DFS's own code
+ *               and back, with the channel or catalogue lookup
+ *   fs_byte     DFS's buffer copy, per byte; the catalogue reloads of
+ *               OSFILE, an OSFIND open and OSGBPB 5 and 8 move its two
+ *               sectors, and OSWORD &7F every sector it reads
+ *   rs423_irq   the ACIA part of the MOS's IRQ1V handler, per byte
+ *   rs423_buffer  one buffer insert, remove or count through OSBYTE 128,
+ *               138 or 145, or an OSWRCH to RS423 */
+static const struct {
+    const char *name;
+    uint32_t    cycles;
+} beeb_costs[COSTS] = {
+    { "fs_call",      200 },
+    { "fs_byte",      30 },
+    { "rs423_irq",    150 },
+    { "rs423_buffer", 120 }
+};
+
+void beeb_init(beeb *b) {
+    int i;
+
+    memset(b, 0, sizeof(*b));
+    b->cpu.ctx = b;
+    b->cpu.read = beeb_read;
+    b->cpu.write = beeb_write;
+    b->out = stdout;
+    b->romsel = 15;
+    b->cycle_limit = 1000000000ULL;
+    for (i = 0; i < COSTS; i++) b->cost[i] = beeb_costs[i].cycles;
+    dfs_init(&b->disc);
+    acia_init(&b->acia);
+    b->rs423_in.size = 255;
+    b->rs423_out.size = 191;
+    mos_build_rom(b);
+}
+
+const char *beeb_cost_name(int id) {
+    return beeb_costs[id].name;
+}
+
+/* name=cycles; returns 0, or -1 for an unknown name or a bad number */
+int beeb_set_cost(beeb *b, const char *spec) {
+    const char *eq = strchr(spec, '=');
+    char *end;
+    unsigned long cycles;
+    int i;
+
+    if (!eq || !eq[1]) return -1;
+    cycles = strtoul(eq + 1, &end, 0);
+    if (*end || cycles > 0xFFFFFFFFUL) return -1;
+    for (i = 0; i < COSTS; i++) {
+        if (strlen(beeb_costs[i].name) == (size_t)(eq - spec) &&
+            !strncmp(beeb_costs[i].name, spec, (size_t)(eq - spec))) {
+            b->cost[i] = (uint32_t)cycles;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int beeb_load_rom(beeb *b, int slot, const char *path) {
+    FILE *fp;
+    size_t n;
+
+    if (slot < 0 || slot > 15) {
+        fprintf(stderr, "ROM slot %d out of range\n", slot);
+        return -1;
+    }
+    fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    if (!b->rom[slot]) b->rom[slot] = malloc(0x4000);
+    memset(b->rom[slot], 0xFF, 0x4000);
+    n = fread(b->rom[slot], 1, 0x4000, fp);
+    fclose(fp);
+    if (n < 0x10) {
+        fprintf(stderr, "%s: not a sideways ROM image\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+uint8_t beeb_read(void *ctx, uint16_t addr) {
+    beeb *b = ctx;
+
+    if (addr < 0x8000) return b->ram[addr];
+    if (addr < 0xC000) {
+        uint8_t *rom = b->rom[b->romsel & 15];
+        return rom ? rom[addr - 0x8000] : 0xFF;
+    }
+    if (addr >= 0xFC00 && addr < 0xFF00) {
+        if (addr == ROMSEL) return b->romsel;
+        if ((addr & 0xFFF8) == ACIA_BASE) return acia_read(&b->acia, addr, b->cpu.cycles);
+        if (addr >= BENCH_PORT && addr < BENCH_PORT + 4) return b->bench_latch[addr - BENCH_PORT];
+        return 0x00;
+    }
+    return b->mos[addr - 0xC000];
+}
+
+void beeb_write(void *ctx, uint16_t addr, uint8_t value) {
+    beeb *b = ctx;
+
+    if (addr < 0x8000) {
+        b->ram[addr] = value;
+    } else if (addr == ROMSEL) {
+        b->romsel = value & 15;
+    } else if ((addr & 0xFFF8) == ACIA_BASE || (addr & 0xFFF8) == SERIAL_ULA) {
+        acia_write(&b->acia, addr, value, b->cpu.cycles);
+    } else if (addr == BENCH_PORT) {
+        int i;
+        for (i = 0; i < 4; i++) b->bench_latch[i] = (uint8_t)(b->cpu.cycles >> (8 * i));
+    }
+}
+
+uint32_t beeb_read32(beeb *b, uint16_t addr) {
+    return (uint32_t)beeb_read(b, addr)
+         | (uint32_t)beeb_read(b, (uint16_t)(addr + 1)) << 8
+         | (uint32_t)beeb_read(b, (uint16_t)(addr + 2)) << 16
+         | (uint32_t)beeb_read(b, (uint16_t)(addr + 3)) << 24;
+}
+
+void beeb_write32(beeb *b, uint16_t addr, uint32_t value) {
+    int i;
+    for (i = 0; i < 4; i++) {
+        beeb_write(b, (uint16_t)(addr + i), (uint8_t)(value >> (8 * i)));
+    }
+}
+
+/* Read a CR or NUL terminated string from the 6502 address space */
+void beeb_read_string(beeb *b, uint16_t addr, char *buf, size_t size) {
+    size_t i;
+    for (i = 0; i + 1 < size; i++) {
+        uint8_t c = beeb_read(b, (uint16_t)(addr + i));
+        if (c == '\r' || c == 0) break;
+        buf[i] = (char)c;
+    }
+    buf[i] = 0;
+}
+
+/* Generate an error the way the MOS and filing systems do: build a BRK
+ * error block at the bottom of the stack page and execute it. */
+void beeb_raise_error(beeb *b, uint8_t num, const char *msg) {
+    uint16_t p = 0x100;
+    b->ram[p++] = 0x00;
+    b->ram[p++] = num;
+    while (*msg && p < 0x1F0) b->ram[p++] = (uint8_t)*msg++;
+    b->ram[p] = 0x00;
+    b->cpu.pc = 0x100;
+}
+
+/* Profile slot for a JSR target; sideways ROM addresses are kept apart
+ * per bank, since the same address is a different routine in each */
+uint32_t beeb_profile_slot(uint16_t addr, uint8_t bank) {
+    if (addr < 0x8000 || addr >= 0xC000) return addr;
+    return 0x10000 + (uint32_t)(bank & 15) * 0x4000 + (addr - 0x8000);
+}
+
+static void profile_jsr(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    uint16_t target;
+
+    if (beeb_read(b, cpu->pc) != 0x20) return;
+    target = (uint16_t)(beeb_read(b, (uint16_t)(cpu->pc + 1)) |
+                        beeb_read(b, (uint16_t)(cpu->pc + 2)) << 8);
+    b->profile[beeb_profile_slot(target, b->romsel)]++;
+}
+
+static void run_until(beeb *b, uint16_t stop) {
+    cpu6502 *cpu = &b->cpu;
+
+    while (b->status == RUN_ACTIVE) {
+        if ((cpu->pc & 0xFF00) == TRAP_PAGE) {
+            if (cpu->pc == stop) return;
+            mos_trap(b, (uint8_t)cpu->pc);
+            continue;
+        }
+        if (b->profile) profile_jsr(b);
+        if (cpu_step(cpu) < 0) {
+            b->status = RUN_BAD_OPCODE;
+        } else if (cpu->cycles >= b->cycle_limit) {
+            b->status = RUN_CYCLE_LIMIT;
+        }
+        if (cpu->cycles >= b->acia.next_event) acia_update(&b->acia, cpu->cycles);
+        if (b->acia.irq) cpu_irq(cpu);
+    }
+}
+
+/* JSR to addr from the host and run until it returns */
+int beeb_call(beeb *b, uint16_t addr) {
+    uint16_t ret = TRAP_PAGE + TRAP_RETURN - 1;
+    uint16_t saved_pc = b->cpu.pc;
+
+    cpu_push(&b->cpu, (uint8_t)(ret >> 8));
+    cpu_push(&b->cpu, (uint8_t)ret);
+    b->cpu.pc = addr;
+    run_until(b, TRAP_PAGE + TRAP_RETURN);
+    if (b->status != RUN_ACTIVE) return -1;
+    b->cpu.pc = saved_pc;
+    return 0;
+}
+
+static int rom_valid(const uint8_t *rom) {
+    uint8_t off = rom[7];
+    return rom[off] == 0 && rom[off + 1] == '(' && rom[off + 2] == 'C' && rom[off + 3] == ')';
+}
+
+static void service_call(beeb *b, int slot, uint8_t reason, uint8_t *y) {
+    b->romsel = (uint8_t)slot;
+    b->ram[CUR_ROM] = (uint8_t)slot;
+    b->cpu.a = reason;
+    b->cpu.x = (uint8_t)slot;
+    b->cpu.y = *y;
+    if (beeb_call(b, 0x8003) == 0) *y = b->cpu.y;
+}
+
+/* Power-on sequence: build the ROM type table and give each ROM its
+ * workspace claims, the same service calls the MOS makes on reset. */
+void beeb_boot(beeb *b) {
+    uint8_t y;
+    int slot, language = -1;
+
+    b->cpu.s = 0xFF;
+    b->cpu.p = FLAG_I | FLAG_U;
+
+    for (slot = 0; slot < 16; slot++) {
+        uint8_t type = 0;
+        if (b->rom[slot] && rom_valid(b->rom[slot])) {
+            type = b->rom[slot][6];
+            if (type & 0x40) language = slot;
+        }
+        b->ram[ROM_TYPE_TABLE + slot] = type;
+    }
+
+    /* Absolute workspace (1) then private workspace (2), highest slot first */
+    y = 0x0E;
+    for (slot = 15; slot >= 0; slot--) {
+        if (b->ram[ROM_TYPE_TABLE + slot] & 0x80) service_call(b, slot, 1, &y);
+    }
+    y = 0x0E;
+    for (slot = 15; slot >= 0; slot--) {
+        if (b->ram[ROM_TYPE_TABLE + slot] & 0x80) {
+            b->ram[ROM_WORKSPACE + slot] = y;
+            service_call(b, slot, 2, &y);
+        }
+    }
+
+    b->romsel = (uint8_t)(language >= 0 ? language : 15);
+    b->ram[CUR_ROM] = b->romsel;
+    b->cpu.s = 0xFF;
+    b->cpu.p = FLAG_U;
+}
+
+void beeb_run_program(beeb *b, uint16_t exec) {
+    uint16_t ret = TRAP_PAGE + TRAP_EXIT - 1;
+
+    cpu_push(&b->cpu, (uint8_t)(ret >> 8));
+    cpu_push(&b->cpu, (uint8_t)ret);
+    b->cpu.pc = exec;
+    run_until(b, 0);
+}
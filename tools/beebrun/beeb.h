@@ -0,0 +1,153 @@
+/*
+ * beeb.h - headless BBC Micro model: memory map, sideways ROMs and a
+ * host-side MOS that services the OS entry points directly
+ */
+
+#ifndef BEEBRUN_BEEB_H
+#define BEEBRUN_BEEB_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "acia.h"
+#include "cpu.h"
+#include "dfs.h"
+
+#define CPU_HZ          2000000UL
+
+/* Benchmark port in FRED (not present on real hardware): any write to
+ * BENCH_PORT latches the cycle counter, which then reads back as four
+ * bytes, least significant first. */
+#define BENCH_PORT      0xFCD0
+
+/* JSR profile slots: one per address outside sideways ROM space, then
+ * one per address of each of the 16 sideways banks */
+#define PROFILE_SLOTS   (0x10000 + 16 * 0x4000)
+
+/* The default vectors point into this page of the synthetic MOS ROM.
+ * Executing an address here runs the matching host handler, which then
+ * returns to the caller as if the code had ended with RTS. */
+#define TRAP_PAGE       0xF800
+
+enum trap_id {
+    TRAP_USERV = 0, TRAP_BRKV, TRAP_IRQ1V, TRAP_IRQ2V,
+    TRAP_CLIV, TRAP_BYTEV, TRAP_WORDV, TRAP_WRCHV,
+    TRAP_RDCHV, TRAP_FILEV, TRAP_ARGSV, TRAP_BGETV,
+    TRAP_BPUTV, TRAP_GBPBV, TRAP_FINDV, TRAP_FSCV,
+    TRAP_EVNTV,
+    TRAP_VECTORS,               /* number of vectors at &0200 with traps */
+
+    TRAP_RETURN = 0xFE,         /* host-initiated call has returned */
+    TRAP_EXIT   = 0xFF          /* program returned from its entry point */
+};
+
+/* A MOS buffer: the RS423 input and output buffers hold 255 and 191
+ * bytes, as in MOS 1.20 */
+typedef struct mos_buffer {
+    uint8_t  data[256];
+    unsigned head, len, size;
+} mos_buffer;
+
+/* The cycle cost model: what the host's OS work is charged, since the
+ * MOS and DFS code it stands in for never runs (see beeb_costs in
+ * beeb.c). Each can be set with -C name=cycles. */
+enum cost_id {
+    COST_FS_CALL,               /* a filing system call, vector to return */
+    COST_FS_BYTE,               /* each byte such a call moves */
+    COST_RS423_IRQ,             /* an RS423 interrupt the MOS services */
+    COST_RS423_BUFFER,          /* an RS423 buffer insert, remove or count */
+    COSTS
+};
+
+enum run_status {
+    RUN_ACTIVE = 0,
+    RUN_EXIT,                   /* program returned normally */
+    RUN_BRK,                    /* error reached the default BRKV */
+    RUN_NO_INPUT,               /* waited for a key with the script exhausted */
+    RUN_CYCLE_LIMIT,            /* ran past the cycle limit */
+    RUN_BAD_OPCODE              /* executed an undocumented opcode */
+};
+
+typedef struct beeb {
+    cpu6502  cpu;
+
+    uint8_t  ram[0x8000];
+    uint8_t  mos[0x4000];
+    uint8_t *rom[16];
+    uint8_t  romsel;
+    uint8_t  bench_latch[4];
+
+    /* OSBYTE &A6-&FF system variables */
+    uint8_t  sysvar[256];
+    uint8_t  out_streams;
+    uint8_t  in_stream;
+    uint32_t clock_base;
+
+    /* Captured OSWRCH output */
+    FILE    *out;
+    int      text_mode;
+    int      vdu_skip;
+    unsigned long screen_bytes;
+
+    /* RS423: the ACIA, and the buffers the default IRQ1V handler fills
+     * and empties; rs423_held is set while it holds RTS high */
+    acia     acia;
+    mos_buffer rs423_in, rs423_out;
+    int      rs423_held;
+
+    uint32_t cost[COSTS];
+
+    /* Scripted keypresses */
+    uint8_t *keys;
+    size_t   nkeys, key_pos;
+
+    dfs      disc;
+
+    /* Calls that reached the default handler of each vector */
+    unsigned long calls[TRAP_VECTORS];
+
+    /* JSR counts by target, NULL unless profiling (see beeb_profile_slot) */
+    uint32_t *profile;
+
+    uint64_t cycle_limit;
+    int      status;
+    uint16_t exit_code;
+    uint8_t  brk_num;
+    char     brk_msg[256];
+    uint16_t brk_addr;
+} beeb;
+
+/* beeb.c */
+void    beeb_init(beeb *b);
+int     beeb_load_rom(beeb *b, int slot, const char *path);
+uint8_t beeb_read(void *ctx, uint16_t addr);
+void    beeb_write(void *ctx, uint16_t addr, uint8_t value);
+void    beeb_boot(beeb *b);
+int     beeb_call(beeb *b, uint16_t addr);
+void    beeb_run_program(beeb *b, uint16_t exec);
+void    beeb_raise_error(beeb *b, uint8_t num, const char *msg);
+void    beeb_read_string(beeb *b, uint16_t addr, char *buf, size_t size);
+uint32_t beeb_read32(beeb *b, uint16_t addr);
+uint32_t beeb_profile_slot(uint16_t addr, uint8_t bank);
+void    beeb_write32(beeb *b, uint16_t addr, uint32_t value);
+int     beeb_set_cost(beeb *b, const char *spec);
+const char *beeb_cost_name(int id);
+
+/* mos.c */
+void    mos_build_rom(beeb *b);
+void    mos_trap(beeb *b, uint8_t id);
+void    mos_wrch(beeb *b, uint8_t c);
+
+/* fs.c */
+void    fs_osfile(beeb *b);
+void    fs_osargs(beeb *b);
+void    fs_osbget(beeb *b);
+void    fs_osbput(beeb *b);
+void    fs_osgbpb(beeb *b);
+void    fs_osfind(beeb *b);
+void    fs_disc_op(beeb *b, uint16_t blk);
+void    fs_fsc(beeb *b);
+int     fs_command(beeb *b, const char *cmd);
+
+#endif
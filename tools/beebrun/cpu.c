@@ -0,0 +1,372 @@
+/*
+ * cpu.c - NMOS 6502 core with cycle counting for the headless runner
+ *
+ * Covers the documented instruction set only; anything else stops the
+ * run so a wild jump is reported rather than silently executed.
+ * Cycle counts include page-crossing and taken-branch penalties.
+ */
+
+#include "cpu.h"
+
+#define RD(a)       cpu->read(cpu->ctx, (uint16_t)(a))
+#define WR(a, v)    cpu->write(cpu->ctx, (uint16_t)(a), (uint8_t)(v))
+
+void cpu_push(cpu6502 *cpu, uint8_t value) {
+    WR(0x100 | cpu->s, value);
+    cpu->s--;
+}
+
+uint8_t cpu_pull(cpu6502 *cpu) {
+    cpu->s++;
+    return RD(0x100 | cpu->s);
+}
+
+void cpu_rts(cpu6502 *cpu) {
+    uint16_t lo = cpu_pull(cpu);
+    uint16_t hi = cpu_pull(cpu);
+    cpu->pc = (uint16_t)(((hi << 8) | lo) + 1);
+}
+
+static void set_nz(cpu6502 *cpu, uint8_t v) {
+    cpu->p &= ~(FLAG_N | FLAG_Z);
+    if (v == 0) cpu->p |= FLAG_Z;
+    cpu->p |= v & FLAG_N;
+}
+
+static uint16_t fetch16(cpu6502 *cpu) {
+    uint16_t lo = RD(cpu->pc);
+    uint16_t hi = RD(cpu->pc + 1);
+    cpu->pc += 2;
+    return (uint16_t)(lo | (hi << 8));
+}
+
+/* Addressing modes. The penalty argument adds the page-crossing cycle
+ * that only read instructions pay. */
+static uint16_t am_zp(cpu6502 *cpu)  { return RD(cpu->pc++); }
+static uint16_t am_zpx(cpu6502 *cpu) { return (uint8_t)(RD(cpu->pc++) + cpu->x); }
+static uint16_t am_zpy(cpu6502 *cpu) { return (uint8_t)(RD(cpu->pc++) + cpu->y); }
+static uint16_t am_abs(cpu6502 *cpu) { return fetch16(cpu); }
+
+static uint16_t am_absi(cpu6502 *cpu, uint8_t index, int penalty) {
+    uint16_t base = fetch16(cpu);
+    uint16_t ea = (uint16_t)(base + index);
+    if (penalty && ((base ^ ea) & 0xFF00)) cpu->cycles++;
+    return ea;
+}
+
+static uint16_t am_indx(cpu6502 *cpu) {
+    uint8_t zp = (uint8_t)(RD(cpu->pc++) + cpu->x);
+    return (uint16_t)(RD(zp) | (RD((uint8_t)(zp + 1)) << 8));
+}
+
+static uint16_t am_indy(cpu6502 *cpu, int penalty) {
+    uint8_t zp = RD(cpu->pc++);
+    uint16_t base = (uint16_t)(RD(zp) | (RD((uint8_t)(zp + 1)) << 8));
+    uint16_t ea = (uint16_t)(base + cpu->y);
+    if (penalty && ((base ^ ea) & 0xFF00)) cpu->cycles++;
+    return ea;
+}
+
+static void op_adc(cpu6502 *cpu, uint8_t v) {
+    unsigned a = cpu->a;
+    unsigned c = cpu->p & FLAG_C;
+
+    if (cpu->p & FLAG_D) {
+        unsigned tmp = (a & 0x0F) + (v & 0x0F) + c;
+        if (tmp > 0x09) tmp += 0x06;
+        if (tmp <= 0x0F) tmp = (tmp & 0x0F) + (a & 0xF0) + (v & 0xF0);
+        else             tmp = (tmp & 0x0F) + (a & 0xF0) + (v & 0xF0) + 0x10;
+        cpu->p &= ~(FLAG_N | FLAG_Z | FLAG_V | FLAG_C);
+        if (((a + v + c) & 0xFF) == 0) cpu->p |= FLAG_Z;
+        cpu->p |= tmp & FLAG_N;
+        if (((a ^ tmp) & 0x80) && !((a ^ v) & 0x80)) cpu->p |= FLAG_V;
+        if ((tmp & 0x1F0) > 0x90) tmp += 0x60;
+        if ((tmp & 0xFF0) > 0xF0) cpu->p |= FLAG_C;
+        cpu->a = (uint8_t)tmp;
+    } else {
+        unsigned sum = a + v + c;
+        cpu->p &= ~(FLAG_V | FLAG_C);
+        if (~(a ^ v) & (a ^ sum) & 0x80) cpu->p |= FLAG_V;
+        if (sum > 0xFF) cpu->p |= FLAG_C;
+        cpu->a = (uint8_t)sum;
+        set_nz(cpu, cpu->a);
+    }
+}
+
+static void op_sbc(cpu6502 *cpu, uint8_t v) {
+    unsigned a = cpu->a;
+    unsigned borrow = (cpu->p & FLAG_C) ? 0 : 1;
+    unsigned diff = a - v - borrow;
+
+    cpu->p &= ~(FLAG_V | FLAG_C);
+    if ((a ^ v) & (a ^ diff) & 0x80) cpu->p |= FLAG_V;
+    if (diff < 0x100) cpu->p |= FLAG_C;
+    set_nz(cpu, (uint8_t)diff);
+
+    if (cpu->p & FLAG_D) {
+        unsigned tmp = (a & 0x0F) - (v & 0x0F) - borrow;
+        if (tmp & 0x10) tmp = ((tmp - 6) & 0x0F) | ((a & 0xF0) - (v & 0xF0) - 0x10);
+        else            tmp = (tmp & 0x0F) | ((a & 0xF0) - (v & 0xF0));
+        if (tmp & 0x100) tmp -= 0x60;
+        cpu->a = (uint8_t)tmp;
+    } else {
+        cpu->a = (uint8_t)diff;
+    }
+}
+
+static void op_cmp(cpu6502 *cpu, uint8_t reg, uint8_t v) {
+    cpu->p &= ~FLAG_C;
+    if (reg >= v) cpu->p |= FLAG_C;
+    set_nz(cpu, (uint8_t)(reg - v));
+}
+
+static void op_bit(cpu6502 *cpu, uint8_t v) {
+    cpu->p &= ~(FLAG_N | FLAG_V | FLAG_Z);
+    cpu->p |= v & (FLAG_N | FLAG_V);
+    if ((cpu->a & v) == 0) cpu->p |= FLAG_Z;
+}
+
+static uint8_t op_asl(cpu6502 *cpu, uint8_t v) {
+    cpu->p = (uint8_t)((cpu->p & ~FLAG_C) | (v >> 7));
+    v <<= 1;
+    set_nz(cpu, v);
+    return v;
+}
+
+static uint8_t op_lsr(cpu6502 *cpu, uint8_t v) {
+    cpu->p = (uint8_t)((cpu->p & ~FLAG_C) | (v & 1));
+    v >>= 1;
+    set_nz(cpu, v);
+    return v;
+}
+
+static uint8_t op_rol(cpu6502 *cpu, uint8_t v) {
+    uint8_t c = cpu->p & FLAG_C;
+    cpu->p = (uint8_t)((cpu->p & ~FLAG_C) | (v >> 7));
+    v = (uint8_t)((v << 1) | c);
+    set_nz(cpu, v);
+    return v;
+}
+
+static uint8_t op_ror(cpu6502 *cpu, uint8_t v) {
+    uint8_t c = cpu->p & FLAG_C;
+    cpu->p = (uint8_t)((cpu->p & ~FLAG_C) | (v & 1));
+    v = (uint8_t)((v >> 1) | (c << 7));
+    set_nz(cpu, v);
+    return v;
+}
+
+static void op_step(cpu6502 *cpu, uint16_t ea, int delta) {
+    uint8_t v = (uint8_t)(RD(ea) + delta);
+    WR(ea, v);
+    set_nz(cpu, v);
+}
+
+static void branch(cpu6502 *cpu, int taken) {
+    int8_t rel = (int8_t)RD(cpu->pc++);
+    if (taken) {
+        uint16_t target = (uint16_t)(cpu->pc + rel);
+        cpu->cycles += ((cpu->pc ^ target) & 0xFF00) ? 2 : 1;
+        cpu->pc = target;
+    }
+}
+
+static void interrupt(cpu6502 *cpu, uint16_t vector, int brk) {
+    cpu_push(cpu, (uint8_t)(cpu->pc >> 8));
+    cpu_push(cpu, (uint8_t)cpu->pc);
+    cpu_push(cpu, (uint8_t)(cpu->p | FLAG_U | (brk ? FLAG_B : 0)));
+    cpu->p |= FLAG_I;
+    cpu->pc = (uint16_t)(RD(vector) | (RD(vector + 1) << 8));
+    cpu->cycles += 7;
+}
+
+int cpu_irq(cpu6502 *cpu) {
+    if (cpu->p & FLAG_I) return 0;
+    interrupt(cpu, 0xFFFE, 0);
+    return 1;
+}
+
+/* Read-modify-write helper */
+#define RMW(ea, fn) do { uint16_t _ea = (ea); WR(_ea, fn(cpu, RD(_ea))); } while (0)
+
+int cpu_step(cpu6502 *cpu) {
+    uint8_t op = RD(cpu->pc);
+
+    cpu->pc++;
+
+    switch (op) {
+    /* Loads */
+    case 0xA9: cpu->a = RD(cpu->pc++);               set_nz(cpu, cpu->a); cpu->cycles += 2; break;
+    case 0xA5: cpu->a = RD(am_zp(cpu));              set_nz(cpu, cpu->a); cpu->cycles += 3; break;
+    case 0xB5: cpu->a = RD(am_zpx(cpu));             set_nz(cpu, cpu->a); cpu->cycles += 4; break;
+    case 0xAD: cpu->a = RD(am_abs(cpu));             set_nz(cpu, cpu->a); cpu->cycles += 4; break;
+    case 0xBD: cpu->a = RD(am_absi(cpu, cpu->x, 1)); set_nz(cpu, cpu->a); cpu->cycles += 4; break;
+    case 0xB9: cpu->a = RD(am_absi(cpu, cpu->y, 1)); set_nz(cpu, cpu->a); cpu->cycles += 4; break;
+    case 0xA1: cpu->a = RD(am_indx(cpu));            set_nz(cpu, cpu->a); cpu->cycles += 6; break;
+    case 0xB1: cpu->a = RD(am_indy(cpu, 1));         set_nz(cpu, cpu->a); cpu->cycles += 5; break;
+
+    case 0xA2: cpu->x = RD(cpu->pc++);               set_nz(cpu, cpu->x); cpu->cycles += 2; break;
+    case 0xA6: cpu->x = RD(am_zp(cpu));              set_nz(cpu, cpu->x); cpu->cycles += 3; break;
+    case 0xB6: cpu->x = RD(am_zpy(cpu));             set_nz(cpu, cpu->x); cpu->cycles += 4; break;
+    case 0xAE: cpu->x = RD(am_abs(cpu));             set_nz(cpu, cpu->x); cpu->cycles += 4; break;
+    case 0xBE: cpu->x = RD(am_absi(cpu, cpu->y, 1)); set_nz(cpu, cpu->x); cpu->cycles += 4; break;
+
+    case 0xA0: cpu->y = RD(cpu->pc++);               set_nz(cpu, cpu->y); cpu->cycles += 2; break;
+    case 0xA4: cpu->y = RD(am_zp(cpu));              set_nz(cpu, cpu->y); cpu->cycles += 3; break;
+    case 0xB4: cpu->y = RD(am_zpx(cpu));             set_nz(cpu, cpu->y); cpu->cycles += 4; break;
+    case 0xAC: cpu->y = RD(am_abs(cpu));             set_nz(cpu, cpu->y); cpu->cycles += 4; break;
+    case 0xBC: cpu->y = RD(am_absi(cpu, cpu->x, 1)); set_nz(cpu, cpu->y); cpu->cycles += 4; break;
+
+    /* Stores */
+    case 0x85: WR(am_zp(cpu), cpu->a);               cpu->cycles += 3; break;
+    case 0x95: WR(am_zpx(cpu), cpu->a);              cpu->cycles += 4; break;
+    case 0x8D: WR(am_abs(cpu), cpu->a);              cpu->cycles += 4; break;
+    case 0x9D: WR(am_absi(cpu, cpu->x, 0), cpu->a);  cpu->cycles += 5; break;
+    case 0x99: WR(am_absi(cpu, cpu->y, 0), cpu->a);  cpu->cycles += 5; break;
+    case 0x81: WR(am_indx(cpu), cpu->a);             cpu->cycles += 6; break;
+    case 0x91: WR(am_indy(cpu, 0), cpu->a);          cpu->cycles += 6; break;
+
+    case 0x86: WR(am_zp(cpu), cpu->x);               cpu->cycles += 3; break;
+    case 0x96: WR(am_zpy(cpu), cpu->x);              cpu->cycles += 4; break;
+    case 0x8E: WR(am_abs(cpu), cpu->x);              cpu->cycles += 4; break;
+
+    case 0x84: WR(am_zp(cpu), cpu->y);               cpu->cycles += 3; break;
+    case 0x94: WR(am_zpx(cpu), cpu->y);              cpu->cycles += 4; break;
+    case 0x8C: WR(am_abs(cpu), cpu->y);              cpu->cycles += 4; break;
+
+    /* Arithmetic and logic */
+#define ALU(base, fn)                                                                   \
+    case base + 0x09: fn(RD(cpu->pc++));               cpu->cycles += 2; break;         \
+    case base + 0x05: fn(RD(am_zp(cpu)));              cpu->cycles += 3; break;         \
+    case base + 0x15: fn(RD(am_zpx(cpu)));             cpu->cycles += 4; break;         \
+    case base + 0x0D: fn(RD(am_abs(cpu)));             cpu->cycles += 4; break;         \
+    case base + 0x1D: fn(RD(am_absi(cpu, cpu->x, 1))); cpu->cycles += 4; break;         \
+    case base + 0x19: fn(RD(am_absi(cpu, cpu->y, 1))); cpu->cycles += 4; break;         \
+    case base + 0x01: fn(RD(am_indx(cpu)));            cpu->cycles += 6; break;         \
+    case base + 0x11: fn(RD(am_indy(cpu, 1)));         cpu->cycles += 5; break;
+
+#define DO_ORA(v) do { cpu->a |= (v); set_nz(cpu, cpu->a); } while (0)
+#define DO_AND(v) do { cpu->a &= (v); set_nz(cpu, cpu->a); } while (0)
+#define DO_EOR(v) do { cpu->a ^= (v); set_nz(cpu, cpu->a); } while (0)
+#define DO_ADC(v) op_adc(cpu, (v))
+#define DO_SBC(v) op_sbc(cpu, (v))
+#define DO_CMP(v) op_cmp(cpu, cpu->a, (v))
+
+    ALU(0x00, DO_ORA)
+    ALU(0x20, DO_AND)
+    ALU(0x40, DO_EOR)
+    ALU(0x60, DO_ADC)
+    ALU(0xC0, DO_CMP)
+    ALU(0xE0, DO_SBC)
+
+    case 0xE0: op_cmp(cpu, cpu->x, RD(cpu->pc++));   cpu->cycles += 2; break;
+    case 0xE4: op_cmp(cpu, cpu->x, RD(am_zp(cpu)));  cpu->cycles += 3; break;
+    case 0xEC: op_cmp(cpu, cpu->x, RD(am_abs(cpu))); cpu->cycles += 4; break;
+    case 0xC0: op_cmp(cpu, cpu->y, RD(cpu->pc++));   cpu->cycles += 2; break;
+    case 0xC4: op_cmp(cpu, cpu->y, RD(am_zp(cpu)));  cpu->cycles += 3; break;
+    case 0xCC: op_cmp(cpu, cpu->y, RD(am_abs(cpu))); cpu->cycles += 4; break;
+
+    case 0x24: op_bit(cpu, RD(am_zp(cpu)));          cpu->cycles += 3; break;
+    case 0x2C: op_bit(cpu, RD(am_abs(cpu)));         cpu->cycles += 4; break;
+
+    /* Shifts and rotates */
+#define SHIFT(base, fn)                                                                 \
+    case base + 0x0A: cpu->a = fn(cpu, cpu->a);        cpu->cycles += 2; break;         \
+    case base + 0x06: RMW(am_zp(cpu), fn);             cpu->cycles += 5; break;         \
+    case base + 0x16: RMW(am_zpx(cpu), fn);            cpu->cycles += 6; break;         \
+    case base + 0x0E: RMW(am_abs(cpu), fn);            cpu->cycles += 6; break;         \
+    case base + 0x1E: RMW(am_absi(cpu, cpu->x, 0), fn); cpu->cycles += 7; break;
+
+    SHIFT(0x00, op_asl)
+    SHIFT(0x20, op_rol)
+    SHIFT(0x40, op_lsr)
+    SHIFT(0x60, op_ror)
+
+    /* Increments and decrements */
+    case 0xE6: op_step(cpu, am_zp(cpu), 1);                 cpu->cycles += 5; break;
+    case 0xF6: op_step(cpu, am_zpx(cpu), 1);                cpu->cycles += 6; break;
+    case 0xEE: op_step(cpu, am_abs(cpu), 1);                cpu->cycles += 6; break;
+    case 0xFE: op_step(cpu, am_absi(cpu, cpu->x, 0), 1);    cpu->cycles += 7; break;
+    case 0xC6: op_step(cpu, am_zp(cpu), -1);                cpu->cycles += 5; break;
+    case 0xD6: op_step(cpu, am_zpx(cpu), -1);               cpu->cycles += 6; break;
+    case 0xCE: op_step(cpu, am_abs(cpu), -1);               cpu->cycles += 6; break;
+    case 0xDE: op_step(cpu, am_absi(cpu, cpu->x, 0), -1);   cpu->cycles += 7; break;
+
+    case 0xE8: cpu->x++; set_nz(cpu, cpu->x); cpu->cycles += 2; break;
+    case 0xCA: cpu->x--; set_nz(cpu, cpu->x); cpu->cycles += 2; break;
+    case 0xC8: cpu->y++; set_nz(cpu, cpu->y); cpu->cycles += 2; break;
+    case 0x88: cpu->y--; set_nz(cpu, cpu->y); cpu->cycles += 2; break;
+
+    /* Transfers */
+    case 0xAA: cpu->x = cpu->a; set_nz(cpu, cpu->x); cpu->cycles += 2; break;
+    case 0xA8: cpu->y = cpu->a; set_nz(cpu, cpu->y); cpu->cycles += 2; break;
+    case 0x8A: cpu->a = cpu->x; set_nz(cpu, cpu->a); cpu->cycles += 2; break;
+    case 0x98: cpu->a = cpu->y; set_nz(cpu, cpu->a); cpu->cycles += 2; break;
+    case 0xBA: cpu->x = cpu->s; set_nz(cpu, cpu->x); cpu->cycles += 2; break;
+    case 0x9A: cpu->s = cpu->x;                      cpu->cycles += 2; break;
+
+    /* Stack */
+    case 0x48: cpu_push(cpu, cpu->a);                            cpu->cycles += 3; break;
+    case 0x08: cpu_push(cpu, cpu->p | FLAG_B | FLAG_U);          cpu->cycles += 3; break;
+    case 0x68: cpu->a = cpu_pull(cpu); set_nz(cpu, cpu->a);      cpu->cycles += 4; break;
+    case 0x28: cpu->p = (cpu_pull(cpu) & ~FLAG_B) | FLAG_U;      cpu->cycles += 4; break;
+
+    /* Flags */
+    case 0x18: cpu->p &= ~FLAG_C; cpu->cycles += 2; break;
+    case 0x38: cpu->p |=  FLAG_C; cpu->cycles += 2; break;
+    case 0x58: cpu->p &= ~FLAG_I; cpu->cycles += 2; break;
+    case 0x78: cpu->p |=  FLAG_I; cpu->cycles += 2; break;
+    case 0xD8: cpu->p &= ~FLAG_D; cpu->cycles += 2; break;
+    case 0xF8: cpu->p |=  FLAG_D; cpu->cycles += 2; break;
+    case 0xB8: cpu->p &= ~FLAG_V; cpu->cycles += 2; break;
+
+    /* Branches */
+    case 0x10: branch(cpu, !(cpu->p & FLAG_N)); cpu->cycles += 2; break;
+    case 0x30: branch(cpu,  (cpu->p & FLAG_N)); cpu->cycles += 2; break;
+    case 0x50: branch(cpu, !(cpu->p & FLAG_V)); cpu->cycles += 2; break;
+    case 0x70: branch(cpu,  (cpu->p & FLAG_V)); cpu->cycles += 2; break;
+    case 0x90: branch(cpu, !(cpu->p & FLAG_C)); cpu->cycles += 2; break;
+    case 0xB0: branch(cpu,  (cpu->p & FLAG_C)); cpu->cycles += 2; break;
+    case 0xD0: branch(cpu, !(cpu->p & FLAG_Z)); cpu->cycles += 2; break;
+    case 0xF0: branch(cpu,  (cpu->p & FLAG_Z)); cpu->cycles += 2; break;
+
+    /* Jumps and subroutines */
+    case 0x4C: cpu->pc = am_abs(cpu); cpu->cycles += 3; break;
+    case 0x6C: {
+        /* NMOS bug: the high byte is fetched from the same page */
+        uint16_t ptr = am_abs(cpu);
+        uint16_t hi_addr = (uint16_t)((ptr & 0xFF00) | ((ptr + 1) & 0x00FF));
+        cpu->pc = (uint16_t)(RD(ptr) | (RD(hi_addr) << 8));
+        cpu->cycles += 5;
+        break;
+    }
+    case 0x20: {
+        uint16_t target = am_abs(cpu);
+        uint16_t ret = (uint16_t)(cpu->pc - 1);
+        cpu_push(cpu, (uint8_t)(ret >> 8));
+        cpu_push(cpu, (uint8_t)ret);
+        cpu->pc = target;
+        cpu->cycles += 6;
+        break;
+    }
+    case 0x60: cpu_rts(cpu); cpu->cycles += 6; break;
+    case 0x40:
+        cpu->p = (cpu_pull(cpu) & ~FLAG_B) | FLAG_U;
+        cpu->pc = cpu_pull(cpu);
+        cpu->pc |= (uint16_t)(cpu_pull(cpu) << 8);
+        cpu->cycles += 6;
+        break;
+    case 0x00:
+        cpu->pc++;
+        interrupt(cpu, 0xFFFE, 1);
+        break;
+
+    case 0xEA: cpu->cycles += 2; break;
+
+    default:
+        cpu->pc--;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * cpu.h - NMOS 6502 core with cycle counting for the headless runner
+ */
+
+#ifndef BEEBRUN_CPU_H
+#define BEEBRUN_CPU_H
+
+#include <stdint.h>
+
+/* Processor status flags */
+#define FLAG_C  0x01
+#define FLAG_Z  0x02
+#define FLAG_I  0x04
+#define FLAG_D  0x08
+#define FLAG_B  0x10
+#define FLAG_U  0x20
+#define FLAG_V  0x40
+#define FLAG_N  0x80
+
+typedef uint8_t (*cpu_read_fn)(void *ctx, uint16_t addr);
+typedef void    (*cpu_write_fn)(void *ctx, uint16_t addr, uint8_t value);
+
+typedef struct cpu6502 {
+    uint16_t pc;
+    uint8_t  a, x, y, s, p;
+
+    /* Total cycles executed since reset */
+    uint64_t cycles;
+
+    /* Memory interface supplied by the machine */
+    void        *ctx;
+    cpu_read_fn  read;
+    cpu_write_fn write;
+} cpu6502;
+
+/* Execute one instruction. Returns 0, or -1 on an undocumented opcode
+ * (PC is left pointing at the offending byte). */
+int  cpu_step(cpu6502 *cpu);
+
+/* Take a maskable interrupt if I is clear. Returns 1 if taken. */
+int  cpu_irq(cpu6502 *cpu);
+
+/* Stack helpers, also used by the MOS layer to emulate RTS/JSR */
+void     cpu_push(cpu6502 *cpu, uint8_t value);
+uint8_t  cpu_pull(cpu6502 *cpu);
+void     cpu_rts(cpu6502 *cpu);
+
+#endif
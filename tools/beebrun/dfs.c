@@ -0,0 +1,310 @@
+/*
+ * dfs.c - in-memory Acorn DFS disc built from a single-sided .ssd image
+ *
+ * The disc is read once at startup; files written by the program live
+ * in memory for the rest of the run, so every run starts from the same
+ * disc contents.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfs.h"
+
+#define SECTOR_SIZE     256
+#define SSD_MAX_SIZE    (80 * 10 * SECTOR_SIZE)
+
+void dfs_init(dfs *d) {
+    memset(d, 0, sizeof(*d));
+    d->cur_dir = '$';
+}
+
+void dfs_free(dfs *d) {
+    int i;
+    for (i = 0; i < d->nfiles; i++) {
+        free(d->files[i].data);
+    }
+    dfs_init(d);
+}
+
+const char *dfs_error_text(int err) {
+    switch (err) {
+    case DFS_ERR_TOO_MANY_OPEN: return "Too many open";
+    case DFS_ERR_READ_ONLY:     return "Read only";
+    case DFS_ERR_OPEN:          return "Open";
+    case DFS_ERR_LOCKED:        return "Locked";
+    case DFS_ERR_CAT_FULL:      return "Cat full";
+    case DFS_ERR_BAD_NAME:      return "Bad name";
+    case DFS_ERR_NOT_FOUND:     return "Not found";
+    case DFS_ERR_CHANNEL:       return "Channel";
+    case DFS_ERR_EOF:           return "EOF";
+    default:                    return "Disc fault";
+    }
+}
+
+static void copy_trimmed(char *dst, const uint8_t *src, int len) {
+    int i;
+    for (i = 0; i < len; i++) {
+        dst[i] = (char)(src[i] & 0x7F);
+    }
+    dst[len] = 0;
+    while (len > 0 && (dst[len - 1] == ' ' || dst[len - 1] == 0)) {
+        dst[--len] = 0;
+    }
+}
+
+int dfs_load_ssd(dfs *d, const char *path) {
+    FILE *fp;
+    uint8_t *img;
+    size_t size;
+    int i, count;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    img = calloc(1, SSD_MAX_SIZE);
+    size = fread(img, 1, SSD_MAX_SIZE, fp);
+    fclose(fp);
+
+    if (size < 2 * SECTOR_SIZE) {
+        fprintf(stderr, "%s: too small to be a DFS disc image\n", path);
+        free(img);
+        return -1;
+    }
+
+    memcpy(d->title, img, 8);
+    memcpy(d->title + 8, img + SECTOR_SIZE, 4);
+    copy_trimmed(d->title, (uint8_t *)d->title, 12);
+    d->cycle = img[SECTOR_SIZE + 4];
+    d->boot_option = (img[SECTOR_SIZE + 6] >> 4) & 3;
+
+    count = img[SECTOR_SIZE + 5] / 8;
+    if (count > DFS_MAX_FILES) count = DFS_MAX_FILES;
+
+    for (i = 0; i < count; i++) {
+        const uint8_t *n = img + 8 + i * 8;
+        const uint8_t *a = img + SECTOR_SIZE + 8 + i * 8;
+        dfs_file *f = &d->files[i];
+        uint32_t start, offset;
+
+        copy_trimmed(f->name, n, 7);
+        f->dir    = (char)(n[7] & 0x7F);
+        f->locked = (n[7] & 0x80) != 0;
+        f->load   = a[0] | (a[1] << 8) | ((a[6] >> 2) & 3) << 16;
+        f->exec   = a[2] | (a[3] << 8) | ((a[6] >> 6) & 3) << 16;
+        f->length = a[4] | (a[5] << 8) | ((a[6] >> 4) & 3) << 16;
+        start     = a[7] | (a[6] & 3) << 8;
+
+        /* 18-bit addresses with both top bits set mean the I/O processor */
+        if ((f->load & 0x30000) == 0x30000) f->load |= 0xFFFF0000;
+        if ((f->exec & 0x30000) == 0x30000) f->exec |= 0xFFFF0000;
+
+        f->capacity = f->length ? f->length : 1;
+        f->data = calloc(1, f->capacity);
+        offset = start * SECTOR_SIZE;
+        if (offset < size) {
+            uint32_t avail = (uint32_t)(size - offset);
+            memcpy(f->data, img + offset, f->length < avail ? f->length : avail);
+        }
+    }
+    d->nfiles = count;
+
+    free(img);
+    return 0;
+}
+
+/* Acorn DFS keeps the catalogue in order of start sector, highest first.
+ * Files here have no sectors of their own, so they are given ones laid
+ * end to end from sector 2 in that order. */
+void dfs_catalogue(const dfs *d, uint8_t cat[2 * SECTOR_SIZE]) {
+    char title[13], name[8];
+    uint32_t start = 2;
+    int i;
+
+    memset(cat, 0, 2 * SECTOR_SIZE);
+    snprintf(title, sizeof(title), "%-12s", d->title);
+    memcpy(cat, title, 8);
+    memcpy(cat + SECTOR_SIZE, title + 8, 4);
+    cat[SECTOR_SIZE + 4] = d->cycle;
+    cat[SECTOR_SIZE + 5] = (uint8_t)(d->nfiles * 8);
+    cat[SECTOR_SIZE + 6] = (uint8_t)(d->boot_option << 4 | (SSD_MAX_SIZE / SECTOR_SIZE) >> 8);
+    cat[SECTOR_SIZE + 7] = (uint8_t)(SSD_MAX_SIZE / SECTOR_SIZE);
+
+    for (i = d->nfiles - 1; i >= 0; i--) {
+        const dfs_file *f = &d->files[i];
+        uint8_t *n = cat + 8 + i * 8;
+        uint8_t *a = cat + SECTOR_SIZE + 8 + i * 8;
+
+        snprintf(name, sizeof(name), "%-7s", f->name);
+        memcpy(n, name, 7);
+        n[7] = (uint8_t)(f->dir | (f->locked ? 0x80 : 0));
+        a[0] = (uint8_t)f->load;
+        a[1] = (uint8_t)(f->load >> 8);
+        a[2] = (uint8_t)f->exec;
+        a[3] = (uint8_t)(f->exec >> 8);
+        a[4] = (uint8_t)f->length;
+        a[5] = (uint8_t)(f->length >> 8);
+        a[6] = (uint8_t)(((f->exec >> 16) & 3) << 6 | ((f->length >> 16) & 3) << 4 |
+                         ((f->load >> 16) & 3) << 2 | ((start >> 8) & 3));
+        a[7] = (uint8_t)start;
+        start += (f->length + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    }
+}
+
+int dfs_parse_name(const dfs *d, const char *in, char *dir, char name[8]) {
+    int len = 0;
+
+    while (*in == ' ') in++;
+
+    /* Drive prefix ":0." - only a single drive is modelled */
+    if (in[0] == ':' && in[1] && in[2] == '.') in += 3;
+
+    *dir = d->cur_dir;
+    if (in[0] && in[1] == '.') {
+        *dir = (char)toupper((unsigned char)in[0]);
+        in += 2;
+    }
+
+    while (*in && *in != ' ' && *in != '\r') {
+        if (len == 7 || *in == '.' || *in == ':' || *in == '"' || *in < ' ') {
+            return DFS_ERR_BAD_NAME;
+        }
+        name[len++] = *in++;
+    }
+    name[len] = 0;
+
+    return len ? 0 : DFS_ERR_BAD_NAME;
+}
+
+int dfs_find(const dfs *d, char dir, const char *name) {
+    int i;
+    for (i = 0; i < d->nfiles; i++) {
+        const dfs_file *f = &d->files[i];
+        if (toupper((unsigned char)f->dir) == toupper((unsigned char)dir) &&
+            strcasecmp(f->name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int dfs_is_open(const dfs *d, int file, int *writable) {
+    int i, found = 0;
+    if (writable) *writable = 0;
+    for (i = 0; i < DFS_MAX_CHANNELS; i++) {
+        if (d->chan[i].open && d->chan[i].file == file) {
+            found = 1;
+            if (writable && d->chan[i].writable) *writable = 1;
+        }
+    }
+    return found;
+}
+
+int dfs_set_length(dfs *d, int file, uint32_t length) {
+    dfs_file *f = &d->files[file];
+    if (length > f->capacity) {
+        uint32_t cap = f->capacity * 2;
+        uint8_t *data;
+        if (cap < length) cap = length;
+        data = realloc(f->data, cap);
+        if (!data) return -DFS_ERR_CAT_FULL;
+        memset(data + f->capacity, 0, cap - f->capacity);
+        f->data = data;
+        f->capacity = cap;
+    }
+    if (length < f->length) {
+        memset(f->data + length, 0, f->length - length);
+    }
+    f->length = length;
+    return 0;
+}
+
+int dfs_create(dfs *d, char dir, const char *name, uint32_t length) {
+    int idx = dfs_find(d, dir, name);
+    dfs_file *f;
+
+    if (idx >= 0) {
+        if (d->files[idx].locked) return -DFS_ERR_LOCKED;
+        if (dfs_is_open(d, idx, NULL)) return -DFS_ERR_OPEN;
+        d->files[idx].length = 0;
+        dfs_set_length(d, idx, length);
+        return idx;
+    }
+
+    if (d->nfiles == DFS_MAX_FILES) return -DFS_ERR_CAT_FULL;
+
+    idx = d->nfiles++;
+    f = &d->files[idx];
+    memset(f, 0, sizeof(*f));
+    f->dir = dir;
+    strncpy(f->name, name, 7);
+    f->capacity = length ? length : 64;
+    f->data = calloc(1, f->capacity);
+    f->length = length;
+    d->cycle++;
+    return idx;
+}
+
+int dfs_delete(dfs *d, int file) {
+    int i;
+
+    if (d->files[file].locked) return -DFS_ERR_LOCKED;
+    if (dfs_is_open(d, file, NULL)) return -DFS_ERR_OPEN;
+
+    free(d->files[file].data);
+    for (i = file; i < d->nfiles - 1; i++) {
+        d->files[i] = d->files[i + 1];
+    }
+    d->nfiles--;
+
+    /* Keep open channels pointing at the right catalogue entry */
+    for (i = 0; i < DFS_MAX_CHANNELS; i++) {
+        if (d->chan[i].open && d->chan[i].file > file) d->chan[i].file--;
+    }
+    d->cycle++;
+    return 0;
+}
+
+int dfs_open(dfs *d, int file, int writable) {
+    int i, open_for_write;
+
+    /* DFS allows several readers, but a writer must be the only user */
+    if (dfs_is_open(d, file, &open_for_write) && (writable || open_for_write)) {
+        return -DFS_ERR_OPEN;
+    }
+
+    for (i = 0; i < DFS_MAX_CHANNELS; i++) {
+        if (!d->chan[i].open) {
+            d->chan[i].open = 1;
+            d->chan[i].file = file;
+            d->chan[i].writable = writable;
+            d->chan[i].ptr = 0;
+            return DFS_FIRST_HANDLE + i;
+        }
+    }
+    return -DFS_ERR_TOO_MANY_OPEN;
+}
+
+dfs_channel *dfs_channel_for(dfs *d, int handle) {
+    int i = handle - DFS_FIRST_HANDLE;
+    if (i < 0 || i >= DFS_MAX_CHANNELS || !d->chan[i].open) return NULL;
+    return &d->chan[i];
+}
+
+int dfs_close(dfs *d, int handle) {
+    dfs_channel *c;
+    int i;
+
+    if (handle == 0) {
+        for (i = 0; i < DFS_MAX_CHANNELS; i++) d->chan[i].open = 0;
+        return 0;
+    }
+    c = dfs_channel_for(d, handle);
+    if (!c) return -DFS_ERR_CHANNEL;
+    c->open = 0;
+    return 0;
+}
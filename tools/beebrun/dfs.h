@@ -0,0 +1,76 @@
+/*
+ * dfs.h - in-memory Acorn DFS disc built from a single-sided .ssd image
+ */
+
+#ifndef BEEBRUN_DFS_H
+#define BEEBRUN_DFS_H
+
+#include <stdint.h>
+
+#define DFS_MAX_FILES       31
+#define DFS_MAX_CHANNELS    5
+#define DFS_FIRST_HANDLE    0x11
+
+typedef struct dfs_file {
+    char     dir;
+    char     name[8];       /* up to 7 characters, nul terminated */
+    uint32_t load;
+    uint32_t exec;
+    uint32_t length;
+    uint32_t capacity;
+    uint8_t *data;
+    int      locked;
+} dfs_file;
+
+typedef struct dfs_channel {
+    int      open;
+    int      file;          /* index into files[] */
+    int      writable;
+    uint32_t ptr;
+} dfs_channel;
+
+typedef struct dfs {
+    char        title[13];
+    uint8_t     cycle;
+    uint8_t     boot_option;
+    char        cur_dir;
+    dfs_file    files[DFS_MAX_FILES];
+    int         nfiles;
+    dfs_channel chan[DFS_MAX_CHANNELS];
+} dfs;
+
+/* Error numbers raised through BRK, as Acorn DFS reports them */
+#define DFS_ERR_TOO_MANY_OPEN   0xC0
+#define DFS_ERR_READ_ONLY       0xC1
+#define DFS_ERR_OPEN            0xC2
+#define DFS_ERR_LOCKED          0xC3
+#define DFS_ERR_CAT_FULL        0xBE
+#define DFS_ERR_BAD_NAME        0xCC
+#define DFS_ERR_NOT_FOUND       0xD6
+#define DFS_ERR_CHANNEL         0xDE
+#define DFS_ERR_EOF             0xDF
+
+void        dfs_init(dfs *d);
+void        dfs_free(dfs *d);
+int         dfs_load_ssd(dfs *d, const char *path);
+const char *dfs_error_text(int err);
+
+/* Split "D.NAME" into directory and name. Returns 0 or DFS_ERR_BAD_NAME. */
+int  dfs_parse_name(const dfs *d, const char *in, char *dir, char name[8]);
+
+/* Catalogue operations. Return a file index, or -1 / a negated error. */
+int  dfs_find(const dfs *d, char dir, const char *name);
+int  dfs_create(dfs *d, char dir, const char *name, uint32_t length);
+int  dfs_delete(dfs *d, int file);
+int  dfs_set_length(dfs *d, int file, uint32_t length);
+int  dfs_is_open(const dfs *d, int file, int *writable);
+
+/* Track 0 sectors 0 and 1, the catalogue as it would be on the disc */
+void dfs_catalogue(const dfs *d, uint8_t cat[512]);
+
+/* Channel operations. Handles are DFS_FIRST_HANDLE.. as on real DFS. */
+int          dfs_open(dfs *d, int file, int writable);
+int          dfs_close(dfs *d, int handle);
+dfs_channel *dfs_channel_for(dfs *d, int handle);
+
+#endif
@@ -0,0 +1,505 @@
+/*
+ * fs.c - filing system vectors (OSFILE, OSFIND, OSARGS, OSBGET, OSBPUT,
+ * OSGBPB, FSC) backed by the in-memory DFS disc
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+#include "beeb.h"
+
+#define FS_NUMBER_DFS   4
+
+/* OS calls are otherwise free, but a file transfer benchmark needs the
+ * filing system calls to cost what they do on a real machine: each is
+ * charged the cost model's fs_call, and fs_byte for every byte it moves
+ * (see beeb_costs in beeb.c). Sector reads and head movement are not
+ * modelled, except that the calls for which DFS loads the catalogue
+ * again are charged for moving its two sectors. */
+#define FS_CATALOGUE_BYTES (2 * 256)
+
+static void fs_charge(beeb *b, uint32_t bytes) {
+    b->cpu.cycles += b->cost[COST_FS_CALL] + (uint64_t)b->cost[COST_FS_BYTE] * bytes;
+}
+
+static void fs_error(beeb *b, int err) {
+    beeb_raise_error(b, (uint8_t)err, dfs_error_text(err));
+}
+
+/* Resolve a filename at addr; raises "Bad name" and returns -1 on error */
+static int fs_name(beeb *b, uint16_t addr, char *dir, char name[8]) {
+    char raw[64];
+    int err;
+
+    beeb_read_string(b, addr, raw, sizeof(raw));
+    err = dfs_parse_name(&b->disc, raw, dir, name);
+    if (err) {
+        fs_error(b, err);
+        return -1;
+    }
+    return 0;
+}
+
+static dfs_channel *fs_channel(beeb *b, uint8_t handle) {
+    dfs_channel *c = dfs_channel_for(&b->disc, handle);
+    if (!c) fs_error(b, DFS_ERR_CHANNEL);
+    return c;
+}
+
+static void fill_info(beeb *b, uint16_t blk, const dfs_file *f) {
+    beeb_write32(b, blk + 2, f->load);
+    beeb_write32(b, blk + 6, f->exec);
+    beeb_write32(b, blk + 10, f->length);
+    beeb_write32(b, blk + 14, f->locked ? 0x08 : 0x00);
+}
+
+void fs_osfile(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    dfs *d = &b->disc;
+    uint16_t blk = (uint16_t)(cpu->x | (cpu->y << 8));
+    uint16_t name_addr = (uint16_t)(beeb_read(b, blk) | (beeb_read(b, blk + 1) << 8));
+    char dir, name[8];
+    int idx;
+    uint32_t i;
+
+    fs_charge(b, FS_CATALOGUE_BYTES);
+    if (fs_name(b, name_addr, &dir, name) < 0) return;
+    idx = dfs_find(d, dir, name);
+
+    switch (cpu->a) {
+    case 0xFF: {                    /* load */
+        dfs_file *f;
+        uint32_t addr;
+        if (idx < 0) {
+            fs_error(b, DFS_ERR_NOT_FOUND);
+            return;
+        }
+        f = &d->files[idx];
+        addr = beeb_read(b, blk + 6) == 0 ? beeb_read32(b, blk + 2) : f->load;
+        for (i = 0; i < f->length; i++) {
+            beeb_write(b, (uint16_t)(addr + i), f->data[i]);
+        }
+        fill_info(b, blk, f);
+        cpu->a = 1;
+        break;
+    }
+    case 0x00:                      /* save */
+    case 0x07: {                    /* create */
+        uint32_t start = beeb_read32(b, blk + 10);
+        uint32_t end = beeb_read32(b, blk + 14);
+        uint32_t len = end > start ? end - start : 0;
+        dfs_file *f;
+
+        idx = dfs_create(d, dir, name, len);
+        if (idx < 0) {
+            fs_error(b, -idx);
+            return;
+        }
+        f = &d->files[idx];
+        f->load = beeb_read32(b, blk + 2);
+        f->exec = beeb_read32(b, blk + 6);
+        if (cpu->a == 0x00) {
+            for (i = 0; i < len; i++) {
+                f->data[i] = beeb_read(b, (uint16_t)(start + i));
+            }
+        }
+        fill_info(b, blk, f);
+        cpu->a = 1;
+        break;
+    }
+    case 0x01: case 0x02: case 0x03: case 0x04: {
+        dfs_file *f;
+        if (idx < 0) {
+            cpu->a = 0;
+            break;
+        }
+        f = &d->files[idx];
+        if (cpu->a == 1 || cpu->a == 2) f->load = beeb_read32(b, blk + 2);
+        if (cpu->a == 1 || cpu->a == 3) f->exec = beeb_read32(b, blk + 6);
+        if (cpu->a == 1 || cpu->a == 4) f->locked = (beeb_read(b, blk + 14) & 0x0A) != 0;
+        cpu->a = 1;
+        break;
+    }
+    case 0x05:                      /* read catalogue information */
+        if (idx < 0) {
+            cpu->a = 0;
+            break;
+        }
+        fill_info(b, blk, &d->files[idx]);
+        cpu->a = 1;
+        break;
+    case 0x06: {                    /* delete */
+        int err;
+        if (idx < 0) {
+            cpu->a = 0;
+            break;
+        }
+        fill_info(b, blk, &d->files[idx]);
+        err = dfs_delete(d, idx);
+        if (err < 0) {
+            fs_error(b, -err);
+            return;
+        }
+        cpu->a = 1;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void fs_osfind(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    dfs *d = &b->disc;
+    char dir, name[8];
+    int idx, handle;
+
+    fs_charge(b, cpu->a ? FS_CATALOGUE_BYTES : 0);
+    if (cpu->a == 0) {
+        if (dfs_close(d, cpu->y) < 0) fs_error(b, DFS_ERR_CHANNEL);
+        return;
+    }
+
+    if (fs_name(b, (uint16_t)(cpu->x | (cpu->y << 8)), &dir, name) < 0) return;
+    idx = dfs_find(d, dir, name);
+
+    switch (cpu->a & 0xC0) {
+    case 0x40:                      /* OPENIN: missing file returns 0 */
+        if (idx < 0) {
+            cpu->a = 0;
+            return;
+        }
+        handle = dfs_open(d, idx, 0);
+        break;
+    case 0x80:                      /* OPENOUT: create or truncate */
+        if (idx >= 0 && d->files[idx].locked) {
+            fs_error(b, DFS_ERR_LOCKED);
+            return;
+        }
+        if (idx >= 0 && dfs_is_open(d, idx, NULL)) {
+            fs_error(b, DFS_ERR_OPEN);
+            return;
+        }
+        idx = dfs_create(d, dir, name, 0);
+        if (idx < 0) {
+            fs_error(b, -idx);
+            return;
+        }
+        handle = dfs_open(d, idx, 1);
+        break;
+    default:                        /* OPENUP */
+        if (idx < 0) {
+            cpu->a = 0;
+            return;
+        }
+        if (d->files[idx].locked) {
+            fs_error(b, DFS_ERR_LOCKED);
+            return;
+        }
+        handle = dfs_open(d, idx, 1);
+        break;
+    }
+
+    if (handle < 0) {
+        fs_error(b, -handle);
+        return;
+    }
+    cpu->a = (uint8_t)handle;
+}
+
+void fs_osbget(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    dfs_channel *c = fs_channel(b, cpu->y);
+    dfs_file *f;
+
+    fs_charge(b, 1);
+    if (!c) return;
+    f = &b->disc.files[c->file];
+    if (c->ptr >= f->length) {
+        cpu->a = 0xFE;
+        cpu->p |= FLAG_C;
+        return;
+    }
+    cpu->a = f->data[c->ptr++];
+    cpu->p &= ~FLAG_C;
+}
+
+static int put_byte(beeb *b, dfs_channel *c, uint8_t value) {
+    dfs_file *f = &b->disc.files[c->file];
+    if (!c->writable) {
+        fs_error(b, DFS_ERR_READ_ONLY);
+        return -1;
+    }
+    if (c->ptr >= f->length && dfs_set_length(&b->disc, c->file, c->ptr + 1) < 0) {
+        fs_error(b, DFS_ERR_CAT_FULL);
+        return -1;
+    }
+    f->data[c->ptr++] = value;
+    return 0;
+}
+
+void fs_osbput(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    dfs_channel *c = fs_channel(b, cpu->y);
+    fs_charge(b, 1);
+    if (c) put_byte(b, c, cpu->a);
+}
+
+void fs_osargs(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    uint16_t zp = cpu->x;
+    dfs_channel *c;
+    dfs_file *f;
+
+    fs_charge(b, 0);
+    if (cpu->y == 0) {
+        switch (cpu->a) {
+        case 0x00: cpu->a = FS_NUMBER_DFS;       break;
+        case 0x01: beeb_write32(b, zp, 0);       break;
+        default:                                 break;
+        }
+        return;
+    }
+
+    c = fs_channel(b, cpu->y);
+    if (!c) return;
+    f = &b->disc.files[c->file];
+
+    switch (cpu->a) {
+    case 0x00:                      /* read PTR# */
+        beeb_write32(b, zp, c->ptr);
+        break;
+    case 0x01: {                    /* write PTR#, extending writable files */
+        uint32_t ptr = beeb_read32(b, zp);
+        if (ptr > f->length) {
+            if (!c->writable) {
+                fs_error(b, DFS_ERR_EOF);
+                return;
+            }
+            dfs_set_length(&b->disc, c->file, ptr);
+        }
+        c->ptr = ptr;
+        break;
+    }
+    case 0x02:                      /* read EXT# */
+        beeb_write32(b, zp, f->length);
+        break;
+    case 0x03:                      /* write EXT# */
+        if (!c->writable) {
+            fs_error(b, DFS_ERR_READ_ONLY);
+            return;
+        }
+        dfs_set_length(&b->disc, c->file, beeb_read32(b, zp));
+        if (c->ptr > f->length) c->ptr = f->length;
+        break;
+    default:                        /* &FF: ensure - nothing is buffered */
+        break;
+    }
+}
+
+static void write_counted(beeb *b, uint16_t *addr, const char *s, size_t len) {
+    size_t i;
+    beeb_write(b, (*addr)++, (uint8_t)len);
+    for (i = 0; i < len; i++) beeb_write(b, (*addr)++, (uint8_t)s[i]);
+}
+
+void fs_osgbpb(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    dfs *d = &b->disc;
+    uint16_t blk = (uint16_t)(cpu->x | (cpu->y << 8));
+    uint16_t addr = (uint16_t)beeb_read32(b, blk + 1);
+    uint32_t count = beeb_read32(b, blk + 5);
+    uint8_t reason = cpu->a;
+
+    fs_charge(b, reason == 5 || reason == 8 ? FS_CATALOGUE_BYTES : 0);
+    cpu->p &= ~FLAG_C;
+
+    if (reason >= 1 && reason <= 4) {
+        dfs_channel *c = fs_channel(b, beeb_read(b, blk));
+        dfs_file *f;
+        if (!c) return;
+        f = &d->files[c->file];
+        if (reason == 1 || reason == 3) c->ptr = beeb_read32(b, blk + 9);
+
+        while (count > 0) {
+            if (reason <= 2) {
+                if (put_byte(b, c, beeb_read(b, addr)) < 0) return;
+            } else {
+                if (c->ptr >= f->length) {
+                    cpu->p |= FLAG_C;
+                    break;
+                }
+                beeb_write(b, addr, f->data[c->ptr++]);
+            }
+            addr++;
+            count--;
+            b->cpu.cycles += b->cost[COST_FS_BYTE];
+        }
+        beeb_write32(b, blk + 1, addr);
+        beeb_write32(b, blk + 5, count);
+        beeb_write32(b, blk + 9, c->ptr);
+    } else if (reason == 5) {       /* title and boot option */
+        write_counted(b, &addr, d->title, strlen(d->title));
+        beeb_write(b, addr, d->boot_option);
+    } else if (reason == 6 || reason == 7) {
+        char drive = '0';
+        char dir = reason == 6 ? d->cur_dir : '$';
+        write_counted(b, &addr, &drive, 1);
+        write_counted(b, &addr, &dir, 1);
+    } else if (reason == 8) {       /* names in the current directory */
+        uint32_t index = beeb_read32(b, blk + 9);
+        int i, seen = 0;
+
+        beeb_write(b, blk, d->cycle);
+        for (i = 0; i < d->nfiles && count > 0; i++) {
+            char padded[8];
+            if (d->files[i].dir != d->cur_dir) continue;
+            if ((uint32_t)seen++ < index) continue;
+            snprintf(padded, sizeof(padded), "%-7s", d->files[i].name);
+            write_counted(b, &addr, padded, 7);
+            count--;
+            index++;
+        }
+        if (count > 0) cpu->p |= FLAG_C;
+        beeb_write32(b, blk + 5, count);
+        beeb_write32(b, blk + 9, index);
+    }
+
+    cpu->a = 0;
+}
+
+/* OSWORD &7F. Only reads of the catalogue, track 0 sectors 0 and 1, are
+ * modelled; anything else fails with the 8271's "sector not found". */
+#define DISC_READ           0x53
+#define DISC_READ_DELETED   0x57
+#define DISC_NOT_FOUND      0x18
+
+void fs_disc_op(beeb *b, uint16_t blk) {
+    uint8_t cat[512];
+    uint16_t addr = (uint16_t)beeb_read32(b, blk + 1);
+    uint8_t params = beeb_read(b, blk + 5);
+    uint8_t cmd = beeb_read(b, blk + 6);
+    uint8_t track = beeb_read(b, blk + 7);
+    uint8_t sector = beeb_read(b, blk + 8);
+    uint8_t count = beeb_read(b, blk + 9) & 0x1F;
+    uint8_t size = beeb_read(b, blk + 9) >> 5;
+    uint8_t result = DISC_NOT_FOUND;
+    int i;
+
+    if ((cmd == DISC_READ || cmd == DISC_READ_DELETED) && params == 3 &&
+        track == 0 && size == 1 && sector + count <= 2) {
+        dfs_catalogue(&b->disc, cat);
+        for (i = 0; i < count * 256; i++) {
+            beeb_write(b, (uint16_t)(addr + i), cat[sector * 256 + i]);
+        }
+        fs_charge(b, count * 256u);     /* the same as DFS's own read */
+        result = 0;
+    }
+    beeb_write(b, (uint16_t)(blk + 7 + params), result);
+}
+
+static void print_text(beeb *b, const char *s) {
+    while (*s) {
+        if (*s == '\n') mos_wrch(b, '\r');
+        mos_wrch(b, (uint8_t)*s++);
+    }
+}
+
+static void catalogue(beeb *b) {
+    dfs *d = &b->disc;
+    char line[64];
+    int i;
+
+    snprintf(line, sizeof(line), "%s (%02X)\nDrive: 0  Option %d\nDir. :0.%c\n\n",
+             d->title, d->cycle, d->boot_option, d->cur_dir);
+    print_text(b, line);
+    for (i = 0; i < d->nfiles; i++) {
+        const dfs_file *f = &d->files[i];
+        if (f->dir == d->cur_dir) {
+            snprintf(line, sizeof(line), "  %-7s%s\n", f->name, f->locked ? " L" : "");
+        } else {
+            snprintf(line, sizeof(line), "  %c.%-7s%s\n", f->dir, f->name, f->locked ? " L" : "");
+        }
+        print_text(b, line);
+    }
+}
+
+static int match_word(const char **p, const char *word) {
+    size_t n = strlen(word);
+    if (strncasecmp(*p, word, n) != 0) return 0;
+    if ((*p)[n] && (*p)[n] != ' ') return 0;
+    *p += n;
+    while (**p == ' ') (*p)++;
+    return 1;
+}
+
+/* Filing system *commands. Returns -1 if the command is not recognised. */
+int fs_command(beeb *b, const char *cmd) {
+    dfs *d = &b->disc;
+    char dir, name[8];
+
+    if (match_word(&cmd, "CAT") || match_word(&cmd, ".")) {
+        catalogue(b);
+    } else if (match_word(&cmd, "DIR")) {
+        if (*cmd) d->cur_dir = (char)toupper((unsigned char)*cmd);
+    } else if (match_word(&cmd, "DRIVE") || match_word(&cmd, "DISC") || match_word(&cmd, "DISK")) {
+        /* single drive only */
+    } else if (match_word(&cmd, "DELETE")) {
+        int idx, err;
+        if (dfs_parse_name(d, cmd, &dir, name)) {
+            fs_error(b, DFS_ERR_BAD_NAME);
+            return 0;
+        }
+        idx = dfs_find(d, dir, name);
+        if (idx < 0) {
+            fs_error(b, DFS_ERR_NOT_FOUND);
+            return 0;
+        }
+        err = dfs_delete(d, idx);
+        if (err < 0) fs_error(b, -err);
+    } else if (match_word(&cmd, "ACCESS")) {
+        int idx;
+        if (dfs_parse_name(d, cmd, &dir, name)) {
+            fs_error(b, DFS_ERR_BAD_NAME);
+            return 0;
+        }
+        idx = dfs_find(d, dir, name);
+        if (idx < 0) {
+            fs_error(b, DFS_ERR_NOT_FOUND);
+            return 0;
+        }
+        d->files[idx].locked = strchr(cmd, 'L') != NULL || strchr(cmd, 'l') != NULL;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+void fs_fsc(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+
+    switch (cpu->a) {
+    case 0x01: {                    /* EOF#: X = handle */
+        dfs_channel *c = fs_channel(b, cpu->x);
+        if (!c) return;
+        cpu->x = c->ptr >= b->disc.files[c->file].length ? 0xFF : 0x00;
+        break;
+    }
+    case 0x03: {                    /* unrecognised *command at XY */
+        char cmd[256];
+        beeb_read_string(b, (uint16_t)(cpu->x | (cpu->y << 8)), cmd, sizeof(cmd));
+        if (fs_command(b, cmd) < 0) beeb_raise_error(b, 0xFE, "Bad command");
+        break;
+    }
+    case 0x05:                      /* *CAT */
+        catalogue(b);
+        break;
+    case 0x07:                      /* range of file handles */
+        cpu->x = DFS_FIRST_HANDLE;
+        cpu->y = DFS_FIRST_HANDLE + DFS_MAX_CHANNELS - 1;
+        break;
+    default:
+        break;
+    }
+}
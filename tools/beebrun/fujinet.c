@@ -0,0 +1,322 @@
+/*
+ * fujinet.c - a FujiNet stand-in on the RS423 port: the FN_FUJI (&70)
+ * and N1: (&71) serial protocol, with canned answers and a local file
+ * for the network
+ *
+ * Each command is a 7-byte frame (device, command, four aux bytes,
+ * checksum), answered 'A', or 'N' for a bad checksum or a command not
+ * known here. N1:'s open and write then take a block of data and its
+ * checksum, answered the same way. The device finishes with 'C' and any
+ * reply with its checksum, or 'E'. Everything is answered as soon as
+ * the last byte arrives, and goes back at the line's rate, so a run
+ * times the Beeb's side of the protocol and the baud rate and nothing
+ * else: there is no WiFi or server in the way.
+ *
+ * N1: serves one body whatever URL is opened, the file given to
+ * fujinet_attach() or a built-in text. Status says how much of it is
+ * left, up to 65535 bytes, and a read of more than that gets 'E'.
+ * Writes are taken and dropped.
+ *
+ * Opening one of the N:TEST:// URLs in faults[] also makes the next
+ * command go wrong, once, so that a client's error paths can be tested:
+ * its frame is answered 'N', or not at all, or it ends with 'E', or its
+ * reply comes with a bad checksum. N:TEST://STALL stalls the
+ * connection instead: until the next open, close or reset, status says
+ * it is connected with nothing waiting.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fujinet.h"
+
+#define FN_FUJI         0x70
+#define FN_NETWORK      0x71
+
+#define FUJI_RESET      0xFF
+#define FUJI_GET_SSID   0xFE
+#define FUJI_GET_HOSTS  0xF4
+#define FUJI_GET_SLOTS  0xF2
+#define NET_OPEN        'O'
+#define NET_CLOSE       'C'
+#define NET_READ        'R'
+#define NET_STATUS      'S'
+#define NET_WRITE       'W'
+
+#define URL_SIZE        256
+#define SSID_SIZE       (33 + 64)
+#define HOST_SLOTS      8
+#define HOST_SIZE       32
+#define DEVICE_SLOTS    8
+#define SLOT_SIZE       38
+#define EMPTY_SLOT      0xFF
+
+#define NET_OK          1           /* status error byte */
+#define NET_EOF         136
+
+#define BODY_SIZE       16384       /* the built-in body */
+#define STALL_URL       "N:TEST://STALL"
+
+enum fault {
+    FAULT_NONE,
+    FAULT_NAK,                      /* the frame answered 'N' */
+    FAULT_SILENT,                   /* the frame not answered */
+    FAULT_ERROR,                    /* 'E' in place of 'C' */
+    FAULT_CHECKSUM                  /* the reply's checksum one out */
+};
+
+typedef struct fujinet {
+    uint8_t  frame[7];
+    int      frame_len;
+    uint8_t  data[65535 + 1];       /* a block and its checksum */
+    size_t   data_len, data_want;   /* data_want 0: collecting frames */
+
+    uint8_t *body;
+    size_t   body_len, body_pos;
+    int      open, stalled;
+    enum fault fault;               /* for the next command */
+    enum fault now;                 /* for this one */
+} fujinet;
+
+static fujinet fn;
+
+static const char *hosts[HOST_SLOTS] = {
+    "SD", "fujinet.online", "tnfs.fujinet.online"
+};
+
+static const struct {
+    uint8_t     host_slot, mode;
+    const char *file;
+} slots[DEVICE_SLOTS] = {
+    { 1, 1, "/BBC/GAMES/ELITE.SSD" },
+    { 1, 1, "/BBC/UTILS/DISCDOCTOR.SSD" },
+    { 0, 2, "/WORK.SSD" },
+    { EMPTY_SLOT, 0, "" }, { EMPTY_SLOT, 0, "" }, { EMPTY_SLOT, 0, "" },
+    { EMPTY_SLOT, 0, "" }, { EMPTY_SLOT, 0, "" }
+};
+
+static const struct {
+    const char *url;
+    enum fault  fault;
+} faults[] = {
+    { "N:TEST://NAK",      FAULT_NAK },
+    { "N:TEST://SILENT",   FAULT_SILENT },
+    { "N:TEST://ERROR",    FAULT_ERROR },
+    { "N:TEST://CHECKSUM", FAULT_CHECKSUM }
+};
+
+/* 8-bit sum with the carry added back in */
+static uint8_t checksum(const uint8_t *p, size_t n) {
+    unsigned sum = 0;
+    size_t i;
+    for (i = 0; i < n; i++) {
+        sum += p[i];
+        sum = (sum >> 8) + (sum & 0xFF);
+    }
+    return (uint8_t)sum;
+}
+
+static void put(acia *a, uint8_t c, uint64_t now) {
+    acia_send(a, &c, 1, now);
+}
+
+/* 'C', then the reply and its checksum if there is one */
+static void complete(acia *a, const uint8_t *reply, size_t n, uint64_t now) {
+    put(a, 'C', now);
+    if (n) {
+        acia_send(a, reply, n, now);
+        put(a, (uint8_t)(checksum(reply, n) + (fn.now == FAULT_CHECKSUM)), now);
+    }
+}
+
+static void fuji_command(acia *a, uint8_t cmd, uint64_t now) {
+    uint8_t reply[DEVICE_SLOTS * SLOT_SIZE];
+    int i;
+
+    memset(reply, 0, sizeof(reply));
+    switch (cmd) {
+    case FUJI_RESET:
+        fn.open = 0;
+        fn.stalled = 0;
+        complete(a, NULL, 0, now);
+        break;
+    case FUJI_GET_SSID:
+        strcpy((char *)reply, "BEEBNET");
+        complete(a, reply, SSID_SIZE, now);
+        break;
+    case FUJI_GET_HOSTS:
+        for (i = 0; i < HOST_SLOTS; i++) {
+            if (hosts[i]) strcpy((char *)reply + i * HOST_SIZE, hosts[i]);
+        }
+        complete(a, reply, HOST_SLOTS * HOST_SIZE, now);
+        break;
+    case FUJI_GET_SLOTS:
+        for (i = 0; i < DEVICE_SLOTS; i++) {
+            reply[i * SLOT_SIZE] = slots[i].host_slot;
+            reply[i * SLOT_SIZE + 1] = slots[i].mode;
+            strcpy((char *)reply + i * SLOT_SIZE + 2, slots[i].file);
+        }
+        complete(a, reply, DEVICE_SLOTS * SLOT_SIZE, now);
+        break;
+    }
+}
+
+static void net_command(acia *a, uint8_t cmd, size_t n, uint64_t now) {
+    size_t left = fn.body_len - fn.body_pos;
+    uint8_t status[4];
+    size_t i;
+
+    switch (cmd) {
+    case NET_OPEN:
+        fn.open = 1;
+        fn.body_pos = 0;
+        fn.stalled = !strncmp((const char *)fn.data, STALL_URL, URL_SIZE);
+        for (i = 0; i < sizeof(faults) / sizeof(faults[0]); i++) {
+            if (!strncmp((const char *)fn.data, faults[i].url, URL_SIZE)) {
+                fn.fault = faults[i].fault;
+            }
+        }
+        complete(a, NULL, 0, now);
+        break;
+    case NET_CLOSE:
+        fn.open = 0;
+        fn.stalled = 0;
+        complete(a, NULL, 0, now);
+        break;
+    case NET_STATUS:
+        if (!fn.open) left = 0;
+        if (left > 0xFFFF) left = 0xFFFF;
+        if (fn.stalled) left = 0;
+        status[0] = (uint8_t)left;
+        status[1] = (uint8_t)(left >> 8);
+        status[2] = left > 0 || fn.stalled;
+        status[3] = left > 0 || fn.stalled ? NET_OK : NET_EOF;
+        complete(a, status, sizeof(status), now);
+        break;
+    case NET_READ:
+        if (!fn.open || n == 0 || n > left) {
+            put(a, 'E', now);
+            break;
+        }
+        complete(a, fn.body + fn.body_pos, n, now);
+        fn.body_pos += n;
+        break;
+    case NET_WRITE:
+        if (!fn.open) {
+            put(a, 'E', now);
+            break;
+        }
+        complete(a, NULL, 0, now);
+        break;
+    }
+}
+
+/* A whole frame and any data it carries have arrived and been acked */
+static void run(acia *a, uint64_t now) {
+    size_t n = fn.frame[2] | fn.frame[3] << 8;
+
+    if (fn.now == FAULT_ERROR) {
+        put(a, 'E', now);
+    } else if (fn.frame[0] == FN_FUJI) {
+        fuji_command(a, fn.frame[1], now);
+    } else {
+        net_command(a, fn.frame[1], n, now);
+    }
+}
+
+static int known(const uint8_t *frame) {
+    if (frame[0] == FN_FUJI) {
+        return frame[1] == FUJI_RESET || frame[1] == FUJI_GET_SSID ||
+               frame[1] == FUJI_GET_HOSTS || frame[1] == FUJI_GET_SLOTS;
+    }
+    if (frame[0] == FN_NETWORK) {
+        return frame[1] == NET_OPEN || frame[1] == NET_CLOSE || frame[1] == NET_READ ||
+               frame[1] == NET_STATUS || frame[1] == NET_WRITE;
+    }
+    return 0;
+}
+
+static void fujinet_device(acia *a, void *ctx, uint8_t c, uint64_t now) {
+    int ok;
+
+    (void)ctx;
+    if (fn.data_want) {
+        fn.data[fn.data_len++] = c;
+        if (fn.data_len < fn.data_want + 1) return;
+        ok = checksum(fn.data, fn.data_want) == fn.data[fn.data_want];
+        fn.data_want = 0;
+        put(a, ok ? 'A' : 'N', now);
+        if (ok) run(a, now);
+        return;
+    }
+
+    fn.frame[fn.frame_len++] = c;
+    if (fn.frame_len < 7) return;
+    fn.frame_len = 0;
+    fn.now = fn.fault;
+    fn.fault = FAULT_NONE;
+    if (fn.now == FAULT_SILENT) return;
+    ok = checksum(fn.frame, 6) == fn.frame[6] && known(fn.frame) && fn.now != FAULT_NAK;
+    put(a, ok ? 'A' : 'N', now);
+    if (!ok) return;
+
+    /* Open and write carry data; a zero-length write has none */
+    if (fn.frame[0] == FN_NETWORK && fn.frame[1] == NET_OPEN) {
+        fn.data_want = URL_SIZE;
+    } else if (fn.frame[0] == FN_NETWORK && fn.frame[1] == NET_WRITE) {
+        fn.data_want = fn.frame[2] | fn.frame[3] << 8;
+    }
+    fn.data_len = 0;
+    if (!fn.data_want) run(a, now);
+}
+
+/* Numbered lines of text, so a dropped or repeated block shows */
+static int make_body(void) {
+    size_t n = 0;
+    unsigned line = 0;
+    char text[64];
+
+    fn.body = malloc(BODY_SIZE);
+    if (!fn.body) return -1;
+    while (n < BODY_SIZE) {
+        int len = snprintf(text, sizeof(text),
+                           "%05u The quick brown fox jumps over the lazy dog.\r\n", line++);
+        if ((size_t)len > BODY_SIZE - n) len = (int)(BODY_SIZE - n);
+        memcpy(fn.body + n, text, (size_t)len);
+        n += (size_t)len;
+    }
+    fn.body_len = n;
+    return 0;
+}
+
+static int load_body(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    long len;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    fn.body = malloc(len > 0 ? (size_t)len : 1);
+    if (!fn.body || len < 0 || fread(fn.body, 1, (size_t)len, fp) != (size_t)len) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    fn.body_len = (size_t)len;
+    return 0;
+}
+
+int fujinet_attach(acia *a, const char *path) {
+    free(fn.body);
+    memset(&fn, 0, sizeof(fn));
+    if ((path ? load_body(path) : make_body()) < 0) return -1;
+    a->device = fujinet_device;
+    a->device_ctx = NULL;
+    return 0;
+}
@@ -0,0 +1,17 @@
+/*
+ * fujinet.h - a FujiNet stand-in on the RS423 port: the FN_FUJI (&70)
+ * and N1: (&71) serial protocol, with canned answers and a local file
+ * for the network
+ */
+
+#ifndef BEEBRUN_FUJINET_H
+#define BEEBRUN_FUJINET_H
+
+#include "acia.h"
+
+/* Plug the stand-in into the port. N1: serves the file at path whatever
+ * URL is opened, or a built-in text body when path is NULL. Returns 0,
+ * or -1 if the file cannot be read. */
+int fujinet_attach(acia *a, const char *path);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+ * beebrun - headless BBC Micro runner for the clib test programs
+ *
+ * Loads sideways ROM images, boots a DFS disc image, *RUNs a program
+ * from it and captures everything written through OSWRCH. Keypresses
+ * come from a script, and the run ends when the program returns, hits
+ * an uncaught error, or waits for a key the script does not have.
+ * A report of cycles, exit code and OS call counts follows the run.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "beeb.h"
+
+static const char *vector_names[TRAP_VECTORS] = {
+    "USERV", "BRKV", "IRQ1V", "IRQ2V", "OSCLI", "OSBYTE", "OSWORD", "OSWRCH",
+    "OSRDCH", "OSFILE", "OSARGS", "OSBGET", "OSBPUT", "OSGBPB", "OSFIND", "FSC",
+    "EVNTV"
+};
+
+static const char *status_names[] = {
+    "running", "exit", "brk", "no-input", "cycle-limit", "bad-opcode"
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [OPTIONS] <disc.ssd>\n"
+        "\n"
+        "Options:\n"
+        "  -r <slot>:<file>   Load a sideways ROM image into a slot (repeatable)\n"
+        "  -f <name>          File to *RUN from the disc (default: $.TEST)\n"
+        "  -k <keys>          Scripted keypresses (\\r \\e \\xNN escapes)\n"
+        "  -K <file>          Read scripted keypresses from a file\n"
+        "  -o <file>          Write OSWRCH output to file (default: stdout)\n"
+        "  -t                 Text output: drop VDU control codes, LF as newline\n"
+        "  -c <cycles>        Stop after this many cycles (default: 1000000000)\n"
+        "  -R <file>          Write the run report to file (default: stderr)\n"
+        "  -p <file>          Write a profile of JSR targets and call counts\n"
+        "  -S <device>        Plug a device into the RS423 port: loop (TX to RX),\n"
+        "                     or fujinet[:<file>] (a FujiNet serving the file)\n"
+        "  -C <name>=<cycles> Set a figure of the cost model (repeatable): fs_call,\n"
+        "                     fs_byte, rs423_irq or rs423_buffer\n"
+        "  -h                 Show this help message\n",
+        prog);
+}
+
+/* Decode a key script; returns the number of bytes written to out */
+static size_t decode_keys(const char *in, uint8_t *out) {
+    size_t n = 0;
+
+    while (*in) {
+        if (*in != '\\' || !in[1]) {
+            out[n++] = (uint8_t)*in++;
+            continue;
+        }
+        in++;
+        switch (*in) {
+        case 'r': case 'n': out[n++] = '\r'; in++; break;
+        case 'e':           out[n++] = 27;   in++; break;
+        case 't':           out[n++] = 9;    in++; break;
+        case 'x': {
+            unsigned v = 0;
+            int digits = 0;
+            in++;
+            while (digits < 2 && isxdigit((unsigned char)*in)) {
+                v = v * 16 + (unsigned)(isdigit((unsigned char)*in) ? *in - '0'
+                                                                     : (toupper((unsigned char)*in) - 'A' + 10));
+                in++;
+                digits++;
+            }
+            out[n++] = (uint8_t)v;
+            break;
+        }
+        default:
+            out[n++] = (uint8_t)*in++;
+            break;
+        }
+    }
+    return n;
+}
+
+static char *read_text_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    char *buf;
+    long len;
+
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = calloc(1, (size_t)len + 1);
+    if (fread(buf, 1, (size_t)len, fp) != (size_t)len) len = 0;
+    buf[len] = 0;
+    fclose(fp);
+
+    /* A trailing newline from an editor is not a keypress */
+    while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) buf[--len] = 0;
+    return buf;
+}
+
+static void report(beeb *b, FILE *fp) {
+    int i;
+
+    fprintf(fp, "status      %s\n", status_names[b->status]);
+    if (b->status == RUN_EXIT) {
+        fprintf(fp, "exit_code   %u\n", b->exit_code);
+    }
+    if (b->status == RUN_BRK) {
+        fprintf(fp, "brk         &%02X \"%s\" at &%04X\n", b->brk_num, b->brk_msg, b->brk_addr);
+    }
+    if (b->status == RUN_BAD_OPCODE) {
+        fprintf(fp, "bad_opcode  &%02X at &%04X\n", beeb_read(b, b->cpu.pc), b->cpu.pc);
+    }
+    fprintf(fp, "cycles      %llu\n", (unsigned long long)b->cpu.cycles);
+    fprintf(fp, "seconds     %.3f\n", (double)b->cpu.cycles / CPU_HZ);
+    fprintf(fp, "keys_used   %lu/%lu\n", (unsigned long)b->key_pos, (unsigned long)b->nkeys);
+    fprintf(fp, "screen      %lu\n", b->screen_bytes);
+    if (b->acia.tx_bytes) {
+        fprintf(fp, "serial_tx   %lu\n", b->acia.tx_bytes);
+    }
+    if (b->acia.rx_bytes) {
+        fprintf(fp, "serial_rx   %lu\n", b->acia.rx_bytes);
+    }
+    if (b->acia.overruns) {
+        fprintf(fp, "overruns    %lu\n", b->acia.overruns);
+    }
+    for (i = 0; i < COSTS; i++) {
+        fprintf(fp, "cost        %-12s %lu\n", beeb_cost_name(i), (unsigned long)b->cost[i]);
+    }
+    for (i = 0; i < TRAP_VECTORS; i++) {
+        if (b->calls[i]) fprintf(fp, "calls       %-7s %lu\n", vector_names[i], b->calls[i]);
+    }
+}
+
+static const uint32_t *profile_counts;
+
+static int by_count(const void *pa, const void *pb) {
+    uint32_t a = profile_counts[*(const uint32_t *)pa];
+    uint32_t b = profile_counts[*(const uint32_t *)pb];
+    return a < b ? 1 : a > b ? -1 : 0;
+}
+
+/* One line per JSR target, most called first: "&XXXX bank calls",
+ * bank is "-" outside sideways ROM space */
+static int write_profile(beeb *b, const char *path) {
+    FILE *fp = fopen(path, "w");
+    uint32_t *slots, slot, n = 0, i;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    slots = malloc(PROFILE_SLOTS * sizeof(*slots));
+    for (slot = 0; slot < PROFILE_SLOTS; slot++) {
+        if (b->profile[slot]) slots[n++] = slot;
+    }
+    profile_counts = b->profile;
+    qsort(slots, n, sizeof(*slots), by_count);
+
+    fprintf(fp, "# beebrun JSR profile: target bank calls\n");
+    for (i = 0; i < n; i++) {
+        slot = slots[i];
+        if (slot < 0x10000) {
+            fprintf(fp, "&%04X -  %lu\n", slot, (unsigned long)b->profile[slot]);
+        } else {
+            fprintf(fp, "&%04X %-2u %lu\n", 0x8000 + (slot - 0x10000) % 0x4000,
+                    (slot - 0x10000) / 0x4000, (unsigned long)b->profile[slot]);
+        }
+    }
+    free(slots);
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    static beeb b;
+    const char *run_name = "$.TEST";
+    const char *out_path = NULL;
+    const char *report_path = NULL;
+    const char *profile_path = NULL;
+    char *key_text = NULL;
+    char dir, name[8];
+    FILE *report_fp = stderr;
+    dfs_file *f;
+    uint32_t i;
+    int opt, idx, rc;
+
+    beeb_init(&b);
+
+    while ((opt = getopt(argc, argv, "r:f:k:K:o:tc:R:p:S:C:h")) != -1) {
+        switch (opt) {
+        case 'r': {
+            char *colon = strchr(optarg, ':');
+            if (!colon) {
+                fprintf(stderr, "-r expects <slot>:<file>\n");
+                return 1;
+            }
+            *colon = 0;
+            if (beeb_load_rom(&b, atoi(optarg), colon + 1) < 0) return 1;
+            break;
+        }
+        case 'f': run_name = optarg; break;
+        case 'k': free(key_text); key_text = strdup(optarg); break;
+        case 'K':
+            free(key_text);
+            key_text = read_text_file(optarg);
+            if (!key_text) return 1;
+            break;
+        case 'o': out_path = optarg; break;
+        case 't': b.text_mode = 1; break;
+        case 'c': b.cycle_limit = strtoull(optarg, NULL, 0); break;
+        case 'R': report_path = optarg; break;
+        case 'p': profile_path = optarg; break;
+        case 'S':
+            if (acia_attach(&b.acia, optarg) < 0) {
+                fprintf(stderr, "-S: no RS423 device %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'C':
+            if (beeb_set_cost(&b, optarg) < 0) {
+                fprintf(stderr, "-C expects <name>=<cycles>, not %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (dfs_load_ssd(&b.disc, argv[optind]) < 0) return 1;
+
+    if (key_text) {
+        b.keys = malloc(strlen(key_text) + 1);
+        b.nkeys = decode_keys(key_text, b.keys);
+    }
+
+    if (dfs_parse_name(&b.disc, run_name, &dir, name) ||
+        (idx = dfs_find(&b.disc, dir, name)) < 0) {
+        fprintf(stderr, "%s: no file %s on the disc\n", argv[optind], run_name);
+        return 1;
+    }
+    f = &b.disc.files[idx];
+    if ((f->load & 0xFFFF) + f->length > 0x8000) {
+        fprintf(stderr, "%s: does not fit below &8000\n", run_name);
+        return 1;
+    }
+
+    if (out_path) {
+        b.out = fopen(out_path, "wb");
+        if (!b.out) {
+            perror(out_path);
+            return 1;
+        }
+    }
+    if (report_path) {
+        report_fp = fopen(report_path, "w");
+        if (!report_fp) {
+            perror(report_path);
+            return 1;
+        }
+    }
+
+    if (profile_path) {
+        b.profile = calloc(PROFILE_SLOTS, sizeof(*b.profile));
+        if (!b.profile) {
+            perror("profile");
+            return 1;
+        }
+    }
+
+    beeb_boot(&b);
+    if (b.status == RUN_ACTIVE) {
+        for (i = 0; i < f->length; i++) {
+            b.ram[(f->load + i) & 0x7FFF] = f->data[i];
+        }
+        beeb_run_program(&b, (uint16_t)f->exec);
+    }
+
+    if (b.out) fflush(b.out);
+    if (b.out && b.out != stdout) fclose(b.out);
+    report(&b, report_fp);
+    if (report_fp != stderr) fclose(report_fp);
+    if (profile_path && write_profile(&b, profile_path) < 0) return 1;
+
+    /* Exit status: 0 for a normal return, otherwise 10 + run status */
+    rc = b.status == RUN_EXIT ? 0 : 10 + b.status;
+    dfs_free(&b.disc);
+    free(b.profile);
+    return rc;
+}
@@ -0,0 +1,550 @@
+/*
+ * mos.c - host-side MOS: entry points, default vector handlers,
+ * OSBYTE/OSWORD, output capture and scripted keyboard input
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "beeb.h"
+
+#define VECTORS     0x0200
+#define IRQ_ENTRY   0xDC1C      /* MOS 1.20 IRQ/BRK entry point */
+#define MOS_WAIT    0xDE00      /* CLI: JMP <trap>, four bytes per vector */
+
+/* Free space in the RS423 input buffer below which RTS goes high */
+#define RS423_HANDSHAKE     9
+
+/* Number of parameter bytes that follow each VDU control code */
+static const uint8_t vdu_params[32] = {
+    0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 2, 5, 0, 0, 1, 9, 8, 5, 0, 0, 4, 4, 0, 2
+};
+
+static void put_bytes(beeb *b, uint16_t addr, const uint8_t *code, size_t len) {
+    memcpy(&b->mos[addr - 0xC000], code, len);
+}
+
+/* Lay out the parts of MOS 1.20 that programs depend on by address:
+ * the &FFxx entry points, the hardware vectors and the IRQ/BRK entry
+ * that decodes the error block and jumps through BRKV. */
+void mos_build_rom(beeb *b) {
+    static const uint8_t irq_entry[] = {
+        0x85, 0xFC,             /*       STA &FC             */
+        0x68,                   /*       PLA                 */
+        0x48,                   /*       PHA                 */
+        0x29, 0x10,             /*       AND #&10            */
+        0xD0, 0x03,             /*       BNE brk             */
+        0x6C, 0x04, 0x02,       /*       JMP (IRQ1V)         */
+        0x8A,                   /* brk:  TXA                 */
+        0x48,                   /*       PHA                 */
+        0xBA,                   /*       TSX                 */
+        0xBD, 0x03, 0x01,       /*       LDA &0103,X         */
+        0xD8,                   /*       CLD                 */
+        0x38,                   /*       SEC                 */
+        0xE9, 0x01,             /*       SBC #1              */
+        0x85, 0xFD,             /*       STA &FD             */
+        0xBD, 0x04, 0x01,       /*       LDA &0104,X         */
+        0xE9, 0x00,             /*       SBC #0              */
+        0x85, 0xFE,             /*       STA &FE             */
+        0xA5, 0xF4,             /*       LDA &F4             */
+        0x8D, 0x4A, 0x02,       /*       STA &024A           */
+        0x68,                   /*       PLA                 */
+        0xAA,                   /*       TAX                 */
+        0xA5, 0xFC,             /*       LDA &FC             */
+        0x58,                   /*       CLI                 */
+        0x6C, 0x02, 0x02        /*       JMP (BRKV)          */
+    };
+    static const uint8_t osasci[] = {
+        0xC9, 0x0D,             /* &FFE3 CMP #&0D            */
+        0xD0, 0x07,             /*       BNE OSWRCH          */
+        0xA9, 0x0A,             /* &FFE7 LDA #&0A (OSNEWL)   */
+        0x20, 0xEE, 0xFF,       /*       JSR OSWRCH          */
+        0xA9, 0x0D              /* &FFEC LDA #&0D            */
+    };
+    static const struct { uint16_t addr; uint8_t vector; } entries[] = {
+        { 0xFFCE, 0x1C }, { 0xFFD1, 0x1A }, { 0xFFD4, 0x18 }, { 0xFFD7, 0x16 },
+        { 0xFFDA, 0x14 }, { 0xFFDD, 0x12 }, { 0xFFE0, 0x10 }, { 0xFFEE, 0x0E },
+        { 0xFFF1, 0x0C }, { 0xFFF4, 0x0A }, { 0xFFF7, 0x08 }
+    };
+    size_t i;
+    int v;
+
+    memset(b->mos, 0xFF, sizeof(b->mos));
+    put_bytes(b, IRQ_ENTRY, irq_entry, sizeof(irq_entry));
+    put_bytes(b, 0xFFE3, osasci, sizeof(osasci));
+
+    for (i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+        uint8_t jmp[3] = { 0x6C, entries[i].vector, 0x02 };
+        put_bytes(b, entries[i].addr, jmp, 3);
+    }
+
+    b->mos[0xFFFA - 0xC000] = 0x40;     /* NMI: RTI at &FF40 */
+    b->mos[0xFFFB - 0xC000] = 0xFF;
+    b->mos[0xFF40 - 0xC000] = 0x40;
+    b->mos[0xFFFE - 0xC000] = (uint8_t)IRQ_ENTRY;
+    b->mos[0xFFFF - 0xC000] = (uint8_t)(IRQ_ENTRY >> 8);
+
+    for (v = 0; v < TRAP_VECTORS; v++) {
+        uint8_t wait[4] = { 0x58, 0x4C, (uint8_t)v, (uint8_t)(TRAP_PAGE >> 8) };
+        put_bytes(b, (uint16_t)(MOS_WAIT + v * 4), wait, 4);
+        b->ram[VECTORS + v * 2]     = (uint8_t)v;
+        b->ram[VECTORS + v * 2 + 1] = (uint8_t)(TRAP_PAGE >> 8);
+    }
+}
+
+/* Have a call that must wait for an interrupt run again: the 6502 goes
+ * round a CLI and back into the trap until the handler can finish, so
+ * the wait takes its time on the emulated clock */
+static void mos_wait(beeb *b, uint8_t id) {
+    b->calls[id]--;
+    b->cpu.pc = (uint16_t)(MOS_WAIT + id * 4);
+}
+
+/* ---- RS423 -------------------------------------------------------- */
+
+static int buffer_put(mos_buffer *m, uint8_t c) {
+    if (m->len >= m->size) return -1;
+    m->data[(m->head + m->len++) & 0xFF] = c;
+    return 0;
+}
+
+static int buffer_get(mos_buffer *m) {
+    int c;
+    if (m->len == 0) return -1;
+    c = m->data[m->head];
+    m->head = (m->head + 1) & 0xFF;
+    m->len--;
+    return c;
+}
+
+/* Set the ACIA's RTS/transmit interrupt bits for the state of the
+ * buffers: RTS high while the input buffer is nearly full, otherwise the
+ * transmit interrupt on while there is output waiting */
+static void rs423_control(beeb *b) {
+    uint8_t tx = b->rs423_out.len ? ACIA_TX_IRQ : 0;
+    if (b->rs423_held) tx = ACIA_RTS_HIGH;
+    if ((b->acia.control & ACIA_TX_MASK) != tx) {
+        acia_write(&b->acia, ACIA_BASE, (uint8_t)((b->acia.control & ~ACIA_TX_MASK) | tx),
+                   b->cpu.cycles);
+    }
+}
+
+/* The RS423 part of the default IRQ1V handler */
+static void rs423_irq(beeb *b) {
+    acia *a = &b->acia;
+
+    acia_update(a, b->cpu.cycles);
+    if (!(a->status & ACIA_IRQ)) return;
+    if (a->status & (ACIA_RDRF | ACIA_OVRN)) {
+        uint8_t c = acia_read(a, ACIA_BASE + 1, b->cpu.cycles);
+        buffer_put(&b->rs423_in, c);
+        if (b->rs423_in.size - b->rs423_in.len < RS423_HANDSHAKE) b->rs423_held = 1;
+        b->cpu.cycles += b->cost[COST_RS423_IRQ];
+    }
+    if ((a->control & ACIA_TX_MASK) == ACIA_TX_IRQ && (a->status & ACIA_TDRE)) {
+        int c = buffer_get(&b->rs423_out);
+        if (c >= 0) {
+            acia_write(a, ACIA_BASE + 1, (uint8_t)c, b->cpu.cycles);
+            b->cpu.cycles += b->cost[COST_RS423_IRQ];
+        }
+    }
+    rs423_control(b);
+}
+
+static int rs423_remove(beeb *b) {
+    int c = buffer_get(&b->rs423_in);
+    if (b->rs423_held && b->rs423_in.size - b->rs423_in.len >= RS423_HANDSHAKE) {
+        b->rs423_held = 0;
+        rs423_control(b);
+    }
+    return c;
+}
+
+static int rs423_insert(beeb *b, uint8_t c) {
+    if (buffer_put(&b->rs423_out, c) < 0) return -1;
+    rs423_control(b);
+    return 0;
+}
+
+/* ---- Output ------------------------------------------------------- */
+
+void mos_wrch(beeb *b, uint8_t c) {
+    if (b->out_streams & 0x01) {
+        rs423_insert(b, c);
+    }
+    if (b->out_streams & 0x02) return;     /* VDU disabled by *FX3 */
+
+    b->screen_bytes++;
+    if (!b->out) return;
+
+    if (!b->text_mode) {
+        fputc(c, b->out);
+        return;
+    }
+
+    /* Text mode: drop VDU control sequences and map LF to newline */
+    if (b->vdu_skip) {
+        b->vdu_skip--;
+    } else if (c < 32) {
+        b->vdu_skip = vdu_params[c];
+        if (c == 10) fputc('\n', b->out);
+    } else if (c != 127) {
+        fputc(c, b->out);
+    }
+}
+
+/* ---- Keyboard ----------------------------------------------------- */
+
+static int next_key(beeb *b) {
+    if (b->key_pos < b->nkeys) return b->keys[b->key_pos++];
+    return -1;
+}
+
+static void mos_rdch(beeb *b) {
+    int key = next_key(b);
+    if (key < 0) {
+        b->status = RUN_NO_INPUT;
+        return;
+    }
+    b->cpu.a = (uint8_t)key;
+    b->cpu.p &= ~FLAG_C;
+}
+
+/* ---- OSBYTE ------------------------------------------------------- */
+
+static const uint16_t mode_himem[8] = {
+    0x3000, 0x3000, 0x3000, 0x4000, 0x5800, 0x5800, 0x6000, 0x7C00
+};
+
+static void mos_byte(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    uint8_t a = cpu->a, x = cpu->x, y = cpu->y;
+    uint8_t old;
+
+    switch (a) {
+    case 0x00:                      /* identify host OS: OS 1.20 */
+        cpu->x = 1;
+        break;
+    case 0x02:                      /* *FX2 select input stream */
+        old = b->in_stream;
+        b->in_stream = x;
+        cpu->x = old;
+        /* RS423 receives for 1 and 2, and is off for 0 */
+        acia_write(&b->acia, ACIA_BASE, (uint8_t)(x ? b->acia.control | ACIA_RX_IRQ
+                                                    : b->acia.control & ~ACIA_RX_IRQ),
+                   cpu->cycles);
+        break;
+    case 0x03:                      /* *FX3 select output streams */
+        old = b->out_streams;
+        b->out_streams = x;
+        cpu->x = old;
+        break;
+    case 0x07:                      /* RS423 receive baud rate */
+    case 0x08:                      /* RS423 transmit baud rate */
+        acia_set_baud(&b->acia, a == 0x07, x);
+        break;
+    case 0x0F:                      /* flush buffers */
+    case 0x15:
+        /* Scripted keys arrive on demand rather than sitting in the
+         * keyboard buffer, so only the RS423 buffers have anything to
+         * discard. */
+        if (a == 0x0F || x == 1) {
+            while (rs423_remove(b) >= 0) {}
+        }
+        if (a == 0x15 && x == 2) {
+            b->rs423_out.len = 0;
+            rs423_control(b);
+        }
+        break;
+    case 0x7C:                      /* clear escape condition */
+    case 0x7D:                      /* set escape condition */
+        break;
+    case 0x7E:                      /* acknowledge escape */
+        cpu->x = 0;
+        break;
+    case 0x80:                      /* ADVAL: buffer status and ADC */
+        if (x == 0xFF) {
+            size_t left = b->nkeys - b->key_pos;
+            cpu->x = (uint8_t)(left > 31 ? 31 : left);
+        } else if (x == 0xFE) {
+            cpu->x = (uint8_t)b->rs423_in.len;
+            cpu->cycles += b->cost[COST_RS423_BUFFER];
+        } else if (x == 0xFD) {
+            cpu->x = (uint8_t)(b->rs423_out.size - b->rs423_out.len);
+            cpu->cycles += b->cost[COST_RS423_BUFFER];
+        } else {
+            cpu->x = 0;
+        }
+        cpu->y = 0;
+        break;
+    case 0x81:                      /* INKEY */
+        if (y == 0xFF && x == 0x00) {
+            cpu->x = 0x01;          /* OS 1.20 */
+        } else if (y >= 0x80) {
+            cpu->x = 0;             /* negative INKEY: key not pressed */
+            cpu->y = 0;
+        } else {
+            int key = next_key(b);
+            if (key >= 0) {
+                cpu->x = (uint8_t)key;
+                cpu->y = 0;
+                cpu->p &= ~FLAG_C;
+            } else {
+                /* Let the timeout elapse on the emulated clock */
+                cpu->cycles += (uint64_t)((y << 8) | x) * (CPU_HZ / 100);
+                cpu->y = 0xFF;
+                cpu->p |= FLAG_C;
+            }
+        }
+        break;
+    case 0x82:                      /* machine high order address */
+        cpu->x = cpu->y = 0xFF;
+        break;
+    case 0x83:                      /* OSHWM with DFS: &1900 */
+        cpu->x = 0x00;
+        cpu->y = 0x19;
+        break;
+    case 0x84:                      /* HIMEM in the current mode (7) */
+    case 0x85:                      /* HIMEM for mode X */
+        {
+            uint16_t himem = mode_himem[(a == 0x84 ? 7 : x) & 7];
+            cpu->x = (uint8_t)himem;
+            cpu->y = (uint8_t)(himem >> 8);
+        }
+        break;
+    case 0x86:                      /* text cursor position */
+        cpu->x = cpu->y = 0;
+        break;
+    case 0x87:                      /* character at cursor and mode */
+        cpu->x = ' ';
+        cpu->y = 7;
+        break;
+    case 0x8A:                      /* insert character into buffer */
+        cpu->p |= FLAG_C;
+        if (x == 2) {
+            cpu->cycles += b->cost[COST_RS423_BUFFER];
+            if (rs423_insert(b, y) == 0) cpu->p &= ~FLAG_C;
+        }
+        break;
+    case 0x91:                      /* remove character from buffer */
+        {
+            int c = -1;
+            if (x == 0) {
+                c = next_key(b);
+            } else if (x == 1) {
+                cpu->cycles += b->cost[COST_RS423_BUFFER];
+                c = rs423_remove(b);
+            }
+            if (c >= 0) {
+                cpu->y = (uint8_t)c;
+                cpu->p &= ~FLAG_C;
+                break;
+            }
+        }
+        cpu->p |= FLAG_C;
+        break;
+    case 0x9C:                      /* read/write ACIA control register */
+        old = b->acia.control;
+        acia_write(&b->acia, ACIA_BASE, (uint8_t)((old & y) ^ x), cpu->cycles);
+        cpu->x = old;
+        break;
+    default:
+        if (a >= 0xA6) {
+            /* Read/write system variable: new = (old AND Y) EOR X */
+            old = b->sysvar[a];
+            b->sysvar[a] = (uint8_t)((old & y) ^ x);
+            cpu->x = old;
+            cpu->y = b->sysvar[(uint8_t)(a + 1)];
+        }
+        break;
+    }
+}
+
+/* ---- OSWORD ------------------------------------------------------- */
+
+static uint32_t centiseconds(beeb *b) {
+    return (uint32_t)(b->cpu.cycles / (CPU_HZ / 100)) + b->clock_base;
+}
+
+static void mos_word(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    uint16_t blk = (uint16_t)(cpu->x | (cpu->y << 8));
+
+    switch (cpu->a) {
+    case 0x00: {                    /* read line */
+        uint16_t buf = (uint16_t)(beeb_read(b, blk) | (beeb_read(b, blk + 1) << 8));
+        uint8_t max = beeb_read(b, blk + 2);
+        uint8_t len = 0;
+        int key;
+
+        for (;;) {
+            key = next_key(b);
+            if (key < 0) {
+                b->status = RUN_NO_INPUT;
+                return;
+            }
+            if (key == '\r') break;
+            if (key == 27) {
+                cpu->p |= FLAG_C;
+                return;
+            }
+            if (len < max) {
+                beeb_write(b, (uint16_t)(buf + len++), (uint8_t)key);
+                mos_wrch(b, (uint8_t)key);
+            }
+        }
+        beeb_write(b, (uint16_t)(buf + len), '\r');
+        mos_wrch(b, '\r');
+        mos_wrch(b, '\n');
+        cpu->y = len;
+        cpu->p &= ~FLAG_C;
+        break;
+    }
+    case 0x01:                      /* read system clock */
+        beeb_write32(b, blk, centiseconds(b));
+        beeb_write(b, blk + 4, 0);
+        break;
+    case 0x02:                      /* write system clock */
+        b->clock_base = beeb_read32(b, blk) - centiseconds(b) + b->clock_base;
+        break;
+    case 0x05:                      /* read I/O processor memory */
+        beeb_write(b, blk + 4, beeb_read(b, (uint16_t)beeb_read32(b, blk)));
+        break;
+    case 0x06:                      /* write I/O processor memory */
+        beeb_write(b, (uint16_t)beeb_read32(b, blk), beeb_read(b, blk + 4));
+        break;
+    case 0x09:                      /* read pixel: off screen */
+        beeb_write(b, blk + 4, 0xFF);
+        break;
+    case 0x7F:                      /* disc controller command */
+        fs_disc_op(b, blk);
+        break;
+    default:
+        /* Sound, envelopes, palette and character definitions are
+         * accepted and ignored. */
+        break;
+    }
+}
+
+/* ---- OSCLI -------------------------------------------------------- */
+
+static int parse_num(const char **s) {
+    int v = 0;
+    while (**s == ' ' || **s == ',') (*s)++;
+    while (isdigit((unsigned char)**s)) v = v * 10 + (*(*s)++ - '0');
+    return v;
+}
+
+static void mos_cli(beeb *b) {
+    cpu6502 *cpu = &b->cpu;
+    uint16_t addr = (uint16_t)(cpu->x | (cpu->y << 8));
+    char cmd[256];
+    const char *p;
+    int slot;
+
+    beeb_read_string(b, addr, cmd, sizeof(cmd));
+    p = cmd;
+    while (*p == ' ' || *p == '*') p++;
+    if (*p == 0 || *p == '|') return;
+
+    if (toupper((unsigned char)p[0]) == 'F' && toupper((unsigned char)p[1]) == 'X') {
+        uint8_t sa = cpu->a, sx = cpu->x, sy = cpu->y;
+        p += 2;
+        cpu->a = (uint8_t)parse_num(&p);
+        cpu->x = (uint8_t)parse_num(&p);
+        cpu->y = (uint8_t)parse_num(&p);
+        mos_byte(b);
+        cpu->a = sa; cpu->x = sx; cpu->y = sy;
+        return;
+    }
+
+    /* Offer the command to the sideways ROMs (service call 4) */
+    b->ram[0xF2] = (uint8_t)addr;
+    b->ram[0xF3] = (uint8_t)(addr >> 8);
+    for (slot = 15; slot >= 0; slot--) {
+        uint8_t prev = b->romsel, prev_f4 = b->ram[0xF4];
+        if (!(b->ram[0x02A1 + slot] & 0x80)) continue;
+        b->romsel = (uint8_t)slot;
+        b->ram[0xF4] = (uint8_t)slot;
+        cpu->a = 4;
+        cpu->x = (uint8_t)slot;
+        cpu->y = (uint8_t)(p - cmd);
+        if (beeb_call(b, 0x8003) < 0) return;
+        b->romsel = prev;
+        b->ram[0xF4] = prev_f4;
+        if (cpu->a == 0) return;
+    }
+
+    if (fs_command(b, p) < 0) {
+        beeb_raise_error(b, 0xFE, "Bad command");
+    }
+}
+
+/* ---- Trap dispatch ------------------------------------------------ */
+
+void mos_trap(beeb *b, uint8_t id) {
+    cpu6502 *cpu = &b->cpu;
+
+    if (id < TRAP_VECTORS) b->calls[id]++;
+
+    switch (id) {
+    case TRAP_EXIT:
+        b->exit_code = (uint16_t)(cpu->a | (cpu->x << 8));
+        b->status = RUN_EXIT;
+        return;
+
+    case TRAP_BRKV: {
+        /* Uncaught error: &FD/&FE point at the error number */
+        uint16_t p = (uint16_t)(b->ram[0xFD] | (b->ram[0xFE] << 8));
+        b->brk_num = beeb_read(b, p);
+        b->brk_addr = (uint16_t)(p - 1);
+        beeb_read_string(b, (uint16_t)(p + 1), b->brk_msg, sizeof(b->brk_msg));
+        b->status = RUN_BRK;
+        return;
+    }
+
+    case TRAP_IRQ1V:
+    case TRAP_IRQ2V:
+        /* The ACIA is the only interrupt source modelled: service it
+         * for the RS423 buffers, then restore A and return */
+        if (id == TRAP_IRQ1V) rs423_irq(b);
+        cpu->a = b->ram[0xFC];
+        cpu->p = (cpu_pull(cpu) & ~FLAG_B) | FLAG_U;
+        cpu->pc = cpu_pull(cpu);
+        cpu->pc |= (uint16_t)(cpu_pull(cpu) << 8);
+        return;
+
+    case TRAP_CLIV:  mos_cli(b);      break;
+    case TRAP_BYTEV: mos_byte(b);     break;
+    case TRAP_WORDV: mos_word(b);     break;
+    case TRAP_WRCHV:
+        /* RS423 output waits for room in its buffer, and pays for the
+         * insert as OSBYTE 138 does */
+        if (b->out_streams & 0x01) {
+            if (b->rs423_out.len >= b->rs423_out.size) {
+                mos_wait(b, id);
+                return;
+            }
+            cpu->cycles += b->cost[COST_RS423_BUFFER];
+        }
+        mos_wrch(b, cpu->a);
+        break;
+    case TRAP_RDCHV: mos_rdch(b);     break;
+    case TRAP_FILEV: fs_osfile(b);    break;
+    case TRAP_ARGSV: fs_osargs(b);    break;
+    case TRAP_BGETV: fs_osbget(b);    break;
+    case TRAP_BPUTV: fs_osbput(b);    break;
+    case TRAP_GBPBV: fs_osgbpb(b);    break;
+    case TRAP_FINDV: fs_osfind(b);    break;
+    case TRAP_FSCV:  fs_fsc(b);       break;
+    default:
+        break;
+    }
+
+    /* Handlers that raised an error have already redirected PC */
+    if (b->status == RUN_ACTIVE && (cpu->pc & 0xFF00) == TRAP_PAGE) {
+        cpu_rts(cpu);
+    }
+}
@@ -0,0 +1,254 @@
+#!/bin/bash
+
+# clibords.sh - ordinal import table for the clib ROM
+# Usage: ./clibords.sh [-f clib.ord] -u [-l clib.lbl]     append new ROM exports
+#        ./clibords.sh [-f clib.ord] -n                   list ordinal names
+#        ./clibords.sh [-f clib.ord] -c <source.s>...      check exports numbered
+#        ./clibords.sh [-f clib.ord] -t [-o out.s]        ROM dispatch table
+#        ./clibords.sh [-f clib.ord] [-o out.s] [-i sym] <function>...  app stubs
+#
+# Applications call the clib ROM through a single entry point with the
+# function ordinal in Y (lib/clib_tramp.s, clib_ord_call). Each app stub is
+# five bytes, "ldy #ordinal : jmp clib_ord_call", and is generated one
+# function per file so an application links only the ordinals it uses.
+# The ROM side is lib/rom/clib_dispatch.s plus the table from -t.
+#
+# Variadic functions are flagged "v" in clib.ord. cc65 passes the argument
+# byte count of a variadic call in Y, so their stubs move it to A first
+# ("tya : ldy #ordinal : jmp clib_ord_call") and the ROM table routes them
+# through a shim that moves it back.
+#
+# -i makes the stubs import a symbol as well, so that linking any of them
+# links the module that exports it (lib/clib_flush.s, for the stream
+# functions).
+#
+# -c fails if a C function exported by the given ROM sources has no
+# ordinal, since a program calling it would otherwise link the stock
+# bbc-clib address stub, which points into a different ROM.
+
+set -e
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+
+ORD_FILE="${SCRIPT_DIR}/../lib/clib.ord"
+LABELS="${SCRIPT_DIR}/../roms/clib.lbl"
+OUTPUT=""
+IMPORTS=""
+MODE=stubs
+
+while getopts "f:l:o:i:uncth" opt; do
+  case $opt in
+    f) ORD_FILE="$OPTARG" ;;
+    l) LABELS="$OPTARG" ;;
+    o) OUTPUT="$OPTARG" ;;
+    i) IMPORTS="$IMPORTS $OPTARG" ;;
+    u) MODE=update ;;
+    n) MODE=names ;;
+    c) MODE=check ;;
+    t) MODE=table ;;
+    h|*)
+      echo "Usage: $0 [-f clib.ord] -u [-l clib.lbl]"
+      echo "       $0 [-f clib.ord] -n"
+      echo "       $0 [-f clib.ord] -c <source.s>..."
+      echo "       $0 [-f clib.ord] -t [-o out.s]"
+      echo "       $0 [-f clib.ord] [-o out.s] [-i sym] <function>..."
+      exit 0
+      ;;
+  esac
+done
+shift $((OPTIND-1))
+
+if [ ! -f "$ORD_FILE" ]; then
+  echo "Error: $ORD_FILE not found" >&2
+  exit 1
+fi
+
+# cc65 library functions with a variable argument list
+VARIADIC="printf fprintf sprintf snprintf scanf fscanf sscanf cprintf cscanf open"
+
+# C-visible data the ROM exports, which is reached by address, not called
+DATA="stdin stdout stderr"
+
+# "<ordinal> <flags>" for a function, empty if it is not numbered
+ordinal_of() {
+  awk -v fn="$1" '!/^#/ && NF >= 2 && $2 == fn { print $1, $3; exit }' "$ORD_FILE"
+}
+
+update_ordinals() {
+  if [ ! -f "$LABELS" ]; then
+    echo "Error: $LABELS not found, build the ROM first (./build.sh -r)" >&2
+    return 1
+  fi
+  # C functions exported by the ROM, "al 00A1B2 ._strlen", minus runtime
+  # internals (two leading underscores) and those already numbered
+  local added
+  added=$(awk -v variadic="$VARIADIC" -v data="$DATA" '
+    BEGIN {
+      n = split(variadic, v, " "); for (i = 1; i <= n; i++) isvar[v[i]] = 1
+      n = split(data, v, " "); for (i = 1; i <= n; i++) have[v[i]] = 1
+    }
+    FILENAME == ARGV[1] { if (!/^#/ && NF >= 2) { have[$2] = 1; next_ord = $1 + 1 } next }
+    $1 == "al" && $3 ~ /^\._[A-Za-z]/ {
+      name = substr($3, 3)
+      if (name ~ /[@.]/ || name in have) next
+      have[name] = 1
+      printf "%d %s%s\n", next_ord++, name, (name in isvar) ? " v" : ""
+    }
+  ' "$ORD_FILE" "$LABELS")
+  if [ -n "$added" ]; then
+    # Nothing is written unless every new ordinal fits in Y
+    if ! echo "$added" | awk '$1 > 255 { print "Error: ordinal " $1 " (" $2 ") does not fit in Y" > "/dev/stderr"; bad = 1 } END { exit bad }'; then
+      return 1
+    fi
+    echo "$added" >> "$ORD_FILE"
+    echo "Added $(echo "$added" | wc -l | tr -d ' ') ordinals to $ORD_FILE" >&2
+  fi
+}
+
+check_exports() {
+  if [ $# -eq 0 ]; then
+    echo "Error: no sources given" >&2
+    return 1
+  fi
+  # ".export _strtol, _strtoul" lines, minus runtime internals (two
+  # leading underscores), data and those already numbered
+  awk -v data="$DATA" '
+    BEGIN { n = split(data, v, " "); for (i = 1; i <= n; i++) have[v[i]] = 1 }
+    FILENAME == ARGV[1] { if (!/^#/ && NF >= 2) have[$2] = 1; next }
+    $1 == ".export" {
+      sub(/;.*/, ""); sub(/^[ \t]*\.export[ \t]+/, "")
+      n = split($0, sym, /[ \t]*,[ \t]*/)
+      for (i = 1; i <= n; i++) {
+        gsub(/[ \t]/, "", sym[i])
+        if (sym[i] !~ /^_[A-Za-z]/) continue
+        name = substr(sym[i], 2)
+        if (name in have) continue
+        print "Error: " name " (" FILENAME ") has no ordinal in " ARGV[1] > "/dev/stderr"
+        bad = 1
+      }
+    }
+    END { exit bad }
+  ' "$ORD_FILE" "$@"
+}
+
+# "<ordinal> <name> [v]" lines in ordinal order, after checking that they
+# run from 0 with no gap or repeat, since the table is indexed by ordinal
+sorted_ordinals() {
+  awk '!/^#/ && NF >= 2' "$ORD_FILE" | sort -n -k1,1 | awk '
+    $1 != NR - 1 {
+      if ($1 < NR - 1) print "Error: ordinal " $1 " (" $2 ") is used twice" > "/dev/stderr"
+      else print "Error: no function has ordinal " NR - 1 > "/dev/stderr"
+      bad = 1; exit
+    }
+    $1 > 255 { print "Error: ordinal " $1 " (" $2 ") does not fit in Y" > "/dev/stderr"; bad = 1; exit }
+    { print }
+    END { exit bad }'
+}
+
+generate_table() {
+  local sorted
+  sorted=$(sorted_ordinals) || return 1
+  local names=($(echo "$sorted" | awk '{ print $2 }'))
+  local varargs=($(echo "$sorted" | awk '$3 == "v" { print $2 }'))
+  local fn entry
+
+  echo "; clib_ordtab.s - clib ROM dispatch table, indexed by ordinal"
+  echo "; Generated by tools/clibords.sh from $(basename "$ORD_FILE"), do not edit."
+  echo
+  echo "        .export clib_ord_lo, clib_ord_hi, clib_ord_count"
+  for fn in "${names[@]}"; do
+    echo "        .import _$fn"
+  done
+  echo
+  echo "clib_ord_count = ${#names[@]}"
+  echo
+  echo "        .rodata"
+  echo
+  echo "; RTS dispatch: each entry is the routine address - 1"
+  echo "clib_ord_lo:"
+  for fn in "${names[@]}"; do
+    entry="_$fn"
+    [[ " ${varargs[*]} " == *" $fn "* ]] && entry="ord_$fn"
+    echo "        .lobytes $entry-1"
+  done
+  echo "clib_ord_hi:"
+  for fn in "${names[@]}"; do
+    entry="_$fn"
+    [[ " ${varargs[*]} " == *" $fn "* ]] && entry="ord_$fn"
+    echo "        .hibytes $entry-1"
+  done
+  if [ ${#varargs[@]} -gt 0 ]; then
+    echo
+    echo "        .code"
+    echo
+    echo "; Variadic entries: the stub passed the argument byte count in A"
+    for fn in "${varargs[@]}"; do
+      echo "ord_$fn:"
+      echo "        tay"
+      echo "        jmp     _$fn"
+    done
+  fi
+}
+
+generate_stubs() {
+  local fn ord sym
+
+  if [ $# -eq 0 ]; then
+    echo "Error: no functions given" >&2
+    return 1
+  fi
+  echo "; Ordinal clib ROM call stubs: $*"
+  echo "; Generated by tools/clibords.sh from $(basename "$ORD_FILE"), do not edit."
+  echo
+  for fn in "$@"; do
+    echo "        .export _$fn"
+  done
+  echo "        .import clib_ord_call"
+  for sym in $IMPORTS; do
+    echo "        .import $sym"
+  done
+  echo
+  echo "        .code"
+  for fn in "$@"; do
+    read -r ord flags <<< "$(ordinal_of "$fn")"
+    if [ -z "$ord" ]; then
+      echo "Error: $fn has no ordinal in $ORD_FILE" >&2
+      return 1
+    fi
+    echo
+    echo "_$fn:"
+    if [ "$flags" = "v" ]; then
+      echo "        tya                     ; argument byte count"
+    fi
+    echo "        ldy     #$ord"
+    echo "        jmp     clib_ord_call"
+  done
+}
+
+case $MODE in
+  update)
+    update_ordinals
+    exit $?
+    ;;
+  names)
+    awk '!/^#/ && NF >= 2 { print $2 }' "$ORD_FILE"
+    exit 0
+    ;;
+  check)
+    check_exports "$@"
+    exit $?
+    ;;
+  table) generate=generate_table ;;
+  stubs) generate=generate_stubs ;;
+esac
+
+if [ -n "$OUTPUT" ]; then
+  mkdir -p "$(dirname "$OUTPUT")"
+  if ! $generate "$@" > "$OUTPUT.tmp"; then
+    rm -f "$OUTPUT.tmp"
+    exit 1
+  fi
+  mv "$OUTPUT.tmp" "$OUTPUT"
+else
+  $generate "$@"
+fi
@@ -0,0 +1,123 @@
+#!/bin/bash
+
+# clibstubs.sh - generate fast-path ROM call stubs from the clib ROM labels
+# Usage: ./clibstubs.sh [-l clib.lbl] [-o out.s] [-R] <function>...
+#        ./clibstubs.sh -T [-r clib.rom] [-o out.s]
+# Example: ./clibstubs.sh -o build/lib/fast/strlen.s strlen
+#
+# Each stub jumps straight into the ROM when the clib ROM is already the
+# paged bank, and otherwise calls clib_far_call in lib/clib_tramp.s, which
+# pages the ROM in around the call. Generate one function per file so the
+# linker only pulls in the stubs an application uses.
+#
+# -R takes cc65 runtime helpers such as tosmulax instead of C functions:
+# their symbols have no leading underscore. Only helpers that take their
+# arguments in A/X and on the C stack can be stubbed, because the far
+# path uses ptr1.
+#
+# -T writes the module holding the ROM title instead, which the trampoline
+# uses to find the clib bank at startup.
+#
+# Only functions with a fixed argument list can have a fast stub: cc65
+# passes the argument byte count of variadic calls in Y.
+
+set -e
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+
+LABELS="${SCRIPT_DIR}/../roms/clib.lbl"
+ROM="${SCRIPT_DIR}/../roms/clib.rom"
+OUTPUT=""
+TITLE_ONLY=0
+PREFIX="_"
+
+while getopts "l:r:o:RTh" opt; do
+  case $opt in
+    l) LABELS="$OPTARG" ;;
+    r) ROM="$OPTARG" ;;
+    o) OUTPUT="$OPTARG" ;;
+    R) PREFIX="" ;;
+    T) TITLE_ONLY=1 ;;
+    h|*)
+      echo "Usage: $0 [-l clib.lbl] [-o out.s] [-R] <function>..."
+      echo "       $0 -T [-r clib.rom] [-o out.s]"
+      exit 0
+      ;;
+  esac
+done
+shift $((OPTIND-1))
+
+generate_title() {
+  if [ ! -f "$ROM" ]; then
+    echo "Error: $ROM not found, build the ROM first (./build.sh -r)" >&2
+    return 1
+  fi
+
+  # ROM title: from offset 9 of the header up to the terminating zero
+  local title=$(dd if="$ROM" bs=1 skip=9 count=64 2>/dev/null | tr '\0' '\n' | head -n 1)
+
+  echo "; clib_title.s - title of the clib ROM the fast-path stubs call"
+  echo "; Generated by tools/clibstubs.sh from $(basename "$ROM"), do not edit."
+  echo
+  echo "        .export clib_rom_title"
+  echo
+  echo "        .rodata"
+  echo
+  echo "clib_rom_title:"
+  echo "        .byte   \"$title\",0"
+}
+
+generate_stubs() {
+  if [ $# -eq 0 ]; then
+    echo "Error: no functions given" >&2
+    return 1
+  fi
+  if [ ! -f "$LABELS" ]; then
+    echo "Error: $LABELS not found, build the ROM first (./build.sh -r)" >&2
+    return 1
+  fi
+
+  local fn addr
+  echo "; Fast-path clib ROM call stubs: $*"
+  echo "; Generated by tools/clibstubs.sh from $(basename "$LABELS"), do not edit."
+  echo
+  for fn in "$@"; do
+    echo "        .export $PREFIX$fn"
+  done
+  echo "        .import clib_far_call, _clib_slot"
+  echo
+  echo "        .code"
+  for fn in "$@"; do
+    # VICE label format from ld65 -Ln: "al 00A1B2 ._strlen"
+    addr=$(awk -v sym=".$PREFIX$fn" '$1 == "al" && $3 == sym { print substr($2, 3); exit }' "$LABELS")
+    if [ -z "$addr" ]; then
+      echo "Error: $PREFIX$fn is not exported by the ROM ($LABELS)" >&2
+      return 1
+    fi
+    echo
+    echo "$PREFIX$fn:"
+    echo "        ldy     \$F4             ; MOS ROMSEL copy"
+    echo "        cpy     _clib_slot"
+    echo "        bne     @far"
+    echo "        jmp     \$$addr"
+    echo "@far:   jsr     clib_far_call"
+    echo "        .addr   \$$addr"
+  done
+}
+
+if [ "$TITLE_ONLY" = 1 ]; then
+  generate=generate_title
+else
+  generate=generate_stubs
+fi
+
+if [ -n "$OUTPUT" ]; then
+  mkdir -p "$(dirname "$OUTPUT")"
+  if ! $generate "$@" > "$OUTPUT.tmp"; then
+    rm -f "$OUTPUT.tmp"
+    exit 1
+  fi
+  mv "$OUTPUT.tmp" "$OUTPUT"
+else
+  $generate "$@"
+fi
@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# pgosplit.sh - choose which clib functions an application links locally
+# Usage: ./pgosplit.sh -p profile.txt -l test.lbl -o <dir> [options]
+# Example: ./pgosplit.sh -p build/test/profile.txt -l build/test/test.lbl -o build/test/pgo
+#
+# Reads a beebrun JSR profile (beebrun -p) of a bbc-clib application and
+# looks up each called stub in the application's labels. A function that
+# is called at least -n times and is no bigger than -s bytes in the ROM is
+# extracted from the static bbc library into <dir>. Linking <dir>/*.o
+# ahead of the target library replaces the ROM stub for just those
+# functions; everything else stays in the ROM.
+#
+# <dir>/split.txt records the decision for every ROM function called.
+
+set -e
+
+SCRIPT_DIR=$( cd -- "$( dirname -- "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )
+
+PROFILE=""
+APP_LABELS=""
+ROM_LABELS="${SCRIPT_DIR}/../roms/clib.lbl"
+STATIC_LIB="${CC65_HOME:-${SCRIPT_DIR}/../../cc65}/lib/bbc.lib"
+OUT_DIR=""
+MIN_CALLS=16
+MAX_BYTES=64
+
+usage() {
+  echo "Usage: $0 -p <profile> -l <app.lbl> -o <dir> [options]"
+  echo ""
+  echo "Options:"
+  echo "  -p <profile>   beebrun JSR profile of a run of the application"
+  echo "  -l <app.lbl>   Labels of the profiled executable (cl65 -Ln)"
+  echo "  -o <dir>       Output directory for the local objects and split.txt"
+  echo "  -r <clib.lbl>  ROM labels (default: roms/clib.lbl)"
+  echo "  -L <lib>       Static library to take local copies from (default: cc65 lib/bbc.lib)"
+  echo "  -n <calls>     Minimum calls for a function to go local (default: $MIN_CALLS)"
+  echo "  -s <bytes>     Maximum ROM size of a function that goes local (default: $MAX_BYTES)"
+  echo "  -h             Show this help message"
+  exit 0
+}
+
+while getopts "p:l:o:r:L:n:s:h" opt; do
+  case $opt in
+    p) PROFILE="$OPTARG" ;;
+    l) APP_LABELS="$OPTARG" ;;
+    o) OUT_DIR="$OPTARG" ;;
+    r) ROM_LABELS="$OPTARG" ;;
+    L) STATIC_LIB="$OPTARG" ;;
+    n) MIN_CALLS="$OPTARG" ;;
+    s) MAX_BYTES="$OPTARG" ;;
+    h|*) usage ;;
+  esac
+done
+
+if [ -z "$PROFILE" ] || [ -z "$APP_LABELS" ] || [ -z "$OUT_DIR" ]; then
+  usage
+fi
+for f in "$PROFILE" "$APP_LABELS" "$ROM_LABELS" "$STATIC_LIB"; do
+  if [ ! -f "$f" ]; then
+    echo "Error: $f not found" >&2
+    exit 1
+  fi
+done
+
+rm -rf "$OUT_DIR"
+mkdir -p "$OUT_DIR"
+STATIC_LIB=$(realpath "$STATIC_LIB")
+
+# name calls rom_bytes, for every C function in the ROM that the app called
+awk -v min="$MIN_CALLS" -v max="$MAX_BYTES" '
+  function hex(s,    i, v) {
+    v = 0
+    s = toupper(s)
+    for (i = 1; i <= length(s); i++) v = v * 16 + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+    return v
+  }
+  # Pass 1: ROM labels, sizes from the distance to the next C symbol
+  FILENAME == ARGV[1] {
+    if ($1 == "al" && substr($3, 1, 2) == "._") {
+      rom[substr($3, 2)] = hex($2)
+      addrs[++n] = hex($2)
+    }
+    next
+  }
+  # Pass 2: application labels by address
+  FILENAME == ARGV[2] {
+    if ($1 == "al" && substr($3, 1, 2) == "._") app[hex($2)] = substr($3, 2)
+    next
+  }
+  # Pass 3: profile lines "&XXXX bank calls", most called first
+  /^&/ && $2 == "-" {
+    name = app[hex(substr($1, 2))]
+    if (name == "" || !(name in rom)) next
+    size = 0
+    for (i = 1; i <= n; i++) {
+      if (addrs[i] > rom[name] && (size == 0 || addrs[i] - rom[name] < size)) size = addrs[i] - rom[name]
+    }
+    local = ($3 >= min && size > 0 && size <= max) ? "local" : "rom"
+    printf "%-12s %8d %6d %s\n", substr(name, 2), $3, size, local
+  }
+' "$ROM_LABELS" "$APP_LABELS" "$PROFILE" > "$OUT_DIR/split.tmp"
+
+modules=$(ar65 t "$STATIC_LIB")
+
+{
+  echo "# function calls rom_bytes placement (min $MIN_CALLS calls, max $MAX_BYTES bytes)"
+  while read -r fn calls size placement; do
+    if [ "$placement" = "local" ]; then
+      if echo "$modules" | grep -qxF -e "$fn.o" -e "$fn"; then
+        (cd "$OUT_DIR" && ar65 x "$STATIC_LIB" "$fn.o")
+      else
+        echo "Warning: no module $fn.o in $(basename "$STATIC_LIB"), keeping $fn in ROM" >&2
+        placement="rom"
+      fi
+    fi
+    printf "%-12s %8s %6s %s\n" "$fn" "$calls" "$size" "$placement"
+  done < "$OUT_DIR/split.tmp"
+} > "$OUT_DIR/split.txt"
+rm -f "$OUT_DIR/split.tmp"
+
+cat "$OUT_DIR/split.txt"